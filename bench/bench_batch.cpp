@@ -0,0 +1,157 @@
+#include "rs_batch_renderer.h"
+#include "rs_bench_gl.h"
+#include "rs_frame_constants.h"
+#include "rs_gl.h"
+#include "shader.hpp"
+#include <chrono>
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+// CPU submit time per frame for N objects drawn one glDrawElements at a
+// time, through instanced draws per mesh and through a single
+// glMultiDrawElementsIndirect. Runs on a hidden window, software GL
+// (LIBGL_ALWAYS_SOFTWARE=1, llvmpipe) is fine since only the CPU side is
+// of interest. The viewport is tiny to keep rasterisation out of the way.
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+namespace {
+const u_int MESHES = 16;
+const u_int OBJECT_COUNTS[] = {1000, 10000, 50000, 100000};
+const int FRAMES = 10;
+
+void buildCube(std::vector<RS::Vertex> &vertices,
+               std::vector<u_int32_t> &indices) {
+  for (int i = 0; i < 8; i++) {
+    RS::Vertex vertex;
+    vertex.position = glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f,
+                                i & 4 ? 0.5f : -0.5f);
+    vertex.texCoord = glm::vec2(i & 1 ? 1.0f : 0.0f, i & 2 ? 1.0f : 0.0f);
+    vertices.push_back(vertex);
+  };
+  const u_int32_t CUBE_INDICES[] = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5,
+                                    0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6,
+                                    0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+  indices.assign(CUBE_INDICES, CUBE_INDICES + 36);
+};
+
+double timeFrames(void (*frame)(void *), void *data) {
+  double best = 0.0;
+  for (int i = 0; i < FRAMES; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    frame(data);
+    auto end = std::chrono::high_resolution_clock::now();
+    glFinish(); // Not part of the CPU submit time
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    if (i == 0 || ms < best) {
+      best = ms;
+    }
+  };
+  return best;
+};
+
+struct Scene {
+  RS::BatchRenderer *batch;
+  Shader *legacyShader;
+  Shader *instancedShader;
+  std::vector<glm::mat4> models;
+  std::vector<RS::MeshHandle> meshes;
+  UniformHandle modelUniform;
+};
+
+void legacyFrame(void *data) {
+  Scene *scene = static_cast<Scene *>(data);
+  scene->legacyShader->use();
+  glBindVertexArray(scene->batch->getVertexArray());
+  for (size_t i = 0; i < scene->models.size(); i++) {
+    scene->legacyShader->setMat4(scene->modelUniform, scene->models[i]);
+    // All meshes are cubes stored back to back: 36 indices, 8 vertices
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES, 36, GL_UNSIGNED_INT,
+        (void *)(sizeof(u_int32_t) * 36 * scene->meshes[i]),
+        (GLint)(8 * scene->meshes[i]));
+  };
+  glBindVertexArray(0);
+};
+
+void batchFrame(void *data) {
+  Scene *scene = static_cast<Scene *>(data);
+  scene->instancedShader->use();
+  for (size_t i = 0; i < scene->models.size(); i++) {
+    scene->batch->submit(scene->meshes[i], scene->models[i]);
+  };
+  scene->batch->flush();
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  RS::Bench::GLContext context;
+  if (!RS::Bench::createGLContext(context)) {
+    return 1;
+  };
+  std::printf("GL_RENDERER: %s\n", (const char *)glGetString(GL_RENDERER));
+  glViewport(0, 0, 8, 8);
+
+  RS::FrameConstantsBuffer frameConstants;
+  frameConstants.init();
+  RS::FrameConstants constants;
+  constants.view = glm::mat4(1.0f);
+  constants.projection = glm::mat4(1.0f);
+  frameConstants.upload(constants);
+
+  RS::BatchRenderer batch;
+  batch.init(MESHES * 8, MESHES * 36, 100000);
+
+  std::vector<RS::Vertex> vertices;
+  std::vector<u_int32_t> indices;
+  buildCube(vertices, indices);
+  for (u_int i = 0; i < MESHES; i++) {
+    batch.addMesh(vertices.data(), (u_int)vertices.size(), indices.data(),
+                  (u_int)indices.size());
+  };
+
+  Shader legacyShader(REDSTAR_SHADER_DIR "/vert/main.vert",
+                      REDSTAR_SHADER_DIR "/frag/main.frag");
+  legacyShader.use();
+  legacyShader.setMat4("transform", glm::mat4(1.0f));
+  Shader instancedShader(REDSTAR_SHADER_DIR "/vert/instanced.vert",
+                         REDSTAR_SHADER_DIR "/frag/main.frag");
+
+  Scene scene;
+  scene.batch = &batch;
+  scene.legacyShader = &legacyShader;
+  scene.instancedShader = &instancedShader;
+  scene.modelUniform = legacyShader.getUniform("model");
+
+  std::printf("%-10s %14s %14s %14s %10s\n", "objects", "per-draw ms",
+              "instanced ms", "MDI ms", "MDI calls");
+  for (u_int count : OBJECT_COUNTS) {
+    scene.models.resize(count);
+    scene.meshes.resize(count);
+    for (u_int i = 0; i < count; i++) {
+      scene.models[i] = glm::translate(
+          glm::mat4(1.0f), glm::vec3((float)(i % 100), (float)(i / 100), 0));
+      scene.meshes[i] = i % MESHES;
+    };
+
+    double legacy = timeFrames(legacyFrame, &scene);
+
+    batch.setMultiDrawIndirect(false);
+    double instanced = timeFrames(batchFrame, &scene);
+
+    batch.setMultiDrawIndirect(true);
+    double multiDraw = timeFrames(batchFrame, &scene);
+
+    std::printf("%-10u %14.3f %14.3f %14.3f %10u\n", count, legacy, instanced,
+                batch.usesMultiDrawIndirect() ? multiDraw : 0.0,
+                batch.getStats().drawCalls);
+  };
+
+  glDeleteProgram(legacyShader.ID);
+  glDeleteProgram(instancedShader.ID);
+  RS::Bench::destroyGLContext(context);
+  return 0;
+};
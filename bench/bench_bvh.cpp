@@ -0,0 +1,145 @@
+#include "rs_bench.h"
+#include "rs_bvh.h"
+#include "rs_culling.h"
+#include <cstddef>
+#include <cstdio>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+// Build, update and query cost of DynamicBVH at 10k to 1M objects
+// scattered through a 1000 unit cube. Brute force scans over the same
+// bounds are timed for comparison.
+
+namespace {
+const size_t COUNTS[] = {10000, 100000, 1000000};
+const size_t QUERIES = 10000;
+const size_t BRUTE_QUERIES = 20;
+const int REPETITIONS = 3;
+const float WORLD = 500.0f;
+
+void benchmarkCount(size_t count) {
+  std::printf("-- %zu objects\n", count);
+  std::mt19937 random(11);
+  std::uniform_real_distribution<float> position(-WORLD, WORLD);
+  std::uniform_real_distribution<float> size(0.5f, 2.0f);
+  std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+
+  std::vector<RS::AABB> bounds(count);
+  for (RS::AABB &box : bounds) {
+    box = RS::AABB::fromCenterExtents(
+        glm::vec3(position(random), position(random), position(random)),
+        glm::vec3(size(random), size(random), size(random)));
+  };
+  std::vector<glm::vec3> points(QUERIES);
+  std::vector<glm::vec3> directions(QUERIES);
+  for (size_t i = 0; i < QUERIES; i++) {
+    points[i] = glm::vec3(position(random), position(random), position(random));
+    directions[i] = glm::normalize(
+        glm::vec3(step(random), step(random), step(random)) + glm::vec3(0.01f));
+  };
+
+  RS::DynamicBVH bvh;
+  std::vector<RS::BVHProxy> proxies(count);
+  RS::Bench::run("insert (incremental build)", count, 1, [&]() {
+    bvh.clear();
+    for (size_t i = 0; i < count; i++) {
+      proxies[i] = bvh.createProxy(bounds[i], (u_int32_t)i);
+    };
+  });
+  RS::BVHStats stats = bvh.getStats();
+  std::printf("%44s height %u, SAH cost %.1f\n", "", stats.height,
+              stats.sahCost);
+
+  RS::Bench::run("rebuild (binned SAH)", count, REPETITIONS,
+                 [&]() { bvh.rebuild(); });
+  stats = bvh.getStats();
+  std::printf("%44s height %u, SAH cost %.1f\n", "", stats.height,
+              stats.sahCost);
+
+  // 10% of the objects move a little each frame
+  const size_t moving = count / 10;
+  std::vector<glm::vec3> steps(moving);
+  for (glm::vec3 &delta : steps) {
+    delta = glm::vec3(step(random), step(random), step(random));
+  };
+  RS::Bench::run("moveProxy, 10% moving", moving, REPETITIONS, [&]() {
+    for (size_t i = 0; i < moving; i++) {
+      RS::AABB &box = bounds[i * 10];
+      box.min += steps[i];
+      box.max += steps[i];
+      bvh.moveProxy(proxies[i * 10], box, steps[i]);
+    };
+  });
+  RS::Bench::run("refitProxy, 10% moving", moving, REPETITIONS, [&]() {
+    for (size_t i = 0; i < moving; i++) {
+      RS::AABB &box = bounds[i * 10];
+      box.min += steps[i];
+      box.max += steps[i];
+      bvh.refitProxy(proxies[i * 10], box);
+    };
+  });
+  bvh.rebuild();
+
+  std::vector<u_int32_t> results;
+  results.reserve(count);
+  const glm::vec3 queryExtents(10.0f);
+  RS::Bench::run("queryAABB, 20 unit box", QUERIES, REPETITIONS, [&]() {
+    results.clear();
+    for (const glm::vec3 &point : points) {
+      bvh.queryAABB(RS::AABB::fromCenterExtents(point, queryExtents), results);
+    };
+    RS::Bench::doNotOptimize(results.size());
+  });
+  RS::Bench::run("brute force AABB", BRUTE_QUERIES, 1, [&]() {
+    results.clear();
+    for (size_t q = 0; q < BRUTE_QUERIES; q++) {
+      RS::AABB query = RS::AABB::fromCenterExtents(points[q], queryExtents);
+      for (size_t i = 0; i < count; i++) {
+        if (bvh.getFatBounds(proxies[i]).overlaps(query)) {
+          results.push_back((u_int32_t)i);
+        }
+      };
+    };
+    RS::Bench::doNotOptimize(results.size());
+  });
+
+  RS::RayHit hit;
+  size_t hits = 0;
+  RS::Bench::run("raycast, 200 units", QUERIES, REPETITIONS, [&]() {
+    hits = 0;
+    for (size_t i = 0; i < QUERIES; i++) {
+      hits += bvh.raycast(points[i], directions[i], 200.0f, hit) ? 1 : 0;
+    };
+    RS::Bench::doNotOptimize(hits);
+  });
+
+  RS::Bench::run("queryNearest, k = 8", QUERIES, REPETITIONS, [&]() {
+    results.clear();
+    for (const glm::vec3 &point : points) {
+      bvh.queryNearest(point, 8, results);
+    };
+    RS::Bench::doNotOptimize(results.size());
+  });
+
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, -1.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 projection =
+      glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+  RS::Frustum frustum = RS::Frustum::fromMatrix(projection * view);
+  RS::Bench::run("queryFrustum (per object)", count, REPETITIONS, [&]() {
+    results.clear();
+    bvh.queryFrustum(frustum, results);
+    RS::Bench::doNotOptimize(results.size());
+  });
+  std::printf("%44s %zu visible\n", "", results.size());
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  for (size_t count : COUNTS) {
+    benchmarkCount(count);
+  };
+  return 0;
+};
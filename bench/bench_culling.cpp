@@ -0,0 +1,110 @@
+#include "rs_bench.h"
+#include "rs_culling.h"
+#include <cstddef>
+#include <cstdio>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+// Frustum culling of OBJECTS bounds per frame: straightforward glm code over
+// an array of structs against the SoA scalar, SSE and AVX2 paths of
+// rs_culling. Objects are scattered through a cube around the camera so
+// roughly a sixth of them survive.
+
+namespace {
+const size_t OBJECTS = 1000000;
+const int REPETITIONS = 20;
+
+struct ObjectBounds {
+  glm::vec3 center;
+  glm::vec3 extents;
+  float radius;
+};
+
+// What culling looks like without the SoA layout or intrinsics
+size_t cullGlm(const RS::Frustum &frustum,
+               const std::vector<ObjectBounds> &objects, u_int32_t *visible,
+               bool boxes) {
+  size_t count = 0;
+  for (size_t i = 0; i < objects.size(); i++) {
+    const ObjectBounds &object = objects[i];
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; p++) {
+      glm::vec3 normal = glm::vec3(frustum.planes[p]);
+      float distance = glm::dot(normal, object.center) + frustum.planes[p].w;
+      float reach =
+          boxes ? glm::dot(glm::abs(normal), object.extents) : object.radius;
+      inside = distance >= -reach;
+    }
+    if (inside) {
+      visible[count++] = (u_int32_t)i;
+    }
+  };
+  return count;
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+  std::vector<ObjectBounds> objects(OBJECTS);
+  RS::CullBounds bounds;
+  bounds.reserve(OBJECTS);
+  for (ObjectBounds &object : objects) {
+    object.center = glm::vec3(position(random), position(random),
+                              position(random));
+    object.extents = glm::vec3(size(random), size(random), size(random));
+    object.radius = glm::length(object.extents);
+    bounds.push(object.center, object.extents);
+  };
+
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.1f, -1.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 projection =
+      glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+  RS::Frustum frustum = RS::Frustum::fromMatrix(projection * view);
+
+  std::vector<u_int32_t> visible(OBJECTS);
+  std::printf("best backend on this CPU: %s\n",
+              RS::getCullBackendName(RS::CULL_AUTO));
+
+  const RS::CullBackend backends[] = {RS::CULL_SCALAR, RS::CULL_SSE,
+                                      RS::CULL_AVX2};
+  for (int boxes = 0; boxes < 2; boxes++) {
+    std::printf("-- %s, %zu objects\n", boxes ? "AABBs" : "spheres", OBJECTS);
+
+    size_t expected = 0;
+    double baseline = RS::Bench::run("glm, array of structs", OBJECTS,
+                                     REPETITIONS, [&]() {
+                                       expected = cullGlm(frustum, objects,
+                                                          visible.data(),
+                                                          boxes != 0);
+                                       RS::Bench::doNotOptimize(expected);
+                                     });
+
+    for (RS::CullBackend backend : backends) {
+      if (backend > RS::getBestCullBackend()) {
+        continue; // Not supported by this CPU
+      }
+      size_t count = 0;
+      std::string name =
+          std::string("rs_culling ") + RS::getCullBackendName(backend);
+      double perItem =
+          RS::Bench::run(name.c_str(), OBJECTS, REPETITIONS, [&]() {
+            count = boxes ? RS::cullBoxes(frustum, bounds, visible.data(),
+                                          backend)
+                          : RS::cullSpheres(frustum, bounds, visible.data(),
+                                            backend);
+            RS::Bench::doNotOptimize(count);
+          });
+      std::printf("%44s %zu visible, %.2fx over glm%s\n", "", count,
+                  perItem > 0.0 ? baseline / perItem : 0.0,
+                  count == expected ? "" : " (MISMATCH)");
+    };
+  };
+  return 0;
+};
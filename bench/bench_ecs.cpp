@@ -0,0 +1,95 @@
+#include "classes/entity.hpp"
+#include "rs_bench.h"
+#include "rs_components.h"
+#include "rs_registry.h"
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+// Compares Velocity -> Position integration over the ECS pools against the
+// object layouts the engine used before: heap allocated Entity objects
+// reached through pointers and a contiguous array of Entity objects.
+
+namespace {
+class MovingEntity : public Entity {
+public:
+  glm::vec3 Velocity;
+  virtual ~MovingEntity() {};
+};
+
+const int REPETITIONS = 10;
+const float DELTA_TIME = 1.0f / 60.0f;
+
+void benchmarkCount(size_t count) {
+  std::printf("-- %zu entities\n", count);
+
+  std::vector<MovingEntity *> heapEntities;
+  heapEntities.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    MovingEntity *entity = new MovingEntity();
+    entity->Position = glm::vec3((float)i, 0.0f, 0.0f);
+    entity->Velocity = glm::vec3(1.0f, 2.0f, 3.0f);
+    heapEntities.push_back(entity);
+  };
+
+  RS::Bench::run("Entity* array (heap objects)", count, REPETITIONS, [&]() {
+    for (MovingEntity *entity : heapEntities) {
+      entity->Position += entity->Velocity * DELTA_TIME;
+    };
+    RS::Bench::doNotOptimize(heapEntities.back()->Position);
+  });
+
+  std::vector<MovingEntity> entities(count);
+  for (size_t i = 0; i < count; i++) {
+    entities[i].Position = glm::vec3((float)i, 0.0f, 0.0f);
+    entities[i].Velocity = glm::vec3(1.0f, 2.0f, 3.0f);
+  };
+
+  RS::Bench::run("Entity array (contiguous objects)", count, REPETITIONS,
+                 [&]() {
+                   for (MovingEntity &entity : entities) {
+                     entity.Position += entity.Velocity * DELTA_TIME;
+                   };
+                   RS::Bench::doNotOptimize(entities.back().Position);
+                 });
+
+  RS::Registry registry;
+  registry.reserve<RS::Position>(count);
+  registry.reserve<RS::Velocity>(count);
+  for (size_t i = 0; i < count; i++) {
+    RS::EntityID entity = registry.createEntity();
+    registry.addComponent(entity, RS::Position{glm::vec3((float)i, 0, 0)});
+    registry.addComponent(entity, RS::Velocity{glm::vec3(1.0f, 2.0f, 3.0f)});
+  };
+
+  RS::Bench::run("ECS view<Position, Velocity>", count, REPETITIONS, [&]() {
+    registry.view<RS::Position, RS::Velocity>().each(
+        [](RS::EntityID, RS::Position &position, RS::Velocity &velocity) {
+          position.value += velocity.value * DELTA_TIME;
+        });
+    RS::Bench::doNotOptimize(registry.getPool<RS::Position>().data()[0]);
+  });
+
+  // Entities were created in order so both pools share the same packing,
+  // which is the layout a system gets after the pools have been sorted.
+  RS::Bench::run("ECS packed pools (linear)", count, REPETITIONS, [&]() {
+    RS::Position *positions = registry.getPool<RS::Position>().data();
+    const RS::Velocity *velocities = registry.getPool<RS::Velocity>().data();
+    const size_t size = registry.getPool<RS::Position>().size();
+    for (size_t i = 0; i < size; i++) {
+      positions[i].value += velocities[i].value * DELTA_TIME;
+    };
+    RS::Bench::doNotOptimize(positions[0]);
+  });
+
+  for (MovingEntity *entity : heapEntities) {
+    delete entity;
+  };
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  benchmarkCount(100000);
+  benchmarkCount(1000000);
+  return 0;
+};
@@ -0,0 +1,128 @@
+#include "rs_bench.h"
+#include "rs_event_listener.h"
+#include "rs_event_manager.h"
+#include "rs_events.h"
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// Events per second through the old synchronous EventManager (map lookup
+// and a copy of the listener vector per emit) against the queued path.
+
+namespace {
+class CountingListener : public RS::EventListener {
+public:
+  void update(const RS::RS_EVENT event) override { _count += (size_t)event; };
+
+  void updateBatch(const RS::Event *events, size_t count) override {
+    for (size_t i = 0; i < count; i++) {
+      _count += (size_t)events[i].eventType;
+    };
+  };
+
+  size_t _count = 0;
+};
+
+// The EventManager as it was before queued dispatch, kept here as the
+// baseline
+class LegacyEventManager {
+public:
+  void emitEvent(u_int sid, const RS::RS_EVENT event) {
+    std::vector<RS::EventListener *> _listeners = _rs_systems[sid];
+    for (size_t i = 0; i < _listeners.size(); i++) {
+      _listeners[i]->update(event);
+    };
+  };
+
+  void addListener(u_int sid, RS::EventListener *listener) {
+    _rs_systems[sid].push_back(listener);
+  };
+
+private:
+  std::map<u_int, std::vector<RS::EventListener *>> _rs_systems;
+};
+
+const u_int SYSTEMS = 8;
+const u_int LISTENERS_PER_SYSTEM = 16;
+const size_t EVENTS_PER_FRAME = 20000;
+const int REPETITIONS = 10;
+const u_int PRODUCERS = 4;
+
+void benchmarkEvents() {
+  std::vector<CountingListener> listeners(SYSTEMS * LISTENERS_PER_SYSTEM);
+
+  LegacyEventManager legacy;
+  RS::EventManager manager;
+  for (u_int sid = 0; sid < SYSTEMS; sid++) {
+    for (u_int i = 0; i < LISTENERS_PER_SYSTEM; i++) {
+      legacy.addListener(sid, &listeners[sid * LISTENERS_PER_SYSTEM + i]);
+      manager.addListener(sid, &listeners[sid * LISTENERS_PER_SYSTEM + i]);
+    };
+  };
+
+  RS::Bench::run("legacy emitEvent (map + vector copy)", EVENTS_PER_FRAME,
+                 REPETITIONS, [&]() {
+                   for (size_t i = 0; i < EVENTS_PER_FRAME; i++) {
+                     legacy.emitEvent(i % SYSTEMS,
+                                      RS::RS_EVENT_WINDOW_RESIZED);
+                   };
+                 });
+
+  RS::Bench::run("emitEvent (flat arrays)", EVENTS_PER_FRAME, REPETITIONS,
+                 [&]() {
+                   for (size_t i = 0; i < EVENTS_PER_FRAME; i++) {
+                     manager.emitEvent(i % SYSTEMS,
+                                       RS::RS_EVENT_WINDOW_RESIZED);
+                   };
+                 });
+
+  RS::Bench::run("queueEvent + dispatchQueuedEvents", EVENTS_PER_FRAME,
+                 REPETITIONS, [&]() {
+                   for (size_t i = 0; i < EVENTS_PER_FRAME; i++) {
+                     manager.queueEvent(RS::makeEvent(
+                         i % SYSTEMS, RS::RS_EVENT_WINDOW_RESIZED));
+                   };
+                   manager.dispatchQueuedEvents();
+                 });
+
+  RS::EventManager asyncManager(EVENTS_PER_FRAME * 2);
+  for (u_int sid = 0; sid < SYSTEMS; sid++) {
+    for (u_int i = 0; i < LISTENERS_PER_SYSTEM; i++) {
+      asyncManager.addListener(sid,
+                               &listeners[sid * LISTENERS_PER_SYSTEM + i]);
+    };
+  };
+
+  RS::Bench::run("queueEventAsync (4 producers) + dispatch", EVENTS_PER_FRAME,
+                 REPETITIONS, [&]() {
+                   std::vector<std::thread> threads;
+                   for (u_int t = 0; t < PRODUCERS; t++) {
+                     threads.emplace_back([&asyncManager, t]() {
+                       for (size_t i = t; i < EVENTS_PER_FRAME;
+                            i += PRODUCERS) {
+                         asyncManager.queueEventAsync(RS::makeEvent(
+                             i % SYSTEMS, RS::RS_EVENT_WINDOW_RESIZED));
+                       };
+                     });
+                   };
+                   for (std::thread &thread : threads) {
+                     thread.join();
+                   };
+                   asyncManager.dispatchQueuedEvents();
+                 });
+
+  size_t total = 0;
+  for (CountingListener &listener : listeners) {
+    total += listener._count;
+  };
+  RS::Bench::doNotOptimize(total);
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  benchmarkEvents();
+  return 0;
+};
@@ -0,0 +1,134 @@
+#include "rs_bench.h"
+#include "rs_components.h"
+#include "rs_job_system.h"
+#include "rs_registry.h"
+#include "rs_system.h"
+#include "rs_system_graph.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// Scaling of parallelFor over a component pool and of the SystemGraph with
+// independent systems as the worker count grows.
+
+namespace {
+const size_t ENTITIES = 1000000;
+const int REPETITIONS = 5;
+const u_int THREAD_COUNTS[] = {1, 2, 4, 8, 12, 16};
+
+// Enough math per entity that the loop is compute bound
+inline void simulate(RS::Position &position, const RS::Velocity &velocity) {
+  glm::vec3 value = position.value;
+  for (int i = 0; i < 16; i++) {
+    value += velocity.value * (1.0f / 60.0f);
+    value.y = std::sqrt(value.y * value.y + 1.0f);
+  };
+  position.value = value;
+};
+
+// Each instance owns its own pool so none of them conflict
+template <int N> struct Work {
+  float value;
+};
+
+template <int N> class WorkSystem : public RS::System {
+public:
+  void emitEvent(const RS::RS_EVENT event) override {};
+  void update(const RS::RS_EVENT event) override {};
+
+  void tick(RS::Registry &registry, float deltaTime) override {
+    RS::ComponentPool<Work<N>> &pool = registry.getPool<Work<N>>();
+    Work<N> *data = pool.data();
+    for (size_t i = 0; i < pool.size(); i++) {
+      for (int j = 0; j < 16; j++) {
+        data[i].value = std::sqrt(data[i].value * data[i].value + deltaTime);
+      };
+    };
+  };
+
+  RS::ComponentAccess getComponentAccess() const override {
+    RS::ComponentAccess access;
+    access.writes = RS::componentMask<Work<N>>();
+    access.mainThread = false;
+    return access;
+  };
+};
+
+template <int N>
+void addWork(RS::Registry &registry, RS::SystemGraph &graph,
+             std::vector<RS::System *> &systems, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    registry.addComponent(registry.createEntity(), Work<N>{(float)i});
+  };
+  systems.push_back(new WorkSystem<N>());
+  graph.addSystem(systems.back());
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  RS::Registry registry;
+  registry.reserve<RS::Position>(ENTITIES);
+  registry.reserve<RS::Velocity>(ENTITIES);
+  for (size_t i = 0; i < ENTITIES; i++) {
+    RS::EntityID entity = registry.createEntity();
+    registry.addComponent(entity, RS::Position{glm::vec3((float)i, 0, 0)});
+    registry.addComponent(entity, RS::Velocity{glm::vec3(1.0f, 2.0f, 3.0f)});
+  };
+
+  // Registry pools have to exist before the graph reads them from workers
+  RS::SystemGraph graph;
+  std::vector<RS::System *> systems;
+  const size_t WORK_ITEMS = 200000;
+  addWork<0>(registry, graph, systems, WORK_ITEMS);
+  addWork<1>(registry, graph, systems, WORK_ITEMS);
+  addWork<2>(registry, graph, systems, WORK_ITEMS);
+  addWork<3>(registry, graph, systems, WORK_ITEMS);
+  addWork<4>(registry, graph, systems, WORK_ITEMS);
+  addWork<5>(registry, graph, systems, WORK_ITEMS);
+  addWork<6>(registry, graph, systems, WORK_ITEMS);
+  addWork<7>(registry, graph, systems, WORK_ITEMS);
+
+  std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+
+  double singleFor = 0.0;
+  double singleGraph = 0.0;
+  for (u_int threads : THREAD_COUNTS) {
+    RS::JobSystem jobs(threads - 1);
+    char name[64];
+
+    std::snprintf(name, sizeof(name), "parallelFor view, %u threads", threads);
+    double perItem = RS::Bench::run(name, ENTITIES, REPETITIONS, [&]() {
+      RS::View<RS::Position, RS::Velocity> view =
+          registry.view<RS::Position, RS::Velocity>();
+      jobs.parallelFor(view.sizeHint(), 0, [&view](size_t begin, size_t end) {
+        view.eachInRange(begin, end,
+                         [](RS::EntityID, RS::Position &position,
+                            RS::Velocity &velocity) {
+                           simulate(position, velocity);
+                         });
+      });
+    });
+    if (threads == 1) {
+      singleFor = perItem;
+    };
+    std::printf("  speedup %.2fx\n", singleFor / perItem);
+
+    std::snprintf(name, sizeof(name), "SystemGraph 8 systems, %u threads",
+                  threads);
+    perItem = RS::Bench::run(name, WORK_ITEMS * 8, REPETITIONS, [&]() {
+      graph.run(jobs, registry, 1.0f / 60.0f);
+    });
+    if (threads == 1) {
+      singleGraph = perItem;
+    };
+    std::printf("  speedup %.2fx\n", singleGraph / perItem);
+  };
+
+  for (RS::System *system : systems) {
+    delete system;
+  };
+  return 0;
+};
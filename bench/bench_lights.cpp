@@ -0,0 +1,192 @@
+#include "rs_batch_renderer.h"
+#include "rs_bench_gl.h"
+#include "rs_frame_constants.h"
+#include "rs_gl.h"
+#include "rs_light_clusters.h"
+#include "rs_shader_cache.h"
+#include "rs_shader_variants.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+// Frame time of a field of cubes drawn with the clustered LIT forward
+// shader as the point light count goes from 16 to 4096, next to the same
+// field unlit. Cluster build time is the CPU side, scalar and SSE. Unlike
+// bench_batch the viewport is full size, shading is what is measured.
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+namespace {
+const u_int LIGHT_COUNTS[] = {16, 64, 256, 1024, 4096};
+const int WIDTH = 1280;
+const int HEIGHT = 720;
+// Cubes in a GRID x GRID field on the ground
+const u_int GRID = 64;
+const float SPACING = 2.0f;
+const int FRAMES = 10;
+
+float randomRange(float low, float high) {
+  return low + (high - low) * ((float)std::rand() / (float)RAND_MAX);
+};
+
+void buildCube(std::vector<RS::Vertex> &vertices,
+               std::vector<u_int32_t> &indices) {
+  for (int i = 0; i < 8; i++) {
+    RS::Vertex vertex;
+    vertex.position = glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f,
+                                i & 4 ? 0.5f : -0.5f);
+    vertex.texCoord = glm::vec2(i & 1 ? 1.0f : 0.0f, i & 2 ? 1.0f : 0.0f);
+    vertices.push_back(vertex);
+  };
+  const u_int32_t CUBE_INDICES[] = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5,
+                                    0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6,
+                                    0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+  indices.assign(CUBE_INDICES, CUBE_INDICES + 36);
+};
+
+struct Scene {
+  RS::BatchRenderer *batch;
+  RS::MeshHandle cube;
+  std::vector<glm::mat4> models;
+};
+
+// Best GPU bound frame over FRAMES, draw to glFinish
+double timeFrames(Scene &scene, GLuint program) {
+  double best = 0.0;
+  glUseProgram(program);
+  for (int i = 0; i < FRAMES; i++) {
+    glFinish();
+    auto start = std::chrono::high_resolution_clock::now();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    for (const glm::mat4 &model : scene.models) {
+      scene.batch->submit(scene.cube, model);
+    };
+    scene.batch->flush();
+    glFinish();
+    auto end = std::chrono::high_resolution_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    if (i == 0 || ms < best) {
+      best = ms;
+    }
+  };
+  return best;
+};
+
+// Everything GL lives in here, so it is gone before the context
+bool runAll(SDL_Window *window, const char *cacheDirectory) {
+  // Camera above the field looking across it
+  RS::FrameConstantsBuffer frameConstants;
+  frameConstants.init();
+  RS::FrameConstants constants;
+  constants.view = glm::lookAt(glm::vec3(0.0f, 12.0f, 10.0f),
+                               glm::vec3(0.0f, 0.0f, -40.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  constants.projection = glm::perspective(
+      glm::radians(60.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 200.0f);
+  frameConstants.upload(constants);
+
+  RS::BatchRenderer batch;
+  batch.init(8, 36, GRID * GRID);
+  std::vector<RS::Vertex> vertices;
+  std::vector<u_int32_t> indices;
+  buildCube(vertices, indices);
+  Scene scene;
+  scene.batch = &batch;
+  scene.cube = batch.addMesh(vertices.data(), (u_int)vertices.size(),
+                             indices.data(), (u_int)indices.size());
+  for (u_int z = 0; z < GRID; z++) {
+    for (u_int x = 0; x < GRID; x++) {
+      const glm::vec3 position(((float)x - GRID * 0.5f) * SPACING, 0.0f,
+                               -(float)z * SPACING);
+      scene.models.push_back(glm::translate(glm::mat4(1.0f), position));
+    };
+  };
+
+  RS::ShaderCache cache(cacheDirectory, window);
+  RS::ShaderPermutations forward(&cache);
+  if (!forward.load(REDSTAR_SHADER_DIR "/vert/forward.vert",
+                    REDSTAR_SHADER_DIR "/frag/forward.frag")) {
+    return false;
+  };
+  const RS::ShaderVariantKey unlitKey =
+      RS::ShaderFeatures<RS::RS_SHADER_INSTANCED>::key;
+  const RS::ShaderVariantKey litKey =
+      RS::ShaderFeatures<RS::RS_SHADER_INSTANCED, RS::RS_SHADER_LIT>::key;
+  forward.request(unlitKey);
+  forward.request(litKey);
+  cache.waitAll();
+  const GLuint unlit = forward.getProgram(unlitKey);
+  const GLuint lit = forward.getProgram(litKey);
+  if (unlit == 0 || lit == 0) {
+    std::printf("forward shader variants failed to build\n");
+    return false;
+  };
+
+  RS::LightClusterBuilder builder;
+  RS::LightClusterBuffer buffer;
+  buffer.init();
+  RS::LightClusters clusters;
+
+  std::printf("unlit frame: %.3f ms\n", timeFrames(scene, unlit));
+  std::printf("%-8s %12s %12s %10s %12s %14s\n", "lights", "scalar ms",
+              "SSE ms", "indices", "max/cluster", "lit frame ms");
+  std::srand(1);
+  std::vector<RS::ClusterLight> lights;
+  for (u_int count : LIGHT_COUNTS) {
+    // Spread over the field, radii so neighbours overlap
+    lights.resize(count);
+    for (RS::ClusterLight &light : lights) {
+      light.positionRadius = glm::vec4(
+          randomRange(-(float)GRID * 0.5f, (float)GRID * 0.5f) * SPACING,
+          randomRange(0.5f, 4.0f), -randomRange(0.0f, GRID * SPACING),
+          randomRange(3.0f, 8.0f));
+      light.color = glm::vec4(randomRange(0.2f, 1.0f), randomRange(0.2f, 1.0f),
+                              randomRange(0.2f, 1.0f), 0.0f) *
+                    4.0f;
+    };
+
+    builder.build(constants.view, constants.projection, lights.data(),
+                  lights.size(), clusters, RS::CULL_SCALAR);
+    const double scalarMs = builder.getStats().buildMs;
+    builder.build(constants.view, constants.projection, lights.data(),
+                  lights.size(), clusters, RS::CULL_SSE);
+    const RS::LightClusterStats stats = builder.getStats();
+    clusters.constants.ambient = glm::vec4(0.05f);
+    buffer.upload(clusters, WIDTH, HEIGHT);
+
+    std::printf("%-8u %12.3f %12.3f %10u %12u %14.3f\n", count, scalarMs,
+                stats.buildMs, stats.indices, stats.maxPerCluster,
+                timeFrames(scene, lit));
+  };
+  return true;
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  RS::Bench::GLContext context;
+  if (!RS::Bench::createGLContext(context, WIDTH, HEIGHT)) {
+    return 1;
+  };
+  std::printf("GL_RENDERER: %s\n", (const char *)glGetString(GL_RENDERER));
+  if (!RS::glVersionAtLeast(4, 3)) {
+    std::printf("needs GL 4.3 for storage buffers\n");
+    RS::Bench::destroyGLContext(context);
+    return 0;
+  };
+  glViewport(0, 0, WIDTH, HEIGHT);
+  glEnable(GL_DEPTH_TEST);
+
+  const std::string cacheDirectory =
+      (std::filesystem::temp_directory_path() / "redstar_bench_lights")
+          .string();
+  bool ran = runAll(context.window, cacheDirectory.c_str());
+
+  std::filesystem::remove_all(cacheDirectory);
+  RS::Bench::destroyGLContext(context);
+  return ran ? 0 : 1;
+};
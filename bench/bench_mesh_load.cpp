@@ -0,0 +1,145 @@
+#include "rs_bench_gl.h"
+#include "rs_gl.h"
+#include "rs_mesh_file.h"
+#include "rs_mesh_format.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Load throughput of a GRID x GRID vertex .rsmesh: mmap straight into
+// glBufferData against reading the file into memory first. The file is
+// hot in the page cache after the first run, so this measures the CPU and
+// driver side of loading, not the disk. The mmap path includes
+// MeshFile::open()'s validation pass over the indices, the fread one
+// trusts the file.
+
+namespace {
+const u_int GRID = 1024;
+const int REPS = 10;
+
+void buildGrid(std::vector<RS::Vertex> &vertices,
+               std::vector<u_int32_t> &indices) {
+  for (u_int y = 0; y < GRID; y++) {
+    for (u_int x = 0; x < GRID; x++) {
+      RS::Vertex vertex;
+      vertex.position = glm::vec3((float)x, 0.0f, (float)y);
+      vertex.texCoord = glm::vec2(x / (float)(GRID - 1), y / (float)(GRID - 1));
+      vertices.push_back(vertex);
+    };
+  };
+  for (u_int y = 0; y + 1 < GRID; y++) {
+    for (u_int x = 0; x + 1 < GRID; x++) {
+      u_int32_t corner = y * GRID + x;
+      indices.insert(indices.end(), {corner, corner + 1, corner + GRID,
+                                     corner + 1, corner + GRID + 1,
+                                     corner + GRID});
+    };
+  };
+};
+
+double mappedLoad(const char *path, GLuint vertexBuffer, GLuint indexBuffer) {
+  auto start = std::chrono::high_resolution_clock::now();
+  RS::MeshFile file;
+  if (!file.open(path)) {
+    return -1.0;
+  }
+  file.upload(vertexBuffer, indexBuffer);
+  glFinish();
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+};
+
+// What a plain fread based loader would do
+double copiedLoad(const char *path, GLuint vertexBuffer, GLuint indexBuffer) {
+  auto start = std::chrono::high_resolution_clock::now();
+  FILE *file = std::fopen(path, "rb");
+  if (file == NULL) {
+    return -1.0;
+  }
+  std::fseek(file, 0, SEEK_END);
+  std::vector<unsigned char> contents((size_t)std::ftell(file));
+  std::fseek(file, 0, SEEK_SET);
+  size_t read = std::fread(contents.data(), 1, contents.size(), file);
+  std::fclose(file);
+  if (read != contents.size()) {
+    return -1.0;
+  }
+
+  const RS::MeshFileHeader *header =
+      (const RS::MeshFileHeader *)contents.data();
+  const size_t indexSize = (header->flags & RS::RS_MESH_INDEX_32) != 0 ? 4 : 2;
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER,
+               (GLsizeiptr)header->vertexCount * sizeof(RS::Vertex),
+               contents.data() + header->vertexOffset, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               (GLsizeiptr)(header->indexCount * indexSize),
+               contents.data() + header->indexOffset, GL_STATIC_DRAW);
+  glFinish();
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+};
+
+double best(double (*load)(const char *, GLuint, GLuint), const char *path,
+            GLuint vertexBuffer, GLuint indexBuffer) {
+  double bestMs = -1.0;
+  for (int rep = 0; rep < REPS; rep++) {
+    double ms = load(path, vertexBuffer, indexBuffer);
+    if (ms >= 0.0 && (bestMs < 0.0 || ms < bestMs)) {
+      bestMs = ms;
+    }
+  };
+  return bestMs;
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  RS::Bench::GLContext context;
+  if (!RS::Bench::createGLContext(context)) {
+    return 1;
+  };
+  std::printf("GL_RENDERER: %s\n", (const char *)glGetString(GL_RENDERER));
+
+  std::vector<RS::Vertex> vertices;
+  std::vector<u_int32_t> indices;
+  buildGrid(vertices, indices);
+  RS::MeshFileSubmesh submesh = {};
+  submesh.indexCount = (u_int32_t)indices.size();
+
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "redstar_bench_mesh.rsmesh")
+          .string();
+  if (!RS::MeshFile::write(path.c_str(), vertices.data(),
+                           (u_int)vertices.size(), indices.data(),
+                           (u_int)indices.size(), &submesh, 1)) {
+    return 1;
+  };
+  const double megabytes =
+      std::filesystem::file_size(path) / (1024.0 * 1024.0);
+
+  // VAO bound so the element array binding has somewhere to live
+  GLuint vao;
+  GLuint buffers[2];
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  glGenBuffers(2, buffers);
+
+  double mapped = best(mappedLoad, path.c_str(), buffers[0], buffers[1]);
+  double copied = best(copiedLoad, path.c_str(), buffers[0], buffers[1]);
+  std::printf("%u vertices, %zu indices, %.1f MB\n", GRID * GRID,
+              indices.size(), megabytes);
+  std::printf("%-8s %10.3f ms %10.1f MB/s\n", "mmap", mapped,
+              megabytes / (mapped / 1000.0));
+  std::printf("%-8s %10.3f ms %10.1f MB/s\n", "fread", copied,
+              megabytes / (copied / 1000.0));
+
+  glBindVertexArray(0);
+  glDeleteBuffers(2, buffers);
+  glDeleteVertexArrays(1, &vao);
+  std::filesystem::remove(path);
+  RS::Bench::destroyGLContext(context);
+  return 0;
+};
@@ -0,0 +1,210 @@
+#include "rs_batch_renderer.h"
+#include "rs_bench_gl.h"
+#include "rs_frame_constants.h"
+#include "rs_framebuffer.h"
+#include "rs_gl.h"
+#include "rs_gl_state.h"
+#include "rs_occlusion.h"
+#include "shader.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+// GPU occlusion culling on a grid of cubes, once behind a wall and once in
+// the open. Prints the instances tested and drawn and the CPU time per
+// frame, and fails when drawn exceeds tested, when the wall hides nothing
+// or when the open grid loses any. Runs on software GL
+// (LIBGL_ALWAYS_SOFTWARE=1, llvmpipe has compute shaders), --headless
+// needs no display. --frames N sets the frames per scene, the counters
+// come back RS_OCCLUSION_FRAMES behind so it has to be more than that.
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+namespace {
+const int WIDTH = 256;
+const int HEIGHT = 256;
+const int GRID = 32; // GRID x GRID cubes
+
+void buildCube(std::vector<RS::Vertex> &vertices,
+               std::vector<u_int32_t> &indices) {
+  for (int i = 0; i < 8; i++) {
+    RS::Vertex vertex;
+    vertex.position = glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f,
+                                i & 4 ? 0.5f : -0.5f);
+    vertex.texCoord = glm::vec2(i & 1 ? 1.0f : 0.0f, i & 2 ? 1.0f : 0.0f);
+    vertices.push_back(vertex);
+  };
+  const u_int32_t CUBE_INDICES[] = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5,
+                                    0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6,
+                                    0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+  indices.assign(CUBE_INDICES, CUBE_INDICES + 36);
+};
+
+struct Scene {
+  RS::BatchRenderer *batch;
+  RS::OcclusionCuller *culler;
+  RS::GLStateCache *state;
+  RS::Framebuffer *target;
+  Shader *shader;
+  RS::MeshHandle cube;
+  glm::mat4 viewProjection;
+  std::vector<glm::mat4> models;
+};
+
+// One frame the way RenderSystem::submit() runs it, returns the CPU ms
+double frame(Scene &scene) {
+  auto start = std::chrono::high_resolution_clock::now();
+  scene.target->bind();
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  scene.state->beginFrame();
+  scene.culler->beginFrame();
+  scene.batch->beginFrame();
+  scene.state->useProgram(scene.shader->ID);
+  for (const glm::mat4 &model : scene.models) {
+    scene.batch->submit(scene.cube, model);
+  };
+  scene.batch->flush();
+  scene.batch->endFrame();
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, scene.target->getFramebuffer());
+  scene.culler->buildPyramid(WIDTH, HEIGHT, scene.viewProjection);
+  scene.culler->endFrame();
+  auto end = std::chrono::high_resolution_clock::now();
+  glFinish(); // Not part of the CPU time, and lets the counters come back
+  return std::chrono::duration<double, std::milli>(end - start).count();
+};
+
+// Runs the scene and reports, false if the counters are off
+bool run(Scene &scene, const char *name, bool walled, int frames) {
+  scene.models.clear();
+  for (int y = 0; y < GRID; y++) {
+    for (int x = 0; x < GRID; x++) {
+      scene.models.push_back(glm::translate(
+          glm::mat4(1.0f),
+          glm::vec3((float)x - GRID * 0.5f, (float)y - GRID * 0.5f, -10.0f)));
+    };
+  };
+  if (walled) {
+    // Between the camera and the grid, wider than the view
+    scene.models.push_back(
+        glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 5.0f)),
+                   glm::vec3(40.0f, 40.0f, 1.0f)));
+  };
+
+  // Off and on again starts from an empty pyramid
+  scene.culler->setEnabled(false);
+  scene.culler->setEnabled(true);
+  double total = 0.0;
+  for (int i = 0; i < frames; i++) {
+    total += frame(scene);
+  };
+  // Picks up the last frame's counters that are RS_OCCLUSION_FRAMES old
+  scene.culler->beginFrame();
+  const RS::OcclusionStats &stats = scene.culler->getStats();
+  std::printf("%-10s %10u %10u %12.3f\n", name, stats.tested, stats.visible,
+              total / frames);
+
+  bool ok = true;
+  if (stats.tested != (u_int)scene.models.size()) {
+    std::fprintf(stderr, "%s: tested %u of %u instances\n", name,
+                 stats.tested, (u_int)scene.models.size());
+    ok = false;
+  };
+  if (stats.visible > stats.tested) {
+    std::fprintf(stderr, "%s: drew %u of %u tested\n", name, stats.visible,
+                 stats.tested);
+    ok = false;
+  };
+  if (walled && stats.visible >= stats.tested) {
+    std::fprintf(stderr, "%s: the wall hid nothing\n", name);
+    ok = false;
+  };
+  if (!walled && stats.visible != stats.tested) {
+    std::fprintf(stderr, "%s: culled %u unoccluded instances\n", name,
+                 stats.tested - stats.visible);
+    ok = false;
+  };
+  return ok;
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bool headless = false;
+  int frames = 8;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = std::atoi(argv[++i]);
+    } else {
+      std::fprintf(stderr, "usage: %s [--headless] [--frames N]\n", argv[0]);
+      return 1;
+    };
+  };
+  if (frames <= (int)RS::RS_OCCLUSION_FRAMES) {
+    std::fprintf(stderr, "--frames has to be over %u\n",
+                 RS::RS_OCCLUSION_FRAMES);
+    return 1;
+  };
+
+  RS::Bench::GLContext context;
+  if (!RS::Bench::createGLContext(context, WIDTH, HEIGHT, headless)) {
+    return 1;
+  };
+  std::printf("GL_RENDERER: %s\n", (const char *)glGetString(GL_RENDERER));
+
+  RS::Framebuffer target;
+  RS::FrameConstantsBuffer frameConstants;
+  RS::GLStateCache state;
+  RS::BatchRenderer batch;
+  RS::OcclusionCuller culler;
+  const u_int instances = GRID * GRID + 1;
+  if (!target.init(WIDTH, HEIGHT) || !batch.init(8, 36, instances) ||
+      !culler.init(instances, RS::RS_MAX_BATCH_COMMANDS)) {
+    std::fprintf(stderr, "occlusion culling is not supported here\n");
+    RS::Bench::destroyGLContext(context);
+    return 1;
+  };
+  culler.setStateCache(&state);
+  batch.setStateCache(&state);
+  batch.setOcclusionCuller(&culler);
+  glEnable(GL_DEPTH_TEST);
+
+  std::vector<RS::Vertex> vertices;
+  std::vector<u_int32_t> indices;
+  buildCube(vertices, indices);
+
+  Shader shader(REDSTAR_SHADER_DIR "/vert/instanced.vert",
+                REDSTAR_SHADER_DIR "/frag/main.frag");
+
+  Scene scene;
+  scene.batch = &batch;
+  scene.culler = &culler;
+  scene.state = &state;
+  scene.target = &target;
+  scene.shader = &shader;
+  scene.cube = batch.addMesh(vertices.data(), (u_int)vertices.size(),
+                             indices.data(), (u_int)indices.size());
+
+  RS::FrameConstants constants;
+  constants.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 20.0f), glm::vec3(0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  constants.projection = glm::perspective(
+      glm::radians(60.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+  frameConstants.init();
+  frameConstants.upload(constants);
+  scene.viewProjection = constants.projection * constants.view;
+
+  std::printf("%-10s %10s %10s %12s\n", "scene", "tested", "drawn",
+              "ms/frame");
+  bool ok = run(scene, "occluded", true, frames);
+  ok = run(scene, "open", false, frames) && ok;
+
+  glDeleteProgram(shader.ID);
+  RS::Bench::destroyGLContext(context);
+  return ok ? 0 : 1;
+};
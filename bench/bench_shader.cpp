@@ -0,0 +1,127 @@
+#include "rs_bench.h"
+#include "rs_bench_gl.h"
+#include "rs_frame_constants.h"
+#include "shader.hpp"
+#include <cstddef>
+#include <cstdio>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Uniform set throughput: the old glGetUniformLocation + std::string path
+// against the reflected name table and cached handles, and per program
+// camera uniforms against one shared uniform buffer upload.
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+namespace {
+const size_t SETS = 100000;
+const size_t PROGRAMS = 100;
+const int REPETITIONS = 5;
+
+// What every Shader setter did before the uniform table
+void legacySetMat4(GLuint program, const std::string &name,
+                   const glm::mat4 &mat) {
+  glUniformMatrix4fv(glGetUniformLocation(program, name.c_str()), 1, GL_FALSE,
+                     &mat[0][0]);
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  RS::Bench::GLContext context;
+  if (!RS::Bench::createGLContext(context)) {
+    return 1;
+  };
+  std::printf("GL_RENDERER: %s\n", (const char *)glGetString(GL_RENDERER));
+
+  Shader shader(REDSTAR_SHADER_DIR "/vert/main.vert",
+                REDSTAR_SHADER_DIR "/frag/main.frag");
+  shader.use();
+
+  const glm::mat4 matrix(1.0f);
+  RS::Bench::run("setMat4 legacy (string + glGetUniformLocation)", SETS,
+                 REPETITIONS, [&]() {
+                   for (size_t i = 0; i < SETS; i++) {
+                     legacySetMat4(shader.ID, "model", matrix);
+                   };
+                   glFinish();
+                 });
+
+  RS::Bench::run("setMat4 by name (reflected table)", SETS, REPETITIONS,
+                 [&]() {
+                   for (size_t i = 0; i < SETS; i++) {
+                     shader.setMat4("model", matrix);
+                   };
+                   glFinish();
+                 });
+
+  const UniformHandle model = shader.getUniform("model");
+  RS::Bench::run("setMat4 by handle", SETS, REPETITIONS, [&]() {
+    for (size_t i = 0; i < SETS; i++) {
+      shader.setMat4(model, matrix);
+    };
+    glFinish();
+  });
+
+  // Camera constants: the same view/projection set on every program versus a
+  // single shared uniform buffer upload per frame
+  std::vector<Shader *> programs;
+  for (size_t i = 0; i < PROGRAMS; i++) {
+    programs.push_back(new Shader(REDSTAR_SHADER_DIR "/vert/main.vert",
+                                  REDSTAR_SHADER_DIR "/frag/main.frag"));
+  };
+
+  const char *LEGACY_VERT = "#version 330 core\n"
+                            "layout (location = 0) in vec3 aPos;\n"
+                            "uniform mat4 view;\n"
+                            "uniform mat4 projection;\n"
+                            "void main() {\n"
+                            "  gl_Position = projection * view * vec4(aPos, 1);\n"
+                            "}\n";
+  GLuint legacyProgram = glCreateProgram();
+  GLuint legacyShader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(legacyShader, 1, &LEGACY_VERT, NULL);
+  glCompileShader(legacyShader);
+  glAttachShader(legacyProgram, legacyShader);
+  glLinkProgram(legacyProgram);
+  glDeleteShader(legacyShader);
+
+  const size_t FRAMES = 1000;
+  RS::Bench::run("camera uniforms per program (legacy)", FRAMES * PROGRAMS,
+                 REPETITIONS, [&]() {
+                   for (size_t frame = 0; frame < FRAMES; frame++) {
+                     for (size_t i = 0; i < PROGRAMS; i++) {
+                       glUseProgram(legacyProgram);
+                       legacySetMat4(legacyProgram, "view", matrix);
+                       legacySetMat4(legacyProgram, "projection", matrix);
+                     };
+                   };
+                   glFinish();
+                 });
+
+  RS::FrameConstantsBuffer frameConstants;
+  frameConstants.init();
+  RS::FrameConstants constants;
+  constants.view = matrix;
+  constants.projection = matrix;
+  RS::Bench::run("camera uniforms via FrameConstants UBO", FRAMES * PROGRAMS,
+                 REPETITIONS, [&]() {
+                   for (size_t frame = 0; frame < FRAMES; frame++) {
+                     frameConstants.upload(constants);
+                     for (size_t i = 0; i < PROGRAMS; i++) {
+                       programs[i]->use();
+                     };
+                   };
+                   glFinish();
+                 });
+
+  glDeleteProgram(legacyProgram);
+  for (Shader *program : programs) {
+    glDeleteProgram(program->ID);
+    delete program;
+  };
+  RS::Bench::destroyGLContext(context);
+  return 0;
+};
@@ -0,0 +1,96 @@
+#include "rs_bench.h"
+#include "rs_bench_gl.h"
+#include "rs_shader_cache.h"
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Startup cost of PROGRAMS distinct programs: a cold start that compiles
+// everything and fills the binary cache, then a warm start that restores
+// every program from it.
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+namespace {
+const int PROGRAMS = 128;
+
+double buildAll(const char *cacheDirectory, SDL_Window *window,
+                const std::vector<std::string> &vertexSources,
+                const std::string &fragmentSource, RS::ShaderCacheStats &out) {
+  auto start = std::chrono::high_resolution_clock::now();
+
+  RS::ShaderCache cache(cacheDirectory, window);
+  std::vector<RS::ProgramRequest> requests;
+  for (const std::string &vertexSource : vertexSources) {
+    requests.push_back(
+        cache.requestProgramFromSource(vertexSource, fragmentSource));
+  };
+  cache.waitAll();
+
+  auto end = std::chrono::high_resolution_clock::now();
+  out = cache.getStats();
+
+  for (RS::ProgramRequest request : requests) {
+    glDeleteProgram(cache.getProgram(request));
+  };
+  return std::chrono::duration<double, std::milli>(end - start).count();
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  // Keep Mesa's own disk cache out of the cold numbers
+  setenv("MESA_SHADER_CACHE_DISABLE", "true", 1);
+
+  RS::Bench::GLContext context;
+  if (!RS::Bench::createGLContext(context)) {
+    return 1;
+  };
+  std::printf("GL_RENDERER: %s\n", (const char *)glGetString(GL_RENDERER));
+
+  std::string vertexSource;
+  std::string fragmentSource;
+  if (!RS::ShaderCache::readFile(REDSTAR_SHADER_DIR "/vert/main.vert",
+                                 vertexSource) ||
+      !RS::ShaderCache::readFile(REDSTAR_SHADER_DIR "/frag/main.frag",
+                                 fragmentSource)) {
+    return 1;
+  };
+
+  // Distinct sources so neither our cache nor the driver can share work
+  std::vector<std::string> vertexSources;
+  const size_t versionEnd = vertexSource.find('\n') + 1;
+  for (int i = 0; i < PROGRAMS; i++) {
+    vertexSources.push_back(vertexSource.substr(0, versionEnd) +
+                            "// variant " + std::to_string(i) + "\n" +
+                            vertexSource.substr(versionEnd));
+  };
+
+  const std::string cacheDirectory =
+      (std::filesystem::temp_directory_path() / "redstar_bench_shader_cache")
+          .string();
+  std::filesystem::remove_all(cacheDirectory);
+
+  RS::ShaderCacheStats stats;
+  double cold = buildAll(cacheDirectory.c_str(), context.window, vertexSources,
+                         fragmentSource, stats);
+  std::printf("cold start: %d programs in %8.2f ms (%u compiled, %s)\n",
+              PROGRAMS, cold, stats.binaryMisses,
+              stats.parallelCompile ? "KHR_parallel_shader_compile"
+                                    : "shared context worker");
+
+  double warm = buildAll(cacheDirectory.c_str(), context.window, vertexSources,
+                         fragmentSource, stats);
+  std::printf("warm start: %d programs in %8.2f ms (%u from binary cache)\n",
+              PROGRAMS, warm, stats.binaryHits);
+  std::printf("warm speedup: %.2fx\n", warm > 0.0 ? cold / warm : 0.0);
+
+  std::filesystem::remove_all(cacheDirectory);
+  RS::Bench::destroyGLContext(context);
+  return 0;
+};
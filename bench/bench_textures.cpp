@@ -0,0 +1,140 @@
+#include "rs_bench_gl.h"
+#include "rs_frame_clock.h"
+#include "rs_texture_manager.h"
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Streams TEXTURES textures of mixed sizes in while a frame loop keeps
+// running and reports what that did to frame times compared to idle
+// frames. The images are generated as BMPs in a temporary directory.
+
+namespace {
+const int TEXTURES = 320;
+// Every 32nd texture is a large 2048x2048 one
+const int SIZES[] = {64, 128, 256, 512};
+const int LARGE_SIZE = 2048;
+const int IDLE_FRAMES = 240;
+// Stop waiting for uploads after this many frames
+const int MAX_FRAMES = 20000;
+
+bool writeImage(const std::string &path, int size, int seed) {
+  SDL_Surface *surface = SDL_CreateSurface(size, size, SDL_PIXELFORMAT_RGBA32);
+  if (surface == NULL) {
+    return false;
+  };
+  for (int y = 0; y < size; y++) {
+    unsigned char *row = (unsigned char *)surface->pixels + y * surface->pitch;
+    for (int x = 0; x < size; x++) {
+      row[x * 4 + 0] = (unsigned char)(x + seed);
+      row[x * 4 + 1] = (unsigned char)(y * seed);
+      row[x * 4 + 2] = (unsigned char)((x ^ y) + seed);
+      row[x * 4 + 3] = 255;
+    };
+  };
+  bool saved = SDL_SaveBMP(surface, path.c_str());
+  SDL_DestroySurface(surface);
+  return saved;
+};
+
+// One frame of "game": pick up uploads, clear, present
+void frame(RS::Bench::GLContext &context, RS::TextureManager *textures) {
+  if (textures != NULL) {
+    textures->update();
+  }
+  glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  SDL_GL_SwapWindow(context.window);
+};
+
+void printStats(const char *label, RS::FrameStats stats) {
+  std::printf("%-10s frames %6llu  p50 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+              label, (unsigned long long)stats.frameCount, stats.p50Ms,
+              stats.p99Ms, stats.maxMs);
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  RS::Bench::GLContext context;
+  if (!RS::Bench::createGLContext(context)) {
+    return 1;
+  };
+  std::printf("GL_RENDERER: %s\n", (const char *)glGetString(GL_RENDERER));
+
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "redstar_bench_textures";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  std::vector<std::string> paths;
+  size_t sourceBytes = 0;
+  for (int i = 0; i < TEXTURES; i++) {
+    int size = i % 32 == 31 ? LARGE_SIZE : SIZES[i % 4];
+    std::string path =
+        (directory / ("texture_" + std::to_string(i) + ".bmp")).string();
+    if (!writeImage(path, size, i)) {
+      std::fprintf(stderr, "could not write %s: %s\n", path.c_str(),
+                   SDL_GetError());
+      return 1;
+    }
+    paths.push_back(path);
+    sourceBytes += (size_t)size * size * 4;
+  };
+
+  RS::FrameClock idleClock(IDLE_FRAMES);
+  idleClock.beginFrame();
+  for (int i = 0; i < IDLE_FRAMES; i++) {
+    frame(context, NULL);
+    idleClock.beginFrame();
+  };
+
+  {
+    RS::TextureManager textures;
+    RS::FrameClock streamingClock(MAX_FRAMES);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const std::string &path : paths) {
+      textures.load(path.c_str());
+    };
+
+    streamingClock.beginFrame();
+    int frames = 0;
+    double worstUploadMs = 0.0;
+    while (frames < MAX_FRAMES) {
+      frame(context, &textures);
+      streamingClock.beginFrame();
+      frames++;
+
+      const RS::TextureStats &stats = textures.getStats();
+      if (stats.uploadMs > worstUploadMs) {
+        worstUploadMs = stats.uploadMs;
+      }
+      if (stats.resident + stats.failed == stats.requested) {
+        break;
+      }
+    };
+    glFinish();
+    auto end = std::chrono::high_resolution_clock::now();
+    double totalMs =
+        std::chrono::duration<double, std::milli>(end - start).count();
+
+    const RS::TextureStats &stats = textures.getStats();
+    std::printf("%d textures, %.1f MB level 0, %.1f MB uploaded with mips\n",
+                TEXTURES, sourceBytes / (1024.0 * 1024.0),
+                stats.totalBytesUploaded / (1024.0 * 1024.0));
+    std::printf("resident %u, failed %u, in %.1f ms over %d frames "
+                "(%.1f MB/s)\n",
+                stats.resident, stats.failed, totalMs, frames,
+                stats.totalBytesUploaded / (1024.0 * 1024.0) /
+                    (totalMs / 1000.0));
+    std::printf("worst update(): %.3f ms\n", worstUploadMs);
+    printStats("idle", idleClock.getStats());
+    printStats("streaming", streamingClock.getStats());
+  }
+
+  std::filesystem::remove_all(directory);
+  RS::Bench::destroyGLContext(context);
+  return 0;
+};
@@ -0,0 +1,144 @@
+#include "rs_bench.h"
+#include "rs_job_system.h"
+#include "rs_transform.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <random>
+#include <vector>
+
+// World matrix cost for 100k parented nodes: the usual scene graph of
+// heap nodes walked recursively every frame, against TransformHierarchy
+// with everything moving, with 1% moving and with nothing moving.
+
+namespace {
+const size_t NODES = 100000;
+const size_t ROOTS = 100;
+const size_t FAN_OUT = 4;
+const int REPETITIONS = 10;
+
+struct NaiveNode {
+  glm::vec3 position;
+  glm::quat rotation;
+  glm::vec3 scale;
+  glm::mat4 world;
+  std::vector<NaiveNode *> children;
+};
+
+void naiveUpdate(NaiveNode *node, const glm::mat4 &parent) {
+  glm::mat4 local = glm::mat4_cast(node->rotation);
+  local[0] *= node->scale.x;
+  local[1] *= node->scale.y;
+  local[2] *= node->scale.z;
+  local[3] = glm::vec4(node->position, 1.0f);
+  node->world = parent * local;
+  for (NaiveNode *child : node->children) {
+    naiveUpdate(child, node->world);
+  };
+};
+
+size_t parentOf(size_t i) { return (i - ROOTS) / FAN_OUT; };
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::mt19937 random(5);
+  std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+  std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+
+  RS::JobSystem jobs;
+  RS::TransformHierarchy hierarchy;
+  std::vector<RS::TransformHandle> handles(NODES);
+  std::vector<NaiveNode *> naive(NODES);
+  for (size_t i = 0; i < NODES; i++) {
+    glm::vec3 position(offset(random), offset(random), offset(random));
+    glm::quat rotation =
+        glm::angleAxis(angle(random), glm::normalize(glm::vec3(0.3f, 1, 0.2f)));
+    glm::vec3 scale(1.0f + offset(random) * 0.05f);
+
+    const bool root = i < ROOTS;
+    handles[i] = hierarchy.create(root ? RS::RS_NULL_TRANSFORM
+                                       : handles[parentOf(i)]);
+    hierarchy.setLocalPosition(handles[i], position);
+    hierarchy.setLocalRotation(handles[i], rotation);
+    hierarchy.setLocalScale(handles[i], scale);
+
+    naive[i] = new NaiveNode();
+    naive[i]->position = position;
+    naive[i]->rotation = rotation;
+    naive[i]->scale = scale;
+    if (!root) {
+      naive[parentOf(i)]->children.push_back(naive[i]);
+    };
+  };
+  hierarchy.update(&jobs);
+  std::printf("%zu nodes, %u levels, %u threads\n", NODES,
+              hierarchy.getStats().levels, jobs.getThreadCount());
+
+  RS::Bench::run("naive recursive, every node", NODES, REPETITIONS, [&]() {
+    for (size_t i = 0; i < ROOTS; i++) {
+      naiveUpdate(naive[i], glm::mat4(1.0f));
+    };
+  });
+
+  // Both sides have to agree before their timings mean anything
+  float worst = 0.0f;
+  for (size_t i = 0; i < NODES; i++) {
+    const glm::mat4 &a = hierarchy.getWorldMatrix(handles[i]);
+    const glm::mat4 &b = naive[i]->world;
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        float difference = std::fabs(a[column][row] - b[column][row]);
+        worst = difference > worst ? difference : worst;
+      };
+    };
+  };
+  std::printf("largest difference to the naive result: %g\n", worst);
+
+  // Moving every root dirties everything
+  float nudge = 0.001f;
+  auto moveRoots = [&]() {
+    nudge = -nudge;
+    for (size_t i = 0; i < ROOTS; i++) {
+      hierarchy.setLocalPosition(handles[i],
+                                 hierarchy.getLocalPosition(handles[i]) +
+                                     glm::vec3(nudge));
+    };
+  };
+  RS::Bench::run("hierarchy, every node dirty, 1 thread", NODES, REPETITIONS,
+                 [&]() {
+                   moveRoots();
+                   hierarchy.update();
+                 });
+  RS::Bench::run("hierarchy, every node dirty, jobs", NODES, REPETITIONS,
+                 [&]() {
+                   moveRoots();
+                   hierarchy.update(&jobs);
+                 });
+
+  std::vector<size_t> moving(NODES / 100);
+  std::uniform_int_distribution<size_t> pick(ROOTS, NODES - 1);
+  for (size_t &index : moving) {
+    index = pick(random);
+  };
+  RS::Bench::run("hierarchy, 1% of nodes moved", NODES, REPETITIONS, [&]() {
+    nudge = -nudge;
+    for (size_t index : moving) {
+      hierarchy.setLocalPosition(handles[index],
+                                 hierarchy.getLocalPosition(handles[index]) +
+                                     glm::vec3(nudge));
+    };
+    hierarchy.update(&jobs);
+  });
+  std::printf("  recomputed %u world matrices\n",
+              hierarchy.getStats().updated);
+
+  RS::Bench::run("hierarchy, nothing moved", NODES, REPETITIONS,
+                 [&]() { hierarchy.update(&jobs); });
+
+  for (NaiveNode *node : naive) {
+    delete node;
+  };
+  return 0;
+};
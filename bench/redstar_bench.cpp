@@ -0,0 +1,382 @@
+#include "classes/camera.hpp"
+#include "rs_batch_renderer.h"
+#include "rs_bench.h"
+#include "rs_bench_gl.h"
+#include "rs_bench_report.h"
+#include "rs_culling.h"
+#include "rs_event_listener.h"
+#include "rs_event_manager.h"
+#include "rs_events.h"
+#include "rs_frame_constants.h"
+#include "rs_gl.h"
+#include "rs_render_queue.h"
+#include "shader.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+// The engine's hot paths in one executable so a change in the core shows up
+// against a stored baseline:
+//
+//   redstar_bench [--filter SUITE] [--json OUT] [--baseline FILE]
+//                 [--threshold 0.10] [--no-gpu] [--window]
+//
+// Suites are events, camera, culling, sorting, shader and render. The GPU suites
+// (shader, render) run on SDL's offscreen driver unless --window is given,
+// so software GL such as llvmpipe on a build machine is fine. Exits with 1
+// when any benchmark is slower than its baseline by more than the threshold.
+// A missing baseline, or one recorded on another GL_RENDERER, fails too.
+// The bench_check and bench_baseline CMake targets wrap this.
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+namespace {
+const int REPETITIONS = 10;
+
+struct Options {
+  const char *filter = NULL;
+  const char *json = NULL;
+  const char *baseline = NULL;
+  double threshold = 0.10;
+  bool gpu = true;
+  bool headless = true;
+};
+
+bool enabled(const Options &options, const char *suite) {
+  return options.filter == NULL || std::strstr(suite, options.filter) != NULL;
+};
+
+class CountingListener : public RS::EventListener {
+public:
+  void update(const RS::RS_EVENT event) override { _count += (size_t)event; };
+
+  void updateBatch(const RS::Event *events, size_t count) override {
+    for (size_t i = 0; i < count; i++) {
+      _count += (size_t)events[i].eventType;
+    };
+  };
+
+  size_t _count = 0;
+};
+
+void benchmarkEvents() {
+  const u_int SYSTEMS = 8;
+  const u_int LISTENERS_PER_SYSTEM = 16;
+  const size_t EVENTS = 20000;
+
+  std::vector<CountingListener> listeners(SYSTEMS * LISTENERS_PER_SYSTEM);
+  RS::EventManager manager;
+  for (u_int sid = 0; sid < SYSTEMS; sid++) {
+    for (u_int i = 0; i < LISTENERS_PER_SYSTEM; i++) {
+      manager.addListener(sid, &listeners[sid * LISTENERS_PER_SYSTEM + i]);
+    };
+  };
+
+  RS::Bench::run("events/emitEvent", EVENTS, REPETITIONS, [&]() {
+    for (size_t i = 0; i < EVENTS; i++) {
+      manager.emitEvent(i % SYSTEMS, RS::RS_EVENT_WINDOW_RESIZED);
+    };
+  });
+
+  RS::Bench::run("events/queueEvent + dispatch", EVENTS, REPETITIONS, [&]() {
+    for (size_t i = 0; i < EVENTS; i++) {
+      manager.queueEvent(
+          RS::makeEvent(i % SYSTEMS, RS::RS_EVENT_WINDOW_RESIZED));
+    };
+    manager.dispatchQueuedEvents();
+  });
+
+  // Listeners coming and going, one add and one remove per item
+  const u_int CHURN_SID = SYSTEMS;
+  std::vector<CountingListener> churn(256);
+  RS::Bench::run("events/addListener + removeListener", churn.size(),
+                 REPETITIONS, [&]() {
+                   for (CountingListener &listener : churn) {
+                     manager.addListener(CHURN_SID, &listener);
+                   };
+                   for (CountingListener &listener : churn) {
+                     manager.removeListener(CHURN_SID, &listener);
+                   };
+                 });
+
+  size_t total = 0;
+  for (CountingListener &listener : listeners) {
+    total += listener._count;
+  };
+  RS::Bench::doNotOptimize(total);
+};
+
+void benchmarkCamera() {
+  const size_t UPDATES = 100000;
+  Camera camera;
+
+  RS::Bench::run("camera/ProcessMouseMovement", UPDATES, REPETITIONS, [&]() {
+    for (size_t i = 0; i < UPDATES; i++) {
+      camera.ProcessMouseMovement(i & 1 ? 0.5f : -0.5f, 0.25f);
+    };
+    RS::Bench::doNotOptimize(camera.Front);
+  });
+
+  RS::Bench::run("camera/Move", UPDATES, REPETITIONS, [&]() {
+    for (size_t i = 0; i < UPDATES; i++) {
+      camera.Move(i & 1 ? RIGHT : FORWARD, 0.001f);
+    };
+    RS::Bench::doNotOptimize(camera.Position);
+  });
+
+  // Moving invalidates the view, so every call rebuilds view, view
+  // projection and frustum
+  RS::Bench::run("camera/GetViewMatrix rebuild", UPDATES, REPETITIONS, [&]() {
+    for (size_t i = 0; i < UPDATES; i++) {
+      camera.Position.x += 0.001f;
+      RS::Bench::doNotOptimize(camera.GetViewMatrix());
+    };
+  });
+
+  RS::Bench::run("camera/GetViewMatrix cached", UPDATES, REPETITIONS, [&]() {
+    for (size_t i = 0; i < UPDATES; i++) {
+      RS::Bench::doNotOptimize(camera.GetViewMatrix());
+    };
+  });
+};
+
+void benchmarkCulling() {
+  const size_t OBJECTS = 100000;
+  RS::CullBounds bounds;
+  bounds.reserve(OBJECTS);
+  for (size_t i = 0; i < OBJECTS; i++) {
+    glm::vec3 center((float)(i % 100) - 50.0f, (float)((i / 100) % 100) - 50.0f,
+                     -(float)(i / 10000) * 10.0f);
+    bounds.push(center, glm::vec3(0.5f));
+  };
+
+  Camera camera;
+  camera.SetAspectRatio(16, 9);
+  const RS::Frustum &frustum = camera.GetFrustum();
+  std::vector<u_int32_t> visible(OBJECTS);
+  RS::Bench::run("culling/cullBoxes", OBJECTS, REPETITIONS, [&]() {
+    RS::Bench::doNotOptimize(RS::cullBoxes(frustum, bounds, visible.data()));
+  });
+};
+
+void benchmarkSorting() {
+  const u_int DRAWS = 100000;
+  // A typical frame: a few programs, a few dozen materials, any depth
+  std::vector<u_int64_t> keys(DRAWS);
+  u_int32_t seed = 1;
+  for (u_int i = 0; i < DRAWS; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    keys[i] = RS::makeSortKey(0, (seed >> 28) == 0, (seed >> 8) % 4,
+                              (seed >> 12) % 48, (float)(seed % 10000) * 0.01f);
+  };
+
+  RS::RenderQueue queue;
+  queue.reserve(DRAWS);
+  RS::Bench::run("sorting/RenderQueue record + radix sort", DRAWS,
+                 REPETITIONS, [&]() {
+                   queue.clear();
+                   for (u_int i = 0; i < DRAWS; i++) {
+                     queue.push(keys[i], i);
+                   };
+                   queue.sort();
+                   RS::Bench::doNotOptimize(queue[0]);
+                 });
+};
+
+void benchmarkShader() {
+  const size_t SETS = 100000;
+  Shader shader(REDSTAR_SHADER_DIR "/vert/main.vert",
+                REDSTAR_SHADER_DIR "/frag/main.frag");
+  shader.use();
+
+  const glm::mat4 matrix(1.0f);
+  RS::Bench::run("shader/setMat4 by name", SETS, REPETITIONS, [&]() {
+    for (size_t i = 0; i < SETS; i++) {
+      shader.setMat4("model", matrix);
+    };
+    glFinish();
+  });
+
+  const UniformHandle model = shader.getUniform("model");
+  RS::Bench::run("shader/setMat4 by handle", SETS, REPETITIONS, [&]() {
+    for (size_t i = 0; i < SETS; i++) {
+      shader.setMat4(model, matrix);
+    };
+    glFinish();
+  });
+
+  const size_t UPLOADS = 10000;
+  RS::FrameConstantsBuffer frameConstants;
+  frameConstants.init();
+  RS::FrameConstants constants;
+  constants.view = matrix;
+  constants.projection = matrix;
+  RS::Bench::run("shader/FrameConstants upload", UPLOADS, REPETITIONS, [&]() {
+    for (size_t i = 0; i < UPLOADS; i++) {
+      frameConstants.upload(constants);
+    };
+    glFinish();
+  });
+
+  glDeleteProgram(shader.ID);
+};
+
+void benchmarkRender() {
+  const u_int MESHES = 16;
+  const u_int OBJECTS = 10000;
+
+  RS::FrameConstantsBuffer frameConstants;
+  frameConstants.init();
+  RS::FrameConstants constants;
+  constants.view = glm::mat4(1.0f);
+  constants.projection = glm::mat4(1.0f);
+  frameConstants.upload(constants);
+
+  // Unit cubes stored back to back
+  std::vector<RS::Vertex> vertices;
+  for (int i = 0; i < 8; i++) {
+    RS::Vertex vertex;
+    vertex.position = glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f,
+                                i & 4 ? 0.5f : -0.5f);
+    vertex.texCoord = glm::vec2(i & 1 ? 1.0f : 0.0f, i & 2 ? 1.0f : 0.0f);
+    vertices.push_back(vertex);
+  };
+  const u_int32_t INDICES[] = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5,
+                               0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6,
+                               0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+
+  RS::BatchRenderer batch;
+  batch.init(MESHES * 8, MESHES * 36, OBJECTS);
+  for (u_int i = 0; i < MESHES; i++) {
+    batch.addMesh(vertices.data(), (u_int)vertices.size(), INDICES, 36);
+  };
+  Shader shader(REDSTAR_SHADER_DIR "/vert/instanced.vert",
+                REDSTAR_SHADER_DIR "/frag/main.frag");
+
+  std::vector<glm::mat4> models(OBJECTS);
+  for (u_int i = 0; i < OBJECTS; i++) {
+    models[i] = glm::translate(glm::mat4(1.0f),
+                               glm::vec3((float)(i % 100), (float)(i / 100), 0));
+  };
+
+  // The viewport is tiny so rasterisation stays out of the numbers
+  glViewport(0, 0, 8, 8);
+  for (int multiDraw = 0; multiDraw < 2; multiDraw++) {
+    batch.setMultiDrawIndirect(multiDraw == 1);
+    if (multiDraw == 1 && !batch.usesMultiDrawIndirect()) {
+      continue;
+    };
+    RS::Bench::run(multiDraw == 1 ? "render/submit + flush (MDI)"
+                                  : "render/submit + flush (instanced)",
+                   OBJECTS, REPETITIONS, [&]() {
+                     shader.use();
+                     for (u_int i = 0; i < OBJECTS; i++) {
+                       batch.submit(i % MESHES, models[i]);
+                     };
+                     batch.flush();
+                     glFinish();
+                   });
+  };
+
+  glDeleteProgram(shader.ID);
+};
+
+bool parseArgs(int argc, char *argv[], Options &options) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(arg, "--no-gpu") == 0) {
+      options.gpu = false;
+    } else if (std::strcmp(arg, "--window") == 0) {
+      options.headless = false;
+    } else if (std::strcmp(arg, "--filter") == 0 && hasValue) {
+      options.filter = argv[++i];
+    } else if (std::strcmp(arg, "--json") == 0 && hasValue) {
+      options.json = argv[++i];
+    } else if (std::strcmp(arg, "--baseline") == 0 && hasValue) {
+      options.baseline = argv[++i];
+    } else if (std::strcmp(arg, "--threshold") == 0 && hasValue) {
+      options.threshold = std::strtod(argv[++i], NULL);
+    } else {
+      std::fprintf(stderr, "unknown argument %s\n", arg);
+      return false;
+    };
+  };
+  return true;
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!parseArgs(argc, argv, options)) {
+    return 1;
+  };
+
+  if (enabled(options, "events")) {
+    benchmarkEvents();
+  };
+  if (enabled(options, "camera")) {
+    benchmarkCamera();
+  };
+  if (enabled(options, "culling")) {
+    benchmarkCulling();
+  };
+  if (enabled(options, "sorting")) {
+    benchmarkSorting();
+  };
+
+  std::string renderer = "none";
+  const bool gpu = options.gpu && (enabled(options, "shader") ||
+                                   enabled(options, "render"));
+  if (gpu) {
+    RS::Bench::GLContext context;
+    if (!RS::Bench::createGLContext(context, 1280, 720, options.headless)) {
+      return 1;
+    };
+    renderer = (const char *)glGetString(GL_RENDERER);
+    std::printf("GL_RENDERER: %s\n", renderer.c_str());
+
+    if (enabled(options, "shader")) {
+      benchmarkShader();
+    };
+    if (enabled(options, "render")) {
+      benchmarkRender();
+    };
+    RS::Bench::destroyGLContext(context);
+  };
+
+  if (options.json != NULL && !RS::Bench::writeJSON(options.json,
+                                                    renderer.c_str())) {
+    return 1;
+  };
+
+  if (options.baseline == NULL) {
+    return 0;
+  };
+  // A gate that cannot compare must not pass
+  std::map<std::string, RS::Bench::BaselineEntry> baseline;
+  std::string baselineRenderer;
+  if (!RS::Bench::readBaseline(options.baseline, baseline,
+                               baselineRenderer)) {
+    std::printf("no baseline at %s, record one with the bench_baseline "
+                "target\n",
+                options.baseline);
+    return 1;
+  };
+  if (baselineRenderer != renderer) {
+    std::printf("baseline was recorded on \"%s\", this is \"%s\", numbers "
+                "are not comparable\n",
+                baselineRenderer.c_str(), renderer.c_str());
+    return 1;
+  };
+  int regressions = RS::Bench::compareBaseline(baseline, options.threshold);
+  std::printf("%d regression(s) beyond %.0f%%\n", regressions,
+              options.threshold * 100.0);
+  return regressions == 0 ? 0 : 1;
+};
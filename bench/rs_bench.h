@@ -0,0 +1,53 @@
+#ifndef RS_BENCH_H
+#define RS_BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace RS {
+namespace Bench {
+struct Result {
+  std::string name;
+  size_t items;
+  double nsPerItem;
+};
+
+// Every run() of this process, in order, for rs_bench_report.h
+inline std::vector<Result> &results() {
+  static std::vector<Result> all;
+  return all;
+};
+
+// Keeps the compiler from optimising away a value we only compute for timing
+template <typename T> inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+};
+
+// Runs fn repetitions times, keeps the fastest run and prints the cost per
+// item. Returns the best time in nanoseconds per item.
+template <typename Func>
+double run(const char *name, size_t items, int repetitions, Func fn) {
+  double best = 0.0;
+  for (int i = 0; i < repetitions; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    auto end = std::chrono::high_resolution_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    if (i == 0 || ns < best) {
+      best = ns;
+    }
+  };
+
+  double perItem = items == 0 ? best : best / (double)items;
+  std::printf("%-44s %10zu items %10.3f ns/item %10.2f Mitems/s\n", name,
+              items, perItem, perItem > 0.0 ? 1000.0 / perItem : 0.0);
+  results().push_back({name, items, perItem});
+  return perItem;
+};
+} // namespace Bench
+} // namespace RS
+
+#endif // !RS_BENCH_H
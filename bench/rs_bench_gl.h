@@ -0,0 +1,61 @@
+#ifndef RS_BENCH_GL_H
+#define RS_BENCH_GL_H
+
+#include <SDL3/SDL.h>
+#include <cstdio>
+
+namespace RS {
+namespace Bench {
+// Hidden window with a current GL 4.5 core context for the GPU benchmarks.
+// Runs on software GL as well, e.g. LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe.
+// headless uses SDL's offscreen video driver so no display is needed.
+struct GLContext {
+  SDL_Window *window;
+  SDL_GLContext context;
+};
+
+inline bool createGLContext(GLContext &out, int width = 1280,
+                            int height = 720, bool headless = false) {
+  out.window = NULL;
+  out.context = NULL;
+  if (headless) {
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+  }
+  if (!SDL_InitSubSystem(SDL_INIT_VIDEO)) {
+    std::fprintf(stderr, "SDL video init failed: %s\n", SDL_GetError());
+    return false;
+  }
+
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+  out.window = SDL_CreateWindow("RedStar bench", width, height,
+                                SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (out.window == NULL) {
+    std::fprintf(stderr, "window creation failed: %s\n", SDL_GetError());
+    return false;
+  }
+
+  out.context = SDL_GL_CreateContext(out.window);
+  if (out.context == NULL) {
+    std::fprintf(stderr, "GL context creation failed: %s\n", SDL_GetError());
+    return false;
+  }
+  SDL_GL_SetSwapInterval(0);
+  return true;
+};
+
+inline void destroyGLContext(GLContext &context) {
+  if (context.context != NULL) {
+    SDL_GL_DestroyContext(context.context);
+  }
+  if (context.window != NULL) {
+    SDL_DestroyWindow(context.window);
+  }
+  SDL_Quit();
+};
+} // namespace Bench
+} // namespace RS
+
+#endif // !RS_BENCH_GL_H
@@ -0,0 +1,162 @@
+#ifndef RS_BENCH_REPORT_H
+#define RS_BENCH_REPORT_H
+
+#include "rs_bench.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace RS {
+namespace Bench {
+// Writes results() as JSON:
+//   {"version": 1, "renderer": "...", "results": [
+//     {"name": "...", "items": N, "ns_per_item": X}, ...]}
+// A baseline is the same file, optionally with a "threshold" on an entry to
+// override the global one for a noisy benchmark.
+inline bool writeJSON(const char *path, const char *renderer) {
+  FILE *file = std::fopen(path, "w");
+  if (file == NULL) {
+    std::fprintf(stderr, "could not write %s\n", path);
+    return false;
+  };
+  std::fprintf(file, "{\n  \"version\": 1,\n  \"renderer\": \"%s\",\n",
+               renderer);
+  std::fprintf(file, "  \"results\": [\n");
+  const std::vector<Result> &all = results();
+  for (size_t i = 0; i < all.size(); i++) {
+    std::fprintf(file,
+                 "    {\"name\": \"%s\", \"items\": %zu, "
+                 "\"ns_per_item\": %.4f}%s\n",
+                 all[i].name.c_str(), all[i].items, all[i].nsPerItem,
+                 i + 1 < all.size() ? "," : "");
+  };
+  std::fprintf(file, "  ]\n}\n");
+  return std::fclose(file) == 0;
+};
+
+struct BaselineEntry {
+  double nsPerItem;
+  // Below zero uses the global threshold
+  double threshold;
+};
+
+namespace Detail {
+// Number following "key": inside [begin, end), false if it is not there
+inline bool findNumber(const char *begin, const char *end, const char *key,
+                       double &out) {
+  std::string pattern = std::string("\"") + key + "\"";
+  const char *found = std::strstr(begin, pattern.c_str());
+  if (found == NULL || found >= end) {
+    return false;
+  };
+  const char *colon = std::strchr(found + pattern.size(), ':');
+  if (colon == NULL || colon >= end) {
+    return false;
+  };
+  out = std::strtod(colon + 1, NULL);
+  return true;
+};
+
+// String following "key": anywhere in text, false if it is not there
+inline bool findString(const char *text, const char *key, std::string &out) {
+  std::string pattern = std::string("\"") + key + "\"";
+  const char *found = std::strstr(text, pattern.c_str());
+  if (found == NULL) {
+    return false;
+  };
+  const char *colon = std::strchr(found + pattern.size(), ':');
+  const char *open = colon == NULL ? NULL : std::strchr(colon, '"');
+  const char *close = open == NULL ? NULL : std::strchr(open + 1, '"');
+  if (close == NULL) {
+    return false;
+  };
+  out.assign(open + 1, close);
+  return true;
+};
+} // namespace Detail
+
+// Only understands what writeJSON() produces, plus "threshold". renderer
+// is the GL_RENDERER the baseline was recorded on.
+inline bool readBaseline(const char *path,
+                         std::map<std::string, BaselineEntry> &out,
+                         std::string &renderer) {
+  FILE *file = std::fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  };
+  std::string text;
+  char buffer[4096];
+  size_t read = 0;
+  while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    text.append(buffer, read);
+  };
+  std::fclose(file);
+
+  if (!Detail::findString(text.c_str(), "renderer", renderer)) {
+    std::fprintf(stderr, "malformed baseline %s\n", path);
+    return false;
+  };
+  const char *cursor = std::strstr(text.c_str(), "\"results\"");
+  while (cursor != NULL) {
+    const char *name = std::strstr(cursor, "\"name\"");
+    if (name == NULL) {
+      break;
+    };
+    const char *objectEnd = std::strchr(name, '}');
+    const char *open = std::strchr(name + 6, '"');
+    const char *close = open == NULL ? NULL : std::strchr(open + 1, '"');
+    if (objectEnd == NULL || close == NULL || close > objectEnd) {
+      std::fprintf(stderr, "malformed baseline %s\n", path);
+      return false;
+    };
+
+    BaselineEntry entry;
+    entry.threshold = -1.0;
+    if (Detail::findNumber(name, objectEnd, "ns_per_item", entry.nsPerItem)) {
+      Detail::findNumber(name, objectEnd, "threshold", entry.threshold);
+      out[std::string(open + 1, close)] = entry;
+    };
+    cursor = objectEnd + 1;
+  };
+  return true;
+};
+
+// Prints every result next to its baseline, returns how many got slower
+// than baseline * (1 + threshold). Benchmarks missing from the baseline are
+// reported but never count as regressions.
+inline int compareBaseline(const std::map<std::string, BaselineEntry> &baseline,
+                           double threshold) {
+  int regressions = 0;
+  std::printf("\n%-44s %12s %12s %9s\n", "benchmark", "baseline ns",
+              "current ns", "change");
+  for (const Result &result : results()) {
+    auto entry = baseline.find(result.name);
+    if (entry == baseline.end()) {
+      std::printf("%-44s %12s %12.3f %9s\n", result.name.c_str(), "-",
+                  result.nsPerItem, "new");
+      continue;
+    };
+
+    const double allowed =
+        entry->second.threshold >= 0.0 ? entry->second.threshold : threshold;
+    const double change =
+        entry->second.nsPerItem > 0.0
+            ? result.nsPerItem / entry->second.nsPerItem - 1.0
+            : 0.0;
+    const bool regressed = change > allowed;
+    if (regressed) {
+      regressions++;
+    };
+    std::printf("%-44s %12.3f %12.3f %+8.1f%%%s\n", result.name.c_str(),
+                entry->second.nsPerItem, result.nsPerItem, change * 100.0,
+                regressed ? "  REGRESSION" : "");
+  };
+  return regressions;
+};
+} // namespace Bench
+} // namespace RS
+
+#endif // !RS_BENCH_REPORT_H
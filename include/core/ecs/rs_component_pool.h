@@ -0,0 +1,100 @@
+#ifndef RS_COMPONENT_POOL_H
+#define RS_COMPONENT_POOL_H
+
+#include "rs_entity.h"
+#include <cstddef>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace RS {
+// Type erased base so the Registry can clean up every pool when an entity
+// is destroyed without knowing the component types.
+class ComponentPoolBase {
+public:
+  virtual ~ComponentPoolBase() {};
+
+  virtual bool remove(u_int32_t index) = 0;
+
+  inline bool contains(u_int32_t index) const {
+    return index < _sparse.size() && _sparse[index] != RS_INVALID_INDEX;
+  };
+
+  inline size_t size() const { return _entities.size(); };
+
+  // Entity indices in the same order as the packed component data
+  inline const u_int32_t *entities() const { return _entities.data(); };
+
+protected:
+  // _sparse maps an entity index to its slot in the packed arrays,
+  // _entities maps a slot back to the entity index.
+  std::vector<u_int32_t> _sparse;
+  std::vector<u_int32_t> _entities;
+};
+
+// Sparse set storage. Components of one type live contiguously in _data so
+// systems iterating a single component stream through memory linearly.
+template <typename T> class ComponentPool : public ComponentPoolBase {
+public:
+  ComponentPool() {};
+  ~ComponentPool() override {};
+
+  void reserve(size_t count) {
+    _entities.reserve(count);
+    _data.reserve(count);
+  };
+
+  T &insert(u_int32_t index, const T &component) {
+    if (index >= _sparse.size()) {
+      _sparse.resize(index + 1, RS_INVALID_INDEX);
+    }
+
+    if (_sparse[index] != RS_INVALID_INDEX) {
+      _data[_sparse[index]] = component;
+      return _data[_sparse[index]];
+    }
+
+    _sparse[index] = (u_int32_t)_entities.size();
+    _entities.push_back(index);
+    _data.push_back(component);
+    return _data.back();
+  };
+
+  // Swap-and-pop keeps the arrays packed
+  bool remove(u_int32_t index) override {
+    if (!contains(index)) {
+      return false;
+    }
+
+    u_int32_t slot = _sparse[index];
+    u_int32_t last = (u_int32_t)_entities.size() - 1;
+    if (slot != last) {
+      _entities[slot] = _entities[last];
+      _data[slot] = std::move(_data[last]);
+      _sparse[_entities[slot]] = slot;
+    }
+
+    _entities.pop_back();
+    _data.pop_back();
+    _sparse[index] = RS_INVALID_INDEX;
+    return true;
+  };
+
+  // Caller must check contains() first
+  inline T &get(u_int32_t index) { return _data[_sparse[index]]; };
+  inline const T &get(u_int32_t index) const { return _data[_sparse[index]]; };
+
+  inline T *tryGet(u_int32_t index) {
+    return contains(index) ? &_data[_sparse[index]] : NULL;
+  };
+
+  inline T *data() { return _data.data(); };
+  inline const T *data() const { return _data.data(); };
+
+private:
+  std::vector<T> _data;
+};
+
+} // namespace RS
+
+#endif // !RS_COMPONENT_POOL_H
@@ -0,0 +1,56 @@
+#ifndef RS_COMPONENTS_H
+#define RS_COMPONENTS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <sys/types.h>
+
+namespace RS {
+// Components are plain data. Every component type gets its own tightly
+// packed pool in the Registry, so keep them small and trivially copyable.
+
+struct Position {
+  glm::vec3 value;
+};
+
+// Position at the previous simulation tick, entities that own it are drawn
+// interpolated between the last two ticks
+struct PreviousPosition {
+  glm::vec3 value;
+};
+
+struct Rotation {
+  glm::quat value;
+};
+
+struct Scale {
+  glm::vec3 value;
+};
+
+struct Velocity {
+  glm::vec3 value;
+};
+
+// Node in the engine's TransformHierarchy, see rs_transform.h. Position,
+// Rotation and Scale of the entity become the node's local transform and
+// the entity is drawn with the node's world matrix.
+struct Transform {
+  u_int32_t node;
+};
+
+struct Renderable {
+  u_int mesh;
+  u_int material;
+};
+
+// Point light at the entity's Position. Only materials drawn with the LIT
+// shader feature are lit by it.
+struct PointLight {
+  glm::vec3 color;
+  float intensity;
+  float radius; // Falls off to nothing here
+};
+
+} // namespace RS
+
+#endif // !RS_COMPONENTS_H
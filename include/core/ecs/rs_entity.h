@@ -0,0 +1,28 @@
+#ifndef RS_ENTITY_H
+#define RS_ENTITY_H
+
+#include <cstdint>
+#include <sys/types.h>
+
+namespace RS {
+// An entity is only an index into the component pools plus a generation.
+// The generation is bumped every time an index is recycled so that stale
+// handles held by other systems can be detected.
+struct EntityID {
+  u_int32_t index;
+  u_int32_t generation;
+
+  inline bool operator==(const EntityID &other) const {
+    return index == other.index && generation == other.generation;
+  };
+  inline bool operator!=(const EntityID &other) const {
+    return !(*this == other);
+  };
+};
+
+const u_int32_t RS_INVALID_INDEX = UINT32_MAX;
+const EntityID RS_NULL_ENTITY = {RS_INVALID_INDEX, 0};
+
+} // namespace RS
+
+#endif // !RS_ENTITY_H
@@ -0,0 +1,56 @@
+#include "rs_registry.h"
+#include "rs_component_pool.h"
+#include "rs_entity.h"
+#include <atomic>
+#include <sys/types.h>
+
+u_int ::RS::nextComponentTypeID() {
+  static std::atomic<u_int> counter{0};
+  return counter.fetch_add(1);
+};
+
+::RS::Registry::~Registry() {
+  for (ComponentPoolBase *pool : _pools) {
+    delete pool;
+  };
+  _pools.clear();
+};
+
+::RS::EntityID RS::Registry::createEntity() {
+  u_int32_t index;
+  if (!_free_indices.empty()) {
+    index = _free_indices.back();
+    _free_indices.pop_back();
+  } else {
+    index = (u_int32_t)_generations.size();
+    _generations.push_back(0);
+    _alive.push_back(false);
+  };
+
+  _alive[index] = true;
+  _alive_count++;
+  return EntityID{index, _generations[index]};
+};
+
+bool ::RS::Registry::destroyEntity(EntityID entity) {
+  if (!isAlive(entity)) {
+    return false;
+  };
+
+  for (ComponentPoolBase *pool : _pools) {
+    if (pool != NULL) {
+      pool->remove(entity.index);
+    }
+  };
+
+  _alive[entity.index] = false;
+  _generations[entity.index]++;
+  _free_indices.push_back(entity.index);
+  _alive_count--;
+  return true;
+};
+
+bool ::RS::Registry::isAlive(EntityID entity) const {
+  return entity.index < _generations.size() && _alive[entity.index] &&
+         _generations[entity.index] == entity.generation;
+};
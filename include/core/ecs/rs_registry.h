@@ -0,0 +1,206 @@
+#ifndef RS_REGISTRY_H
+#define RS_REGISTRY_H
+
+#include "rs_component_pool.h"
+#include "rs_entity.h"
+#include <bitset>
+#include <cstddef>
+#include <sys/types.h>
+#include <tuple>
+#include <vector>
+
+namespace RS {
+const u_int RS_MAX_COMPONENTS = 64;
+typedef std::bitset<RS_MAX_COMPONENTS> ComponentMask;
+
+// Hands out a new id every time a component type is seen for the first time
+u_int nextComponentTypeID();
+
+template <typename T> u_int componentTypeID() {
+  static const u_int id = nextComponentTypeID();
+  return id;
+};
+
+template <typename... Ts> ComponentMask componentMask() {
+  ComponentMask mask;
+  (mask.set(componentTypeID<Ts>()), ...);
+  return mask;
+};
+
+// A View streams every entity that owns all of Ts. Iteration is driven by
+// the smallest pool so the membership checks on the other pools stay cheap.
+template <typename... Ts> class View {
+public:
+  View(const u_int32_t *generations, ComponentPool<Ts> *...pools)
+      : _generations(generations), _pools(pools...) {};
+
+  // fn(EntityID, Ts &...)
+  template <typename Func> void each(Func fn) {
+    const ComponentPoolBase *driver = smallestPool();
+    if (driver == NULL) {
+      return;
+    }
+
+    const u_int32_t *entities = driver->entities();
+    const size_t count = driver->size();
+    for (size_t i = 0; i < count; i++) {
+      visit(i, entities[i], fn);
+    }
+  };
+
+  // Same as each() but only visits slots [begin, end) of the driving pool,
+  // used to split a view across several workers.
+  template <typename Func> void eachInRange(size_t begin, size_t end, Func fn) {
+    const ComponentPoolBase *driver = smallestPool();
+    if (driver == NULL) {
+      return;
+    }
+
+    const u_int32_t *entities = driver->entities();
+    if (end > driver->size()) {
+      end = driver->size();
+    }
+    for (size_t i = begin; i < end; i++) {
+      visit(i, entities[i], fn);
+    }
+  };
+
+  // Upper bound on the number of entities each() will visit
+  size_t sizeHint() const {
+    const ComponentPoolBase *driver = smallestPool();
+    return driver == NULL ? 0 : driver->size();
+  };
+
+private:
+  const ComponentPoolBase *smallestPool() const {
+    const ComponentPoolBase *smallest = NULL;
+    const ComponentPoolBase *candidates[] = {
+        static_cast<const ComponentPoolBase *>(
+            std::get<ComponentPool<Ts> *>(_pools))...};
+    for (const ComponentPoolBase *pool : candidates) {
+      if (pool == NULL) {
+        return NULL; // A missing pool means no entity can match
+      }
+      if (smallest == NULL || pool->size() < smallest->size()) {
+        smallest = pool;
+      }
+    }
+    return smallest;
+  };
+
+  // Pools filled in the same order share their packing, in that case the
+  // slot of the driving pool can be used directly and the sparse lookup is
+  // skipped.
+  template <typename T>
+  static inline T *lookup(ComponentPool<T> *pool, size_t slot,
+                          u_int32_t index) {
+    if (slot < pool->size() && pool->entities()[slot] == index) {
+      return pool->data() + slot;
+    }
+    return pool->tryGet(index);
+  };
+
+  template <typename Func>
+  inline void visit(size_t slot, u_int32_t index, Func &fn) {
+    std::tuple<Ts *...> components(
+        lookup(std::get<ComponentPool<Ts> *>(_pools), slot, index)...);
+    if (!((std::get<Ts *>(components) != NULL) && ...)) {
+      return;
+    }
+    fn(EntityID{index, _generations[index]}, *std::get<Ts *>(components)...);
+  };
+
+  const u_int32_t *_generations;
+  std::tuple<ComponentPool<Ts> *...> _pools;
+};
+
+class Registry {
+public:
+  // Constructor
+  Registry() { _alive_count = 0; };
+
+  Registry(const Registry &) = delete;
+  Registry &operator=(const Registry &) = delete;
+
+  // Deconstructor
+  ~Registry();
+
+  EntityID createEntity();
+  // Removes every component and retires the handle. False for a handle
+  // that is stale or already destroyed, nothing changes then.
+  bool destroyEntity(EntityID entity);
+  bool isAlive(EntityID entity) const;
+
+  inline size_t getEntityCount() const { return _alive_count; };
+
+  // Reserve room for count components of type T up front
+  template <typename T> void reserve(size_t count) {
+    getPool<T>().reserve(count);
+  };
+
+  // Returns NULL if the entity is dead
+  template <typename T> T *addComponent(EntityID entity, const T &component) {
+    if (!isAlive(entity)) {
+      return NULL;
+    }
+    return &getPool<T>().insert(entity.index, component);
+  };
+
+  template <typename T> bool removeComponent(EntityID entity) {
+    ComponentPool<T> *pool = findPool<T>();
+    if (pool == NULL || !isAlive(entity)) {
+      return false;
+    }
+    return pool->remove(entity.index);
+  };
+
+  template <typename T> bool hasComponent(EntityID entity) const {
+    const ComponentPool<T> *pool = findPool<T>();
+    return pool != NULL && isAlive(entity) && pool->contains(entity.index);
+  };
+
+  // Returns NULL if the entity is dead or does not own a T
+  template <typename T> T *getComponent(EntityID entity) {
+    ComponentPool<T> *pool = findPool<T>();
+    if (pool == NULL || !isAlive(entity)) {
+      return NULL;
+    }
+    return pool->tryGet(entity.index);
+  };
+
+  template <typename T> ComponentPool<T> &getPool() {
+    const u_int id = componentTypeID<T>();
+    if (id >= _pools.size()) {
+      _pools.resize(id + 1, NULL);
+    }
+    if (_pools[id] == NULL) {
+      _pools[id] = new ComponentPool<T>();
+    }
+    return *static_cast<ComponentPool<T> *>(_pools[id]);
+  };
+
+  template <typename... Ts> View<Ts...> view() {
+    return View<Ts...>(_generations.data(), findPool<Ts>()...);
+  };
+
+private:
+  template <typename T> ComponentPool<T> *findPool() const {
+    const u_int id = componentTypeID<T>();
+    if (id >= _pools.size()) {
+      return NULL;
+    }
+    return static_cast<ComponentPool<T> *>(_pools[id]);
+  };
+
+  // Indexed by EntityID::index
+  std::vector<u_int32_t> _generations;
+  std::vector<bool> _alive;
+  std::vector<u_int32_t> _free_indices;
+  size_t _alive_count;
+
+  // Indexed by componentTypeID<T>()
+  std::vector<ComponentPoolBase *> _pools;
+};
+} // namespace RS
+
+#endif // !RS_REGISTRY_H
@@ -0,0 +1,336 @@
+#include "engine.h"
+#include "classes/camera.hpp"
+#include "rs_components.h"
+#include "rs_frame_clock.h"
+#include "rs_memory.h"
+#include "rs_profiler.h"
+#include <SDL3/SDL_video.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+
+namespace {
+// Spin, then yield, then sleep while waiting on the other thread
+void backoff(u_int attempt) {
+  if (attempt < 256) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  };
+};
+
+u_int64_t elapsedNs(RS::Clock::time_point start) {
+  return (u_int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             RS::Clock::now() - start)
+      .count();
+};
+} // namespace
+
+void ::RS::Engine::run() {
+  const double fixedStep = 1.0 / _config.tickRate;
+  // Never try to catch up on more than maxTicksPerFrame ticks
+  const double maxFrameTime = fixedStep * _config.maxTicksPerFrame;
+  // Headless has no display to sync with
+  const bool vsync = _config.vsync && !_config.window.headless;
+  const bool capped = !vsync && _config.targetFrameRate > 0.0;
+  const std::chrono::microseconds spinThreshold(_config.spinThresholdUs);
+  const Clock::duration targetFrame =
+      std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+          capped ? 1.0 / _config.targetFrameRate : 0.0));
+
+  double accumulator = 0.0;
+  _exit_requested = false;
+  _frame_clock.beginFrame();
+
+  RS_PROFILE_THREAD("Main");
+  if (_config.renderThread) {
+    startRenderThread();
+  };
+
+  while (!_exit_requested) {
+    RS_PROFILE_FRAME();
+    _frame_arena.beginFrame();
+    const u_int64_t heapAllocations = getHeapAllocationCount();
+
+    {
+      RS_PROFILE_SCOPE("Events");
+      if (!_input_system->pollEvents()) {
+        _exit_requested = true;
+      };
+
+      // Deliver everything systems queued during the last frame
+      _event_manager->dispatchQueuedEvents();
+    }
+
+    u_int ticks = 0;
+    while (accumulator >= fixedStep && ticks < _config.maxTicksPerFrame) {
+      RS_PROFILE_SCOPE("Simulation tick");
+      storePreviousState();
+      tickSystems((float)fixedStep);
+      accumulator -= fixedStep;
+      ticks++;
+    };
+
+    // Whatever is still owed past the catch-up limit is dropped
+    u_int64_t missed = 0;
+    if (accumulator >= fixedStep) {
+      missed = (u_int64_t)(accumulator / fixedStep);
+      accumulator -= (double)missed * fixedStep;
+    };
+    _frame_clock.recordTicks(ticks, missed);
+
+    _interpolation_alpha = (float)(accumulator / fixedStep);
+    {
+      const Clock::time_point buildStart = Clock::now();
+      // Input that came in while the simulation ran still makes this frame
+      latchCamera();
+      RenderPacket &packet = _packets.getWriteBuffer();
+      packet.frameIndex = _frame_index;
+      packet.oldestInputNs = _input_system->getState().oldestEventNs;
+      _render_system->buildPacket(*_registry, _interpolation_alpha, packet);
+      _build_ns += elapsedNs(buildStart);
+
+      if (_config.renderThread) {
+        RS_PROFILE_SCOPE("Render handoff");
+        // Never drop a packet, wait until the render thread took the last
+        const Clock::time_point handoffStart = Clock::now();
+        for (u_int attempt = 0; !_packets.tryPublish(); attempt++) {
+          backoff(attempt);
+        };
+        _handoff_ns += elapsedNs(handoffStart);
+      } else {
+        renderFrame(packet);
+        _input_system->markSubmitted(packet.oldestInputNs);
+        _submitted_frames.fetch_add(1, std::memory_order_relaxed);
+      };
+    }
+
+    // With a render thread its share is counted there
+    checkAllocations(_frame_index, heapAllocations, "MAIN");
+
+    _frame_index++;
+    if (_config.maxFrames != 0 && _frame_index >= _config.maxFrames) {
+      _exit_requested = true;
+    };
+
+    if (capped) {
+      RS_PROFILE_SCOPE("Frame pacing");
+      FrameClock::waitUntil(_frame_clock.getFrameStart() + targetFrame,
+                            spinThreshold);
+    };
+
+    double frameTime = _frame_clock.beginFrame();
+    if (_config.deterministic) {
+      // The clock still measures the frame for the stats
+      frameTime = fixedStep;
+    };
+    _frame_delta_time = (float)frameTime;
+    accumulator += frameTime < maxFrameTime ? frameTime : maxFrameTime;
+    if (frameTime > maxFrameTime) {
+      _frame_clock.recordTicks(
+          0, (u_int64_t)((frameTime - maxFrameTime) / fixedStep));
+    };
+  };
+
+  if (_config.renderThread) {
+    stopRenderThread();
+  };
+
+  if (_config.recordShaderManifest && !_config.shaderManifest.empty()) {
+    _shader_library->writeManifest(_config.shaderManifest.c_str());
+  };
+};
+
+void ::RS::Engine::setCamera(Camera *camera) {
+  _camera = camera;
+  if (_camera != NULL) {
+    _camera->SetAspectRatio(_window_system->getWidth(),
+                            _window_system->getHeight());
+  };
+  if (!_config.window.headless && _config.relativeMouse) {
+    _input_system->setRelativeMouseMode(getWindow(), _camera != NULL);
+  };
+};
+
+void ::RS::Engine::latchCamera() {
+  RS_PROFILE_SCOPE("Input latch");
+  _input_system->latch();
+  const InputState &input = _input_system->getState();
+  if (input.quit) {
+    _exit_requested = true;
+  };
+  if (_camera == NULL) {
+    return;
+  };
+
+  if (input.mouseDx != 0.0f || input.mouseDy != 0.0f) {
+    // Screen y grows downwards, pitch upwards
+    _camera->ProcessMouseMovement(input.mouseDx, -input.mouseDy);
+  };
+  if (input.isDown(RS_ACTION_MOVE_FORWARD)) {
+    _camera->Move(FORWARD, _frame_delta_time);
+  };
+  if (input.isDown(RS_ACTION_MOVE_BACKWARD)) {
+    _camera->Move(BACKWARD, _frame_delta_time);
+  };
+  if (input.isDown(RS_ACTION_MOVE_LEFT)) {
+    _camera->Move(LEFT, _frame_delta_time);
+  };
+  if (input.isDown(RS_ACTION_MOVE_RIGHT)) {
+    _camera->Move(RIGHT, _frame_delta_time);
+  };
+
+  _render_system->setViewProjection(_camera->GetViewMatrix(),
+                                    _camera->GetProjectionMatrix(),
+                                    _camera->GetFrustum());
+};
+
+void ::RS::Engine::renderFrame(const RenderPacket &packet) {
+  RS_PROFILE_GPU_FRAME(packet.frameIndex);
+  {
+    RS_PROFILE_SCOPE("Render");
+    // Pick up programs that finished compiling in the background
+    _shader_cache->poll();
+    if (_dynamic_resolution != NULL) {
+      _dynamic_resolution->beginFrame();
+      _render_system->setTargetSize(_dynamic_resolution->getRenderWidth(),
+                                    _dynamic_resolution->getRenderHeight(),
+                                    _dynamic_resolution->getTargetWidth(),
+                                    _dynamic_resolution->getTargetHeight());
+    } else {
+      _window_system->beginFrame();
+    };
+    // Budgeted, a burst of new textures spreads over several frames
+    _texture_manager->update();
+    _render_system->submit(packet);
+  }
+  if (_dynamic_resolution != NULL) {
+    _dynamic_resolution->endFrame();
+    RS_PROFILE_GPU_SCOPE("Upscale");
+    _window_system->beginFrame();
+    _dynamic_resolution->upscale();
+  };
+  captureFrame(packet.frameIndex);
+  {
+    RS_PROFILE_SCOPE("Swap");
+    _window_system->present();
+  }
+};
+
+void ::RS::Engine::startRenderThread() {
+  // The context can only be current on one thread at a time
+  _window_system->releaseContext();
+  _render_running.store(true, std::memory_order_release);
+  _render_thread = std::thread(&Engine::renderThreadLoop, this);
+};
+
+void ::RS::Engine::stopRenderThread() {
+  // Packets published before this still get drawn
+  _render_running.store(false, std::memory_order_release);
+  _render_thread.join();
+  // Everything GL gets destroyed from here
+  _window_system->makeCurrent();
+};
+
+void ::RS::Engine::renderThreadLoop() {
+  RS_PROFILE_THREAD("Render");
+  _window_system->makeCurrent();
+
+  Clock::time_point idleStart = Clock::now();
+  u_int attempt = 0;
+  for (;;) {
+    // Read before looking for a packet, so once it reads false every
+    // packet is visible
+    const bool running = _render_running.load(std::memory_order_acquire);
+    if (!_packets.acquire()) {
+      if (!running) {
+        break;
+      };
+      backoff(attempt++);
+      continue;
+    };
+    attempt = 0;
+
+    const Clock::time_point submitStart = Clock::now();
+    _idle_ns.fetch_add(elapsedNs(idleStart), std::memory_order_relaxed);
+    const RenderPacket &packet = _packets.getReadBuffer();
+    const u_int64_t heapAllocations = getHeapAllocationCount();
+    renderFrame(packet);
+    checkAllocations(packet.frameIndex, heapAllocations, "RENDER");
+    // Only this thread records latencies while it runs
+    _input_system->markSubmitted(packet.oldestInputNs);
+    _submit_ns.fetch_add(elapsedNs(submitStart), std::memory_order_relaxed);
+    _submitted_frames.fetch_add(1, std::memory_order_release);
+    idleStart = Clock::now();
+  };
+
+  _window_system->releaseContext();
+};
+
+void ::RS::Engine::checkAllocations(u_int64_t frameIndex, u_int64_t before,
+                                    const char *thread) {
+  if (!heapTrackingEnabled() ||
+      frameIndex < _config.allocationCheckWarmupFrames) {
+    return;
+  };
+  const u_int64_t allocations = getHeapAllocationCount() - before;
+  if (allocations > 0) {
+    _steady_state_allocations.fetch_add(allocations,
+                                        std::memory_order_relaxed);
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "%s THREAD FRAME %llu MADE %llu HEAP ALLOCATIONS\n", thread,
+                 (unsigned long long)frameIndex,
+                 (unsigned long long)allocations);
+  };
+};
+
+::RS::RenderThreadStats RS::Engine::getRenderThreadStats() const {
+  RenderThreadStats stats = {};
+  stats.frames = _submitted_frames.load(std::memory_order_acquire);
+  if (stats.frames == 0) {
+    return stats;
+  };
+
+  const double scale = 1.0 / (1000000.0 * (double)stats.frames);
+  stats.buildMs = (double)_build_ns * scale;
+  stats.handoffMs = (double)_handoff_ns * scale;
+  stats.submitMs = (double)_submit_ns.load(std::memory_order_relaxed) * scale;
+  stats.idleMs = (double)_idle_ns.load(std::memory_order_relaxed) * scale;
+  return stats;
+};
+
+void ::RS::Engine::captureFrame(u_int64_t frameIndex) {
+  if (std::find(_config.captureFrames.begin(), _config.captureFrames.end(),
+                frameIndex) == _config.captureFrames.end()) {
+    return;
+  };
+  RS_PROFILE_SCOPE("Capture");
+
+  if (!SDL_CreateDirectory(_config.captureDirectory.c_str())) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "COULD NOT CREATE %s: %s\n",
+                 _config.captureDirectory.c_str(), SDL_GetError());
+    return;
+  };
+
+  char name[64];
+  if (_config.captureRaw) {
+    std::snprintf(name, sizeof(name), "/frame_%06llu_%dx%d.rgba",
+                  (unsigned long long)frameIndex,
+                  _window_system->getWidth(), _window_system->getHeight());
+  } else {
+    std::snprintf(name, sizeof(name), "/frame_%06llu.png",
+                  (unsigned long long)frameIndex);
+  };
+  std::string path = _config.captureDirectory + name;
+  _window_system->captureFrame(path.c_str(), _config.captureRaw);
+};
+
+void ::RS::Engine::storePreviousState() {
+  _registry->view<Position, PreviousPosition>().each(
+      [](EntityID, Position &position, PreviousPosition &previous) {
+        previous.value = position.value;
+      });
+};
@@ -1,38 +1,262 @@
 #ifndef RS_ENGINE_H
 #define RS_ENGINE_H
 
+#include "rs_dynamic_resolution.h"
 #include "rs_event_manager.h"
+#include "rs_frame_clock.h"
+#include "rs_input.h"
+#include "rs_job_system.h"
+#include "rs_linear_arena.h"
+#include "rs_memory.h"
+#include "rs_movement.h"
+#include "rs_profiler.h"
+#include "rs_registry.h"
 #include "rs_render.h"
+#include "rs_shader_cache.h"
+#include "rs_shader_variants.h"
 #include "rs_system.h"
+#include "rs_system_graph.h"
+#include "rs_texture_manager.h"
+#include "rs_transform_system.h"
+#include "rs_triple_buffer.h"
 #include "rs_window.h"
 #include <SDL3/SDL_video.h>
+#include <atomic>
 #include <cstdio>
 #include <string>
 #include <sys/types.h>
+#include <thread>
 #include <vector>
 
+class Camera;
+
 namespace RS {
+// Where frame time went with EngineConfig::renderThread, averages per frame
+struct RenderThreadStats {
+  double buildMs;   // Main thread building the render packet
+  double handoffMs; // Main thread waiting for the render thread to take it
+  double submitMs;  // Render thread submitting and presenting
+  double idleMs;    // Render thread waiting for the next packet
+  u_int64_t frames; // Packets submitted
+};
+
+struct EngineConfig {
+  // Simulation runs at this fixed rate no matter how fast frames are
+  double tickRate = 60.0;
+  // Upper bound on catch-up ticks per frame, anything above is dropped and
+  // counted as missed so a slow frame cannot spiral
+  u_int maxTicksPerFrame = 5;
+
+  // Let the driver pace frames with the display
+  bool vsync = true;
+  // Frame rate cap used when vsync is off, 0 runs uncapped
+  double targetFrameRate = 0.0;
+  // How close to the frame deadline the pacer stops sleeping and spins
+  u_int spinThresholdUs = 1500;
+
+  // Submit and swap on a render thread that owns the GL context, while the
+  // main thread simulates and builds the next frame's RenderPacket. Meshes,
+  // textures and shaders then have to be created before run().
+  bool renderThread = false;
+
+  // Skip opaque instances hidden behind last frame's depth with a compute
+  // pass, needs GL 4.3. See OcclusionCuller.
+  bool occlusionCulling = false;
+
+  // Window size, and the size of the offscreen target when headless
+  WindowConfig window;
+  // Render the scene below the window size when the GPU is over budget and
+  // upscale it, see DynamicResolution
+  DynamicResolutionConfig dynamicResolution;
+  // Lock the cursor to the window while a camera is set, mouse motion is
+  // then unbounded
+  bool relativeMouse = true;
+
+  // Advance the simulation by exactly one tick per frame instead of by wall
+  // clock time, so frame N shows the same state on every run
+  bool deterministic = false;
+  // Exit after this many frames, 0 runs until quit
+  u_int64_t maxFrames = 0;
+
+  // Frame indices to read back and write into captureDirectory as
+  // frame_<index>.png, or as frame_<index>_<w>x<h>.rgba when captureRaw
+  std::vector<u_int64_t> captureFrames;
+  std::string captureDirectory = "captures";
+  bool captureRaw = false;
+
+  // Shader variants listed here start building at startup, so the ones a
+  // scene uses come out of the binary cache instead of compiling on first
+  // use. See ShaderLibrary for the format and tools/rs_shader_precompile.
+  std::string shaderManifest;
+  // Overwrite shaderManifest with the variants this run requested on exit
+  bool recordShaderManifest = false;
+
+  // Scratch memory per frame, see getFrameArena(). The RenderSystem takes
+  // about 90 bytes per Renderable from it, past that it falls back to the
+  // heap, see getFrameResource().
+  size_t frameArenaBytes = 4 << 20;
+  // In REDSTAR_ALLOC_CHECK builds every frame after this many is expected
+  // to make no heap allocations, the ones that do get logged
+  u_int64_t allocationCheckWarmupFrames = 120;
+};
+
 class Engine {
 public:
-  Engine(u_int major = 0, u_int minor = 0, u_int patch = 0) {
+  Engine(u_int major = 0, u_int minor = 0, u_int patch = 0,
+         const EngineConfig &config = EngineConfig())
+      : _frame_arena(config.frameArenaBytes), _frame_resource(_frame_arena) {
     _major_ver = major;
     _minor_ver = minor;
     _patch_ver = patch;
+    _config = config;
+    _exit_requested = false;
+    _interpolation_alpha = 0.0f;
+    _frame_delta_time = 0.0f;
+    _frame_index = 0;
+    _steady_state_allocations.store(0);
+    _render_running.store(false);
+    _build_ns = 0;
+    _handoff_ns = 0;
+    _submit_ns.store(0);
+    _idle_ns.store(0);
+    _submitted_frames.store(0);
+
+    _event_manager = NULL;
+    _window_system = NULL;
+    _input_system = NULL;
+    _render_system = NULL;
+    _movement_system = NULL;
+    _transform_system = NULL;
+    _registry = NULL;
+    _job_system = NULL;
+    _system_graph = NULL;
+    _shader_cache = NULL;
+    _shader_library = NULL;
+    _texture_manager = NULL;
+    _dynamic_resolution = NULL;
+    _camera = NULL;
 
     setMetaData();
     initSubSystems();
   };
 
   ~Engine() {
+    // Everything holding GL objects goes before the window, which owns the
+    // context. stopRenderThread() already made it current here again.
+    delete _dynamic_resolution;
+    delete _texture_manager;
+    delete _shader_library;
+    delete _shader_cache;
+    delete _system_graph;
+    delete _job_system;
+    delete _transform_system;
+    delete _movement_system;
     delete _render_system;
+    delete _input_system;
     delete _window_system;
     delete _event_manager;
+    delete _registry;
   };
 
   inline const char *getEngineVersion() { return _engine_ver.c_str(); };
   inline SDL_Window *getWindow() { return _window_system->getWindow(); };
+  inline Registry *getRegistry() { return _registry; };
+  inline EventManager *getEventManager() { return _event_manager; };
+  inline InputSystem *getInputSystem() { return _input_system; };
+  inline JobSystem *getJobSystem() { return _job_system; };
+  inline ShaderCache *getShaderCache() { return _shader_cache; };
+  inline ShaderLibrary *getShaderLibrary() { return _shader_library; };
+  inline TextureManager *getTextureManager() { return _texture_manager; };
+  // Nodes for the Transform component
+  inline TransformHierarchy &getTransforms() {
+    return _transform_system->getHierarchy();
+  };
+
+  // Transient allocations that live until the end of the next frame, so
+  // anything handed to rendering stays valid while it is drawn
+  inline FrameArena &getFrameArena() { return _frame_arena; };
+  // The same as a std::pmr resource, for FrameVector
+  inline ArenaResource &getFrameResource() { return _frame_resource; };
+  // Heap allocations seen after the warmup frames, on the main and the
+  // render thread, always 0 unless built with REDSTAR_ALLOC_CHECK
+  inline u_int64_t getSteadyStateAllocations() const {
+    return _steady_state_allocations.load(std::memory_order_relaxed);
+  };
+
+  // The camera follows the move actions and mouse motion, and its matrices
+  // are what gets rendered. It is updated right before the frame is
+  // submitted, with input sampled once more, so mouse look is no more than
+  // one frame behind. NULL leaves setViewProjection() to the caller.
+  void setCamera(Camera *camera);
+  // From input to the frame's draws being issued, on the render thread
+  // when there is one, so only read it once run() returned
+  inline InputLatencyStats getInputLatencyStats() {
+    return _input_system->getLatencyStats();
+  };
+
+  // Main loop, returns once requestExit() was called or the window closed
+  void run();
+  inline void requestExit() { _exit_requested = true; };
+
+  // Timing
+  inline FrameStats getFrameStats() { return _frame_clock.getStats(); };
+  RenderThreadStats getRenderThreadStats() const;
+  // Of the last frame built
+  inline LodStats getLodStats() const { return _render_system->getLodStats(); };
+  inline OcclusionStats getOcclusionStats() const {
+    return _render_system->getOcclusionStats();
+  };
+  inline LightClusterStats getLightClusterStats() const {
+    return _render_system->getLightStats();
+  };
+  // Zeroed without EngineConfig::dynamicResolution
+  inline DynamicResolutionStats getDynamicResolutionStats() const {
+    if (_dynamic_resolution == NULL) {
+      return DynamicResolutionStats{};
+    };
+    return _dynamic_resolution->getStats();
+  };
+  inline float getFrameDeltaTime() const { return _frame_delta_time; };
+  // Frames rendered since the engine started
+  inline u_int64_t getFrameIndex() const { return _frame_index; };
+  inline float getFixedDeltaTime() const {
+    return (float)(1.0 / _config.tickRate);
+  };
+  // How far rendering is between the last two simulation ticks, [0, 1)
+  inline float getInterpolationAlpha() const { return _interpolation_alpha; };
+
+  // Writes the profiler's recent frames as Chrome trace JSON. Always false
+  // when the engine was built without REDSTAR_PROFILE.
+  bool dumpProfile(const char *path) { return RS_PROFILE_DUMP(path); };
+
+  // Runs every initialized system over the registry once, systems that do
+  // not share component pools run in parallel
+  void tickSystems(float deltaTime) {
+    _system_graph->run(*_job_system, *_registry, deltaTime);
+  };
 
 private:
+  // Samples input a last time and moves the camera, see setCamera()
+  void latchCamera();
+
+  // Copies this tick's state so rendering can blend towards the next one
+  void storePreviousState();
+
+  // Submits and presents a built frame, on whichever thread owns the GL
+  // context
+  void renderFrame(const RenderPacket &packet);
+  void startRenderThread();
+  void stopRenderThread();
+  void renderThreadLoop();
+
+  // Adds the calling thread's heap allocations since before to the
+  // steady state count once frameIndex is past the warmup, and logs them
+  void checkAllocations(u_int64_t frameIndex, u_int64_t before,
+                        const char *thread);
+
+  // Writes the frame out if it is one of config.captureFrames
+  void captureFrame(u_int64_t frameIndex);
+
   void setMetaData() {
     // Current _engine_ver
     _engine_ver += std::to_string(_major_ver) + ".";
@@ -47,22 +271,66 @@ private:
   // error.
   bool initSubSystems() {
     if (_window_system != NULL || _render_system != NULL ||
-        _event_manager != NULL) {
+        _event_manager != NULL || _registry != NULL ||
+        _job_system != NULL) {
       // One of the pointers to a system is corrupt,
       // We should call for the exit of the program here.
       return false;
     }
 
+    _job_system = new JobSystem();
+    _system_graph = new SystemGraph();
+    _registry = new Registry();
     _event_manager = new EventManager();
     _window_system = new WindowSystem(_event_manager, 1);
 
     // TODO: Add error handling if system not initialized, exit
-    _window_system->initSDL(_engine_ver.c_str());
+    _window_system->initSDL(_engine_ver.c_str(), _config.window);
+    if (!_config.window.headless) {
+      _window_system->setVSync(_config.vsync);
+    };
     _initialized_systems.push_back(_window_system);
 
-    _render_system = new RenderSystem(_event_manager, 2);
+    _input_system = new InputSystem(_event_manager, 5);
+    _input_system->bindDefaults();
+    _initialized_systems.push_back(_input_system);
+
+    _shader_cache = new ShaderCache("shader_cache", getWindow());
+    _shader_library = new ShaderLibrary(_shader_cache);
+    if (!_config.shaderManifest.empty() && !_config.recordShaderManifest) {
+      _shader_library->precompile(_config.shaderManifest.c_str());
+    };
+    _texture_manager = new TextureManager();
+
+    _render_system = new RenderSystem(_event_manager, 2, &_frame_resource);
+    _render_system->setViewportSize(_window_system->getWidth(),
+                                    _window_system->getHeight());
+    _render_system->setOcclusionCulling(_config.occlusionCulling);
     _initialized_systems.push_back(_render_system);
 
+    if (_config.dynamicResolution.enabled) {
+      _dynamic_resolution = new DynamicResolution();
+      if (!_dynamic_resolution->init(_window_system->getWidth(),
+                                     _window_system->getHeight(),
+                                     _config.dynamicResolution)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                     "DYNAMIC RESOLUTION FAILED, RENDERING AT FULL SIZE\n");
+        delete _dynamic_resolution;
+        _dynamic_resolution = NULL;
+      };
+    };
+
+    _movement_system = new MovementSystem(_event_manager, 3);
+    _initialized_systems.push_back(_movement_system);
+
+    _transform_system = new TransformSystem(_event_manager, 4, _job_system);
+    _initialized_systems.push_back(_transform_system);
+    _render_system->setTransformHierarchy(&_transform_system->getHierarchy());
+
+    for (System *system : _initialized_systems) {
+      _system_graph->addSystem(system);
+    };
+
     return true;
   }; // TODO: Switch from bools to custom Error type
 
@@ -71,13 +339,52 @@ private:
   u_int _minor_ver;
   u_int _patch_ver;
   std::string _engine_ver;
+  EngineConfig _config;
+
+  // Frame loop
+  FrameClock _frame_clock;
+  bool _exit_requested;
+  float _interpolation_alpha;
+  float _frame_delta_time;
+  u_int64_t _frame_index;
+  FrameArena _frame_arena;
+  ArenaResource _frame_resource; // _frame_arena for std::pmr containers
+  std::atomic<u_int64_t> _steady_state_allocations; // Both threads add
+
+  // Render thread, packets go from the main thread to it. Without one the
+  // write slot is built and drawn in place.
+  TripleBuffer<RenderPacket> _packets;
+  std::thread _render_thread;
+  std::atomic<bool> _render_running;
+  u_int64_t _build_ns;
+  u_int64_t _handoff_ns;
+  std::atomic<u_int64_t> _submit_ns;
+  std::atomic<u_int64_t> _idle_ns;
+  std::atomic<u_int64_t> _submitted_frames;
 
   // Systems
   EventManager *_event_manager;
   WindowSystem *_window_system;
+  InputSystem *_input_system;
   RenderSystem *_render_system;
+  MovementSystem *_movement_system;
+  TransformSystem *_transform_system;
+
+  ShaderCache *_shader_cache;
+  ShaderLibrary *_shader_library;
+  TextureManager *_texture_manager;
+  // NULL unless EngineConfig::dynamicResolution is enabled
+  DynamicResolution *_dynamic_resolution;
+  Camera *_camera;
+
+  // Entities and their components
+  Registry *_registry;
 
   std::vector<System *> _initialized_systems;
+
+  // Scheduling
+  JobSystem *_job_system;
+  SystemGraph *_system_graph;
 };
 } // namespace RS
 
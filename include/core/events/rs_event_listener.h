@@ -2,11 +2,24 @@
 #define RS_EVENT_LISTENER_H
 
 #include "rs_events.h"
+#include <cstddef>
+
 namespace RS {
 class EventListener {
 public:
+  virtual ~EventListener() {};
+
   virtual void update(const RS_EVENT event) = 0;
 
+  // Receives every queued event of one system for the frame at once.
+  // Listeners that care about payloads should override this, the default
+  // forwards each event to update().
+  virtual void updateBatch(const Event *events, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      update(events[i].eventType);
+    };
+  };
+
 private:
 };
 } // namespace RS
@@ -1,23 +1,29 @@
 #include "rs_event_manager.h"
 #include "rs_event_listener.h"
 #include "rs_events.h"
+#include <cstddef>
 #include <sys/types.h>
 #include <vector>
 
 void ::RS::EventManager::emitEvent(u_int sid, const RS_EVENT event) {
+  if (sid >= _rs_systems.size()) {
+    return;
+  };
+
   // First get the EventListeners subscribed to
   // the system with sid == sid
-  std::vector<EventListener *> _listeners = _rs_systems[sid];
-  for (int i = 0; i < _listeners.size(); i++) {
+  const std::vector<EventListener *> &_listeners = _rs_systems[sid];
+  for (size_t i = 0; i < _listeners.size(); i++) {
     _listeners[i]->update(event);
   };
 };
 
 bool ::RS::EventManager::addListener(u_int sid, EventListener *listener) {
-  _rs_systems[sid].push_back(listener);
+  std::vector<EventListener *> &_listeners = listenersOf(sid);
+  _listeners.push_back(listener);
 
   // listener was not placed added into the vector
-  if (_rs_systems[sid].back() != listener) {
+  if (_listeners.back() != listener) {
     return false; // TODO: Add custom error handling
   };
 
@@ -25,9 +31,14 @@ bool ::RS::EventManager::addListener(u_int sid, EventListener *listener) {
 };
 
 bool ::RS::EventManager::removeListener(u_int sid, EventListener *listener) {
-  for (u_int i = 0; i < _rs_systems[sid].size(); i++) {
-    if (_rs_systems[sid].at(i) == listener) {
-      _rs_systems[sid].erase(_rs_systems[sid].begin() + i);
+  if (sid >= _rs_systems.size()) {
+    return false;
+  };
+
+  std::vector<EventListener *> &_listeners = _rs_systems[sid];
+  for (u_int i = 0; i < _listeners.size(); i++) {
+    if (_listeners.at(i) == listener) {
+      _listeners.erase(_listeners.begin() + i);
       return true;
     };
   };
@@ -35,3 +46,61 @@ bool ::RS::EventManager::removeListener(u_int sid, EventListener *listener) {
   // TODO: Custom error handling for if removing fails
   return false;
 };
+
+void ::RS::EventManager::queueEvent(const Event &event) {
+  _queued_events.push_back(event);
+};
+
+bool ::RS::EventManager::queueEventAsync(const Event &event) {
+  return _async_events.push(event);
+};
+
+void ::RS::EventManager::dispatchQueuedEvents() {
+  Event event;
+  while (_async_events.pop(event)) {
+    _queued_events.push_back(event);
+  };
+
+  if (_queued_events.empty()) {
+    return;
+  };
+
+  // Events queued by listeners while dispatching land in the emptied buffer
+  // and go out next frame
+  _dispatch_events.swap(_queued_events);
+
+  // Counting sort by sid, keeps emit order within a system
+  const size_t systemCount = _rs_systems.size();
+  _sid_offsets.assign(systemCount + 1, 0);
+  for (const Event &queued : _dispatch_events) {
+    if (queued.sid < systemCount) {
+      _sid_offsets[queued.sid + 1]++;
+    }
+  };
+  for (size_t sid = 0; sid < systemCount; sid++) {
+    _sid_offsets[sid + 1] += _sid_offsets[sid];
+  };
+
+  _sorted_events.resize(_sid_offsets[systemCount]);
+  for (const Event &queued : _dispatch_events) {
+    if (queued.sid < systemCount) {
+      _sorted_events[_sid_offsets[queued.sid]++] = queued;
+    }
+  };
+
+  // Offsets now point at the end of each system's range
+  size_t begin = 0;
+  for (size_t sid = 0; sid < systemCount; sid++) {
+    const size_t end = _sid_offsets[sid];
+    if (end != begin) {
+      const std::vector<EventListener *> &_listeners = _rs_systems[sid];
+      for (size_t i = 0; i < _listeners.size(); i++) {
+        _listeners[i]->updateBatch(&_sorted_events[begin], end - begin);
+      };
+    }
+    begin = end;
+  };
+
+  _dispatch_events.clear();
+  _sorted_events.clear();
+};
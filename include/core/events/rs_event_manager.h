@@ -3,6 +3,8 @@
 
 #include "rs_event_listener.h"
 #include "rs_events.h"
+#include "rs_mpsc_queue.h"
+#include <cstddef>
 #include <map>
 #include <sys/types.h>
 #include <vector>
@@ -11,10 +13,19 @@ namespace RS {
 class EventManager {
 public:
   // Constructor
-  EventManager() { _rs_systems.clear(); };
+  // asyncCapacity is the number of events worker threads can have in flight
+  // between two calls to dispatchQueuedEvents()
+  EventManager(size_t asyncCapacity = 4096) : _async_events(asyncCapacity) {
+    _rs_systems.clear();
+  };
 
-  EventManager(std::map<u_int, std::vector<EventListener *>> rs_systems)
-      : _rs_systems(rs_systems) {};
+  EventManager(std::map<u_int, std::vector<EventListener *>> rs_systems,
+               size_t asyncCapacity = 4096)
+      : _async_events(asyncCapacity) {
+    for (auto &system : rs_systems) {
+      listenersOf(system.first) = system.second;
+    };
+  };
 
   // Deconstructor
   ~EventManager() {
@@ -27,8 +38,40 @@ public:
   bool addListener(u_int sid, EventListener *listener);
   bool removeListener(u_int sid, EventListener *listener);
 
+  // Deferred mode
+  // Stores the event in this frame's buffer, listeners receive it on the
+  // next dispatchQueuedEvents(). Main thread only.
+  void queueEvent(const Event &event);
+
+  // Same as queueEvent but safe to call from any thread. Returns false if
+  // the async queue is full and the event was dropped.
+  bool queueEventAsync(const Event &event);
+
+  // Hands every queued event to its listeners, grouped by system so each
+  // listener gets one updateBatch() call per system per frame.
+  void dispatchQueuedEvents();
+
+  inline size_t getQueuedEventCount() const { return _queued_events.size(); };
+
 private:
-  std::map<u_int, std::vector<EventListener *>> _rs_systems;
+  std::vector<EventListener *> &listenersOf(u_int sid) {
+    if (sid >= _rs_systems.size()) {
+      _rs_systems.resize(sid + 1);
+    }
+    return _rs_systems[sid];
+  };
+
+  // Indexed by sid
+  std::vector<std::vector<EventListener *>> _rs_systems;
+
+  // Per frame buffers, cleared but never shrunk so steady state frames do
+  // not allocate
+  std::vector<Event> _queued_events;
+  std::vector<Event> _dispatch_events;
+  std::vector<Event> _sorted_events;
+  std::vector<size_t> _sid_offsets;
+
+  MPSCQueue<Event> _async_events;
 };
 } // namespace RS
 
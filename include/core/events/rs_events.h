@@ -1,7 +1,8 @@
 #ifndef RS_EVENTS_H
 #define RS_EVENTS_H
 
-#include <any>
+#include <sys/types.h>
+
 namespace RS {
 
 typedef enum RS_EVENT {
@@ -15,9 +16,31 @@ typedef enum RS_EVENT {
 
 } RS_EVENT;
 
-struct EventData {
+// Payloads are kept small and trivially copyable so queued events can be
+// stored by value in one contiguous buffer.
+struct WindowResizedPayload {
+  int width;
+  int height;
+};
+
+union EventPayload {
+  WindowResizedPayload windowResized;
+  u_int64_t raw[2];
+};
+
+struct Event {
   RS_EVENT eventType;
-  std::any data;
+  u_int sid; // ID of the system that emitted the event
+  EventPayload data;
+};
+
+inline Event makeEvent(u_int sid, const RS_EVENT eventType) {
+  Event event;
+  event.eventType = eventType;
+  event.sid = sid;
+  event.data.raw[0] = 0;
+  event.data.raw[1] = 0;
+  return event;
 };
 
 } // namespace RS
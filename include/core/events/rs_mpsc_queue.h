@@ -0,0 +1,91 @@
+#ifndef RS_MPSC_QUEUE_H
+#define RS_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace RS {
+// Bounded lock-free queue with many producers and a single consumer, based
+// on Dmitry Vyukov's bounded MPMC queue. Each cell carries a sequence number
+// that tells producers and the consumer whose turn it is, so no locks are
+// needed. capacity is rounded up to a power of two.
+template <typename T> class MPSCQueue {
+public:
+  explicit MPSCQueue(size_t capacity = 4096) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+
+    _mask = size - 1;
+    _cells = std::vector<Cell>(size);
+    for (size_t i = 0; i < size; i++) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    };
+    _enqueue_pos.store(0, std::memory_order_relaxed);
+    _dequeue_pos = 0;
+  };
+
+  MPSCQueue(const MPSCQueue &) = delete;
+  MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+  // Safe to call from any thread. Returns false if the queue is full.
+  bool push(const T &value) {
+    Cell *cell;
+    size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &_cells[pos & _mask];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (_enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // Full
+      } else {
+        pos = _enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  };
+
+  // Only the consuming thread may call pop(). Returns false if empty.
+  bool pop(T &out) {
+    Cell *cell = &_cells[_dequeue_pos & _mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    if (seq != _dequeue_pos + 1) {
+      return false;
+    }
+
+    out = cell->value;
+    cell->sequence.store(_dequeue_pos + _mask + 1, std::memory_order_release);
+    _dequeue_pos++;
+    return true;
+  };
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+
+    Cell() : sequence(0), value() {};
+    Cell(const Cell &) : sequence(0), value() {};
+  };
+
+  std::vector<Cell> _cells;
+  size_t _mask;
+
+  // Producers and the consumer touch different cache lines
+  alignas(64) std::atomic<size_t> _enqueue_pos;
+  alignas(64) size_t _dequeue_pos;
+};
+} // namespace RS
+
+#endif // !RS_MPSC_QUEUE_H
@@ -0,0 +1,219 @@
+#include "rs_job_system.h"
+#include "rs_profiler.h"
+#include "rs_work_deque.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+
+namespace {
+// Identifies which JobSystem slot the running thread owns
+thread_local const ::RS::JobSystem *t_owner = NULL;
+thread_local u_int t_thread_index = 0;
+thread_local u_int t_steal_seed = 0;
+
+const u_int SPINS_BEFORE_SLEEP = 64;
+} // namespace
+
+::RS::JobSystem::JobSystem(u_int workerCount) {
+  if (workerCount == 0) {
+    u_int hardware = std::thread::hardware_concurrency();
+    workerCount = hardware > 1 ? hardware - 1 : 0;
+  };
+
+  const u_int threadCount = workerCount + 1;
+  _thread_count = threadCount;
+  _next_external.store(threadCount);
+  for (u_int i = 0; i < threadCount + EXTERNAL_THREAD_SLOTS; i++) {
+    _queues.push_back(new WorkStealingDeque<Job *>(JOBS_PER_THREAD));
+    _job_pools.push_back(new Job[JOBS_PER_THREAD]);
+    _job_cursors.push_back(0);
+  };
+
+  _running.store(true);
+  _sleeping.store(0);
+
+  t_owner = this;
+  t_thread_index = 0;
+
+  for (u_int i = 1; i < threadCount; i++) {
+    _workers.emplace_back(&JobSystem::workerLoop, this, i);
+  };
+};
+
+::RS::JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(_sleep_mutex);
+    _running.store(false);
+  }
+  _wake.notify_all();
+
+  for (std::thread &worker : _workers) {
+    worker.join();
+  };
+
+  for (size_t i = 0; i < _queues.size(); i++) {
+    delete _queues[i];
+    delete[] _job_pools[i];
+  };
+
+  if (t_owner == this) {
+    t_owner = NULL;
+  };
+};
+
+void ::RS::JobSystem::run(JobFunction function, void *data,
+                          JobCounter *counter, size_t begin, size_t end) {
+  const u_int index = currentThreadIndex();
+  Job *job = allocateJob(index);
+  if (job == NULL) {
+    // The ring slot is still queued or running, or this is a foreign thread
+    // without a deque. Either way it runs here.
+    function(data, begin, end);
+    return;
+  };
+
+  if (counter != NULL) {
+    counter->pending.fetch_add(1, std::memory_order_relaxed);
+  };
+  job->function = function;
+  job->data = data;
+  job->begin = begin;
+  job->end = end;
+  job->counter = counter;
+
+  // Our own deque is full, run it inline rather than dropping it
+  if (!_queues[index]->push(job)) {
+    execute(job);
+    return;
+  };
+
+  if (_sleeping.load(std::memory_order_relaxed) > 0) {
+    _wake.notify_one();
+  };
+};
+
+void ::RS::JobSystem::wait(const JobCounter *counter) {
+  while (!counter->isDone()) {
+    if (!tryRunJob()) {
+      std::this_thread::yield();
+    }
+  };
+};
+
+bool ::RS::JobSystem::tryRunJob() {
+  Job *job = findJob();
+  if (job == NULL) {
+    return false;
+  };
+  execute(job);
+  return true;
+};
+
+void ::RS::JobSystem::workerLoop(u_int index) {
+  t_owner = this;
+  t_thread_index = index;
+  t_steal_seed = index * 2654435761u;
+  RS_PROFILE_THREAD("Job worker");
+
+  u_int idleSpins = 0;
+  while (_running.load(std::memory_order_relaxed)) {
+    if (tryRunJob()) {
+      idleSpins = 0;
+      continue;
+    };
+
+    if (++idleSpins < SPINS_BEFORE_SLEEP) {
+      std::this_thread::yield();
+      continue;
+    };
+
+    // Nothing to do for a while, sleep until a job is pushed. The timeout
+    // covers the window between checking the queues and going to sleep.
+    std::unique_lock<std::mutex> lock(_sleep_mutex);
+    _sleeping.fetch_add(1);
+    _wake.wait_for(lock, std::chrono::milliseconds(1));
+    _sleeping.fetch_sub(1);
+    idleSpins = 0;
+  };
+};
+
+::RS::Job *RS::JobSystem::allocateJob(u_int index) {
+  if (index == NO_THREAD_INDEX) {
+    return NULL;
+  };
+  // Thieves may still be running the job the ring wrapped around to
+  Job *job = &_job_pools[index][_job_cursors[index] & (JOBS_PER_THREAD - 1)];
+  if (job->busy.load(std::memory_order_acquire)) {
+    return NULL;
+  };
+  _job_cursors[index]++;
+  job->busy.store(true, std::memory_order_relaxed);
+  return job;
+};
+
+::RS::Job *RS::JobSystem::findJob() {
+  const u_int index = currentThreadIndex();
+  Job *job = NULL;
+  if (index != NO_THREAD_INDEX) {
+    job = _queues[index]->pop();
+    if (job != NULL) {
+      return job;
+    };
+  };
+
+  // Start stealing at a random victim so thieves spread out
+  const u_int count = (u_int)_queues.size();
+  t_steal_seed = t_steal_seed * 1664525u + 1013904223u;
+  const u_int start = t_steal_seed % count;
+  for (u_int i = 0; i < count; i++) {
+    u_int victim = (start + i) % count;
+    if (victim == index) {
+      continue;
+    }
+    job = _queues[victim]->steal();
+    if (job != NULL) {
+      return job;
+    }
+  };
+  return NULL;
+};
+
+void ::RS::JobSystem::execute(Job *job) {
+  assert(job->busy.load(std::memory_order_relaxed));
+  // Copy out first, the slot may be recycled as soon as busy drops
+  JobCounter *counter = job->counter;
+  job->function(job->data, job->begin, job->end);
+  job->busy.store(false, std::memory_order_release);
+  if (counter != NULL) {
+    counter->pending.fetch_sub(1, std::memory_order_release);
+  };
+};
+
+size_t RS::JobSystem::defaultGrain(size_t count) const {
+  // A few chunks per thread gives stealing room to balance uneven work
+  size_t chunks = (size_t)getThreadCount() * 4;
+  size_t grain = (count + chunks - 1) / chunks;
+  return grain == 0 ? 1 : grain;
+};
+
+u_int RS::JobSystem::currentThreadIndex() {
+  if (t_owner == this) {
+    return t_thread_index;
+  };
+
+  // A foreign thread, give it a deque of its own. Sharing one with the
+  // owner would race on its owner only end.
+  u_int index = _next_external.fetch_add(1, std::memory_order_relaxed);
+  if (index >= _queues.size()) {
+    _next_external.store((u_int)_queues.size(), std::memory_order_relaxed);
+    return NO_THREAD_INDEX;
+  };
+  t_owner = this;
+  t_thread_index = index;
+  t_steal_seed = index * 2654435761u;
+  return index;
+};
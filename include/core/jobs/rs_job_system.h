@@ -0,0 +1,129 @@
+#ifndef RS_JOB_SYSTEM_H
+#define RS_JOB_SYSTEM_H
+
+#include "rs_work_deque.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace RS {
+typedef void (*JobFunction)(void *data, size_t begin, size_t end);
+
+// Counts the jobs that still have to finish. Waiting on a counter is the
+// fence between dependent pieces of work.
+struct JobCounter {
+  std::atomic<u_int> pending;
+
+  JobCounter() : pending(0) {};
+  inline bool isDone() const {
+    return pending.load(std::memory_order_acquire) == 0;
+  };
+};
+
+// One cache line per job so workers never share lines while running them
+struct alignas(64) Job {
+  JobFunction function;
+  void *data;
+  size_t begin;
+  size_t end;
+  JobCounter *counter;
+  // Set from allocation until the job has run, its ring slot is not
+  // reused before
+  std::atomic<bool> busy;
+
+  Job() : busy(false) {};
+};
+
+// Work stealing scheduler. Every worker owns a deque, pushes its own jobs to
+// it and steals from the others when it runs dry. The thread that created
+// the JobSystem is treated as worker 0 and helps execute jobs whenever it
+// waits. Any other thread, like the render thread, claims one of
+// EXTERNAL_THREAD_SLOTS the first time it submits or waits. Once those are
+// taken, further threads run their jobs inline and only steal while they
+// wait.
+class JobSystem {
+public:
+  // Constructor
+  // workerCount 0 uses one worker per hardware thread minus the caller
+  JobSystem(u_int workerCount = 0);
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // Deconstructor
+  ~JobSystem();
+
+  // Queues fn(data, begin, end) and adds one to counter if given. Runs it
+  // inline when the calling thread has JOBS_PER_THREAD jobs in flight.
+  void run(JobFunction function, void *data, JobCounter *counter,
+           size_t begin = 0, size_t end = 0);
+
+  // Runs other jobs until counter reaches zero
+  void wait(const JobCounter *counter);
+
+  // Executes one pending job if there is one, returns false otherwise
+  bool tryRunJob();
+
+  // Splits [0, count) into chunks of at most grain items and calls
+  // fn(begin, end) for each of them across all threads. Blocks until every
+  // chunk is done, fn may therefore live on the caller's stack.
+  template <typename Func>
+  void parallelFor(size_t count, size_t grain, const Func &fn) {
+    if (count == 0) {
+      return;
+    }
+    if (grain == 0) {
+      grain = defaultGrain(count);
+    }
+
+    JobCounter counter;
+    JobFunction trampoline = [](void *data, size_t begin, size_t end) {
+      (*static_cast<const Func *>(data))(begin, end);
+    };
+    for (size_t begin = 0; begin < count; begin += grain) {
+      size_t end = begin + grain < count ? begin + grain : count;
+      run(trampoline, (void *)&fn, &counter, begin, end);
+    };
+    wait(&counter);
+  };
+
+  // Total threads executing jobs, including the owning thread
+  inline u_int getThreadCount() const { return _thread_count; };
+
+private:
+  static const size_t JOBS_PER_THREAD = 4096;
+  static const u_int EXTERNAL_THREAD_SLOTS = 4;
+  static const u_int NO_THREAD_INDEX = ~0u;
+
+  void workerLoop(u_int index);
+  // NULL when the thread has no slot or its ring is full
+  Job *allocateJob(u_int index);
+  Job *findJob();
+  void execute(Job *job);
+  size_t defaultGrain(size_t count) const;
+  // NO_THREAD_INDEX for a foreign thread once the external slots are gone
+  u_int currentThreadIndex();
+
+  std::vector<std::thread> _workers;
+  // Owner and workers first, then the external slots
+  std::vector<WorkStealingDeque<Job *> *> _queues;
+  u_int _thread_count;
+  std::atomic<u_int> _next_external;
+
+  // Ring of jobs per thread. The slot under the cursor is only reused once
+  // its job has run, a still busy one makes run() go inline.
+  std::vector<Job *> _job_pools;
+  std::vector<size_t> _job_cursors;
+
+  std::atomic<bool> _running;
+  std::atomic<u_int> _sleeping;
+  std::mutex _sleep_mutex;
+  std::condition_variable _wake;
+};
+} // namespace RS
+
+#endif // !RS_JOB_SYSTEM_H
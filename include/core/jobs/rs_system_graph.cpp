@@ -0,0 +1,109 @@
+#include "rs_system_graph.h"
+#include "rs_job_system.h"
+#include "rs_profiler.h"
+#include "rs_registry.h"
+#include "rs_system.h"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+::RS::SystemGraph::~SystemGraph() {
+  for (Node *node : _nodes) {
+    delete node;
+  };
+  _nodes.clear();
+};
+
+void ::RS::SystemGraph::addSystem(System *system) {
+  Node *node = new Node();
+  node->graph = this;
+  node->system = system;
+  node->access = system->getComponentAccess();
+  node->dependencyCount = 0;
+  node->remaining.store(0);
+
+  for (Node *earlier : _nodes) {
+    if (conflicts(earlier->access, node->access)) {
+      earlier->successors.push_back(node);
+      node->dependencyCount++;
+    }
+  };
+
+  _nodes.push_back(node);
+};
+
+void ::RS::SystemGraph::run(JobSystem &jobs, Registry &registry,
+                            float deltaTime) {
+  if (_nodes.empty()) {
+    return;
+  };
+
+  _jobs = &jobs;
+  _registry = &registry;
+  _delta_time = deltaTime;
+  _remaining_systems.pending.store((u_int)_nodes.size());
+
+  for (Node *node : _nodes) {
+    node->remaining.store(node->dependencyCount, std::memory_order_relaxed);
+  };
+  for (Node *node : _nodes) {
+    if (node->dependencyCount == 0) {
+      schedule(node);
+    }
+  };
+
+  // Run main thread systems as they become ready and help with the rest
+  while (!_remaining_systems.isDone()) {
+    Node *ready = NULL;
+    {
+      std::lock_guard<std::mutex> lock(_main_thread_mutex);
+      if (!_main_thread_ready.empty()) {
+        ready = _main_thread_ready.back();
+        _main_thread_ready.pop_back();
+      }
+    }
+
+    if (ready != NULL) {
+      runNode(ready, 0, 0);
+    } else if (!jobs.tryRunJob()) {
+      std::this_thread::yield();
+    }
+  };
+
+  _jobs = NULL;
+  _registry = NULL;
+};
+
+bool ::RS::SystemGraph::conflicts(const ComponentAccess &a,
+                                  const ComponentAccess &b) {
+  return (a.writes & (b.reads | b.writes)).any() || (b.writes & a.reads).any();
+};
+
+void ::RS::SystemGraph::runNode(void *data, size_t begin, size_t end) {
+  Node *node = static_cast<Node *>(data);
+  SystemGraph *graph = node->graph;
+
+  {
+    RS_PROFILE_SCOPE("System tick");
+    node->system->tick(*graph->_registry, graph->_delta_time);
+  }
+
+  for (Node *successor : node->successors) {
+    if (successor->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      graph->schedule(successor);
+    }
+  };
+
+  graph->_remaining_systems.pending.fetch_sub(1, std::memory_order_release);
+};
+
+void ::RS::SystemGraph::schedule(Node *node) {
+  if (node->access.mainThread) {
+    std::lock_guard<std::mutex> lock(_main_thread_mutex);
+    _main_thread_ready.push_back(node);
+    return;
+  };
+
+  _jobs->run(&SystemGraph::runNode, node, NULL);
+};
@@ -0,0 +1,68 @@
+#ifndef RS_SYSTEM_GRAPH_H
+#define RS_SYSTEM_GRAPH_H
+
+#include "rs_job_system.h"
+#include "rs_registry.h"
+#include "rs_system.h"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+// Per frame schedule of systems. A system depends on every system added
+// before it whose component access conflicts with its own (write/write or
+// read/write on the same pool). Systems without such a conflict run
+// concurrently on the JobSystem, main thread systems always run on the
+// thread that calls run().
+class SystemGraph {
+public:
+  // Constructor
+  SystemGraph() {
+    _jobs = NULL;
+    _registry = NULL;
+    _delta_time = 0.0f;
+  };
+
+  SystemGraph(const SystemGraph &) = delete;
+  SystemGraph &operator=(const SystemGraph &) = delete;
+
+  // Deconstructor
+  ~SystemGraph();
+
+  void addSystem(System *system);
+
+  // Ticks every system once, returns when all of them are done
+  void run(JobSystem &jobs, Registry &registry, float deltaTime);
+
+  inline size_t getSystemCount() const { return _nodes.size(); };
+
+private:
+  struct Node {
+    SystemGraph *graph;
+    System *system;
+    ComponentAccess access;
+    std::vector<Node *> successors;
+    u_int dependencyCount;
+    std::atomic<u_int> remaining;
+  };
+
+  static bool conflicts(const ComponentAccess &a, const ComponentAccess &b);
+  static void runNode(void *data, size_t begin, size_t end);
+  void schedule(Node *node);
+
+  std::vector<Node *> _nodes;
+
+  // Valid only during run()
+  JobSystem *_jobs;
+  Registry *_registry;
+  float _delta_time;
+  JobCounter _remaining_systems;
+
+  std::mutex _main_thread_mutex;
+  std::vector<Node *> _main_thread_ready;
+};
+} // namespace RS
+
+#endif // !RS_SYSTEM_GRAPH_H
@@ -0,0 +1,76 @@
+#ifndef RS_TRIPLE_BUFFER_H
+#define RS_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <sys/types.h>
+
+namespace RS {
+// Lock free handoff between one producer and one consumer thread. Each
+// side owns one of three slots, the third sits in the middle and is
+// swapped in and out with a single atomic exchange. Slots are reused as
+// they are, so vectors inside T keep their capacity from frame to frame.
+template <typename T> class TripleBuffer {
+public:
+  TripleBuffer() {
+    _write = 0;
+    _read = 2;
+    _middle.store(1, std::memory_order_relaxed);
+  };
+
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+  // Producer only
+  inline T &getWriteBuffer() { return _slots[_write]; };
+
+  // Producer only. Hands the write slot over, replacing a published slot
+  // the consumer has not taken yet.
+  void publish() {
+    u_int8_t old =
+        _middle.exchange(_write | FRESH, std::memory_order_acq_rel);
+    _write = old & INDEX;
+  };
+
+  // Producer only. Like publish() but never drops a slot, returns false
+  // while the consumer has not taken the previous one.
+  bool tryPublish() {
+    // Only the consumer touches the middle while it is fresh, and it does
+    // not once it is taken, so a plain store is enough past this check
+    u_int8_t old = _middle.load(std::memory_order_acquire);
+    if ((old & FRESH) != 0) {
+      return false;
+    }
+    _middle.store(_write | FRESH, std::memory_order_release);
+    _write = old & INDEX;
+    return true;
+  };
+
+  // Consumer only. Swaps in the latest published slot, false if nothing
+  // was published since the last call.
+  bool acquire() {
+    if ((_middle.load(std::memory_order_acquire) & FRESH) == 0) {
+      return false;
+    }
+    u_int8_t old = _middle.exchange(_read, std::memory_order_acq_rel);
+    _read = old & INDEX;
+    return true;
+  };
+
+  // Consumer only
+  inline T &getReadBuffer() { return _slots[_read]; };
+
+private:
+  static const u_int8_t INDEX = 0x3;
+  static const u_int8_t FRESH = 0x4;
+
+  T _slots[3];
+  // Producer side
+  alignas(64) u_int8_t _write;
+  // Slot index | FRESH when published and not yet acquired
+  alignas(64) std::atomic<u_int8_t> _middle;
+  // Consumer side
+  alignas(64) u_int8_t _read;
+};
+} // namespace RS
+
+#endif // !RS_TRIPLE_BUFFER_H
@@ -0,0 +1,95 @@
+#ifndef RS_WORK_DEQUE_H
+#define RS_WORK_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace RS {
+// Fixed size Chase-Lev work stealing deque (Le et al. 2013, "Correct and
+// Efficient Work-Stealing for Weak Memory Models"). The owning thread
+// pushes and pops at the bottom, every other thread steals from the top.
+// T must be a pointer type, NULL means "nothing there".
+template <typename T> class WorkStealingDeque {
+public:
+  explicit WorkStealingDeque(size_t capacity = 4096) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    _mask = size - 1;
+    _buffer = std::vector<std::atomic<T>>(size);
+    _top.store(0, std::memory_order_relaxed);
+    _bottom.store(0, std::memory_order_relaxed);
+  };
+
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+  // Owner only. Returns false if the deque is full.
+  bool push(T item) {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_acquire);
+    if (bottom - top > (int64_t)_mask) {
+      return false;
+    }
+
+    _buffer[bottom & _mask].store(item, std::memory_order_relaxed);
+    _bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+  };
+
+  // Owner only
+  T pop() {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = _top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+      // Empty
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+      return NULL;
+    }
+
+    T item = _buffer[bottom & _mask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // Last item, race the thieves for it
+      if (!_top.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        item = NULL;
+      }
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  };
+
+  // Any thread
+  T steal() {
+    int64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = _bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return NULL;
+    }
+
+    T item = _buffer[top & _mask].load(std::memory_order_relaxed);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return NULL; // Lost the race
+    }
+    return item;
+  };
+
+private:
+  std::vector<std::atomic<T>> _buffer;
+  size_t _mask;
+
+  alignas(64) std::atomic<int64_t> _top;
+  alignas(64) std::atomic<int64_t> _bottom;
+};
+} // namespace RS
+
+#endif // !RS_WORK_DEQUE_H
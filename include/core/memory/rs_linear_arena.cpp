@@ -0,0 +1,44 @@
+#include "rs_linear_arena.h"
+#include "rs_memory.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace {
+// Cache line, so two arenas never share one
+const size_t ARENA_BLOCK_ALIGNMENT = 64;
+} // namespace
+
+::RS::LinearArena::LinearArena(size_t capacity, MemoryTag tag) {
+  _memory = static_cast<unsigned char *>(::operator new(
+      capacity, std::align_val_t(ARENA_BLOCK_ALIGNMENT)));
+  _capacity = capacity;
+  _used = 0;
+  _peak = 0;
+  _overflows = 0;
+  _tag = tag;
+  trackAllocation(_tag, _capacity);
+};
+
+::RS::LinearArena::~LinearArena() {
+  ::operator delete(_memory, std::align_val_t(ARENA_BLOCK_ALIGNMENT));
+  trackFree(_tag, _capacity);
+};
+
+void *::RS::LinearArena::allocate(size_t size, size_t alignment) {
+  uintptr_t base = reinterpret_cast<uintptr_t>(_memory);
+  uintptr_t start = (base + _used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  size_t end = (size_t)(start - base) + size;
+  if (end > _capacity) {
+    _overflows++;
+    return NULL;
+  };
+
+  _used = end;
+  if (_used > _peak) {
+    _peak = _used;
+  };
+  return reinterpret_cast<void *>(start);
+};
+
+void ::RS::LinearArena::reset() { _used = 0; };
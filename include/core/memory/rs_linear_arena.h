@@ -0,0 +1,97 @@
+#ifndef RS_LINEAR_ARENA_H
+#define RS_LINEAR_ARENA_H
+
+#include "rs_memory.h"
+#include <cstddef>
+#include <new>
+#include <sys/types.h>
+
+namespace RS {
+// Bump allocator over one block reserved up front. allocate() is a pointer
+// bump, nothing is freed on its own, reset() drops everything at once.
+// Destructors are never run, so only put trivially destructible data here.
+// Not thread safe.
+class LinearArena {
+public:
+  // Constructor
+  LinearArena(size_t capacity, MemoryTag tag = MEM_FRAME);
+
+  LinearArena(const LinearArena &) = delete;
+  LinearArena &operator=(const LinearArena &) = delete;
+
+  // Deconstructor
+  ~LinearArena();
+
+  // NULL once the block is used up, the overflow is counted so the
+  // capacity can be raised
+  void *allocate(size_t size, size_t alignment = alignof(max_align_t));
+
+  template <typename T> T *allocateArray(size_t count) {
+    void *memory = allocate(sizeof(T) * count, alignof(T));
+    return memory == NULL ? NULL : new (memory) T[count];
+  };
+
+  void reset();
+
+  inline bool owns(const void *memory) const {
+    const unsigned char *byte = static_cast<const unsigned char *>(memory);
+    return byte >= _memory && byte < _memory + _capacity;
+  };
+
+  inline size_t getUsed() const { return _used; };
+  inline size_t getCapacity() const { return _capacity; };
+  // Highest use since construction
+  inline size_t getPeak() const { return _peak; };
+  inline u_int64_t getOverflows() const { return _overflows; };
+
+private:
+  unsigned char *_memory;
+  size_t _capacity;
+  size_t _used;
+  size_t _peak;
+  u_int64_t _overflows;
+  MemoryTag _tag;
+};
+
+// Two arenas taking turns. beginFrame() switches to the other one and
+// clears it, so whatever was allocated last frame stays readable for one
+// more frame, e.g. by the render thread while the next frame is built.
+class FrameArena {
+public:
+  // Constructor
+  FrameArena(size_t capacityPerFrame, MemoryTag tag = MEM_FRAME)
+      : _arenas{LinearArena(capacityPerFrame, tag),
+                LinearArena(capacityPerFrame, tag)} {
+    _current = 0;
+  };
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  void beginFrame() {
+    _current ^= 1;
+    _arenas[_current].reset();
+  };
+
+  inline void *allocate(size_t size,
+                        size_t alignment = alignof(max_align_t)) {
+    return _arenas[_current].allocate(size, alignment);
+  };
+  template <typename T> T *allocateArray(size_t count) {
+    return _arenas[_current].allocateArray<T>(count);
+  };
+
+  inline bool owns(const void *memory) const {
+    return _arenas[0].owns(memory) || _arenas[1].owns(memory);
+  };
+
+  inline LinearArena &current() { return _arenas[_current]; };
+  inline LinearArena &previous() { return _arenas[_current ^ 1]; };
+
+private:
+  LinearArena _arenas[2];
+  u_int _current;
+};
+} // namespace RS
+
+#endif // !RS_LINEAR_ARENA_H
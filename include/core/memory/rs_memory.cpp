@@ -0,0 +1,112 @@
+#include "rs_memory.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <sys/types.h>
+
+namespace {
+struct AtomicMemoryStats {
+  std::atomic<u_int64_t> allocations{0};
+  std::atomic<u_int64_t> frees{0};
+  std::atomic<u_int64_t> bytesAllocated{0};
+  std::atomic<u_int64_t> bytesLive{0};
+};
+
+AtomicMemoryStats g_memory_stats[RS::MEM_TAG_COUNT];
+// Per thread, so job workers and the shader and texture threads do not
+// show up in the main thread's per frame check
+thread_local u_int64_t t_heap_allocations = 0;
+} // namespace
+
+const char *RS::getMemoryTagName(MemoryTag tag) {
+  switch (tag) {
+  case MEM_GENERAL:
+    return "General";
+  case MEM_ECS:
+    return "ECS";
+  case MEM_EVENTS:
+    return "Events";
+  case MEM_JOBS:
+    return "Jobs";
+  case MEM_RENDER:
+    return "Render";
+  case MEM_FRAME:
+    return "Frame";
+  default:
+    return "Unknown";
+  };
+};
+
+void RS::trackAllocation(MemoryTag tag, size_t bytes) {
+  AtomicMemoryStats &stats = g_memory_stats[tag];
+  stats.allocations.fetch_add(1, std::memory_order_relaxed);
+  stats.bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+  stats.bytesLive.fetch_add(bytes, std::memory_order_relaxed);
+};
+
+void RS::trackFree(MemoryTag tag, size_t bytes) {
+  AtomicMemoryStats &stats = g_memory_stats[tag];
+  stats.frees.fetch_add(1, std::memory_order_relaxed);
+  stats.bytesLive.fetch_sub(bytes, std::memory_order_relaxed);
+};
+
+::RS::MemoryStats RS::getMemoryStats(MemoryTag tag) {
+  const AtomicMemoryStats &stats = g_memory_stats[tag];
+  MemoryStats out;
+  out.allocations = stats.allocations.load(std::memory_order_relaxed);
+  out.frees = stats.frees.load(std::memory_order_relaxed);
+  out.bytesAllocated = stats.bytesAllocated.load(std::memory_order_relaxed);
+  out.bytesLive = stats.bytesLive.load(std::memory_order_relaxed);
+  return out;
+};
+
+u_int64_t RS::getHeapAllocationCount() {
+  return t_heap_allocations;
+};
+
+#ifdef REDSTAR_ALLOC_CHECK
+
+bool RS::heapTrackingEnabled() { return true; };
+
+// Replacing the global operators catches everything, std containers and
+// third party code included. The array and nothrow forms forward to these
+// by default, the sized deletes are spelled out since some runtimes bring
+// their own.
+void *operator new(size_t size) {
+  t_heap_allocations++;
+  void *memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == NULL) {
+    throw std::bad_alloc();
+  };
+  return memory;
+};
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  t_heap_allocations++;
+  size_t align = (size_t)alignment;
+  // aligned_alloc wants a multiple of the alignment
+  void *memory = std::aligned_alloc(align, (size + align - 1) / align * align);
+  if (memory == NULL) {
+    throw std::bad_alloc();
+  };
+  return memory;
+};
+
+void operator delete(void *memory) noexcept { std::free(memory); };
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+  std::free(memory);
+};
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); };
+
+void operator delete(void *memory, size_t, std::align_val_t) noexcept {
+  std::free(memory);
+};
+
+#else
+
+bool RS::heapTrackingEnabled() { return false; };
+
+#endif // REDSTAR_ALLOC_CHECK
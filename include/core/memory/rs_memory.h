@@ -0,0 +1,42 @@
+#ifndef RS_MEMORY_H
+#define RS_MEMORY_H
+
+#include <cstddef>
+#include <sys/types.h>
+
+namespace RS {
+// Who an allocation is charged to. Arenas, pools and CountingResource take
+// one of these and keep the counters below up to date.
+enum MemoryTag {
+  MEM_GENERAL,
+  MEM_ECS,
+  MEM_EVENTS,
+  MEM_JOBS,
+  MEM_RENDER,
+  MEM_FRAME,
+  MEM_TAG_COUNT
+};
+
+struct MemoryStats {
+  u_int64_t allocations;
+  u_int64_t frees;
+  u_int64_t bytesAllocated; // Total ever handed out
+  u_int64_t bytesLive;      // Handed out and not given back yet
+};
+
+const char *getMemoryTagName(MemoryTag tag);
+
+// Thread safe
+void trackAllocation(MemoryTag tag, size_t bytes);
+void trackFree(MemoryTag tag, size_t bytes);
+MemoryStats getMemoryStats(MemoryTag tag);
+
+// Counts every global operator new, only when built with REDSTAR_ALLOC_CHECK
+// (cmake -DREDSTAR_ALLOC_CHECK=ON), which replaces the global operators.
+// Without it heapTrackingEnabled() is false and the count stays 0.
+bool heapTrackingEnabled();
+// The calling thread's count
+u_int64_t getHeapAllocationCount();
+} // namespace RS
+
+#endif // !RS_MEMORY_H
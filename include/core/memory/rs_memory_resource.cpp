@@ -0,0 +1,34 @@
+#include "rs_memory_resource.h"
+#include "rs_linear_arena.h"
+#include "rs_memory.h"
+#include <cstddef>
+#include <memory_resource>
+
+void *::RS::ArenaResource::do_allocate(size_t bytes, size_t alignment) {
+  void *memory = _arena->allocate(bytes, alignment);
+  if (memory != NULL) {
+    return memory;
+  };
+  _fallbacks++;
+  return _upstream->allocate(bytes, alignment);
+};
+
+void ::RS::ArenaResource::do_deallocate(void *memory, size_t bytes,
+                                        size_t alignment) {
+  // Arena memory goes away with the frame
+  if (!_arena->owns(memory)) {
+    _upstream->deallocate(memory, bytes, alignment);
+  };
+};
+
+void *::RS::CountingResource::do_allocate(size_t bytes, size_t alignment) {
+  void *memory = _upstream->allocate(bytes, alignment);
+  trackAllocation(_tag, bytes);
+  return memory;
+};
+
+void ::RS::CountingResource::do_deallocate(void *memory, size_t bytes,
+                                           size_t alignment) {
+  _upstream->deallocate(memory, bytes, alignment);
+  trackFree(_tag, bytes);
+};
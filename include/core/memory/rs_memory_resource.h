@@ -0,0 +1,72 @@
+#ifndef RS_MEMORY_RESOURCE_H
+#define RS_MEMORY_RESOURCE_H
+
+#include "rs_linear_arena.h"
+#include "rs_memory.h"
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace RS {
+// std::pmr adapters so standard containers can sit on the engine's
+// allocators:
+//
+//   ArenaResource frameResource(frameArena);
+//   std::pmr::vector<u_int32_t> visible(&frameResource);
+//
+// and for long lived containers with a lot of small nodes, a standard pool
+// over a counted upstream:
+//
+//   CountingResource counted(MEM_ECS);
+//   std::pmr::unsynchronized_pool_resource pool(&counted);
+
+// Allocates from the current frame of a FrameArena, deallocate does
+// nothing. Containers using it have to be cleared or dropped before their
+// memory is reused two frames later. If the arena runs out it falls back
+// to upstream instead of failing, check getFallbacks() to size the arena.
+class ArenaResource : public std::pmr::memory_resource {
+public:
+  // Constructor
+  ArenaResource(FrameArena &arena, std::pmr::memory_resource *upstream =
+                                       std::pmr::new_delete_resource())
+      : _arena(&arena), _upstream(upstream), _fallbacks(0) {};
+
+  inline u_int64_t getFallbacks() const { return _fallbacks; };
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *memory, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  };
+
+  FrameArena *_arena;
+  std::pmr::memory_resource *_upstream;
+  u_int64_t _fallbacks;
+};
+
+// Passes everything to upstream and charges it to a MemoryTag
+class CountingResource : public std::pmr::memory_resource {
+public:
+  // Constructor
+  CountingResource(MemoryTag tag, std::pmr::memory_resource *upstream =
+                                      std::pmr::new_delete_resource())
+      : _tag(tag), _upstream(upstream) {};
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *memory, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  };
+
+  MemoryTag _tag;
+  std::pmr::memory_resource *_upstream;
+};
+
+template <typename T> using FrameVector = std::pmr::vector<T>;
+} // namespace RS
+
+#endif // !RS_MEMORY_RESOURCE_H
@@ -0,0 +1,66 @@
+#include "rs_object_pool.h"
+#include "rs_memory.h"
+#include <cstddef>
+#include <new>
+
+::RS::BlockPool::BlockPool(size_t blockSize, size_t blocksPerChunk,
+                           MemoryTag tag, size_t alignment) {
+  // Every block has to be able to hold the free list link
+  if (blockSize < sizeof(FreeBlock)) {
+    blockSize = sizeof(FreeBlock);
+  };
+  if (alignment < alignof(FreeBlock)) {
+    alignment = alignof(FreeBlock);
+  };
+  _block_size = (blockSize + alignment - 1) / alignment * alignment;
+  _per_chunk = blocksPerChunk == 0 ? 1 : blocksPerChunk;
+  _alignment = alignment;
+  _free = NULL;
+  _live = 0;
+  _tag = tag;
+};
+
+::RS::BlockPool::~BlockPool() {
+  for (unsigned char *chunk : _chunks) {
+    ::operator delete(chunk, std::align_val_t(_alignment));
+    trackFree(_tag, _block_size * _per_chunk);
+  };
+};
+
+void *::RS::BlockPool::allocate() {
+  if (_free == NULL) {
+    addChunk();
+  };
+  FreeBlock *block = _free;
+  _free = block->next;
+  _live++;
+  return block;
+};
+
+void ::RS::BlockPool::deallocate(void *block) {
+  FreeBlock *freed = static_cast<FreeBlock *>(block);
+  freed->next = _free;
+  _free = freed;
+  _live--;
+};
+
+void ::RS::BlockPool::reserve(size_t count) {
+  while (getCapacity() < count) {
+    addChunk();
+  };
+};
+
+void ::RS::BlockPool::addChunk() {
+  const size_t bytes = _block_size * _per_chunk;
+  unsigned char *chunk = static_cast<unsigned char *>(
+      ::operator new(bytes, std::align_val_t(_alignment)));
+  _chunks.push_back(chunk);
+  trackAllocation(_tag, bytes);
+
+  // Thread the new blocks onto the free list, first block first out
+  for (size_t i = _per_chunk; i > 0; i--) {
+    FreeBlock *block = reinterpret_cast<FreeBlock *>(chunk + (i - 1) * _block_size);
+    block->next = _free;
+    _free = block;
+  };
+};
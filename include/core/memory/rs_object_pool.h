@@ -0,0 +1,84 @@
+#ifndef RS_OBJECT_POOL_H
+#define RS_OBJECT_POOL_H
+
+#include "rs_memory.h"
+#include <cstddef>
+#include <new>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace RS {
+// Fixed size blocks carved out of chunks, free blocks are kept in an
+// intrusive list so allocate and deallocate are a couple of pointer moves.
+// Chunks are only given back when the pool goes away. Not thread safe.
+class BlockPool {
+public:
+  // Constructor
+  BlockPool(size_t blockSize, size_t blocksPerChunk = 256,
+            MemoryTag tag = MEM_GENERAL,
+            size_t alignment = alignof(max_align_t));
+
+  BlockPool(const BlockPool &) = delete;
+  BlockPool &operator=(const BlockPool &) = delete;
+
+  // Deconstructor
+  ~BlockPool();
+
+  void *allocate();
+  // Has to be a block of this pool
+  void deallocate(void *block);
+
+  // Grows until at least count blocks exist, so a level load can fill the
+  // pool up front and frames never have to
+  void reserve(size_t count);
+
+  inline size_t getBlockSize() const { return _block_size; };
+  inline size_t getLiveCount() const { return _live; };
+  inline size_t getCapacity() const { return _chunks.size() * _per_chunk; };
+
+private:
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  void addChunk();
+
+  std::vector<unsigned char *> _chunks;
+  FreeBlock *_free;
+  size_t _block_size;
+  size_t _per_chunk;
+  size_t _alignment;
+  size_t _live;
+  MemoryTag _tag;
+};
+
+// BlockPool sized for T that runs constructors and destructors
+template <typename T> class ObjectPool {
+public:
+  // Constructor
+  ObjectPool(size_t objectsPerChunk = 256, MemoryTag tag = MEM_GENERAL)
+      : _pool(sizeof(T), objectsPerChunk, tag, alignof(T)) {};
+
+  template <typename... Args> T *create(Args &&...args) {
+    return new (_pool.allocate()) T(std::forward<Args>(args)...);
+  };
+
+  void destroy(T *object) {
+    if (object == NULL) {
+      return;
+    };
+    object->~T();
+    _pool.deallocate(object);
+  };
+
+  inline void reserve(size_t count) { _pool.reserve(count); };
+  inline size_t getLiveCount() const { return _pool.getLiveCount(); };
+  inline size_t getCapacity() const { return _pool.getCapacity(); };
+
+private:
+  BlockPool _pool;
+};
+} // namespace RS
+
+#endif // !RS_OBJECT_POOL_H
@@ -0,0 +1,288 @@
+#include "rs_profiler.h"
+
+#ifdef REDSTAR_PROFILE
+
+#include "rs_gl.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <sys/types.h>
+#include <vector>
+
+namespace {
+thread_local ::RS::Profiler *t_profiler = NULL;
+thread_local void *t_buffer = NULL;
+std::atomic<u_int32_t> g_next_thread_id{0};
+
+void writeEscaped(FILE *file, const char *text) {
+  for (const char *c = text; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      std::fputc('\\', file);
+    };
+    std::fputc(*c, file);
+  };
+};
+
+void writeZone(FILE *file, bool &first, const char *name, u_int64_t startNs,
+               u_int64_t endNs, int pid, u_int32_t tid) {
+  std::fprintf(file, "%s\n{\"name\":\"", first ? "" : ",");
+  writeEscaped(file, name);
+  std::fprintf(file,
+               "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,"
+               "\"tid\":%u}",
+               (double)startNs / 1000.0, (double)(endNs - startNs) / 1000.0,
+               pid, tid);
+  first = false;
+};
+} // namespace
+
+::RS::Profiler &RS::Profiler::get() {
+  static Profiler profiler;
+  return profiler;
+};
+
+::RS::Profiler::Profiler() {
+  _epoch_ns = 0;
+  _epoch_ns = nowNs();
+  _frames.resize(RS_PROFILER_FRAME_HISTORY);
+  for (ProfileFrame &frame : _frames) {
+    frame.frameIndex = UINT64_MAX;
+    frame.startNs = 0;
+    frame.endNs = 0;
+  };
+  _frame_index = 0;
+  _frame_start_ns = 0;
+  _gpu_initialized = false;
+  _gpu_zone_open = false;
+  _gpu_frame_index = 0;
+  for (GpuQuerySet &set : _gpu_sets) {
+    set.used = 0;
+    set.frameIndex = UINT64_MAX;
+  };
+};
+
+::RS::Profiler::~Profiler() {
+  for (ThreadBuffer *buffer : _threads) {
+    delete buffer;
+  };
+  // The GL context is gone by the time statics are destroyed, the query
+  // objects go with it
+};
+
+u_int64_t RS::Profiler::nowNs() const {
+  u_int64_t now = (u_int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+  return now - _epoch_ns;
+};
+
+::RS::Profiler::ThreadBuffer *RS::Profiler::threadBuffer() {
+  if (t_profiler == this) {
+    return static_cast<ThreadBuffer *>(t_buffer);
+  };
+
+  ThreadBuffer *buffer = new ThreadBuffer();
+  buffer->threadId = g_next_thread_id.fetch_add(1);
+  buffer->name = "Thread " + std::to_string(buffer->threadId);
+  buffer->zones.reserve(1024);
+  {
+    std::lock_guard<std::mutex> lock(_threads_mutex);
+    _threads.push_back(buffer);
+  }
+
+  t_profiler = this;
+  t_buffer = buffer;
+  return buffer;
+};
+
+void ::RS::Profiler::beginZone() {
+  threadBuffer()->openZones.push_back(nowNs());
+};
+
+void ::RS::Profiler::endZone(const char *name) {
+  ThreadBuffer *buffer = threadBuffer();
+  if (buffer->openZones.empty()) {
+    return;
+  };
+
+  ProfileZone zone;
+  zone.name = name;
+  zone.startNs = buffer->openZones.back();
+  zone.endNs = nowNs();
+  zone.threadId = buffer->threadId;
+  buffer->openZones.pop_back();
+  zone.depth = (u_int16_t)buffer->openZones.size();
+
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  buffer->zones.push_back(zone);
+};
+
+void ::RS::Profiler::setThreadName(const char *name) {
+  ThreadBuffer *buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  buffer->name = name;
+};
+
+void ::RS::Profiler::beginFrame() {
+  const u_int64_t now = nowNs();
+
+  if (_frame_start_ns != 0) {
+    // Close the running frame
+    std::lock_guard<std::mutex> framesLock(_frames_mutex);
+    ProfileFrame &frame = _frames[_frame_index % _frames.size()];
+    frame.frameIndex = _frame_index;
+    frame.startNs = _frame_start_ns;
+    frame.endNs = now;
+    frame.cpuZones.clear();
+    frame.gpuZones.clear();
+
+    std::lock_guard<std::mutex> lock(_threads_mutex);
+    for (ThreadBuffer *buffer : _threads) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      frame.cpuZones.insert(frame.cpuZones.end(), buffer->zones.begin(),
+                            buffer->zones.end());
+      buffer->zones.clear();
+    };
+    _frame_index++;
+  };
+  _frame_start_ns = now;
+};
+
+void ::RS::Profiler::beginGpuFrame(u_int64_t frameIndex) {
+  _gpu_frame_index = frameIndex;
+
+  // Pick up the GPU results of the frame that last used this query set
+  if (_gpu_initialized) {
+    GpuQuerySet &set = _gpu_sets[_gpu_frame_index % RS_PROFILER_GPU_LATENCY];
+    resolveGpuQueries(set);
+    set.used = 0;
+    set.frameIndex = _gpu_frame_index;
+  };
+};
+
+void ::RS::Profiler::beginGpuZone(const char *name) {
+  if (!_gpu_initialized) {
+    for (GpuQuerySet &set : _gpu_sets) {
+      glGenQueries(RS_PROFILER_GPU_QUERIES, set.queries);
+      set.used = 0;
+      set.frameIndex = _gpu_frame_index;
+    };
+    _gpu_initialized = true;
+  };
+
+  // GL_TIME_ELAPSED queries cannot nest, inner GPU zones are skipped
+  GpuQuerySet &set = _gpu_sets[_gpu_frame_index % RS_PROFILER_GPU_LATENCY];
+  if (_gpu_zone_open || set.used >= RS_PROFILER_GPU_QUERIES) {
+    return;
+  };
+
+  set.pending[set.used].name = name;
+  set.pending[set.used].cpuStartNs = nowNs();
+  glBeginQuery(GL_TIME_ELAPSED, set.queries[set.used]);
+  _gpu_zone_open = true;
+};
+
+void ::RS::Profiler::endGpuZone() {
+  if (!_gpu_zone_open) {
+    return;
+  };
+
+  glEndQuery(GL_TIME_ELAPSED);
+  _gpu_sets[_gpu_frame_index % RS_PROFILER_GPU_LATENCY].used++;
+  _gpu_zone_open = false;
+};
+
+void ::RS::Profiler::resolveGpuQueries(GpuQuerySet &set) {
+  std::lock_guard<std::mutex> lock(_frames_mutex);
+  ProfileFrame *frame = findFrame(set.frameIndex);
+
+  // Queries are laid out back to back from the CPU time they were issued at,
+  // GL_TIME_ELAPSED only gives durations
+  u_int64_t cursor = 0;
+  for (u_int i = 0; i < set.used; i++) {
+    GLint available = 0;
+    glGetQueryObjectiv(set.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      continue; // Never wait on the GPU, drop the sample instead
+    }
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(set.queries[i], GL_QUERY_RESULT, &elapsed);
+    if (frame == NULL) {
+      continue;
+    }
+
+    ProfileZone zone;
+    zone.name = set.pending[i].name;
+    zone.startNs =
+        set.pending[i].cpuStartNs > cursor ? set.pending[i].cpuStartNs : cursor;
+    zone.endNs = zone.startNs + elapsed;
+    zone.threadId = 0;
+    zone.depth = 0;
+    frame->gpuZones.push_back(zone);
+    cursor = zone.endNs;
+  };
+};
+
+::RS::ProfileFrame *RS::Profiler::findFrame(u_int64_t frameIndex) {
+  ProfileFrame &frame = _frames[frameIndex % _frames.size()];
+  return frame.frameIndex == frameIndex ? &frame : NULL;
+};
+
+bool ::RS::Profiler::dumpChromeTrace(const char *path) {
+  FILE *file = std::fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  };
+
+  bool first = true;
+  std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  // Process and thread names, pid 0 is the CPU and pid 1 the GPU
+  std::fprintf(file, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+                     "\"args\":{\"name\":\"CPU\"}},");
+  std::fprintf(file, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                     "\"args\":{\"name\":\"GPU\"}}");
+  {
+    std::lock_guard<std::mutex> lock(_threads_mutex);
+    for (ThreadBuffer *buffer : _threads) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      std::fprintf(file,
+                   ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                   "\"tid\":%u,\"args\":{\"name\":\"",
+                   buffer->threadId);
+      writeEscaped(file, buffer->name.c_str());
+      std::fprintf(file, "\"}}");
+    };
+  }
+  first = false;
+
+  // Oldest frame first
+  std::lock_guard<std::mutex> framesLock(_frames_mutex);
+  const u_int64_t count = _frames.size();
+  for (u_int64_t i = 0; i < count; i++) {
+    const ProfileFrame &frame = _frames[(_frame_index + i) % count];
+    if (frame.frameIndex == UINT64_MAX) {
+      continue;
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "Frame %llu",
+                  (unsigned long long)frame.frameIndex);
+    writeZone(file, first, name, frame.startNs, frame.endNs, 0, UINT32_MAX);
+    for (const ProfileZone &zone : frame.cpuZones) {
+      writeZone(file, first, zone.name, zone.startNs, zone.endNs, 0,
+                zone.threadId);
+    };
+    for (const ProfileZone &zone : frame.gpuZones) {
+      writeZone(file, first, zone.name, zone.startNs, zone.endNs, 1, 0);
+    };
+  };
+
+  std::fprintf(file, "\n]}\n");
+  return std::fclose(file) == 0;
+};
+
+#endif // REDSTAR_PROFILE
@@ -0,0 +1,163 @@
+#ifndef RS_PROFILER_H
+#define RS_PROFILER_H
+
+// Built in CPU/GPU frame profiler. Everything here compiles away unless the
+// build defines REDSTAR_PROFILE (cmake -DREDSTAR_PROFILE=ON), so the macros
+// can stay in hot code.
+//
+//   RS_PROFILE_FRAME();             Once per frame, closes the previous one
+//   RS_PROFILE_SCOPE("Name");       CPU zone until the end of the scope
+//   RS_PROFILE_GPU_FRAME(index);    Render thread, before the frame's GPU zones
+//   RS_PROFILE_GPU_SCOPE("Name");   GL_TIME_ELAPSED zone, render thread only
+//   RS_PROFILE_THREAD("Name");      Names the calling thread in the trace
+//   RS_PROFILE_DUMP("trace.json");  Writes the kept frames as Chrome trace
+
+#ifdef REDSTAR_PROFILE
+
+#include "rs_gl.h"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+const size_t RS_PROFILER_FRAME_HISTORY = 240;
+const size_t RS_PROFILER_GPU_QUERIES = 64; // Per frame
+// Query sets in flight. Results of a frame are read back when its set comes
+// around again, by then the GPU is done and reading never stalls.
+const size_t RS_PROFILER_GPU_LATENCY = 2;
+
+struct ProfileZone {
+  const char *name;
+  u_int64_t startNs;
+  u_int64_t endNs;
+  u_int32_t threadId;
+  u_int16_t depth;
+};
+
+struct ProfileFrame {
+  u_int64_t frameIndex;
+  u_int64_t startNs;
+  u_int64_t endNs;
+  std::vector<ProfileZone> cpuZones;
+  std::vector<ProfileZone> gpuZones;
+};
+
+class Profiler {
+public:
+  static Profiler &get();
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  // Closes the running frame, collects every thread's zones into the ring
+  // buffer and starts the next one
+  void beginFrame();
+
+  void beginZone();
+  void endZone(const char *name);
+  void setThreadName(const char *name);
+
+  // GPU zones from here on belong to frameIndex, which may be behind the
+  // frame beginFrame() is on when a render thread submits it. Also reads
+  // back the results of an older frame, so it has to run on the thread
+  // that owns the GL context.
+  void beginGpuFrame(u_int64_t frameIndex);
+  void beginGpuZone(const char *name);
+  void endGpuZone();
+
+  // Writes every frame still in the ring buffer as Chrome trace / Perfetto
+  // JSON. Returns false if the file could not be written.
+  bool dumpChromeTrace(const char *path);
+
+  u_int64_t nowNs() const;
+
+private:
+  struct ThreadBuffer {
+    std::mutex mutex;
+    std::vector<ProfileZone> zones;
+    std::vector<u_int64_t> openZones; // Start times of unfinished zones
+    std::string name;
+    u_int32_t threadId;
+  };
+
+  struct GpuPending {
+    const char *name;
+    u_int64_t cpuStartNs;
+  };
+
+  struct GpuQuerySet {
+    GLuint queries[RS_PROFILER_GPU_QUERIES];
+    GpuPending pending[RS_PROFILER_GPU_QUERIES];
+    u_int used;
+    u_int64_t frameIndex;
+  };
+
+  Profiler();
+  ~Profiler();
+
+  ThreadBuffer *threadBuffer();
+  void resolveGpuQueries(GpuQuerySet &set);
+  ProfileFrame *findFrame(u_int64_t frameIndex);
+
+  u_int64_t _epoch_ns;
+
+  std::mutex _threads_mutex;
+  std::vector<ThreadBuffer *> _threads;
+
+  // The render thread adds GPU zones to closed frames
+  std::mutex _frames_mutex;
+  std::vector<ProfileFrame> _frames;
+  u_int64_t _frame_index;
+  u_int64_t _frame_start_ns;
+
+  // GPU timers, created on first use on the thread that owns the context
+  bool _gpu_initialized;
+  bool _gpu_zone_open;
+  u_int64_t _gpu_frame_index;
+  GpuQuerySet _gpu_sets[RS_PROFILER_GPU_LATENCY];
+};
+
+class ProfileScope {
+public:
+  ProfileScope(const char *name) : _name(name) {
+    Profiler::get().beginZone();
+  };
+  ~ProfileScope() { Profiler::get().endZone(_name); };
+
+private:
+  const char *_name;
+};
+
+class GpuProfileScope {
+public:
+  GpuProfileScope(const char *name) { Profiler::get().beginGpuZone(name); };
+  ~GpuProfileScope() { Profiler::get().endGpuZone(); };
+};
+} // namespace RS
+
+#define RS_PROFILE_CONCAT_INNER(a, b) a##b
+#define RS_PROFILE_CONCAT(a, b) RS_PROFILE_CONCAT_INNER(a, b)
+
+#define RS_PROFILE_FRAME() ::RS::Profiler::get().beginFrame()
+#define RS_PROFILE_GPU_FRAME(index) ::RS::Profiler::get().beginGpuFrame(index)
+#define RS_PROFILE_SCOPE(name)                                                 \
+  ::RS::ProfileScope RS_PROFILE_CONCAT(_rs_profile_scope_, __LINE__)(name)
+#define RS_PROFILE_GPU_SCOPE(name)                                             \
+  ::RS::GpuProfileScope RS_PROFILE_CONCAT(_rs_gpu_scope_, __LINE__)(name)
+#define RS_PROFILE_THREAD(name) ::RS::Profiler::get().setThreadName(name)
+#define RS_PROFILE_DUMP(path) ::RS::Profiler::get().dumpChromeTrace(path)
+
+#else
+
+#define RS_PROFILE_FRAME() ((void)0)
+#define RS_PROFILE_GPU_FRAME(index) ((void)0)
+#define RS_PROFILE_SCOPE(name) ((void)0)
+#define RS_PROFILE_GPU_SCOPE(name) ((void)0)
+#define RS_PROFILE_THREAD(name) ((void)0)
+#define RS_PROFILE_DUMP(path) (false)
+
+#endif // REDSTAR_PROFILE
+
+#endif // !RS_PROFILER_H
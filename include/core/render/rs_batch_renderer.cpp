@@ -0,0 +1,508 @@
+#include "rs_batch_renderer.h"
+#include "rs_gl.h"
+#include "rs_mesh_optimize.h"
+#include "rs_profiler.h"
+#include "rs_stream_buffer.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <sys/types.h>
+
+::RS::BatchRenderer::BatchRenderer() {
+  _vao = 0;
+  _vertex_buffer = 0;
+  _index_buffer = 0;
+  _max_vertices = 0;
+  _max_indices = 0;
+  _max_instances = 0;
+  _vertex_count = 0;
+  _index_count = 0;
+  _multi_draw_supported = false;
+  _multi_draw_indirect = false;
+  _state = NULL;
+  _occlusion = NULL;
+  _culled_vao = 0;
+  _in_frame = false;
+  _frame_instances = 0;
+  _stats = {};
+};
+
+::RS::BatchRenderer::~BatchRenderer() {
+  if (_vao != 0) {
+    glDeleteVertexArrays(1, &_vao);
+    glDeleteBuffers(1, &_vertex_buffer);
+    glDeleteBuffers(1, &_index_buffer);
+  };
+  if (_culled_vao != 0) {
+    glDeleteVertexArrays(1, &_culled_vao);
+  };
+};
+
+bool ::RS::BatchRenderer::init(u_int maxVertices, u_int maxIndices,
+                               u_int maxInstances) {
+  if (_vao != 0) {
+    return false;
+  };
+
+  _max_vertices = maxVertices;
+  _max_indices = maxIndices;
+  _max_instances = maxInstances;
+  _instances.reserve(maxInstances);
+
+  _multi_draw_supported = glVersionAtLeast(4, 3);
+  _multi_draw_indirect = _multi_draw_supported;
+
+  glGenVertexArrays(1, &_vao);
+  glGenBuffers(1, &_vertex_buffer);
+  glGenBuffers(1, &_index_buffer);
+  // Room for a full frame per region: the instances' matrices and, for
+  // the occlusion test, their command indices, the commands with their
+  // bounds, and the padding of four aligned allocations per flush
+  const size_t regionBytes =
+      (size_t)maxInstances * (sizeof(glm::mat4) + sizeof(u_int32_t)) +
+      RS_MAX_BATCH_COMMANDS *
+          (sizeof(DrawElementsIndirectCommand) + 2 * sizeof(glm::vec4)) +
+      RS_BATCH_FLUSHES_PER_FRAME * 4 * RS_STREAM_MAX_ALIGNMENT;
+  if (!_stream.init(regionBytes)) {
+    return false;
+  };
+
+  // The index buffer binding needs a vertex array to live in
+  glBindVertexArray(_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)maxVertices * sizeof(Vertex), NULL,
+               GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _index_buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               (GLsizeiptr)maxIndices * sizeof(u_int32_t), NULL,
+               GL_STATIC_DRAW);
+
+  // The instance attributes point at the start of the stream buffer,
+  // baseInstance picks the frame's allocation
+  setupVertexArray(_vao, _stream.getBuffer());
+  return true;
+};
+
+void ::RS::BatchRenderer::setupVertexArray(GLuint vao, GLuint instanceBuffer) {
+  glBindVertexArray(vao);
+
+  glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (void *)offsetof(Vertex, position));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (void *)offsetof(Vertex, texCoord));
+
+  // The index buffer binding is part of the VAO
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _index_buffer);
+
+  // mat4 per instance, one vec4 column per attribute location 2 to 5
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  for (GLuint column = 0; column < 4; column++) {
+    glEnableVertexAttribArray(2 + column);
+    glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                          (void *)(sizeof(glm::vec4) * column));
+    glVertexAttribDivisor(2 + column, 1);
+  };
+
+  glBindVertexArray(0);
+  if (_state != NULL) {
+    _state->invalidate();
+  };
+};
+
+void ::RS::BatchRenderer::setOcclusionCuller(OcclusionCuller *culler) {
+  _occlusion = culler;
+  if (culler == NULL || !culler->isSupported() || _vao == 0 ||
+      _culled_vao != 0) {
+    return;
+  };
+  glGenVertexArrays(1, &_culled_vao);
+  setupVertexArray(_culled_vao, culler->getModelBuffer());
+};
+
+bool ::RS::BatchRenderer::makeRoom(u_int vertexCount, u_int indexCount) {
+  const u_int64_t vertices = (u_int64_t)_vertex_count + vertexCount;
+  const u_int64_t indices = (u_int64_t)_index_count + indexCount;
+  if (vertices <= _max_vertices && indices <= _max_indices) {
+    return true;
+  };
+  // Counts are GLuint in the draw commands
+  if (_vao == 0 || vertices > 0xFFFFFFFFu || indices > 0xFFFFFFFFu) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "BATCH RENDERER SHARED BUFFERS ARE FULL\n");
+    return false;
+  };
+
+  // Doubling keeps the copies down to a constant per added byte
+  if (vertices > _max_vertices) {
+    u_int64_t grown = std::max(vertices, (u_int64_t)_max_vertices * 2);
+    grown = std::min<u_int64_t>(grown, 0xFFFFFFFFu);
+    growBuffer(_vertex_buffer, (size_t)_vertex_count * sizeof(Vertex),
+               (size_t)grown * sizeof(Vertex));
+    _max_vertices = (u_int)grown;
+  };
+  if (indices > _max_indices) {
+    u_int64_t grown = std::max(indices, (u_int64_t)_max_indices * 2);
+    grown = std::min<u_int64_t>(grown, 0xFFFFFFFFu);
+    growBuffer(_index_buffer, (size_t)_index_count * sizeof(u_int32_t),
+               (size_t)grown * sizeof(u_int32_t));
+    _max_indices = (u_int)grown;
+  };
+
+  // The vertex arrays still point at the old buffers
+  setupVertexArray(_vao, _stream.getBuffer());
+  if (_culled_vao != 0) {
+    setupVertexArray(_culled_vao, _occlusion->getModelBuffer());
+  };
+  return true;
+};
+
+void ::RS::BatchRenderer::growBuffer(GLuint &buffer, size_t usedBytes,
+                                     size_t bytes) {
+  // Copied on the GPU, the copy binding points leave every vertex array's
+  // element buffer alone
+  GLuint grown = 0;
+  glGenBuffers(1, &grown);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+  glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)bytes, NULL, GL_STATIC_DRAW);
+  if (usedBytes > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        (GLsizeiptr)usedBytes);
+  };
+  glDeleteBuffers(1, &buffer);
+  buffer = grown;
+};
+
+::RS::MeshHandle RS::BatchRenderer::addMesh(const Vertex *vertices,
+                                            u_int vertexCount,
+                                            const u_int32_t *indices,
+                                            u_int indexCount) {
+  if (!makeRoom(vertexCount, indexCount)) {
+    return RS_INVALID_MESH;
+  };
+
+  glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)_vertex_count * sizeof(Vertex),
+                  (GLsizeiptr)vertexCount * sizeof(Vertex), vertices);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _index_buffer);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+                  (GLintptr)_index_count * sizeof(u_int32_t),
+                  (GLsizeiptr)indexCount * sizeof(u_int32_t), indices);
+
+  // Indices stay relative to the mesh, baseVertex rebases them at draw time
+  MeshInfo mesh;
+  mesh.firstIndex = _index_count;
+  mesh.indexCount = indexCount;
+  mesh.baseVertex = (GLint)_vertex_count;
+  glm::vec3 boundsMin = vertexCount > 0 ? vertices[0].position : glm::vec3(0.0f);
+  glm::vec3 boundsMax = boundsMin;
+  for (u_int i = 1; i < vertexCount; i++) {
+    boundsMin = glm::min(boundsMin, vertices[i].position);
+    boundsMax = glm::max(boundsMax, vertices[i].position);
+  };
+  mesh.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+  mesh.boundsExtents = (boundsMax - boundsMin) * 0.5f;
+  mesh.lodCount = 0;
+  mesh.lodError = 0.0f;
+  mesh.vertexInvocations =
+      analyzeVertexCache(indices, indexCount, vertexCount).invocations;
+  _meshes.push_back(mesh);
+
+  _vertex_count += vertexCount;
+  _index_count += indexCount;
+  return (MeshHandle)(_meshes.size() - 1);
+};
+
+bool ::RS::BatchRenderer::addMeshFile(const MeshFile &file,
+                                      std::vector<MeshHandle> &out) {
+  const u_int vertexCount = file.getVertexCount();
+  const u_int indexCount = file.getIndexCount();
+  if (!file.isOpen() || !makeRoom(vertexCount, indexCount)) {
+    return false;
+  };
+
+  const void *indices = file.getIndices();
+  if (!file.hasIndices32()) {
+    // The shared index buffer is 32 bit only, rs_mesh_convert never writes
+    // these
+    const u_int16_t *narrow = static_cast<const u_int16_t *>(indices);
+    _widened_indices.assign(narrow, narrow + indexCount);
+    indices = _widened_indices.data();
+  };
+
+  glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)_vertex_count * sizeof(Vertex),
+                  (GLsizeiptr)vertexCount * sizeof(Vertex),
+                  file.getVertices());
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _index_buffer);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+                  (GLintptr)_index_count * sizeof(u_int32_t),
+                  (GLsizeiptr)indexCount * sizeof(u_int32_t), indices);
+
+  const MeshFileSubmesh *submeshes = file.getSubmeshes();
+  const MeshFileLod *lods = file.getLods();
+  for (u_int i = 0; i < file.getSubmeshCount(); i++) {
+    MeshInfo mesh;
+    mesh.firstIndex = _index_count + submeshes[i].firstIndex;
+    mesh.indexCount = submeshes[i].indexCount;
+    mesh.baseVertex = (GLint)_vertex_count + submeshes[i].baseVertex;
+    const MeshBounds &bounds = submeshes[i].bounds;
+    glm::vec3 boundsMin(bounds.min[0], bounds.min[1], bounds.min[2]);
+    glm::vec3 boundsMax(bounds.max[0], bounds.max[1], bounds.max[2]);
+    mesh.boundsCenter = (boundsMin + boundsMax) * 0.5f;
+    mesh.boundsExtents = (boundsMax - boundsMin) * 0.5f;
+    mesh.lodCount = submeshes[i].lodCount;
+    mesh.lodError = 0.0f;
+    mesh.vertexInvocations = submeshes[i].vertexInvocations;
+    _meshes.push_back(mesh);
+    out.push_back((MeshHandle)(_meshes.size() - 1));
+
+    // Same vertices and bounds, only the index range differs
+    for (u_int level = 0; level < submeshes[i].lodCount; level++) {
+      const MeshFileLod &lod = lods[submeshes[i].firstLod + level];
+      MeshInfo coarser = mesh;
+      coarser.firstIndex = _index_count + lod.firstIndex;
+      coarser.indexCount = lod.indexCount;
+      coarser.lodCount = 0;
+      coarser.lodError = lod.error;
+      coarser.vertexInvocations = lod.vertexInvocations;
+      _meshes.push_back(coarser);
+    };
+  };
+  _widened_indices.clear();
+
+  _vertex_count += vertexCount;
+  _index_count += indexCount;
+  return true;
+};
+
+void ::RS::BatchRenderer::beginFrame() {
+  _stream.beginFrame();
+  _stats = {};
+  _in_frame = true;
+  _frame_instances = 0;
+};
+
+void ::RS::BatchRenderer::endFrame() {
+  _stream.endFrame();
+  _in_frame = false;
+  _frame_instances = 0;
+};
+
+void ::RS::BatchRenderer::flush(bool preserveOrder) {
+  RS_PROFILE_SCOPE("BatchRenderer::flush");
+  auto start = std::chrono::high_resolution_clock::now();
+
+  const bool ownFrame = !_in_frame;
+  if (ownFrame) {
+    beginFrame();
+  };
+  _stats.instances += (u_int)_instances.size();
+  _frame_instances += _instances.size();
+  if (_instances.empty()) {
+    if (ownFrame) {
+      endFrame();
+    };
+    return;
+  };
+
+  // The occlusion test hands out slots in whatever order the GPU finds
+  // visible instances, so it is only for flushes that may reorder
+  const bool occlusion = !preserveOrder && _occlusion != NULL &&
+                         _occlusion->isEnabled() && _culled_vao != 0 &&
+                         _multi_draw_indirect;
+  // The test reads its inputs as storage buffers, which need bigger
+  // alignment on some drivers
+  const size_t alignment =
+      occlusion ? std::max(sizeof(glm::mat4), _occlusion->getStorageAlignment())
+                : sizeof(glm::mat4);
+
+  // Everything this flush streams, at worst. A frame with more flushes
+  // than the region has padding for carries on in the next region, which
+  // waits on that region's fence instead of dropping the batch.
+  const size_t instanceCount = _instances.size();
+  const size_t commandCount =
+      std::min(preserveOrder ? instanceCount
+                             : std::min(instanceCount, _meshes.size()),
+               (size_t)RS_MAX_BATCH_COMMANDS);
+  size_t needed = instanceCount * sizeof(glm::mat4) +
+                  commandCount * sizeof(DrawElementsIndirectCommand) +
+                  4 * alignment;
+  if (occlusion) {
+    needed += instanceCount * sizeof(u_int32_t) +
+              commandCount * 2 * sizeof(glm::vec4);
+  };
+  if (_stream.getRemaining() < needed) {
+    _stream.endFrame();
+    _stream.beginFrame();
+  };
+
+  // Written straight into the stream buffer, 64 byte alignment keeps the
+  // offset a whole number of instances
+  StreamAllocation models =
+      _stream.allocate(_instances.size() * sizeof(glm::mat4), alignment);
+  if (models.data == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "BATCH STREAM BUFFER FULL\n");
+    _instances.clear();
+    if (ownFrame) {
+      endFrame();
+    };
+    return;
+  };
+  const GLuint instanceBase = (GLuint)(models.offset / sizeof(glm::mat4));
+  glm::mat4 *streamedModels = static_cast<glm::mat4 *>(models.data);
+
+  // Index of each instance's command, for the occlusion test
+  StreamAllocation instanceCommands = {};
+  if (occlusion) {
+    instanceCommands =
+        _stream.allocate(_instances.size() * sizeof(u_int32_t), alignment);
+  };
+  u_int32_t *commandIndices = static_cast<u_int32_t *>(instanceCommands.data);
+
+  _commands.clear();
+  if (preserveOrder) {
+    // One command per run of the same mesh, GL draws the commands of a
+    // multi draw in order
+    MeshHandle runMesh = RS_INVALID_MESH;
+    for (size_t i = 0; i < _instances.size(); i++) {
+      const Instance &instance = _instances[i];
+      streamedModels[i] = instance.model;
+      if (instance.mesh == runMesh) {
+        _commands.back().instanceCount++;
+        continue;
+      }
+
+      runMesh = instance.mesh;
+      DrawElementsIndirectCommand command;
+      command.count = _meshes[runMesh].indexCount;
+      command.instanceCount = 1;
+      command.firstIndex = _meshes[runMesh].firstIndex;
+      command.baseVertex = _meshes[runMesh].baseVertex;
+      command.baseInstance = instanceBase + (GLuint)i;
+      _commands.push_back(command);
+    };
+  } else {
+    // Counting sort by mesh so each mesh's instances are contiguous and one
+    // command can draw all of them
+    const size_t meshCount = _meshes.size();
+    _mesh_counts.assign(meshCount + 1, 0);
+    _mesh_commands.resize(meshCount);
+    _command_bounds.clear();
+    for (const Instance &instance : _instances) {
+      _mesh_counts[instance.mesh + 1]++;
+    };
+
+    for (size_t mesh = 0; mesh < meshCount; mesh++) {
+      const u_int count = _mesh_counts[mesh + 1];
+      const u_int first = _mesh_counts[mesh];
+      _mesh_counts[mesh + 1] += first;
+      if (count == 0) {
+        continue;
+      }
+
+      DrawElementsIndirectCommand command;
+      command.count = _meshes[mesh].indexCount;
+      command.instanceCount = count;
+      command.firstIndex = _meshes[mesh].firstIndex;
+      command.baseVertex = _meshes[mesh].baseVertex;
+      command.baseInstance = instanceBase + first;
+      _mesh_commands[mesh] = (u_int)_commands.size();
+      _commands.push_back(command);
+      if (commandIndices != NULL) {
+        _command_bounds.push_back(glm::vec4(_meshes[mesh].boundsCenter, 0.0f));
+        _command_bounds.push_back(
+            glm::vec4(_meshes[mesh].boundsExtents, 0.0f));
+      }
+    };
+
+    for (const Instance &instance : _instances) {
+      const u_int slot = _mesh_counts[instance.mesh]++;
+      streamedModels[slot] = instance.model;
+      if (commandIndices != NULL) {
+        commandIndices[slot] = _mesh_commands[instance.mesh];
+      }
+    };
+  };
+
+  // The culler reads the bounds from the stream buffer too
+  GLintptr boundsOffset = -1;
+  if (commandIndices != NULL && _commands.size() <= RS_MAX_BATCH_COMMANDS) {
+    boundsOffset = _stream.upload(_command_bounds.data(),
+                                  _command_bounds.size() * sizeof(glm::vec4),
+                                  alignment);
+  };
+
+  GLintptr commandOffset = -1;
+  if (_multi_draw_indirect && _commands.size() <= RS_MAX_BATCH_COMMANDS) {
+    commandOffset = _stream.upload(
+        _commands.data(),
+        _commands.size() * sizeof(DrawElementsIndirectCommand), 4);
+  };
+  _stream.flush();
+
+  // Instances the culler drops never reach the vertex shader. A frame
+  // out of room in the culler's buffers draws the rest unculled.
+  GLintptr culledOffset = -1;
+  if (boundsOffset >= 0 && commandOffset >= 0) {
+    culledOffset = _occlusion->cull(
+        _stream.getBuffer(), models.offset, instanceCommands.offset,
+        boundsOffset, (u_int)_instances.size(), _commands.data(),
+        (u_int)_commands.size());
+  };
+
+  if (culledOffset >= 0) {
+    if (_state != NULL) {
+      _state->bindVertexArray(_culled_vao);
+    } else {
+      glBindVertexArray(_culled_vao);
+    };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _occlusion->getCommandBuffer());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                (void *)culledOffset,
+                                (GLsizei)_commands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    _stats.drawCalls++;
+    _stats.gpuCulled += (u_int)_instances.size();
+  } else {
+    if (_state != NULL) {
+      _state->bindVertexArray(_vao);
+    } else {
+      glBindVertexArray(_vao);
+    };
+    if (commandOffset >= 0) {
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _stream.getBuffer());
+      glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                  (void *)commandOffset,
+                                  (GLsizei)_commands.size(), 0);
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+      _stats.drawCalls++;
+    } else {
+      for (const DrawElementsIndirectCommand &command : _commands) {
+        glDrawElementsInstancedBaseVertexBaseInstance(
+            GL_TRIANGLES, (GLsizei)command.count, GL_UNSIGNED_INT,
+            (void *)(sizeof(u_int32_t) * command.firstIndex),
+            (GLsizei)command.instanceCount, command.baseVertex,
+            command.baseInstance);
+      };
+      _stats.drawCalls += (u_int)_commands.size();
+    };
+  };
+  if (_state == NULL) {
+    glBindVertexArray(0);
+  };
+  if (ownFrame) {
+    endFrame();
+  };
+
+  _stats.batches += (u_int)_commands.size();
+  _instances.clear();
+
+  auto end = std::chrono::high_resolution_clock::now();
+  _stats.submitMs +=
+      std::chrono::duration<double, std::milli>(end - start).count();
+};
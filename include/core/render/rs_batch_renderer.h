@@ -0,0 +1,216 @@
+#ifndef RS_BATCH_RENDERER_H
+#define RS_BATCH_RENDERER_H
+
+#include "rs_gl.h"
+#include "rs_gl_state.h"
+#include "rs_mesh_file.h"
+#include "rs_mesh_format.h"
+#include "rs_occlusion.h"
+#include "rs_stream_buffer.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+typedef u_int MeshHandle;
+const MeshHandle RS_INVALID_MESH = 0xFFFFFFFFu;
+
+// Layout fixed by GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+struct BatchStats {
+  u_int instances; // Objects submitted this frame
+  u_int drawCalls; // GL draw calls issued
+  u_int batches;   // Indirect commands, one per run of the same mesh
+  u_int gpuCulled; // Instances handed to the GPU occlusion test
+  double submitMs; // CPU time spent in flush()
+};
+
+// Most distinct meshes one flush() can draw, bounds the indirect commands
+// streamed per frame
+const u_int RS_MAX_BATCH_COMMANDS = 4096;
+// Flushes per frame the stream region has alignment padding for. A frame
+// with more of them can run out of region, its flushes then carry on in
+// the next one.
+const u_int RS_BATCH_FLUSHES_PER_FRAME = 64;
+
+// Draws many objects with few calls. Every mesh lives in one shared vertex
+// and index buffer, per instance model matrices and the indirect commands
+// are streamed through a StreamBuffer and each frame goes out as a single
+// glMultiDrawElementsIndirect, or one instanced draw per mesh where
+// multi-draw-indirect is not available (GL < 4.3).
+class BatchRenderer {
+public:
+  // Constructor
+  BatchRenderer();
+
+  BatchRenderer(const BatchRenderer &) = delete;
+  BatchRenderer &operator=(const BatchRenderer &) = delete;
+
+  // Deconstructor
+  ~BatchRenderer();
+
+  // Allocates the shared buffers, needs a current GL context. maxVertices
+  // and maxIndices are where the shared buffers start, they double when a
+  // mesh does not fit. maxInstances is fixed, it caps the instances of a
+  // whole frame and sizes the stream buffer.
+  bool init(u_int maxVertices, u_int maxIndices, u_int maxInstances);
+
+  // Copies a mesh into the shared buffers, growing them if needed. Returns
+  // RS_INVALID_MESH only past 2^32 vertices or indices.
+  MeshHandle addMesh(const Vertex *vertices, u_int vertexCount,
+                     const u_int32_t *indices, u_int indexCount);
+
+  // Copies every submesh of a mapped .rsmesh file in, one handle per
+  // submesh appended to out. rs_mesh_convert writes 32 bit indices, they
+  // are uploaded straight from the mapping. 16 bit streams from other
+  // writers are widened first. Returns false like addMesh() does.
+  //
+  // The LODs of a submesh get the handles right after its own, they are
+  // not appended to out, selectLod() finds them.
+  bool addMeshFile(const MeshFile &file, std::vector<MeshHandle> &out);
+
+  // Coarsest LOD of mesh whose error stays within maxError, in object
+  // space units. mesh itself when it has none or none is good enough.
+  inline MeshHandle selectLod(MeshHandle mesh, float maxError) const {
+    if (mesh >= _meshes.size()) {
+      return mesh;
+    }
+    const MeshInfo &info = _meshes[mesh];
+    for (u_int level = info.lodCount; level > 0; level--) {
+      if (_meshes[mesh + level].lodError <= maxError) {
+        return mesh + level;
+      }
+    }
+    return mesh;
+  };
+  inline u_int getLodCount(MeshHandle mesh) const {
+    return mesh < _meshes.size() ? _meshes[mesh].lodCount : 0;
+  };
+  inline u_int getTriangleCount(MeshHandle mesh) const {
+    return mesh < _meshes.size() ? _meshes[mesh].indexCount / 3 : 0;
+  };
+  // Vertex shader runs one draw of the mesh costs, from a FIFO cache
+  // simulation at load time
+  inline u_int getVertexInvocations(MeshHandle mesh) const {
+    return mesh < _meshes.size() ? _meshes[mesh].vertexInvocations : 0;
+  };
+
+  // Object space AABB of a mesh as center and half extents, false for an
+  // unknown handle
+  inline bool getMeshBounds(MeshHandle mesh, glm::vec3 &center,
+                            glm::vec3 &extents) const {
+    if (mesh >= _meshes.size()) {
+      return false;
+    }
+    center = _meshes[mesh].boundsCenter;
+    extents = _meshes[mesh].boundsExtents;
+    return true;
+  };
+
+  // Queues one instance of mesh for this frame. Past maxInstances over
+  // all of the frame's flushes it is dropped.
+  inline void submit(MeshHandle mesh, const glm::mat4 &model) {
+    if (mesh < _meshes.size() &&
+        _frame_instances + _instances.size() < _max_instances) {
+      _instances.push_back({model, mesh});
+    }
+  };
+
+  // Issues every queued instance and clears the queue. The caller binds
+  // the program. Instances are grouped by mesh, or with preserveOrder
+  // drawn in the order they were submitted, e.g. sorted back to front.
+  // Outside beginFrame()/endFrame() it is a frame of its own and advances
+  // the stream buffer.
+  void flush(bool preserveOrder = false);
+
+  // Brackets several flush() calls, e.g. one per material, that share one
+  // stream buffer region. Stats add up over the frame.
+  void beginFrame();
+  void endFrame();
+
+  // Bind the vertex array through a state cache instead of directly, and
+  // leave it bound afterwards. NULL goes back to binding directly.
+  inline void setStateCache(GLStateCache *state) { _state = state; };
+
+  // Flushes that may reorder instances go through the culler's occlusion
+  // test while it is enabled, and are drawn from what it wrote. Needs
+  // multi-draw-indirect and init() first. NULL turns it off.
+  void setOcclusionCuller(OcclusionCuller *culler);
+
+  inline bool usesMultiDrawIndirect() const { return _multi_draw_indirect; };
+  inline void setMultiDrawIndirect(bool enabled) {
+    _multi_draw_indirect = enabled && _multi_draw_supported;
+  };
+  inline const BatchStats &getStats() const { return _stats; };
+  // Of the last region, a frame that moved on to the next one has two
+  inline const StreamStats &getStreamStats() const {
+    return _stream.getStats();
+  };
+  inline GLuint getVertexArray() const { return _vao; };
+
+private:
+  // Vertex and index buffer plus the mat4 instance attributes, locations
+  // 2 to 5, read from instanceBuffer
+  void setupVertexArray(GLuint vao, GLuint instanceBuffer);
+  // Grows the shared buffers so the counts fit after what is there
+  bool makeRoom(u_int vertexCount, u_int indexCount);
+  // Replaces buffer with a bytes sized one holding its first usedBytes
+  void growBuffer(GLuint &buffer, size_t usedBytes, size_t bytes);
+
+  struct MeshInfo {
+    GLuint firstIndex;
+    GLuint indexCount;
+    GLint baseVertex;
+    glm::vec3 boundsCenter;
+    glm::vec3 boundsExtents;
+    u_int lodCount;  // LOD handles that follow this one
+    float lodError;  // 0 for full detail
+    u_int vertexInvocations;
+  };
+
+  struct Instance {
+    glm::mat4 model;
+    MeshHandle mesh;
+  };
+
+  std::vector<MeshInfo> _meshes;
+  std::vector<Instance> _instances;
+
+  // Per frame scratch, reused so steady state frames do not allocate
+  std::vector<u_int> _mesh_counts;
+  std::vector<u_int> _mesh_commands;      // Command index of each mesh
+  std::vector<glm::vec4> _command_bounds; // Center, extents per command
+  std::vector<DrawElementsIndirectCommand> _commands;
+  std::vector<u_int32_t> _widened_indices;
+
+  GLuint _vao;
+  GLuint _vertex_buffer;
+  GLuint _index_buffer;
+  StreamBuffer _stream; // Instance matrices and indirect commands
+  GLStateCache *_state;
+  OcclusionCuller *_occlusion;
+  GLuint _culled_vao; // Instances from the culler's model buffer
+  bool _in_frame;
+  size_t _frame_instances; // Flushed since beginFrame()
+
+  u_int _max_vertices;
+  u_int _max_indices;
+  u_int _max_instances;
+  u_int _vertex_count;
+  u_int _index_count;
+
+  bool _multi_draw_supported;
+  bool _multi_draw_indirect;
+  BatchStats _stats;
+};
+} // namespace RS
+
+#endif // !RS_BATCH_RENDERER_H
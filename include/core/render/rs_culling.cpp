@@ -0,0 +1,280 @@
+#include "rs_culling.h"
+#include <cmath>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RS_CULL_X86
+#include <immintrin.h>
+#endif
+
+// The SIMD paths are built with per function target attributes and picked
+// at runtime, the rest of the engine does not need -mavx2
+
+namespace {
+// Which test a kernel runs, spheres only need the radius, boxes project
+// their extents onto the plane normal
+enum CullShape { SHAPE_SPHERE, SHAPE_BOX };
+
+inline bool insideScalar(const RS::Frustum &frustum,
+                         const RS::CullBounds &bounds, size_t i,
+                         CullShape shape) {
+  for (int p = 0; p < 6; p++) {
+    const glm::vec4 &plane = frustum.planes[p];
+    float distance = plane.x * bounds.centerX[i] +
+                     plane.y * bounds.centerY[i] +
+                     plane.z * bounds.centerZ[i] + plane.w;
+    float reach = shape == SHAPE_SPHERE
+                      ? bounds.radius[i]
+                      : std::fabs(plane.x) * bounds.extentX[i] +
+                            std::fabs(plane.y) * bounds.extentY[i] +
+                            std::fabs(plane.z) * bounds.extentZ[i];
+    if (distance < -reach) {
+      return false;
+    }
+  }
+  return true;
+};
+
+size_t cullScalar(const RS::Frustum &frustum, const RS::CullBounds &bounds,
+                  size_t begin, u_int32_t *visible, size_t count,
+                  CullShape shape) {
+  const size_t size = bounds.size();
+  for (size_t i = begin; i < size; i++) {
+    // Branch free append, the slot is overwritten when i is culled
+    visible[count] = (u_int32_t)i;
+    count += insideScalar(frustum, bounds, i, shape) ? 1 : 0;
+  };
+  return count;
+};
+
+#ifdef RS_CULL_X86
+// Appends the lanes set in mask
+inline size_t appendMask(u_int32_t *visible, size_t count, u_int32_t base,
+                         u_int32_t mask) {
+  while (mask != 0) {
+    visible[count++] = base + (u_int32_t)__builtin_ctz(mask);
+    mask &= mask - 1;
+  }
+  return count;
+};
+
+__attribute__((target("sse2"))) size_t
+cullSSE(const RS::Frustum &frustum, const RS::CullBounds &bounds,
+        u_int32_t *visible, CullShape shape) {
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+  __m128 absX[6], absY[6], absZ[6];
+  for (int p = 0; p < 6; p++) {
+    planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+    planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+    planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+    planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+    absX[p] = _mm_andnot_ps(signMask, planeX[p]);
+    absY[p] = _mm_andnot_ps(signMask, planeY[p]);
+    absZ[p] = _mm_andnot_ps(signMask, planeZ[p]);
+  };
+
+  const size_t size = bounds.size();
+  const size_t end = size & ~(size_t)3;
+  size_t count = 0;
+  for (size_t i = 0; i < end; i += 4) {
+    __m128 x = _mm_loadu_ps(&bounds.centerX[i]);
+    __m128 y = _mm_loadu_ps(&bounds.centerY[i]);
+    __m128 z = _mm_loadu_ps(&bounds.centerZ[i]);
+    __m128 ex, ey, ez, radius;
+    if (shape == SHAPE_SPHERE) {
+      radius = _mm_loadu_ps(&bounds.radius[i]);
+    } else {
+      ex = _mm_loadu_ps(&bounds.extentX[i]);
+      ey = _mm_loadu_ps(&bounds.extentY[i]);
+      ez = _mm_loadu_ps(&bounds.extentZ[i]);
+    }
+
+    // Lanes stay set while they are in front of every plane so far
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+          _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+      __m128 reach =
+          shape == SHAPE_SPHERE
+              ? radius
+              : _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex),
+                                      _mm_mul_ps(absY[p], ey)),
+                           _mm_mul_ps(absZ[p], ez));
+      inside = _mm_and_ps(
+          inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+    }
+    count = appendMask(visible, count, (u_int32_t)i,
+                       (u_int32_t)_mm_movemask_ps(inside));
+  };
+  return cullScalar(frustum, bounds, end, visible, count, shape);
+};
+
+__attribute__((target("avx2,fma"))) size_t
+cullAVX2(const RS::Frustum &frustum, const RS::CullBounds &bounds,
+         u_int32_t *visible, CullShape shape) {
+  const __m256 signMask = _mm256_set1_ps(-0.0f);
+  __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+  __m256 absX[6], absY[6], absZ[6];
+  for (int p = 0; p < 6; p++) {
+    planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+    planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+    planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+    planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+    absX[p] = _mm256_andnot_ps(signMask, planeX[p]);
+    absY[p] = _mm256_andnot_ps(signMask, planeY[p]);
+    absZ[p] = _mm256_andnot_ps(signMask, planeZ[p]);
+  };
+
+  const size_t size = bounds.size();
+  const size_t end = size & ~(size_t)7;
+  size_t count = 0;
+  for (size_t i = 0; i < end; i += 8) {
+    __m256 x = _mm256_loadu_ps(&bounds.centerX[i]);
+    __m256 y = _mm256_loadu_ps(&bounds.centerY[i]);
+    __m256 z = _mm256_loadu_ps(&bounds.centerZ[i]);
+    __m256 ex, ey, ez, radius;
+    if (shape == SHAPE_SPHERE) {
+      radius = _mm256_loadu_ps(&bounds.radius[i]);
+    } else {
+      ex = _mm256_loadu_ps(&bounds.extentX[i]);
+      ey = _mm256_loadu_ps(&bounds.extentY[i]);
+      ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+    }
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+      __m256 distance = _mm256_fmadd_ps(
+          planeX[p], x,
+          _mm256_fmadd_ps(planeY[p], y, _mm256_fmadd_ps(planeZ[p], z, planeW[p])));
+      __m256 reach =
+          shape == SHAPE_SPHERE
+              ? radius
+              : _mm256_fmadd_ps(absX[p], ex,
+                                _mm256_fmadd_ps(absY[p], ey,
+                                                _mm256_mul_ps(absZ[p], ez)));
+      inside = _mm256_and_ps(inside,
+                             _mm256_cmp_ps(_mm256_add_ps(distance, reach),
+                                           _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    count = appendMask(visible, count, (u_int32_t)i,
+                       (u_int32_t)_mm256_movemask_ps(inside));
+  };
+  return cullScalar(frustum, bounds, end, visible, count, shape);
+};
+#endif
+
+size_t cull(const RS::Frustum &frustum, const RS::CullBounds &bounds,
+            u_int32_t *visible, RS::CullBackend backend, CullShape shape) {
+  if (backend == RS::CULL_AUTO) {
+    backend = RS::getBestCullBackend();
+  };
+  switch (backend) {
+#ifdef RS_CULL_X86
+  case RS::CULL_AVX2:
+    if (RS::getBestCullBackend() == RS::CULL_AVX2) {
+      return cullAVX2(frustum, bounds, visible, shape);
+    }
+    return cullSSE(frustum, bounds, visible, shape);
+  case RS::CULL_SSE:
+    return cullSSE(frustum, bounds, visible, shape);
+#endif
+  default:
+    return cullScalar(frustum, bounds, 0, visible, 0, shape);
+  };
+};
+} // namespace
+
+::RS::Frustum RS::Frustum::fromMatrix(const glm::mat4 &viewProjection) {
+  // Rows of the matrix, glm is column major
+  glm::vec4 rows[4];
+  for (int row = 0; row < 4; row++) {
+    rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row],
+                          viewProjection[2][row], viewProjection[3][row]);
+  };
+
+  Frustum frustum;
+  frustum.planes[0] = rows[3] + rows[0]; // Left
+  frustum.planes[1] = rows[3] - rows[0]; // Right
+  frustum.planes[2] = rows[3] + rows[1]; // Bottom
+  frustum.planes[3] = rows[3] - rows[1]; // Top
+  frustum.planes[4] = rows[3] + rows[2]; // Near
+  frustum.planes[5] = rows[3] - rows[2]; // Far
+  for (int p = 0; p < 6; p++) {
+    float length = glm::length(glm::vec3(frustum.planes[p]));
+    if (length > 0.0f) {
+      frustum.planes[p] /= length;
+    }
+  };
+  return frustum;
+};
+
+void ::RS::CullBounds::clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  extentX.clear();
+  extentY.clear();
+  extentZ.clear();
+  radius.clear();
+};
+
+void ::RS::CullBounds::reserve(size_t count) {
+  centerX.reserve(count);
+  centerY.reserve(count);
+  centerZ.reserve(count);
+  extentX.reserve(count);
+  extentY.reserve(count);
+  extentZ.reserve(count);
+  radius.reserve(count);
+};
+
+void ::RS::CullBounds::push(const glm::vec3 &center,
+                            const glm::vec3 &extents) {
+  centerX.push_back(center.x);
+  centerY.push_back(center.y);
+  centerZ.push_back(center.z);
+  extentX.push_back(extents.x);
+  extentY.push_back(extents.y);
+  extentZ.push_back(extents.z);
+  radius.push_back(glm::length(extents));
+};
+
+::RS::CullBackend RS::getBestCullBackend() {
+#ifdef RS_CULL_X86
+  static const CullBackend best =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+          ? CULL_AVX2
+          : CULL_SSE;
+  return best;
+#else
+  return CULL_SCALAR;
+#endif
+};
+
+const char *RS::getCullBackendName(CullBackend backend) {
+  switch (backend) {
+  case CULL_AUTO:
+    return getCullBackendName(getBestCullBackend());
+  case CULL_SCALAR:
+    return "scalar";
+  case CULL_SSE:
+    return "SSE";
+  case CULL_AVX2:
+    return "AVX2";
+  };
+  return "unknown";
+};
+
+size_t RS::cullSpheres(const Frustum &frustum, const CullBounds &bounds,
+                       u_int32_t *visible, CullBackend backend) {
+  return cull(frustum, bounds, visible, backend, SHAPE_SPHERE);
+};
+
+size_t RS::cullBoxes(const Frustum &frustum, const CullBounds &bounds,
+                     u_int32_t *visible, CullBackend backend) {
+  return cull(frustum, bounds, visible, backend, SHAPE_BOX);
+};
@@ -0,0 +1,66 @@
+#ifndef RS_CULLING_H
+#define RS_CULLING_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+// Six planes (left, right, bottom, top, near, far) as (normal, distance)
+// with normals pointing inwards, a point p is inside a plane when
+// dot(normal, p) + distance >= 0
+struct Frustum {
+  glm::vec4 planes[6];
+
+  // Extracts the planes of a GL clip space view-projection matrix
+  // (Gribb/Hartmann) and normalizes them
+  static Frustum fromMatrix(const glm::mat4 &viewProjection);
+};
+
+// World space bounds in structure of arrays layout so the SIMD paths can
+// load 4 or 8 objects per instruction. Every object has an AABB given as
+// center and half extents, and the sphere around it.
+struct CullBounds {
+  std::vector<float> centerX;
+  std::vector<float> centerY;
+  std::vector<float> centerZ;
+  std::vector<float> extentX;
+  std::vector<float> extentY;
+  std::vector<float> extentZ;
+  std::vector<float> radius;
+
+  inline size_t size() const { return centerX.size(); };
+
+  void clear();
+  void reserve(size_t count);
+  void push(const glm::vec3 &center, const glm::vec3 &extents);
+};
+
+struct CullStats {
+  u_int candidates;
+  u_int visible;
+  double cullMs;
+};
+
+enum CullBackend {
+  CULL_AUTO, // Best the CPU supports
+  CULL_SCALAR,
+  CULL_SSE,  // 4 objects at a time
+  CULL_AVX2, // 8 objects at a time
+};
+
+// What CULL_AUTO resolves to on this CPU
+CullBackend getBestCullBackend();
+const char *getCullBackendName(CullBackend backend);
+
+// Both write the indices of every object at least partly inside the
+// frustum to visible, which needs room for bounds.size() entries, and
+// return how many were written. Indices come out in ascending order.
+size_t cullSpheres(const Frustum &frustum, const CullBounds &bounds,
+                   u_int32_t *visible, CullBackend backend = CULL_AUTO);
+size_t cullBoxes(const Frustum &frustum, const CullBounds &bounds,
+                 u_int32_t *visible, CullBackend backend = CULL_AUTO);
+} // namespace RS
+
+#endif // !RS_CULLING_H
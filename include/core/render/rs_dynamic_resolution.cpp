@@ -0,0 +1,212 @@
+#include "rs_dynamic_resolution.h"
+#include "rs_framebuffer.h"
+#include "rs_gl.h"
+#include "shader.hpp"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <sys/types.h>
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+namespace {
+// Weight of the newest GPU time in the running average
+const double GPU_TIME_SMOOTHING = 0.2;
+
+int scaledSize(int size, float scale) {
+  int scaled = (int)std::lround((double)size * scale);
+  return scaled > 0 ? scaled : 1;
+};
+} // namespace
+
+::RS::DynamicResolution::DynamicResolution() {
+  _output_width = 0;
+  _output_height = 0;
+  _upscale_shader = NULL;
+  _vao = 0;
+  _uv_scale = -1;
+  _uv_min = -1;
+  _uv_max = -1;
+  _texel_size = -1;
+  _sharpness = -1;
+  for (u_int i = 0; i < RS_DYNAMIC_RESOLUTION_QUERIES; i++) {
+    _queries[i][0] = 0;
+    _queries[i][1] = 0;
+    _pending[i] = false;
+  };
+  _frame = 0;
+  _cooldown = 0;
+  _measured = false;
+  _stats = {};
+};
+
+::RS::DynamicResolution::~DynamicResolution() { release(); };
+
+bool ::RS::DynamicResolution::init(int outputWidth, int outputHeight,
+                                   const DynamicResolutionConfig &config) {
+  release();
+  _config = config;
+  _config.minScale = std::min(std::max(_config.minScale, 0.1f), 1.0f);
+  _config.maxScale = std::min(std::max(_config.maxScale, _config.minScale),
+                              1.0f);
+  if (_config.scaleStep <= 0.0f) {
+    _config.scaleStep = 0.05f;
+  };
+  _output_width = outputWidth;
+  _output_height = outputHeight;
+
+  if (!_target.init(scaledSize(outputWidth, _config.maxScale),
+                    scaledSize(outputHeight, _config.maxScale))) {
+    return false;
+  };
+
+  _upscale_shader = new Shader(REDSTAR_SHADER_DIR "/vert/fullscreen.vert",
+                               REDSTAR_SHADER_DIR "/frag/upscale.frag");
+  _uv_scale = _upscale_shader->getUniform("uvScale");
+  _uv_min = _upscale_shader->getUniform("uvMin");
+  _uv_max = _upscale_shader->getUniform("uvMax");
+  _texel_size = _upscale_shader->getUniform("texelSize");
+  _sharpness = _upscale_shader->getUniform("sharpness");
+  glGenVertexArrays(1, &_vao);
+  glGenQueries(RS_DYNAMIC_RESOLUTION_QUERIES * 2, &_queries[0][0]);
+
+  // Starts at full quality and backs off if that does not fit
+  _stats.scale = _config.maxScale;
+  _stats.renderWidth = scaledSize(outputWidth, _stats.scale);
+  _stats.renderHeight = scaledSize(outputHeight, _stats.scale);
+  return true;
+};
+
+void ::RS::DynamicResolution::beginFrame() {
+  readTimings();
+
+  _target.bind();
+  glViewport(0, 0, _stats.renderWidth, _stats.renderHeight);
+
+  const u_int slot = _frame % RS_DYNAMIC_RESOLUTION_QUERIES;
+  glQueryCounter(_queries[slot][0], GL_TIMESTAMP);
+};
+
+void ::RS::DynamicResolution::endFrame() {
+  const u_int slot = _frame % RS_DYNAMIC_RESOLUTION_QUERIES;
+  glQueryCounter(_queries[slot][1], GL_TIMESTAMP);
+  _pending[slot] = true;
+  _frame++;
+};
+
+void ::RS::DynamicResolution::upscale() {
+  const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+  glDisable(GL_DEPTH_TEST);
+
+  const float width = (float)_target.getWidth();
+  const float height = (float)_target.getHeight();
+  _upscale_shader->use();
+  _upscale_shader->setVec2(_uv_scale,
+                           glm::vec2((float)_stats.renderWidth / width,
+                                     (float)_stats.renderHeight / height));
+  _upscale_shader->setVec2(_uv_min, glm::vec2(0.5f / width, 0.5f / height));
+  _upscale_shader->setVec2(
+      _uv_max, glm::vec2(((float)_stats.renderWidth - 0.5f) / width,
+                         ((float)_stats.renderHeight - 0.5f) / height));
+  _upscale_shader->setVec2(_texel_size, glm::vec2(1.0f / width, 1.0f / height));
+  _upscale_shader->setFloat(_sharpness,
+                            _stats.scale < 1.0f ? _config.sharpness : 0.0f);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, _target.getColorTexture());
+  glBindVertexArray(_vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+
+  if (depthTest) {
+    glEnable(GL_DEPTH_TEST);
+  };
+};
+
+void ::RS::DynamicResolution::readTimings() {
+  // The slot about to be reused, the oldest in flight
+  const u_int slot = _frame % RS_DYNAMIC_RESOLUTION_QUERIES;
+  if (!_pending[slot]) {
+    return;
+  };
+  _pending[slot] = false;
+
+  GLint available = 0;
+  glGetQueryObjectiv(_queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return; // Never wait on the GPU, drop the sample instead
+  }
+
+  GLuint64 start = 0;
+  GLuint64 end = 0;
+  glGetQueryObjectui64v(_queries[slot][0], GL_QUERY_RESULT, &start);
+  glGetQueryObjectui64v(_queries[slot][1], GL_QUERY_RESULT, &end);
+  if (end > start) {
+    updateScale((double)(end - start) / 1e6);
+  };
+};
+
+void ::RS::DynamicResolution::updateScale(double gpuMs) {
+  // Smoothed, a single slow frame should not cost resolution
+  if (!_measured) {
+    _stats.gpuMs = gpuMs;
+    _measured = true;
+  } else {
+    _stats.gpuMs += (gpuMs - _stats.gpuMs) * GPU_TIME_SMOOTHING;
+  };
+
+  if (_cooldown > 0) {
+    _cooldown--;
+    return;
+  };
+
+  const float step = _config.scaleStep;
+  const float current = _stats.scale;
+  const float ideal =
+      current * (float)std::sqrt(_config.targetGpuMs /
+                                 std::max(_stats.gpuMs, 0.001));
+  float next = current;
+  if (_stats.gpuMs > _config.targetGpuMs) {
+    // Over budget is a dropped frame, go all the way down at once
+    next = std::floor(ideal / step + 1e-3f) * step;
+    next = std::min(next, current - step);
+  } else if (ideal >= current + step) {
+    next = current + step;
+  };
+  next = std::min(std::max(next, _config.minScale), _config.maxScale);
+  if (std::fabs(next - current) < 1e-4f) {
+    return;
+  };
+
+  _stats.scale = next;
+  _stats.renderWidth = scaledSize(_output_width, next);
+  _stats.renderHeight = scaledSize(_output_height, next);
+  _stats.scaleChanges++;
+  // What the average should read at the new size, so it does not drag
+  // the old size's times into the next decision
+  _stats.gpuMs *= (double)(next * next) / (double)(current * current);
+  _cooldown = RS_DYNAMIC_RESOLUTION_COOLDOWN;
+};
+
+void ::RS::DynamicResolution::release() {
+  if (_upscale_shader != NULL) {
+    glDeleteProgram(_upscale_shader->ID);
+    delete _upscale_shader;
+    _upscale_shader = NULL;
+  };
+  if (_vao != 0) {
+    glDeleteVertexArrays(1, &_vao);
+    glDeleteQueries(RS_DYNAMIC_RESOLUTION_QUERIES * 2, &_queries[0][0]);
+    _vao = 0;
+  };
+  for (u_int i = 0; i < RS_DYNAMIC_RESOLUTION_QUERIES; i++) {
+    _queries[i][0] = 0;
+    _queries[i][1] = 0;
+    _pending[i] = false;
+  };
+  _frame = 0;
+  _cooldown = 0;
+  _measured = false;
+};
@@ -0,0 +1,112 @@
+#ifndef RS_DYNAMIC_RESOLUTION_H
+#define RS_DYNAMIC_RESOLUTION_H
+
+#include "rs_framebuffer.h"
+#include "rs_gl.h"
+#include "shader.hpp"
+#include <sys/types.h>
+
+namespace RS {
+// Frames of GPU timestamps in flight. A frame's times are read when its
+// slot comes around again, by then the GPU is done with it.
+const u_int RS_DYNAMIC_RESOLUTION_QUERIES = 4;
+// Frames the scale holds after a change, so the next decision sees GPU
+// times measured at the new size
+const u_int RS_DYNAMIC_RESOLUTION_COOLDOWN = 8;
+
+struct DynamicResolutionConfig {
+  bool enabled = false;
+  // Bounds of the render scale per axis, against the output size
+  float minScale = 0.5f;
+  float maxScale = 1.0f;
+  // GPU time per frame the scale is steered towards, in ms
+  double targetGpuMs = 15.0;
+  // The scale moves in multiples of this, so small swings in GPU time do
+  // not resize every frame
+  float scaleStep = 0.05f;
+  // Upscale sharpening, 0 is plain bilinear
+  float sharpness = 0.2f;
+};
+
+struct DynamicResolutionStats {
+  float scale; // Per axis
+  int renderWidth;
+  int renderHeight;
+  double gpuMs; // Smoothed GPU time of the scene
+  u_int64_t scaleChanges;
+};
+
+// Renders the scene into an offscreen target at a fraction of the output
+// size and stretches it over the output afterwards. GPU timestamps around
+// the scene drive the fraction: when the smoothed time is over the budget
+// the scale drops straight to what should fit, when there is room for a
+// whole step it climbs one step at a time. Time goes with the pixel
+// count, so the square root of the budget over the measured time is the
+// factor the scale is off by.
+//
+// The target is allocated once at maxScale and every scale renders into
+// its lower left corner, so changing the scale never reallocates.
+class DynamicResolution {
+public:
+  // Constructor
+  DynamicResolution();
+
+  DynamicResolution(const DynamicResolution &) = delete;
+  DynamicResolution &operator=(const DynamicResolution &) = delete;
+
+  // Deconstructor
+  ~DynamicResolution();
+
+  // Needs a current GL context, calling it again resizes
+  bool init(int outputWidth, int outputHeight,
+            const DynamicResolutionConfig &config);
+
+  // Picks this frame's scale from the GPU times read back, binds the target
+  // with the viewport set to the render size and starts timing
+  void beginFrame();
+  // Stops timing, call it after the scene's draws
+  void endFrame();
+  // Draws the rendered part of the target over the bound framebuffer's
+  // viewport. Leaves depth testing as it found it.
+  void upscale();
+
+  inline int getRenderWidth() const { return _stats.renderWidth; };
+  inline int getRenderHeight() const { return _stats.renderHeight; };
+  inline float getScale() const { return _stats.scale; };
+  inline GLuint getFramebuffer() const { return _target.getFramebuffer(); };
+  // Size of the whole target, the render size is its lower left corner
+  inline int getTargetWidth() const { return _target.getWidth(); };
+  inline int getTargetHeight() const { return _target.getHeight(); };
+  inline const DynamicResolutionStats &getStats() const { return _stats; };
+
+private:
+  void readTimings();
+  void updateScale(double gpuMs);
+  void release();
+
+  DynamicResolutionConfig _config;
+  int _output_width;
+  int _output_height;
+
+  Framebuffer _target;
+  Shader *_upscale_shader;
+  GLuint _vao; // Empty, the fullscreen triangle has no vertex buffer
+  UniformHandle _uv_scale;
+  UniformHandle _uv_min;
+  UniformHandle _uv_max;
+  UniformHandle _texel_size;
+  UniformHandle _sharpness;
+
+  // GL_TIMESTAMP pairs, they do not conflict with GL_TIME_ELAPSED zones of
+  // the profiler the way a frame long elapsed query would
+  GLuint _queries[RS_DYNAMIC_RESOLUTION_QUERIES][2];
+  bool _pending[RS_DYNAMIC_RESOLUTION_QUERIES];
+  u_int _frame;
+  u_int _cooldown;
+  bool _measured;
+
+  DynamicResolutionStats _stats;
+};
+} // namespace RS
+
+#endif // !RS_DYNAMIC_RESOLUTION_H
@@ -0,0 +1,124 @@
+#include "rs_framebuffer.h"
+#include "rs_gl.h"
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <vector>
+
+::RS::Framebuffer::Framebuffer() {
+  _framebuffer = 0;
+  _color = 0;
+  _depth = 0;
+  _width = 0;
+  _height = 0;
+};
+
+::RS::Framebuffer::~Framebuffer() { release(); };
+
+bool ::RS::Framebuffer::init(int width, int height) {
+  release();
+  _width = width;
+  _height = height;
+
+  glGenTextures(1, &_color);
+  glBindTexture(GL_TEXTURE_2D, _color);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenRenderbuffers(1, &_depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, _depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         _color, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, _depth);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "FRAMEBUFFER INCOMPLETE: 0x%x\n",
+                 status);
+    release();
+    return false;
+  };
+  return true;
+};
+
+void ::RS::Framebuffer::bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+  glViewport(0, 0, _width, _height);
+};
+
+void ::RS::Framebuffer::unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); };
+
+void ::RS::Framebuffer::release() {
+  if (_framebuffer != 0) {
+    glDeleteFramebuffers(1, &_framebuffer);
+  };
+  if (_color != 0) {
+    glDeleteTextures(1, &_color);
+  };
+  if (_depth != 0) {
+    glDeleteRenderbuffers(1, &_depth);
+  };
+  _framebuffer = 0;
+  _color = 0;
+  _depth = 0;
+};
+
+void RS::readPixels(int width, int height, std::vector<unsigned char> &rgba) {
+  const size_t rowBytes = (size_t)width * 4;
+  rgba.resize(rowBytes * height);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+  // GL hands rows back bottom up
+  std::vector<unsigned char> row(rowBytes);
+  for (int y = 0; y < height / 2; y++) {
+    unsigned char *top = rgba.data() + y * rowBytes;
+    unsigned char *bottom = rgba.data() + (height - 1 - y) * rowBytes;
+    std::memcpy(row.data(), top, rowBytes);
+    std::memcpy(top, bottom, rowBytes);
+    std::memcpy(bottom, row.data(), rowBytes);
+  };
+};
+
+bool RS::writePNG(const char *path, int width, int height,
+                  const std::vector<unsigned char> &rgba) {
+  SDL_Surface *surface =
+      SDL_CreateSurfaceFrom(width, height, SDL_PIXELFORMAT_RGBA32,
+                            (void *)rgba.data(), width * 4);
+  if (surface == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "CAPTURE SURFACE FAILED: %s\n",
+                 SDL_GetError());
+    return false;
+  };
+  bool saved = IMG_SavePNG(surface, path);
+  SDL_DestroySurface(surface);
+  if (!saved) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "COULD NOT WRITE %s: %s\n", path,
+                 SDL_GetError());
+  };
+  return saved;
+};
+
+bool RS::writeRaw(const char *path, const std::vector<unsigned char> &rgba) {
+  FILE *file = std::fopen(path, "wb");
+  if (file == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "COULD NOT WRITE %s\n", path);
+    return false;
+  };
+  bool written = std::fwrite(rgba.data(), 1, rgba.size(), file) == rgba.size();
+  written = std::fclose(file) == 0 && written;
+  return written;
+};
@@ -0,0 +1,57 @@
+#ifndef RS_FRAMEBUFFER_H
+#define RS_FRAMEBUFFER_H
+
+#include "rs_gl.h"
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+// Offscreen render target: an RGBA8 color texture and a depth/stencil
+// renderbuffer
+class Framebuffer {
+public:
+  // Constructor
+  Framebuffer();
+
+  Framebuffer(const Framebuffer &) = delete;
+  Framebuffer &operator=(const Framebuffer &) = delete;
+
+  // Deconstructor
+  ~Framebuffer();
+
+  // Needs a current GL context, calling it again resizes
+  bool init(int width, int height);
+
+  // Binds it for drawing and sets the viewport to cover it
+  void bind() const;
+  // Back to the default framebuffer
+  static void unbind();
+
+  inline GLuint getFramebuffer() const { return _framebuffer; };
+  inline GLuint getColorTexture() const { return _color; };
+  inline int getWidth() const { return _width; };
+  inline int getHeight() const { return _height; };
+
+private:
+  void release();
+
+  GLuint _framebuffer;
+  GLuint _color;
+  GLuint _depth;
+  int _width;
+  int _height;
+};
+
+// Reads the color buffer of the bound read framebuffer into RGBA8 rows,
+// top row first. Blocks until the GPU has finished the frame, so only use
+// it on the frames you want to keep.
+void readPixels(int width, int height, std::vector<unsigned char> &rgba);
+
+// Write RGBA8 pixels, top row first
+bool writePNG(const char *path, int width, int height,
+              const std::vector<unsigned char> &rgba);
+// Headerless RGBA8, the size belongs in the file name
+bool writeRaw(const char *path, const std::vector<unsigned char> &rgba);
+} // namespace RS
+
+#endif // !RS_FRAMEBUFFER_H
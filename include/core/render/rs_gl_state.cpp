@@ -0,0 +1,85 @@
+#include "rs_gl_state.h"
+#include "rs_gl.h"
+#include <sys/types.h>
+
+void ::RS::GLStateCache::invalidate() {
+  _program = UNKNOWN;
+  _vertex_array = UNKNOWN;
+  for (u_int unit = 0; unit < RS_GL_STATE_TEXTURE_UNITS; unit++) {
+    _textures[unit] = UNKNOWN;
+  };
+  _active_unit = UNKNOWN;
+  _blend = UNKNOWN;
+  _depth_write = UNKNOWN;
+};
+
+void ::RS::GLStateCache::beginFrame() {
+  invalidate();
+  _stats = {};
+};
+
+void ::RS::GLStateCache::useProgram(GLuint program) {
+  if (_program == program) {
+    _stats.programsElided++;
+    return;
+  };
+  glUseProgram(program);
+  _program = program;
+  _stats.programs++;
+};
+
+void ::RS::GLStateCache::bindVertexArray(GLuint vertexArray) {
+  if (_vertex_array == vertexArray) {
+    _stats.vertexArraysElided++;
+    return;
+  };
+  glBindVertexArray(vertexArray);
+  _vertex_array = vertexArray;
+  _stats.vertexArrays++;
+};
+
+void ::RS::GLStateCache::bindTexture(u_int unit, GLuint texture) {
+  if (unit >= RS_GL_STATE_TEXTURE_UNITS) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    _active_unit = UNKNOWN;
+    _stats.textures++;
+    return;
+  };
+  if (_textures[unit] == texture) {
+    _stats.texturesElided++;
+    return;
+  };
+  if (_active_unit != unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    _active_unit = unit;
+  };
+  glBindTexture(GL_TEXTURE_2D, texture);
+  _textures[unit] = texture;
+  _stats.textures++;
+};
+
+void ::RS::GLStateCache::setBlend(bool enabled) {
+  if (_blend == (GLuint)enabled) {
+    _stats.renderStatesElided++;
+    return;
+  };
+  if (enabled) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  } else {
+    glDisable(GL_BLEND);
+  };
+  _blend = enabled;
+  _stats.renderStates++;
+};
+
+void ::RS::GLStateCache::setDepthWrite(bool enabled) {
+  if (_depth_write == (GLuint)enabled) {
+    _stats.renderStatesElided++;
+    return;
+  };
+  glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+  _depth_write = enabled;
+  _stats.renderStates++;
+};
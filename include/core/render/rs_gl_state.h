@@ -0,0 +1,68 @@
+#ifndef RS_GL_STATE_H
+#define RS_GL_STATE_H
+
+#include "rs_gl.h"
+#include <sys/types.h>
+
+namespace RS {
+const u_int RS_GL_STATE_TEXTURE_UNITS = 16;
+
+// Binds asked for this frame and how many of them were already bound
+struct GLStateStats {
+  u_int programs;
+  u_int programsElided;
+  u_int vertexArrays;
+  u_int vertexArraysElided;
+  u_int textures;
+  u_int texturesElided;
+  u_int renderStates; // Blend and depth write toggles
+  u_int renderStatesElided;
+};
+
+// Remembers what is bound and drops calls that would not change anything.
+// Only sees what goes through it, so anyone binding behind its back has to
+// be followed by invalidate().
+class GLStateCache {
+public:
+  // Constructor
+  GLStateCache() {
+    _stats = {};
+    invalidate();
+  };
+
+  // Forgets everything, the next call of each kind always reaches GL
+  void invalidate();
+  // invalidate() and a fresh set of counters
+  void beginFrame();
+
+  void useProgram(GLuint program);
+  void bindVertexArray(GLuint vertexArray);
+  // GL_TEXTURE_2D on the given unit
+  void bindTexture(u_int unit, GLuint texture);
+  // Straight alpha blending on or off
+  void setBlend(bool enabled);
+  void setDepthWrite(bool enabled);
+
+  // The program useProgram() last bound, false after invalidate() until
+  // one goes through the cache again
+  inline bool getProgram(GLuint &program) const {
+    program = _program;
+    return _program != UNKNOWN;
+  };
+  inline const GLStateStats &getStats() const { return _stats; };
+
+private:
+  // Stands for "unknown", no real GL name or state has it
+  static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+  GLuint _program;
+  GLuint _vertex_array;
+  GLuint _textures[RS_GL_STATE_TEXTURE_UNITS];
+  GLuint _active_unit;
+  GLuint _blend;
+  GLuint _depth_write;
+  GLStateStats _stats;
+};
+} // namespace RS
+
+#endif // !RS_GL_STATE_H
@@ -0,0 +1,386 @@
+#include "rs_light_clusters.h"
+#include "rs_culling.h"
+#include "rs_gl.h"
+#include "rs_profiler.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RS_LIGHTS_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+// Tile of a normalized device coordinate along an axis of count tiles
+inline int tileOf(float ndc, u_int count) {
+  return (int)std::floor((ndc + 1.0f) * 0.5f * (float)count);
+};
+
+inline u_int clampTile(int tile, u_int count) {
+  return (u_int)std::min(std::max(tile, 0), (int)count - 1);
+};
+
+#ifdef RS_LIGHTS_X86
+// Sphere against 4 boxes of a row at a time, returns the mask of the ones
+// it touches
+__attribute__((target("sse2"))) inline u_int32_t
+touchesSSE(const float *minX, const float *minY, const float *minZ,
+           const float *maxX, const float *maxY, const float *maxZ,
+           __m128 cx, __m128 cy, __m128 cz, __m128 radius2) {
+  const __m128 zero = _mm_setzero_ps();
+  __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX), cx), zero),
+                         _mm_sub_ps(cx, _mm_loadu_ps(maxX)));
+  __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minY), cy), zero),
+                         _mm_sub_ps(cy, _mm_loadu_ps(maxY)));
+  __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minZ), cz), zero),
+                         _mm_sub_ps(cz, _mm_loadu_ps(maxZ)));
+  __m128 distance2 =
+      _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                 _mm_mul_ps(dz, dz));
+  return (u_int32_t)_mm_movemask_ps(_mm_cmple_ps(distance2, radius2));
+};
+#endif
+} // namespace
+
+::RS::LightClusterBuilder::LightClusterBuilder() {
+  _projection = glm::mat4(1.0f);
+  _bounds_valid = false;
+  _near = 0.1f;
+  _far = 100.0f;
+  _slice_scale = 0.0f;
+  _slice_bias = 0.0f;
+  _stats = {};
+};
+
+void ::RS::LightClusterBuilder::buildClusterBounds(
+    const glm::mat4 &projection) {
+  _projection = projection;
+  _bounds_valid = true;
+
+  // Depth range from the projection, GL clip space
+  const glm::mat4 &p = projection;
+  const bool perspective = p[2][3] != 0.0f;
+  if (perspective) {
+    _near = p[3][2] / (p[2][2] - 1.0f);
+    _far = p[3][2] / (p[2][2] + 1.0f);
+  } else {
+    _near = (p[3][2] + 1.0f) / p[2][2];
+    _far = (p[3][2] - 1.0f) / p[2][2];
+  };
+  // Exponential slices need a near plane in front of the eye
+  _near = std::max(_near, 1e-3f);
+  _far = std::max(_far, _near * 2.0f);
+  const float logRange = std::log(_far / _near);
+  _slice_scale = (float)RS_CLUSTER_Z / logRange;
+  _slice_bias = -(float)RS_CLUSTER_Z * std::log(_near) / logRange;
+
+  _min_x.resize(RS_CLUSTER_COUNT);
+  _min_y.resize(RS_CLUSTER_COUNT);
+  _min_z.resize(RS_CLUSTER_COUNT);
+  _max_x.resize(RS_CLUSTER_COUNT);
+  _max_y.resize(RS_CLUSTER_COUNT);
+  _max_z.resize(RS_CLUSTER_COUNT);
+  for (u_int z = 0; z < RS_CLUSTER_Z; z++) {
+    const float depths[2] = {
+        _near * std::pow(_far / _near, (float)z / RS_CLUSTER_Z),
+        _near * std::pow(_far / _near, (float)(z + 1) / RS_CLUSTER_Z)};
+    for (u_int y = 0; y < RS_CLUSTER_Y; y++) {
+      const float ndcY[2] = {-1.0f + 2.0f * y / RS_CLUSTER_Y,
+                             -1.0f + 2.0f * (y + 1) / RS_CLUSTER_Y};
+      for (u_int x = 0; x < RS_CLUSTER_X; x++) {
+        const float ndcX[2] = {-1.0f + 2.0f * x / RS_CLUSTER_X,
+                               -1.0f + 2.0f * (x + 1) / RS_CLUSTER_X};
+        glm::vec3 low(INFINITY);
+        glm::vec3 high(-INFINITY);
+        // Unproject the tile's corners at both ends of the slice
+        for (int corner = 0; corner < 8; corner++) {
+          const float viewZ = -depths[corner >> 2];
+          const float w = p[2][3] * viewZ + p[3][3];
+          const glm::vec3 point(
+              (ndcX[corner & 1] * w - p[2][0] * viewZ - p[3][0]) / p[0][0],
+              (ndcY[(corner >> 1) & 1] * w - p[2][1] * viewZ - p[3][1]) /
+                  p[1][1],
+              viewZ);
+          low = glm::min(low, point);
+          high = glm::max(high, point);
+        };
+
+        const u_int cluster = (z * RS_CLUSTER_Y + y) * RS_CLUSTER_X + x;
+        _min_x[cluster] = low.x;
+        _min_y[cluster] = low.y;
+        _min_z[cluster] = low.z;
+        _max_x[cluster] = high.x;
+        _max_y[cluster] = high.y;
+        _max_z[cluster] = high.z;
+      };
+    };
+  };
+};
+
+void ::RS::LightClusterBuilder::build(const glm::mat4 &view,
+                                      const glm::mat4 &projection,
+                                      const ClusterLight *lights,
+                                      size_t count, LightClusters &out,
+                                      CullBackend backend) {
+  RS_PROFILE_SCOPE("Light clustering");
+  auto start = std::chrono::high_resolution_clock::now();
+  if (!_bounds_valid || projection != _projection) {
+    buildClusterBounds(projection);
+  };
+  if (backend == CULL_AUTO) {
+    backend = getBestCullBackend();
+  };
+
+  _stats = {};
+  _stats.lights = (u_int)count;
+  count = std::min(count, (size_t)RS_MAX_CLUSTERED_LIGHTS);
+  out.lights.clear();
+  _pair_clusters.clear();
+  _pair_lights.clear();
+
+  const glm::mat4 &p = projection;
+  for (size_t i = 0; i < count; i++) {
+    const float radius = lights[i].positionRadius.w;
+    const glm::vec3 center = glm::vec3(
+        view * glm::vec4(glm::vec3(lights[i].positionRadius), 1.0f));
+    // View space looks down -z
+    const float nearest = -center.z - radius;
+    const float farthest = -center.z + radius;
+    if (radius <= 0.0f || farthest < _near || nearest > _far) {
+      continue;
+    }
+    const u_int z0 = clampTile(
+        (int)std::floor(std::log(std::max(nearest, _near)) * _slice_scale +
+                        _slice_bias),
+        RS_CLUSTER_Z);
+    const u_int z1 = clampTile(
+        (int)std::floor(std::log(std::min(farthest, _far)) * _slice_scale +
+                        _slice_bias),
+        RS_CLUSTER_Z);
+
+    // Screen rectangle of the sphere's box, clipped to the near plane. The
+    // projection is monotonic in x, y and z alone, so the corners bound it.
+    glm::vec2 low(INFINITY);
+    glm::vec2 high(-INFINITY);
+    const float zs[2] = {center.z - radius,
+                         std::min(center.z + radius, -_near)};
+    for (int corner = 0; corner < 8; corner++) {
+      const float x = center.x + (corner & 1 ? radius : -radius);
+      const float y = center.y + (corner & 2 ? radius : -radius);
+      const float z = zs[corner >> 2];
+      const float w = p[2][3] * z + p[3][3];
+      const glm::vec2 ndc((p[0][0] * x + p[2][0] * z + p[3][0]) / w,
+                          (p[1][1] * y + p[2][1] * z + p[3][1]) / w);
+      low = glm::min(low, ndc);
+      high = glm::max(high, ndc);
+    };
+    if (high.x < -1.0f || low.x > 1.0f || high.y < -1.0f || low.y > 1.0f) {
+      continue;
+    }
+    const u_int x0 = clampTile(tileOf(low.x, RS_CLUSTER_X), RS_CLUSTER_X);
+    const u_int x1 = clampTile(tileOf(high.x, RS_CLUSTER_X), RS_CLUSTER_X);
+    const u_int y0 = clampTile(tileOf(low.y, RS_CLUSTER_Y), RS_CLUSTER_Y);
+    const u_int y1 = clampTile(tileOf(high.y, RS_CLUSTER_Y), RS_CLUSTER_Y);
+
+    const u_int32_t index = (u_int32_t)out.lights.size();
+    const size_t before = _pair_clusters.size();
+    for (u_int z = z0; z <= z1; z++) {
+      for (u_int y = y0; y <= y1; y++) {
+        binRow(z * RS_CLUSTER_Y + y, x0, x1, center, radius, index, backend);
+      };
+    };
+    if (_pair_clusters.size() == before) {
+      continue; // The box test was too generous
+    }
+
+    ClusterLight clustered;
+    clustered.positionRadius = glm::vec4(center, radius);
+    clustered.color = lights[i].color;
+    out.lights.push_back(clustered);
+  };
+
+  if (out.lights.empty()) {
+    // An empty grid leaves gridSize 0 and upload() skips the storage
+    // buffers, the shaders only get the ambient term
+    out.grid.clear();
+    out.indices.clear();
+    out.constants.gridSize = glm::uvec4(0);
+    auto end = std::chrono::high_resolution_clock::now();
+    _stats.buildMs =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    return;
+  };
+
+  // Counting sort by cluster. Pairs came in light order, so each cluster's
+  // lights stay ascending.
+  out.grid.assign(RS_CLUSTER_COUNT * 2, 0);
+  for (u_int32_t cluster : _pair_clusters) {
+    out.grid[cluster * 2 + 1]++;
+  };
+  u_int32_t offset = 0;
+  for (u_int cluster = 0; cluster < RS_CLUSTER_COUNT; cluster++) {
+    const u_int32_t lightCount = out.grid[cluster * 2 + 1];
+    out.grid[cluster * 2] = offset;
+    // Whatever runs past the index buffer is dropped
+    const u_int32_t kept =
+        offset >= RS_MAX_CLUSTER_INDICES
+            ? 0
+            : std::min(lightCount, RS_MAX_CLUSTER_INDICES - offset);
+    out.grid[cluster * 2 + 1] = 0;
+    _stats.droppedIndices += lightCount - kept;
+    _stats.maxPerCluster = std::max(_stats.maxPerCluster, kept);
+    offset += kept;
+  };
+  out.indices.resize(offset);
+  for (size_t i = 0; i < _pair_clusters.size(); i++) {
+    const u_int32_t cluster = _pair_clusters[i];
+    const u_int32_t slot = out.grid[cluster * 2] + out.grid[cluster * 2 + 1];
+    const u_int32_t next = cluster + 1 < RS_CLUSTER_COUNT
+                               ? out.grid[(cluster + 1) * 2]
+                               : offset;
+    if (slot < next) {
+      out.indices[slot] = _pair_lights[i];
+      out.grid[cluster * 2 + 1]++;
+    };
+  };
+
+  out.constants.gridSize =
+      glm::uvec4(RS_CLUSTER_X, RS_CLUSTER_Y, RS_CLUSTER_Z, RS_CLUSTER_COUNT);
+  out.constants.depthSlicing =
+      glm::vec4(_slice_scale, _slice_bias, _near, _far);
+
+  _stats.visibleLights = (u_int)out.lights.size();
+  _stats.indices = offset;
+  auto end = std::chrono::high_resolution_clock::now();
+  _stats.buildMs =
+      std::chrono::duration<double, std::milli>(end - start).count();
+};
+
+void ::RS::LightClusterBuilder::binRow(u_int row, u_int x0, u_int x1,
+                                       const glm::vec3 &center, float radius,
+                                       u_int32_t light, CullBackend backend) {
+  const u_int first = row * RS_CLUSTER_X;
+  const float radius2 = radius * radius;
+  u_int x = x0;
+#ifdef RS_LIGHTS_X86
+  // Rows are only RS_CLUSTER_X wide, AVX2 would not fill its lanes
+  if (backend != CULL_SCALAR) {
+    const __m128 cx = _mm_set1_ps(center.x);
+    const __m128 cy = _mm_set1_ps(center.y);
+    const __m128 cz = _mm_set1_ps(center.z);
+    const __m128 r2 = _mm_set1_ps(radius2);
+    for (; x + 3 <= x1; x += 4) {
+      const u_int cluster = first + x;
+      u_int32_t mask = touchesSSE(
+          &_min_x[cluster], &_min_y[cluster], &_min_z[cluster],
+          &_max_x[cluster], &_max_y[cluster], &_max_z[cluster], cx, cy, cz,
+          r2);
+      while (mask != 0) {
+        _pair_clusters.push_back(cluster + (u_int32_t)__builtin_ctz(mask));
+        _pair_lights.push_back(light);
+        mask &= mask - 1;
+      };
+    };
+  };
+#endif
+  for (; x <= x1; x++) {
+    const u_int cluster = first + x;
+    const float dx = std::max(std::max(_min_x[cluster] - center.x, 0.0f),
+                              center.x - _max_x[cluster]);
+    const float dy = std::max(std::max(_min_y[cluster] - center.y, 0.0f),
+                              center.y - _max_y[cluster]);
+    const float dz = std::max(std::max(_min_z[cluster] - center.z, 0.0f),
+                              center.z - _max_z[cluster]);
+    if (dx * dx + dy * dy + dz * dz <= radius2) {
+      _pair_clusters.push_back(cluster);
+      _pair_lights.push_back(light);
+    };
+  };
+};
+
+::RS::LightClusterBuffer::LightClusterBuffer() {
+  _constants = 0;
+  _lights = 0;
+  _grid = 0;
+  _indices = 0;
+};
+
+::RS::LightClusterBuffer::~LightClusterBuffer() {
+  if (_constants != 0) {
+    glDeleteBuffers(1, &_constants);
+  };
+  if (_lights != 0) {
+    glDeleteBuffers(1, &_lights);
+    glDeleteBuffers(1, &_grid);
+    glDeleteBuffers(1, &_indices);
+  };
+};
+
+bool ::RS::LightClusterBuffer::init() {
+  glGenBuffers(1, &_constants);
+  glBindBuffer(GL_UNIFORM_BUFFER, _constants);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(ClusterConstants), NULL,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, CLUSTER_CONSTANTS_BINDING, _constants);
+
+  if (!glVersionAtLeast(4, 3)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "NO STORAGE BUFFERS, CLUSTERED LIGHTS ARE OFF\n");
+    return false;
+  };
+  glGenBuffers(1, &_lights);
+  glGenBuffers(1, &_grid);
+  glGenBuffers(1, &_indices);
+  return true;
+};
+
+void ::RS::LightClusterBuffer::upload(const LightClusters &clusters,
+                                      int width, int height) {
+  if (_constants == 0) {
+    return;
+  };
+
+  ClusterConstants constants = clusters.constants;
+  if (_lights == 0 || clusters.grid.empty()) {
+    // Nothing to loop over, the shaders still get the ambient term
+    constants.gridSize = glm::uvec4(0);
+  };
+  constants.screenSize = glm::vec4((float)width, (float)height,
+                                   1.0f / (float)width, 1.0f / (float)height);
+  glBindBuffer(GL_UNIFORM_BUFFER, _constants);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(constants), &constants);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  if (_lights == 0 || clusters.grid.empty()) {
+    return;
+  };
+
+  // Orphaned every frame, last frame's draws may still read the old ones.
+  // Never empty, binding a zero sized buffer is an error.
+  const GLuint buffers[3] = {_lights, _grid, _indices};
+  const GLuint bindings[3] = {CLUSTER_LIGHTS_BINDING, CLUSTER_GRID_BINDING,
+                              CLUSTER_INDICES_BINDING};
+  const void *data[3] = {clusters.lights.data(), clusters.grid.data(),
+                         clusters.indices.data()};
+  const size_t sizes[3] = {
+      clusters.lights.size() * sizeof(ClusterLight),
+      clusters.grid.size() * sizeof(u_int32_t),
+      clusters.indices.size() * sizeof(u_int32_t)};
+  for (int i = 0; i < 3; i++) {
+    const size_t size = std::max(sizes[i], (size_t)16);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[i]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)size, NULL,
+                 GL_STREAM_DRAW);
+    if (sizes[i] > 0) {
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)sizes[i],
+                      data[i]);
+    };
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindings[i], buffers[i]);
+  };
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+};
@@ -0,0 +1,143 @@
+#ifndef RS_LIGHT_CLUSTERS_H
+#define RS_LIGHT_CLUSTERS_H
+
+#include "rs_culling.h"
+#include "rs_gl.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+// Cluster grid, tiles across the screen and exponential slices in depth,
+// so clusters stay roughly cube shaped from near to far
+const u_int RS_CLUSTER_X = 16;
+const u_int RS_CLUSTER_Y = 9;
+const u_int RS_CLUSTER_Z = 24;
+const u_int RS_CLUSTER_COUNT = RS_CLUSTER_X * RS_CLUSTER_Y * RS_CLUSTER_Z;
+// Lights a frame can cluster, the rest are dropped
+const u_int RS_MAX_CLUSTERED_LIGHTS = 16384;
+// Light indices over every cluster, lights past it miss some clusters
+const u_int RS_MAX_CLUSTER_INDICES = 1 << 20;
+
+// Buffer bindings the LIT shaders read, see frag/forward.frag. Storage
+// bindings 0 to 5 belong to the occlusion cull dispatch.
+const GLuint CLUSTER_CONSTANTS_BINDING = 1; // Uniform buffer
+const GLuint CLUSTER_LIGHTS_BINDING = 6;    // Storage buffers from here
+const GLuint CLUSTER_GRID_BINDING = 7;
+const GLuint CLUSTER_INDICES_BINDING = 8;
+
+// Mirrors the std140 ClusterConstants block, vec4 members only
+struct ClusterConstants {
+  glm::uvec4 gridSize;    // x, y, z, cluster count
+  glm::vec4 screenSize;   // width, height, 1 / width, 1 / height
+  glm::vec4 depthSlicing; // slice = log(depth) * x + y, near, far
+  glm::vec4 ambient;      // rgb
+};
+
+// One point light as the shaders read it, std430
+struct ClusterLight {
+  glm::vec4 positionRadius; // View space position, radius of influence
+  glm::vec4 color;          // rgb premultiplied by intensity
+};
+
+// Everything a frame's LIT draws need, built without touching GL so it can
+// travel in a RenderPacket
+struct LightClusters {
+  ClusterConstants constants;
+  // In view space, only the ones that reach into the view frustum
+  std::vector<ClusterLight> lights;
+  // Per cluster: offset into indices, light count. Empty when no light
+  // reaches into the view, gridSize is 0 then.
+  std::vector<u_int32_t> grid;
+  // Into lights, ascending per cluster
+  std::vector<u_int32_t> indices;
+};
+
+struct LightClusterStats {
+  u_int lights;         // Handed to build()
+  u_int visibleLights;  // Reaching into at least one cluster
+  u_int indices;        // Light references over all clusters
+  u_int maxPerCluster;  // Lights the busiest fragment loops over
+  u_int droppedIndices; // Over RS_MAX_CLUSTER_INDICES
+  double buildMs;
+};
+
+// Bins point lights into the clusters of a view frustum on the CPU. Each
+// light's sphere is projected to a conservative range of tiles and slices
+// and then tested against the view space box of every cluster in that
+// range, a row of clusters at a time with SSE. Cluster boxes only depend on
+// the projection and are rebuilt when it changes.
+class LightClusterBuilder {
+public:
+  // Constructor
+  LightClusterBuilder();
+
+  LightClusterBuilder(const LightClusterBuilder &) = delete;
+  LightClusterBuilder &operator=(const LightClusterBuilder &) = delete;
+
+  // lights are in world space, positionRadius and color as in ClusterLight
+  void build(const glm::mat4 &view, const glm::mat4 &projection,
+             const ClusterLight *lights, size_t count, LightClusters &out,
+             CullBackend backend = CULL_AUTO);
+
+  inline const LightClusterStats &getStats() const { return _stats; };
+
+private:
+  void buildClusterBounds(const glm::mat4 &projection);
+  // Appends the clusters of one row the sphere touches
+  void binRow(u_int row, u_int x0, u_int x1, const glm::vec3 &center,
+              float radius, u_int32_t light, CullBackend backend);
+
+  glm::mat4 _projection;
+  bool _bounds_valid;
+  float _near;
+  float _far;
+  float _slice_scale;
+  float _slice_bias;
+
+  // View space box of every cluster, structure of arrays in grid order
+  // (x fastest) so a row loads straight into SIMD registers
+  std::vector<float> _min_x;
+  std::vector<float> _min_y;
+  std::vector<float> _min_z;
+  std::vector<float> _max_x;
+  std::vector<float> _max_y;
+  std::vector<float> _max_z;
+
+  // (cluster, light) pairs, sorted by cluster into the index list
+  std::vector<u_int32_t> _pair_clusters;
+  std::vector<u_int32_t> _pair_lights;
+  LightClusterStats _stats;
+};
+
+// GPU side of LightClusters: the ClusterConstants uniform buffer and the
+// light, grid and index storage buffers, bound once at the bindings above
+class LightClusterBuffer {
+public:
+  // Constructor
+  LightClusterBuffer();
+
+  LightClusterBuffer(const LightClusterBuffer &) = delete;
+  LightClusterBuffer &operator=(const LightClusterBuffer &) = delete;
+
+  // Deconstructor
+  ~LightClusterBuffer();
+
+  // Needs a current GL context. False without storage buffers, GL 4.3,
+  // LIT shaders then see no lights.
+  bool init();
+
+  // One upload per frame. width and height are what the frame is drawn
+  // at, clusters are found from gl_FragCoord.
+  void upload(const LightClusters &clusters, int width, int height);
+
+private:
+  GLuint _constants;
+  GLuint _lights;
+  GLuint _grid;
+  GLuint _indices;
+};
+} // namespace RS
+
+#endif // !RS_LIGHT_CLUSTERS_H
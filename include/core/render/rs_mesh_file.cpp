@@ -0,0 +1,256 @@
+#include "rs_mesh_file.h"
+#include "rs_gl.h"
+#include "rs_mesh_format.h"
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace {
+// True if count elements of size bytes at offset lie inside the file and
+// start on a RS_MESH_ALIGNMENT boundary. The offsets come straight from
+// the file, so this must not overflow for any of them.
+bool rangeInFile(u_int64_t offset, u_int64_t count, size_t size,
+                 size_t fileSize) {
+  return offset % RS::RS_MESH_ALIGNMENT == 0 && offset <= fileSize &&
+         count <= (fileSize - offset) / size;
+};
+
+// True if every index of the range is below limit. Branch free so it
+// vectorizes, and it only reads what the upload is about to read anyway.
+template <typename Index>
+bool indicesBelow(const Index *indices, u_int count, u_int64_t limit) {
+  Index largest = 0;
+  for (u_int i = 0; i < count; i++) {
+    largest = indices[i] > largest ? indices[i] : largest;
+  };
+  return count == 0 || (u_int64_t)largest < limit;
+};
+
+bool indicesBelow(const void *indices, size_t indexSize, u_int first,
+                  u_int count, u_int64_t limit) {
+  if (indexSize == 4) {
+    return indicesBelow((const u_int32_t *)indices + first, count, limit);
+  };
+  return indicesBelow((const u_int16_t *)indices + first, count, limit);
+};
+} // namespace
+
+::RS::MeshFile::MeshFile() {
+  _data = NULL;
+  _size = 0;
+  _header = NULL;
+};
+
+::RS::MeshFile::~MeshFile() { close(); };
+
+bool ::RS::MeshFile::open(const char *path) {
+  close();
+
+  int file = ::open(path, O_RDONLY);
+  if (file < 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "MESH FILE COULD NOT BE OPENED: %s\n",
+                 path);
+    return false;
+  };
+
+  struct stat info;
+  if (fstat(file, &info) != 0 || (size_t)info.st_size < sizeof(MeshFileHeader)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "MESH FILE TOO SMALL: %s\n", path);
+    ::close(file);
+    return false;
+  };
+
+  // The mapping keeps the file alive, the descriptor is not needed anymore
+  void *mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if (mapped == MAP_FAILED) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "MESH FILE COULD NOT BE MAPPED: %s\n",
+                 path);
+    return false;
+  };
+  // Everything is read front to back exactly once by the upload
+  madvise(mapped, (size_t)info.st_size, MADV_SEQUENTIAL);
+  madvise(mapped, (size_t)info.st_size, MADV_WILLNEED);
+
+  _data = (const unsigned char *)mapped;
+  _size = (size_t)info.st_size;
+  const MeshFileHeader *header = (const MeshFileHeader *)_data;
+
+  // Validate every range before anyone dereferences into the mapping
+  const size_t indexSize = (header->flags & RS_MESH_INDEX_32) != 0 ? 4 : 2;
+  bool valid = header->magic == RS_MESH_MAGIC &&
+               header->version == RS_MESH_VERSION &&
+               header->vertexStride == sizeof(Vertex) &&
+               header->fileSize == _size &&
+               rangeInFile(header->vertexOffset, header->vertexCount,
+                           sizeof(Vertex), _size) &&
+               rangeInFile(header->indexOffset, header->indexCount, indexSize,
+                           _size) &&
+               rangeInFile(header->submeshOffset, header->submeshCount,
+                           sizeof(MeshFileSubmesh), _size) &&
+               rangeInFile(header->lodOffset, header->lodCount,
+                           sizeof(MeshFileLod), _size);
+  // The index ranges are only read by GL, out of range ones would read
+  // past the buffer there. Nothing is formed from the offsets until they
+  // are known to be inside the mapping.
+  const MeshFileSubmesh *submeshes =
+      valid ? (const MeshFileSubmesh *)(_data + header->submeshOffset) : NULL;
+  const MeshFileLod *lods =
+      valid ? (const MeshFileLod *)(_data + header->lodOffset) : NULL;
+  for (u_int i = 0; valid && i < header->submeshCount; i++) {
+    valid = (u_int64_t)submeshes[i].firstIndex + submeshes[i].indexCount <=
+                header->indexCount &&
+            (u_int64_t)submeshes[i].firstLod + submeshes[i].lodCount <=
+                header->lodCount;
+  };
+  for (u_int i = 0; valid && i < header->lodCount; i++) {
+    valid = (u_int64_t)lods[i].firstIndex + lods[i].indexCount <=
+            header->indexCount;
+  };
+  // So are the index values, every vertex a range draws has to exist
+  const void *indices = valid ? _data + header->indexOffset : NULL;
+  for (u_int i = 0; valid && i < header->submeshCount; i++) {
+    const MeshFileSubmesh &submesh = submeshes[i];
+    valid = submesh.baseVertex >= 0 &&
+            (u_int64_t)submesh.baseVertex <= header->vertexCount &&
+            indicesBelow(indices, indexSize, submesh.firstIndex,
+                         submesh.indexCount,
+                         header->vertexCount - (u_int64_t)submesh.baseVertex);
+    for (u_int level = 0; valid && level < submesh.lodCount; level++) {
+      const MeshFileLod &lod = lods[submesh.firstLod + level];
+      valid = indicesBelow(indices, indexSize, lod.firstIndex, lod.indexCount,
+                           header->vertexCount -
+                               (u_int64_t)submesh.baseVertex);
+    };
+  };
+  if (!valid) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "MESH FILE IS CORRUPT OR FROM ANOTHER VERSION: %s\n", path);
+    close();
+    return false;
+  };
+
+  _header = header;
+  return true;
+};
+
+void ::RS::MeshFile::close() {
+  if (_data != NULL) {
+    munmap((void *)_data, _size);
+  };
+  _data = NULL;
+  _size = 0;
+  _header = NULL;
+};
+
+void ::RS::MeshFile::upload(GLuint vertexBuffer, GLuint indexBuffer,
+                            GLenum usage) const {
+  // The driver copies straight out of the page cache
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER,
+               (GLsizeiptr)_header->vertexCount * sizeof(Vertex), getVertices(),
+               usage);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               (GLsizeiptr)(_header->indexCount * getIndexSize()),
+               getIndices(), usage);
+};
+
+bool ::RS::MeshFile::write(const char *path, const Vertex *vertices,
+                           u_int vertexCount, const u_int32_t *indices,
+                           u_int indexCount, const MeshFileSubmesh *submeshes,
+                           u_int submeshCount, const MeshFileLod *lods,
+                           u_int lodCount) {
+  // Always 32 bit, it is what the BatchRenderer's shared index buffer
+  // holds, so the indices go to GL without being widened on every load
+  const size_t indexSize = 4;
+
+  MeshFileHeader header = {};
+  header.magic = RS_MESH_MAGIC;
+  header.version = RS_MESH_VERSION;
+  header.flags = RS_MESH_INDEX_32;
+  header.vertexStride = sizeof(Vertex);
+  header.vertexCount = vertexCount;
+  header.indexCount = indexCount;
+  header.submeshCount = submeshCount;
+  header.lodCount = lodCount;
+  header.vertexOffset = meshAlign(sizeof(MeshFileHeader));
+  header.indexOffset =
+      meshAlign(header.vertexOffset + (u_int64_t)vertexCount * sizeof(Vertex));
+  header.submeshOffset =
+      meshAlign(header.indexOffset + (u_int64_t)indexCount * indexSize);
+  header.lodOffset = meshAlign(header.submeshOffset +
+                               (u_int64_t)submeshCount *
+                                   sizeof(MeshFileSubmesh));
+  header.fileSize =
+      header.lodOffset + (u_int64_t)lodCount * sizeof(MeshFileLod);
+
+  for (int axis = 0; axis < 3; axis++) {
+    header.bounds.min[axis] = vertexCount > 0 ? vertices[0].position[axis] : 0;
+    header.bounds.max[axis] = header.bounds.min[axis];
+  };
+  for (u_int i = 0; i < vertexCount; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      float value = vertices[i].position[axis];
+      if (value < header.bounds.min[axis]) {
+        header.bounds.min[axis] = value;
+      }
+      if (value > header.bounds.max[axis]) {
+        header.bounds.max[axis] = value;
+      }
+    }
+  };
+
+  FILE *file = std::fopen(path, "wb");
+  if (file == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "MESH FILE COULD NOT BE WRITTEN: %s\n",
+                 path);
+    return false;
+  };
+
+  const char padding[RS_MESH_ALIGNMENT] = {};
+  bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  u_int64_t position = sizeof(header);
+  auto pad = [&](u_int64_t target) {
+    if (target > position) {
+      written = written &&
+                std::fwrite(padding, 1, target - position, file) ==
+                    target - position;
+    }
+    position = target;
+  };
+
+  pad(header.vertexOffset);
+  written = written && std::fwrite(vertices, sizeof(Vertex), vertexCount,
+                                   file) == vertexCount;
+  position += (u_int64_t)vertexCount * sizeof(Vertex);
+
+  pad(header.indexOffset);
+  written = written &&
+            std::fwrite(indices, indexSize, indexCount, file) == indexCount;
+  position += (u_int64_t)indexCount * indexSize;
+
+  pad(header.submeshOffset);
+  written = written && std::fwrite(submeshes, sizeof(MeshFileSubmesh),
+                                   submeshCount, file) == submeshCount;
+  position += (u_int64_t)submeshCount * sizeof(MeshFileSubmesh);
+
+  pad(header.lodOffset);
+  written = written && (lodCount == 0 ||
+                        std::fwrite(lods, sizeof(MeshFileLod), lodCount,
+                                    file) == lodCount);
+
+  written = std::fclose(file) == 0 && written;
+  if (!written) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "MESH FILE COULD NOT BE WRITTEN: %s\n",
+                 path);
+    std::remove(path);
+  };
+  return written;
+};
@@ -0,0 +1,79 @@
+#ifndef RS_MESH_FILE_H
+#define RS_MESH_FILE_H
+
+#include "rs_gl.h"
+#include "rs_mesh_format.h"
+#include <cstddef>
+#include <sys/types.h>
+
+namespace RS {
+// Read only view of a .rsmesh file. The file is mmap'd and the vertex and
+// index streams are handed to GL straight from the mapping without being
+// copied. open() makes one validation pass over the index data, so every
+// index a range draws is known to name an existing vertex, the rest is
+// never parsed on the CPU.
+class MeshFile {
+public:
+  // Constructor
+  MeshFile();
+
+  MeshFile(const MeshFile &) = delete;
+  MeshFile &operator=(const MeshFile &) = delete;
+
+  // Deconstructor
+  ~MeshFile();
+
+  // Maps and validates the file
+  bool open(const char *path);
+  void close();
+
+  inline bool isOpen() const { return _header != NULL; };
+  inline const MeshFileHeader &getHeader() const { return *_header; };
+  inline u_int getVertexCount() const { return _header->vertexCount; };
+  inline u_int getIndexCount() const { return _header->indexCount; };
+  inline u_int getSubmeshCount() const { return _header->submeshCount; };
+  inline u_int getLodCount() const { return _header->lodCount; };
+  inline const MeshBounds &getBounds() const { return _header->bounds; };
+  inline size_t getFileSize() const { return _size; };
+
+  inline bool hasIndices32() const {
+    return (_header->flags & RS_MESH_INDEX_32) != 0;
+  };
+  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  inline GLenum getIndexType() const {
+    return hasIndices32() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+  };
+  inline size_t getIndexSize() const { return hasIndices32() ? 4 : 2; };
+
+  inline const Vertex *getVertices() const {
+    return (const Vertex *)(_data + _header->vertexOffset);
+  };
+  inline const void *getIndices() const {
+    return _data + _header->indexOffset;
+  };
+  inline const MeshFileSubmesh *getSubmeshes() const {
+    return (const MeshFileSubmesh *)(_data + _header->submeshOffset);
+  };
+  inline const MeshFileLod *getLods() const {
+    return (const MeshFileLod *)(_data + _header->lodOffset);
+  };
+
+  // Uploads both streams into the given buffers with glBufferData
+  void upload(GLuint vertexBuffer, GLuint indexBuffer,
+              GLenum usage = GL_STATIC_DRAW) const;
+
+  // Writes a .rsmesh file with 32 bit indices, used by rs_mesh_convert
+  static bool write(const char *path, const Vertex *vertices,
+                    u_int vertexCount, const u_int32_t *indices,
+                    u_int indexCount, const MeshFileSubmesh *submeshes,
+                    u_int submeshCount, const MeshFileLod *lods = NULL,
+                    u_int lodCount = 0);
+
+private:
+  const unsigned char *_data;
+  size_t _size;
+  const MeshFileHeader *_header;
+};
+} // namespace RS
+
+#endif // !RS_MESH_FILE_H
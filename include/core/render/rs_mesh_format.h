@@ -0,0 +1,92 @@
+#ifndef RS_MESH_FORMAT_H
+#define RS_MESH_FORMAT_H
+
+#include <glm/glm.hpp>
+#include <sys/types.h>
+
+// On disk layout of .rsmesh files, shared by the runtime loader and the
+// rs_mesh_convert tool. Everything is little endian and every section
+// starts on a RS_MESH_ALIGNMENT boundary so the mapped pointers can go to
+// GL as they are.
+//
+//   MeshFileHeader
+//   Vertex[vertexCount]           interleaved, see Vertex
+//   u_int16_t/u_int32_t[indexCount]
+//   MeshFileSubmesh[submeshCount]
+//   MeshFileLod[lodCount]
+//
+// LOD index ranges live in the same index stream as the full detail ones,
+// so every level of a submesh draws from the same buffers.
+
+namespace RS {
+// Matches the attribute layout of main.vert and instanced.vert
+struct Vertex {
+  glm::vec3 position; // location 0
+  glm::vec2 texCoord; // location 1
+};
+
+const u_int32_t RS_MESH_MAGIC = 0x48534D52u; // "RMSH"
+// Bump on any layout change, old files are rejected and need reconverting
+const u_int32_t RS_MESH_VERSION = 3;
+const u_int32_t RS_MESH_ALIGNMENT = 16;
+
+// MeshFileHeader::flags
+const u_int32_t RS_MESH_INDEX_32 = 1u << 0; // Otherwise 16 bit indices
+
+struct MeshBounds {
+  float min[3];
+  float max[3];
+};
+
+struct MeshFileHeader {
+  u_int32_t magic;
+  u_int32_t version;
+  u_int32_t flags;
+  u_int32_t vertexStride; // sizeof(Vertex) when written
+  u_int32_t vertexCount;
+  u_int32_t indexCount;
+  u_int32_t submeshCount;
+  u_int32_t lodCount;
+  u_int64_t vertexOffset;
+  u_int64_t indexOffset;
+  u_int64_t submeshOffset;
+  u_int64_t lodOffset;
+  u_int64_t fileSize;
+  MeshBounds bounds;
+};
+
+// A range of the index stream drawn with one material
+struct MeshFileSubmesh {
+  u_int32_t firstIndex;
+  u_int32_t indexCount;
+  int32_t baseVertex;
+  u_int32_t material;
+  MeshBounds bounds;
+  // Coarser versions of this range, finest first, in the LOD table
+  u_int32_t firstLod;
+  u_int32_t lodCount;
+  // Vertex shader runs of the range, see analyzeVertexCache. Worked out at
+  // import so loading never scans the indices.
+  u_int32_t vertexInvocations;
+  u_int32_t reserved;
+};
+
+// A simplified index range of a submesh, same baseVertex
+struct MeshFileLod {
+  u_int32_t firstIndex;
+  u_int32_t indexCount;
+  float error; // Largest deviation from the full mesh, object space units
+  u_int32_t vertexInvocations;
+};
+
+static_assert(sizeof(Vertex) == 20, "Vertex must stay tightly packed");
+static_assert(sizeof(MeshFileHeader) == 96, "MeshFileHeader layout changed");
+static_assert(sizeof(MeshFileSubmesh) == 56, "MeshFileSubmesh layout changed");
+static_assert(sizeof(MeshFileLod) == 16, "MeshFileLod layout changed");
+
+inline u_int64_t meshAlign(u_int64_t offset) {
+  return (offset + RS_MESH_ALIGNMENT - 1) & ~(u_int64_t)(RS_MESH_ALIGNMENT - 1);
+};
+} // namespace RS
+
+#endif // !RS_MESH_FORMAT_H
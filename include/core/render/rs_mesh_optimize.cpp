@@ -0,0 +1,600 @@
+#include "rs_mesh_optimize.h"
+#include "rs_mesh_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+// Forsyth's scoring, tuned for a 32 entry LRU
+const int FORSYTH_CACHE_SIZE = 32;
+const float FORSYTH_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+const float FORSYTH_VALENCE_SCALE = 2.0f;
+const float FORSYTH_VALENCE_POWER = -0.5f;
+
+float vertexScore(int cachePosition, u_int liveTriangles) {
+  if (liveTriangles == 0) {
+    return -1.0f;
+  };
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // Used by the last triangle, no gain from picking it right away
+      score = FORSYTH_LAST_TRIANGLE_SCORE;
+    } else {
+      const float scale = 1.0f / (float)(FORSYTH_CACHE_SIZE - 3);
+      score = std::pow(1.0f - (float)(cachePosition - 3) * scale,
+                       FORSYTH_DECAY_POWER);
+    };
+  };
+  // Vertices with few triangles left are finished off first
+  return score + FORSYTH_VALENCE_SCALE *
+                     std::pow((float)liveTriangles, FORSYTH_VALENCE_POWER);
+};
+
+// Symmetric 4x4 plane quadric, error(p) = p'Ap + 2b'p + c
+struct Quadric {
+  double a00, a01, a02, a11, a12, a22;
+  double b0, b1, b2;
+  double c;
+
+  void addPlane(const glm::vec3 &normal, double distance) {
+    a00 += normal.x * normal.x;
+    a01 += normal.x * normal.y;
+    a02 += normal.x * normal.z;
+    a11 += normal.y * normal.y;
+    a12 += normal.y * normal.z;
+    a22 += normal.z * normal.z;
+    b0 += normal.x * distance;
+    b1 += normal.y * distance;
+    b2 += normal.z * distance;
+    c += distance * distance;
+  };
+
+  void add(const Quadric &other) {
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+  };
+
+  double error(const glm::vec3 &point) const {
+    const double x = point.x;
+    const double y = point.y;
+    const double z = point.z;
+    double result = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z +
+                    a11 * y * y + 2.0 * a12 * y * z + a22 * z * z +
+                    2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    return result > 0.0 ? result : 0.0;
+  };
+};
+
+struct Collapse {
+  u_int32_t from;
+  u_int32_t to;
+  double cost;
+};
+
+inline u_int64_t edgeKey(u_int32_t a, u_int32_t b) {
+  return a < b ? ((u_int64_t)a << 32) | b : ((u_int64_t)b << 32) | a;
+};
+
+glm::vec3 triangleNormal(const glm::vec3 &a, const glm::vec3 &b,
+                         const glm::vec3 &c) {
+  return glm::cross(b - a, c - a);
+};
+} // namespace
+
+::RS::VertexCacheStats RS::analyzeVertexCache(const u_int32_t *indices,
+                                              size_t indexCount,
+                                              size_t vertexCount,
+                                              u_int cacheSize) {
+  VertexCacheStats stats = {};
+  if (indexCount < 3) {
+    return stats;
+  };
+
+  // A vertex is still cached while fewer than cacheSize misses happened
+  // since it was loaded
+  std::vector<u_int32_t> loadedAt(vertexCount, 0);
+  std::vector<bool> referenced(vertexCount, false);
+  u_int32_t time = cacheSize + 1;
+  size_t unique = 0;
+  for (size_t i = 0; i < indexCount; i++) {
+    const u_int32_t vertex = indices[i];
+    if (vertex >= vertexCount) {
+      continue; // Not a vertex, nothing is loaded for it
+    };
+    if (time - loadedAt[vertex] > cacheSize) {
+      loadedAt[vertex] = time++;
+      stats.invocations++;
+    };
+    if (!referenced[vertex]) {
+      referenced[vertex] = true;
+      unique++;
+    };
+  };
+
+  stats.acmr = (float)stats.invocations / (float)(indexCount / 3);
+  stats.atvr = unique > 0 ? (float)stats.invocations / (float)unique : 0.0f;
+  return stats;
+};
+
+void ::RS::optimizeVertexCache(u_int32_t *indices, size_t indexCount,
+                               size_t vertexCount) {
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return;
+  };
+
+  // Triangles of every vertex, the live ones first
+  std::vector<u_int> live(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++) {
+    live[indices[i]]++;
+  };
+  std::vector<u_int> offsets(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++) {
+    offsets[v + 1] = offsets[v] + live[v];
+  };
+  std::vector<u_int32_t> adjacency(triangleCount * 3);
+  {
+    std::vector<u_int> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+      adjacency[cursor[indices[i]]++] = (u_int32_t)(i / 3);
+    };
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> scores(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) {
+    scores[v] = vertexScore(-1, live[v]);
+  };
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  int best = 0;
+  for (size_t t = 0; t < triangleCount; t++) {
+    triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] +
+                        scores[indices[t * 3 + 2]];
+    if (triangleScores[t] > triangleScores[best]) {
+      best = (int)t;
+    };
+  };
+
+  std::vector<u_int32_t> result(triangleCount * 3);
+  int cache[FORSYTH_CACHE_SIZE + 3];
+  int cacheSize = 0;
+  size_t scan = 0;
+  for (size_t out = 0; out < triangleCount; out++) {
+    if (best < 0) {
+      // Nothing around the cache is left, continue somewhere new
+      while (emitted[scan]) {
+        scan++;
+      };
+      best = (int)scan;
+    };
+
+    const u_int32_t *triangle = indices + best * 3;
+    std::memcpy(&result[out * 3], triangle, 3 * sizeof(u_int32_t));
+    emitted[best] = true;
+
+    for (int corner = 0; corner < 3; corner++) {
+      // Swap the triangle out of the live part of the vertex's list
+      const u_int32_t vertex = triangle[corner];
+      u_int32_t *begin = &adjacency[offsets[vertex]];
+      u_int32_t *end = begin + live[vertex];
+      u_int32_t *found = std::find(begin, end, (u_int32_t)best);
+      if (found != end) {
+        std::swap(*found, *(end - 1));
+        live[vertex]--;
+      };
+    };
+
+    // LRU, the new triangle's vertices go to the front
+    int updated[FORSYTH_CACHE_SIZE + 3];
+    int count = 0;
+    for (int corner = 0; corner < 3; corner++) {
+      updated[count++] = (int)triangle[corner];
+    };
+    for (int i = 0; i < cacheSize; i++) {
+      const int vertex = cache[i];
+      if (vertex != updated[0] && vertex != updated[1] &&
+          vertex != updated[2]) {
+        updated[count++] = vertex;
+      };
+    };
+
+    best = -1;
+    float bestScore = -1.0f;
+    for (int i = 0; i < count; i++) {
+      const int vertex = updated[i];
+      cachePosition[vertex] = i < FORSYTH_CACHE_SIZE ? i : -1;
+      scores[vertex] = vertexScore(cachePosition[vertex], live[vertex]);
+    };
+    for (int i = 0; i < count; i++) {
+      const int vertex = updated[i];
+      for (u_int j = 0; j < live[vertex]; j++) {
+        const u_int32_t t = adjacency[offsets[vertex] + j];
+        triangleScores[t] = scores[indices[t * 3]] +
+                            scores[indices[t * 3 + 1]] +
+                            scores[indices[t * 3 + 2]];
+        if (triangleScores[t] > bestScore) {
+          bestScore = triangleScores[t];
+          best = (int)t;
+        };
+      };
+    };
+
+    cacheSize = count < FORSYTH_CACHE_SIZE ? count : FORSYTH_CACHE_SIZE;
+    std::memcpy(cache, updated, cacheSize * sizeof(int));
+  };
+
+  std::memcpy(indices, result.data(), result.size() * sizeof(u_int32_t));
+};
+
+void ::RS::optimizeOverdraw(u_int32_t *indices, size_t indexCount,
+                            const Vertex *vertices, size_t vertexCount,
+                            float threshold) {
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount == 0) {
+    return;
+  };
+
+  // Hard boundaries where all three vertices miss, the cache starts over
+  // there anyway so splitting costs nothing
+  std::vector<u_int32_t> loadedAt(vertexCount, 0);
+  u_int32_t time = RS_VERTEX_CACHE_SIZE + 1;
+  auto miss = [&](u_int32_t vertex) {
+    if (time - loadedAt[vertex] > RS_VERTEX_CACHE_SIZE) {
+      loadedAt[vertex] = time++;
+      return 1u;
+    };
+    return 0u;
+  };
+  std::vector<size_t> hard;
+  std::vector<u_int> misses(triangleCount);
+  for (size_t t = 0; t < triangleCount; t++) {
+    misses[t] = miss(indices[t * 3]) + miss(indices[t * 3 + 1]) +
+                miss(indices[t * 3 + 2]);
+    if (misses[t] == 3) {
+      hard.push_back(t);
+    };
+  };
+  if (hard.empty() || hard[0] != 0) {
+    hard.insert(hard.begin(), 0);
+  };
+  hard.push_back(triangleCount);
+
+  // Soft boundaries inside, wherever the cluster so far stays within the
+  // allowed ACMR. Every cluster may end up after any other once sorted, so
+  // each one is simulated from a cold cache.
+  std::vector<size_t> clusters;
+  for (size_t h = 0; h + 1 < hard.size(); h++) {
+    const size_t begin = hard[h];
+    const size_t end = hard[h + 1];
+    u_int total = 0;
+    for (size_t t = begin; t < end; t++) {
+      total += misses[t];
+    };
+    const float limit = (float)total / (float)(end - begin) * threshold;
+
+    clusters.push_back(begin);
+    time += RS_VERTEX_CACHE_SIZE + 1;
+    size_t start = begin;
+    u_int running = 0;
+    for (size_t t = begin; t < end; t++) {
+      running += miss(indices[t * 3]) + miss(indices[t * 3 + 1]) +
+                 miss(indices[t * 3 + 2]);
+      if (t + 1 < end && (float)running <= limit * (float)(t + 1 - start)) {
+        clusters.push_back(t + 1);
+        time += RS_VERTEX_CACHE_SIZE + 1;
+        start = t + 1;
+        running = 0;
+      };
+    };
+  };
+  clusters.push_back(triangleCount);
+
+  glm::vec3 meshCenter(0.0f);
+  float meshArea = 0.0f;
+  for (size_t t = 0; t < triangleCount; t++) {
+    const glm::vec3 &a = vertices[indices[t * 3]].position;
+    const glm::vec3 &b = vertices[indices[t * 3 + 1]].position;
+    const glm::vec3 &c = vertices[indices[t * 3 + 2]].position;
+    const float area = glm::length(triangleNormal(a, b, c));
+    meshCenter += (a + b + c) * (area / 3.0f);
+    meshArea += area;
+  };
+  meshCenter = meshArea > 0.0f ? meshCenter / meshArea : meshCenter;
+
+  // Clusters whose surface faces away from the center draw first
+  struct Cluster {
+    size_t begin;
+    size_t end;
+    float outwards;
+  };
+  std::vector<Cluster> order(clusters.size() - 1);
+  for (size_t i = 0; i + 1 < clusters.size(); i++) {
+    glm::vec3 center(0.0f);
+    glm::vec3 normal(0.0f);
+    float area = 0.0f;
+    for (size_t t = clusters[i]; t < clusters[i + 1]; t++) {
+      const glm::vec3 &a = vertices[indices[t * 3]].position;
+      const glm::vec3 &b = vertices[indices[t * 3 + 1]].position;
+      const glm::vec3 &c = vertices[indices[t * 3 + 2]].position;
+      const glm::vec3 weighted = triangleNormal(a, b, c);
+      const float triangleArea = glm::length(weighted);
+      center += (a + b + c) * (triangleArea / 3.0f);
+      normal += weighted;
+      area += triangleArea;
+    };
+    const float length = glm::length(normal);
+    center = area > 0.0f ? center / area : center;
+    normal = length > 0.0f ? normal / length : normal;
+
+    order[i].begin = clusters[i];
+    order[i].end = clusters[i + 1];
+    order[i].outwards = glm::dot(center - meshCenter, normal);
+  };
+  std::stable_sort(order.begin(), order.end(),
+                   [](const Cluster &a, const Cluster &b) {
+                     return a.outwards > b.outwards;
+                   });
+
+  std::vector<u_int32_t> result;
+  result.reserve(triangleCount * 3);
+  for (const Cluster &cluster : order) {
+    result.insert(result.end(), indices + cluster.begin * 3,
+                  indices + cluster.end * 3);
+  };
+  std::memcpy(indices, result.data(), result.size() * sizeof(u_int32_t));
+};
+
+size_t RS::optimizeVertexFetch(Vertex *vertices, u_int32_t *indices,
+                               size_t indexCount, size_t vertexCount) {
+  const u_int32_t UNUSED = 0xFFFFFFFFu;
+  std::vector<u_int32_t> remap(vertexCount, UNUSED);
+  std::vector<Vertex> reordered;
+  reordered.reserve(vertexCount);
+  for (size_t i = 0; i < indexCount; i++) {
+    const u_int32_t vertex = indices[i];
+    if (remap[vertex] == UNUSED) {
+      remap[vertex] = (u_int32_t)reordered.size();
+      reordered.push_back(vertices[vertex]);
+    };
+    indices[i] = remap[vertex];
+  };
+
+  std::copy(reordered.begin(), reordered.end(), vertices);
+  return reordered.size();
+};
+
+size_t RS::simplifyMesh(u_int32_t *out, const u_int32_t *indices,
+                        size_t indexCount, const Vertex *vertices,
+                        size_t vertexCount, size_t targetIndexCount,
+                        float targetError, float *error) {
+  std::copy(indices, indices + indexCount, out);
+  size_t count = indexCount - indexCount % 3;
+  double maxCost = 0.0;
+
+  // Vertices at the same position are one for the topology. Where they
+  // differ in texture coordinates there is a seam, which stays put.
+  std::vector<u_int32_t> canonical(vertexCount);
+  std::vector<bool> locked(vertexCount, false);
+  {
+    struct PositionHash {
+      size_t operator()(const glm::vec3 &p) const {
+        // -0 and 0 compare equal, adding 0 makes them hash equal too
+        const float components[3] = {p.x + 0.0f, p.y + 0.0f, p.z + 0.0f};
+        u_int32_t bits[3];
+        std::memcpy(bits, components, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^
+               (bits[2] * 83492791u);
+      };
+    };
+    std::unordered_map<glm::vec3, u_int32_t, PositionHash> first;
+    first.reserve(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+      auto inserted =
+          first.insert(std::make_pair(vertices[v].position, (u_int32_t)v));
+      canonical[v] = inserted.first->second;
+      if (!inserted.second) {
+        locked[v] = true;
+        locked[canonical[v]] = true;
+      };
+    };
+  }
+
+  // Edges with a single triangle are borders
+  {
+    std::unordered_map<u_int64_t, u_int> edges;
+    edges.reserve(count);
+    for (size_t i = 0; i < count; i += 3) {
+      for (int e = 0; e < 3; e++) {
+        edges[edgeKey(canonical[out[i + e]],
+                      canonical[out[i + (e + 1) % 3]])]++;
+      };
+    };
+    for (const auto &edge : edges) {
+      if (edge.second == 1) {
+        locked[(u_int32_t)(edge.first >> 32)] = true;
+        locked[(u_int32_t)edge.first] = true;
+      };
+    };
+  }
+
+  std::vector<Quadric> quadrics(vertexCount, Quadric());
+  for (size_t i = 0; i < count; i += 3) {
+    const glm::vec3 &a = vertices[out[i]].position;
+    const glm::vec3 &b = vertices[out[i + 1]].position;
+    const glm::vec3 &c = vertices[out[i + 2]].position;
+    glm::vec3 normal = triangleNormal(a, b, c);
+    const float length = glm::length(normal);
+    if (length <= 0.0f) {
+      continue;
+    };
+    normal /= length;
+    const double distance = -glm::dot(normal, a);
+    for (int corner = 0; corner < 3; corner++) {
+      quadrics[canonical[out[i + corner]]].addPlane(normal, distance);
+    };
+  };
+
+  const double costLimit = (double)targetError * (double)targetError;
+  std::vector<Collapse> collapses;
+  std::vector<u_int64_t> keys;
+  std::vector<u_int> offsets(vertexCount + 1);
+  std::vector<u_int32_t> adjacency;
+  std::vector<u_int32_t> remap(vertexCount);
+  std::vector<bool> touched(vertexCount);
+
+  // Passes of independent collapses, cheapest first, until nothing goes
+  while (count > targetIndexCount) {
+    keys.clear();
+    for (size_t i = 0; i < count; i += 3) {
+      for (int e = 0; e < 3; e++) {
+        keys.push_back(edgeKey(out[i + e], out[i + (e + 1) % 3]));
+      };
+    };
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    // Half edge collapses, the vertex that goes takes the other's position
+    collapses.clear();
+    for (u_int64_t key : keys) {
+      const u_int32_t a = (u_int32_t)(key >> 32);
+      const u_int32_t b = (u_int32_t)key;
+      Quadric sum = quadrics[canonical[a]];
+      sum.add(quadrics[canonical[b]]);
+      const double intoB = sum.error(vertices[b].position);
+      const double intoA = sum.error(vertices[a].position);
+      Collapse collapse;
+      if (!locked[a] && !locked[b]) {
+        const bool toB = intoB <= intoA;
+        collapse.from = toB ? a : b;
+        collapse.to = toB ? b : a;
+        collapse.cost = toB ? intoB : intoA;
+      } else if (!locked[a]) {
+        collapse.from = a;
+        collapse.to = b;
+        collapse.cost = intoB;
+      } else if (!locked[b]) {
+        collapse.from = b;
+        collapse.to = a;
+        collapse.cost = intoA;
+      } else {
+        continue;
+      };
+      if (collapse.cost <= costLimit) {
+        collapses.push_back(collapse);
+      };
+    };
+    if (collapses.empty()) {
+      break;
+    };
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse &x, const Collapse &y) {
+                return x.cost < y.cost;
+              });
+
+    // Triangles around every vertex
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (size_t i = 0; i < count; i++) {
+      offsets[out[i] + 1]++;
+    };
+    for (size_t v = 0; v < vertexCount; v++) {
+      offsets[v + 1] += offsets[v];
+    };
+    adjacency.resize(count);
+    {
+      std::vector<u_int> cursor(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < count; i++) {
+        adjacency[cursor[out[i]]++] = (u_int32_t)(i / 3);
+      };
+    }
+
+    for (size_t v = 0; v < vertexCount; v++) {
+      remap[v] = (u_int32_t)v;
+    };
+    std::fill(touched.begin(), touched.end(), false);
+    size_t remaining = count;
+    bool collapsed = false;
+    for (const Collapse &collapse : collapses) {
+      if (remaining <= targetIndexCount) {
+        break;
+      };
+      if (touched[collapse.from] || touched[collapse.to]) {
+        continue;
+      };
+
+      // Refuse collapses that flip a triangle or squash it flat
+      bool flips = false;
+      u_int removed = 0;
+      for (u_int j = offsets[collapse.from]; j < offsets[collapse.from + 1];
+           j++) {
+        const u_int32_t *triangle = out + adjacency[j] * 3;
+        const u_int32_t a = remap[triangle[0]];
+        const u_int32_t b = remap[triangle[1]];
+        const u_int32_t c = remap[triangle[2]];
+        if (a == collapse.to || b == collapse.to || c == collapse.to) {
+          removed++;
+          continue;
+        };
+        const glm::vec3 before =
+            triangleNormal(vertices[a].position, vertices[b].position,
+                           vertices[c].position);
+        const glm::vec3 after = triangleNormal(
+            vertices[a == collapse.from ? collapse.to : a].position,
+            vertices[b == collapse.from ? collapse.to : b].position,
+            vertices[c == collapse.from ? collapse.to : c].position);
+        if (glm::dot(before, after) <= 0.25f * glm::dot(before, before)) {
+          flips = true;
+          break;
+        };
+      };
+      if (flips) {
+        continue;
+      };
+
+      remap[collapse.from] = collapse.to;
+      quadrics[canonical[collapse.to]].add(quadrics[collapse.from]);
+      touched[collapse.from] = true;
+      touched[collapse.to] = true;
+      remaining -= removed * 3;
+      maxCost = std::max(maxCost, collapse.cost);
+      collapsed = true;
+    };
+    if (!collapsed) {
+      break;
+    };
+
+    // Rewrite and drop the triangles that collapsed
+    size_t write = 0;
+    for (size_t i = 0; i < count; i += 3) {
+      const u_int32_t a = remap[out[i]];
+      const u_int32_t b = remap[out[i + 1]];
+      const u_int32_t c = remap[out[i + 2]];
+      if (a == b || b == c || a == c) {
+        continue;
+      };
+      out[write++] = a;
+      out[write++] = b;
+      out[write++] = c;
+    };
+    count = write;
+  };
+
+  if (error != NULL) {
+    *error = (float)std::sqrt(maxCost);
+  };
+  return count;
+};
@@ -0,0 +1,57 @@
+#ifndef RS_MESH_OPTIMIZE_H
+#define RS_MESH_OPTIMIZE_H
+
+#include "rs_mesh_format.h"
+#include <cstddef>
+#include <sys/types.h>
+
+// Import time geometry processing for triangle lists, used by
+// rs_mesh_convert. Indices are absolute into the vertex array. The usual
+// order is optimizeVertexCache, optimizeOverdraw, simplifyMesh for the
+// LODs, and optimizeVertexFetch last over every index range at once.
+
+namespace RS {
+// FIFO size the analysis assumes, in the range of what GPUs reuse
+const u_int RS_VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+  u_int invocations; // Vertex shader runs, one per cache miss
+  float acmr;        // Misses per triangle, 3 is no reuse at all
+  float atvr;        // Misses per referenced vertex, 1 is ideal
+};
+
+// Indices at or past vertexCount are skipped
+VertexCacheStats analyzeVertexCache(const u_int32_t *indices,
+                                    size_t indexCount, size_t vertexCount,
+                                    u_int cacheSize = RS_VERTEX_CACHE_SIZE);
+
+// Reorders triangles for post transform cache hits with Forsyth's "Linear
+// Speed Vertex Cache Optimisation"
+void optimizeVertexCache(u_int32_t *indices, size_t indexCount,
+                         size_t vertexCount);
+
+// Reorders a cache optimized list so clusters facing outwards draw first
+// and early depth testing rejects what they hide, after Sander et al.
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+// threshold is how much worse the ACMR may get, 1.05 allows 5%.
+void optimizeOverdraw(u_int32_t *indices, size_t indexCount,
+                      const Vertex *vertices, size_t vertexCount,
+                      float threshold = 1.05f);
+
+// Moves vertices into the order the indices first use them, drops the
+// unused ones and rewrites the indices. Returns the new vertex count.
+size_t optimizeVertexFetch(Vertex *vertices, u_int32_t *indices,
+                           size_t indexCount, size_t vertexCount);
+
+// Quadric error metric edge collapse (Garland and Heckbert). Collapses
+// until targetIndexCount indices are left or the next collapse would move
+// the surface further than targetError, in object space units. Borders
+// and texture seams are kept. out needs room for indexCount indices.
+// Returns the new index count, error gets the largest error introduced.
+size_t simplifyMesh(u_int32_t *out, const u_int32_t *indices,
+                    size_t indexCount, const Vertex *vertices,
+                    size_t vertexCount, size_t targetIndexCount,
+                    float targetError, float *error = NULL);
+} // namespace RS
+
+#endif // !RS_MESH_OPTIMIZE_H
@@ -0,0 +1,368 @@
+#include "rs_occlusion.h"
+#include "rs_batch_renderer.h"
+#include "rs_gl.h"
+#include "rs_profiler.h"
+#include "rs_shader_cache.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <sys/types.h>
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+namespace {
+// Local sizes of hiz.comp and occlusion_cull.comp
+const GLuint PYRAMID_GROUP_SIZE = 8;
+const GLuint CULL_GROUP_SIZE = 64;
+
+// Largest power of two not above value
+int floorPowerOfTwo(int value) {
+  int power = 1;
+  while (power * 2 <= value) {
+    power *= 2;
+  };
+  return power;
+};
+
+GLuint groupCount(int size, GLuint groupSize) {
+  return ((GLuint)size + groupSize - 1) / groupSize;
+};
+} // namespace
+
+::RS::OcclusionCuller::OcclusionCuller() {
+  _state = NULL;
+  _enabled = false;
+  _storage_alignment = 16;
+  _pyramid_program = 0;
+  _from_depth_location = -1;
+  _depth_size_location = -1;
+  _cull_program = 0;
+  _instance_count_location = -1;
+  _command_base_location = -1;
+  _view_projection_location = -1;
+  _pyramid_valid_location = -1;
+  _depth_copy = 0;
+  _pyramid = 0;
+  _depth_width = 0;
+  _depth_height = 0;
+  _pyramid_width = 0;
+  _pyramid_height = 0;
+  _pyramid_levels = 0;
+  _pyramid_valid = false;
+  _pyramid_view_projection = glm::mat4(1.0f);
+  _model_buffer = 0;
+  _command_buffer = 0;
+  _max_instances = 0;
+  _max_commands = 0;
+  _instance_cursor = 0;
+  _command_cursor = 0;
+  for (u_int i = 0; i < RS_OCCLUSION_FRAMES; i++) {
+    _counters[i] = 0;
+    _fences[i] = NULL;
+    _tested[i] = 0;
+  };
+  _frame = 0;
+  _stats = {};
+};
+
+::RS::OcclusionCuller::~OcclusionCuller() {
+  releasePyramid();
+  if (_pyramid_program != 0) {
+    glDeleteProgram(_pyramid_program);
+  };
+  if (_cull_program != 0) {
+    glDeleteProgram(_cull_program);
+    glDeleteBuffers(1, &_model_buffer);
+    glDeleteBuffers(1, &_command_buffer);
+    glDeleteBuffers(RS_OCCLUSION_FRAMES, _counters);
+  };
+  for (u_int i = 0; i < RS_OCCLUSION_FRAMES; i++) {
+    if (_fences[i] != NULL) {
+      glDeleteSync(_fences[i]);
+    };
+  };
+};
+
+bool ::RS::OcclusionCuller::init(u_int maxInstances, u_int maxCommands) {
+  if (_cull_program != 0 || !glVersionAtLeast(4, 3)) {
+    return false;
+  };
+
+  _pyramid_program =
+      ShaderCache::buildComputeProgram(REDSTAR_SHADER_DIR "/comp/hiz.comp");
+  GLuint cullProgram = ShaderCache::buildComputeProgram(
+      REDSTAR_SHADER_DIR "/comp/occlusion_cull.comp");
+  if (_pyramid_program == 0 || cullProgram == 0) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "OCCLUSION CULLING SHADERS FAILED, CULLING STAYS OFF\n");
+    glDeleteProgram(cullProgram);
+    return false;
+  };
+  _cull_program = cullProgram;
+  _from_depth_location = glGetUniformLocation(_pyramid_program, "fromDepth");
+  _depth_size_location = glGetUniformLocation(_pyramid_program, "depthSize");
+  _instance_count_location =
+      glGetUniformLocation(_cull_program, "instanceCount");
+  _command_base_location = glGetUniformLocation(_cull_program, "commandBase");
+  _view_projection_location =
+      glGetUniformLocation(_cull_program, "pyramidViewProjection");
+  _pyramid_valid_location =
+      glGetUniformLocation(_cull_program, "pyramidValid");
+
+  GLint alignment = 16;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  _storage_alignment = (size_t)alignment;
+
+  // Only the GPU writes and reads these
+  _max_instances = maxInstances;
+  _max_commands = maxCommands;
+  glGenBuffers(1, &_model_buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, _model_buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER,
+               (GLsizeiptr)maxInstances * sizeof(glm::mat4), NULL,
+               GL_DYNAMIC_COPY);
+  glGenBuffers(1, &_command_buffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, _command_buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER,
+               (GLsizeiptr)maxCommands * sizeof(DrawElementsIndirectCommand),
+               NULL, GL_DYNAMIC_DRAW);
+  glGenBuffers(RS_OCCLUSION_FRAMES, _counters);
+  for (u_int i = 0; i < RS_OCCLUSION_FRAMES; i++) {
+    const u_int32_t zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _counters[i]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zero), &zero,
+                 GL_DYNAMIC_READ);
+  };
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  return true;
+};
+
+void ::RS::OcclusionCuller::setEnabled(bool enabled) {
+  _enabled = enabled && isSupported();
+  _pyramid_valid = false;
+};
+
+void ::RS::OcclusionCuller::beginFrame() {
+  _instance_cursor = 0;
+  _command_cursor = 0;
+  if (!_enabled) {
+    return;
+  };
+
+  // The slot last used RS_OCCLUSION_FRAMES frames ago
+  const u_int slot = _frame % RS_OCCLUSION_FRAMES;
+  if (_fences[slot] != NULL) {
+    GLenum status = glClientWaitSync(_fences[slot], 0, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+      u_int32_t visible = 0;
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, _counters[slot]);
+      glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(visible),
+                         &visible);
+      _stats.tested = _tested[slot];
+      _stats.visible = visible;
+    };
+    // Still running means the stats skip a frame, never a stall
+    glDeleteSync(_fences[slot]);
+    _fences[slot] = NULL;
+  };
+
+  const u_int32_t zero = 0;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, _counters[slot]);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  _tested[slot] = 0;
+
+  // Last frame's draws may still read the commands, let the driver hand
+  // out fresh storage instead of waiting
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _command_buffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER,
+               (GLsizeiptr)_max_commands * sizeof(DrawElementsIndirectCommand),
+               NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+};
+
+void ::RS::OcclusionCuller::endFrame() {
+  if (!_enabled) {
+    return;
+  };
+  const u_int slot = _frame % RS_OCCLUSION_FRAMES;
+  _fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  _frame++;
+};
+
+GLintptr RS::OcclusionCuller::cull(GLuint streamBuffer, GLintptr modelsOffset,
+                                   GLintptr instanceCommandsOffset,
+                                   GLintptr boundsOffset, u_int instanceCount,
+                                   const DrawElementsIndirectCommand *commands,
+                                   u_int commandCount) {
+  if (!_enabled || instanceCount == 0 ||
+      _instance_cursor + instanceCount > _max_instances ||
+      _command_cursor + commandCount > _max_commands) {
+    return -1;
+  };
+  RS_PROFILE_SCOPE("Occlusion cull");
+
+  // Same ranges, moved to where this flush's survivors go. Slots are
+  // handed out by the shader, so instanceCount starts at 0.
+  const GLuint instanceBase = (GLuint)(modelsOffset / sizeof(glm::mat4));
+  _commands.assign(commands, commands + commandCount);
+  for (DrawElementsIndirectCommand &command : _commands) {
+    command.baseInstance =
+        command.baseInstance - instanceBase + _instance_cursor;
+    command.instanceCount = 0;
+  };
+  const GLintptr commandOffset =
+      (GLintptr)_command_cursor * sizeof(DrawElementsIndirectCommand);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, _command_buffer);
+  glBufferSubData(
+      GL_SHADER_STORAGE_BUFFER, commandOffset,
+      (GLsizeiptr)commandCount * sizeof(DrawElementsIndirectCommand),
+      _commands.data());
+
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, streamBuffer, modelsOffset,
+                    (GLsizeiptr)instanceCount * sizeof(glm::mat4));
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, streamBuffer,
+                    instanceCommandsOffset,
+                    (GLsizeiptr)instanceCount * sizeof(u_int32_t));
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, streamBuffer, boundsOffset,
+                    (GLsizeiptr)commandCount * 2 * sizeof(glm::vec4));
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, _command_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, _model_buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5,
+                   _counters[_frame % RS_OCCLUSION_FRAMES]);
+
+  // The caller's material program is current, it gets it back. The cache
+  // knows which one that is, GL is only asked without one.
+  GLuint program = 0;
+  if (_state == NULL || !_state->getProgram(program)) {
+    GLint current = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    program = (GLuint)current;
+  };
+  bindProgram(_cull_program);
+  bindTexture(_pyramid_valid ? _pyramid : 0);
+  glUniform1ui(_instance_count_location, instanceCount);
+  glUniform1ui(_command_base_location, _command_cursor);
+  glUniformMatrix4fv(_view_projection_location, 1, GL_FALSE,
+                     glm::value_ptr(_pyramid_view_projection));
+  glUniform1i(_pyramid_valid_location, _pyramid_valid ? 1 : 0);
+  glDispatchCompute(groupCount((int)instanceCount, CULL_GROUP_SIZE), 1, 1);
+
+  // The draw reads the commands and the models as vertex attributes
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+  bindProgram(program);
+
+  _tested[_frame % RS_OCCLUSION_FRAMES] += instanceCount;
+  _instance_cursor += instanceCount;
+  _command_cursor += commandCount;
+  return commandOffset;
+};
+
+void ::RS::OcclusionCuller::buildPyramid(int width, int height, int maxWidth,
+                                         int maxHeight,
+                                         const glm::mat4 &viewProjection) {
+  if (!_enabled || width <= 0 || height <= 0) {
+    return;
+  };
+  RS_PROFILE_SCOPE("Build Hi-Z");
+  maxWidth = std::max(maxWidth, width);
+  maxHeight = std::max(maxHeight, height);
+
+  if (maxWidth != _depth_width || maxHeight != _depth_height) {
+    releasePyramid();
+    _depth_width = maxWidth;
+    _depth_height = maxHeight;
+    _pyramid_width = floorPowerOfTwo(maxWidth);
+    _pyramid_height = floorPowerOfTwo(maxHeight);
+    _pyramid_levels = 1;
+    while ((_pyramid_width >> _pyramid_levels) > 0 ||
+           (_pyramid_height >> _pyramid_levels) > 0) {
+      _pyramid_levels++;
+    };
+
+    glGenTextures(1, &_depth_copy);
+    glBindTexture(GL_TEXTURE_2D, _depth_copy);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, maxWidth,
+                   maxHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &_pyramid);
+    glBindTexture(GL_TEXTURE_2D, _pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, _pyramid_levels, GL_R32F, _pyramid_width,
+                   _pyramid_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if (_state != NULL) {
+      // Bound behind the cache's back
+      _state->invalidate();
+    };
+  };
+
+  // Copying from a depth buffer into a depth texture converts the format
+  // as needed, a blit would have to match it. Only the drawn corner is
+  // copied, level 0 stretches it over the whole pyramid, so the cull maps
+  // the viewport onto the pyramid the same way at every drawn size.
+  bindTexture(_depth_copy);
+  bindProgram(_pyramid_program);
+  glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+  glUniform1i(_from_depth_location, 1);
+  glUniform2i(_depth_size_location, width, height);
+  glBindImageTexture(0, _pyramid, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+  glDispatchCompute(groupCount(_pyramid_width, PYRAMID_GROUP_SIZE),
+                    groupCount(_pyramid_height, PYRAMID_GROUP_SIZE), 1);
+
+  glUniform1i(_from_depth_location, 0);
+  for (int level = 1; level < _pyramid_levels; level++) {
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    const int levelWidth = _pyramid_width >> level;
+    const int levelHeight = _pyramid_height >> level;
+    glBindImageTexture(1, _pyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY,
+                       GL_R32F);
+    glBindImageTexture(0, _pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_R32F);
+    glDispatchCompute(
+        groupCount(levelWidth > 0 ? levelWidth : 1, PYRAMID_GROUP_SIZE),
+        groupCount(levelHeight > 0 ? levelHeight : 1, PYRAMID_GROUP_SIZE), 1);
+  };
+  // Next frame's cull samples it
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+  _pyramid_view_projection = viewProjection;
+  _pyramid_valid = true;
+};
+
+void ::RS::OcclusionCuller::bindProgram(GLuint program) {
+  if (_state != NULL) {
+    _state->useProgram(program);
+  } else {
+    glUseProgram(program);
+  };
+};
+
+void ::RS::OcclusionCuller::bindTexture(GLuint texture) {
+  if (_state != NULL) {
+    _state->bindTexture(RS_OCCLUSION_TEXTURE_UNIT, texture);
+  } else {
+    glActiveTexture(GL_TEXTURE0 + RS_OCCLUSION_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, texture);
+  };
+};
+
+void ::RS::OcclusionCuller::releasePyramid() {
+  if (_pyramid != 0) {
+    glDeleteTextures(1, &_depth_copy);
+    glDeleteTextures(1, &_pyramid);
+  };
+  _depth_copy = 0;
+  _pyramid = 0;
+  _depth_width = 0;
+  _depth_height = 0;
+  _pyramid_valid = false;
+};
@@ -0,0 +1,149 @@
+#ifndef RS_OCCLUSION_H
+#define RS_OCCLUSION_H
+
+#include "rs_gl.h"
+#include "rs_gl_state.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+struct DrawElementsIndirectCommand;
+
+// Frames the visible counters are read back behind, so reading them never
+// waits on the GPU
+const u_int RS_OCCLUSION_FRAMES = 3;
+// Texture unit the pyramid and the depth copy are sampled from, out of the
+// way of the materials' textures. The compute shaders hardcode it.
+const u_int RS_OCCLUSION_TEXTURE_UNIT = 15;
+
+struct OcclusionStats {
+  u_int tested;  // Instances the GPU tested in one frame
+  u_int visible; // Of those, drawn
+};
+
+// GPU occlusion culling against a Hi-Z pyramid of the previous frame's
+// depth. At the end of a frame the depth buffer is copied and reduced
+// into a power of two mip chain where every texel keeps the farthest
+// depth below it (comp/hiz.comp). The next frame, BatchRenderer hands
+// each flush's instances to cull(), a compute shader projects their
+// bounds with the old camera, compares the nearest depth against 2x2
+// texels of the pyramid level that fits, and appends the survivors to
+// the model buffer and indirect commands the draw then reads
+// (comp/occlusion_cull.comp). Nothing is read back for drawing.
+//
+// The old depth is one frame behind, so objects that just came out from
+// behind something can show up a frame late. Needs compute shaders,
+// GL 4.3, which llvmpipe has.
+class OcclusionCuller {
+public:
+  // Constructor
+  OcclusionCuller();
+
+  OcclusionCuller(const OcclusionCuller &) = delete;
+  OcclusionCuller &operator=(const OcclusionCuller &) = delete;
+
+  // Deconstructor
+  ~OcclusionCuller();
+
+  // Builds the compute shaders and output buffers, needs a current GL
+  // context. False if compute shaders are missing or did not build,
+  // culling then stays off.
+  bool init(u_int maxInstances, u_int maxCommands);
+
+  inline bool isSupported() const { return _cull_program != 0; };
+  inline bool isEnabled() const { return _enabled; };
+  // Turning it on starts from an empty pyramid, the first frame is drawn
+  // whole
+  void setEnabled(bool enabled);
+
+  // Programs and RS_OCCLUSION_TEXTURE_UNIT are changed through the cache
+  inline void setStateCache(GLStateCache *state) { _state = state; };
+
+  // Reads back the counters of a finished frame and resets this frame's
+  void beginFrame();
+  void endFrame();
+
+  // Tests instanceCount instances already in the stream buffer: models,
+  // a u_int per instance with its index into commands, and the object
+  // space center and half extents of each command's mesh as two vec4.
+  // Each range has to be aligned to getStorageAlignment(). Writes the
+  // culled commands and returns their byte offset in getCommandBuffer(),
+  // -1 if the frame ran out of room and the caller has to draw unculled.
+  // The current program is restored before returning.
+  GLintptr cull(GLuint streamBuffer, GLintptr modelsOffset,
+                GLintptr instanceCommandsOffset, GLintptr boundsOffset,
+                u_int instanceCount,
+                const DrawElementsIndirectCommand *commands,
+                u_int commandCount);
+
+  // Rebuilds the pyramid from the depth of the bound read framebuffer,
+  // after the frame's opaque draws. viewProjection is the camera they
+  // were drawn with. width x height is the lower left corner they were
+  // drawn into, of a target that can hold up to maxWidth x maxHeight, e.g.
+  // with dynamic resolution. The pyramid is sized for the latter, so the
+  // drawn size can change every frame without reallocating it.
+  void buildPyramid(int width, int height, int maxWidth, int maxHeight,
+                    const glm::mat4 &viewProjection);
+  inline void buildPyramid(int width, int height,
+                           const glm::mat4 &viewProjection) {
+    buildPyramid(width, height, width, height, viewProjection);
+  };
+
+  // Culled draws read their per instance model matrices from here
+  inline GLuint getModelBuffer() const { return _model_buffer; };
+  inline GLuint getCommandBuffer() const { return _command_buffer; };
+  inline size_t getStorageAlignment() const { return _storage_alignment; };
+  // Of the latest frame read back, RS_OCCLUSION_FRAMES behind
+  inline const OcclusionStats &getStats() const { return _stats; };
+
+private:
+  // Through the state cache when there is one
+  void bindProgram(GLuint program);
+  void bindTexture(GLuint texture);
+  void releasePyramid();
+
+  GLStateCache *_state;
+  bool _enabled;
+  size_t _storage_alignment;
+
+  GLuint _pyramid_program;
+  GLint _from_depth_location;
+  GLint _depth_size_location;
+  GLuint _cull_program;
+  GLint _instance_count_location;
+  GLint _command_base_location;
+  GLint _view_projection_location;
+  GLint _pyramid_valid_location;
+
+  // Hi-Z, _depth_width x _depth_height is the largest size it takes
+  GLuint _depth_copy;
+  GLuint _pyramid;
+  int _depth_width;
+  int _depth_height;
+  int _pyramid_width;
+  int _pyramid_height;
+  int _pyramid_levels;
+  bool _pyramid_valid;
+  glm::mat4 _pyramid_view_projection;
+
+  // Outputs, filled front to back over a frame so no flush overwrites
+  // what an earlier one still has to draw
+  GLuint _model_buffer;
+  GLuint _command_buffer;
+  u_int _max_instances;
+  u_int _max_commands;
+  u_int _instance_cursor;
+  u_int _command_cursor;
+  std::vector<DrawElementsIndirectCommand> _commands;
+
+  GLuint _counters[RS_OCCLUSION_FRAMES];
+  GLsync _fences[RS_OCCLUSION_FRAMES];
+  u_int _tested[RS_OCCLUSION_FRAMES];
+  u_int _frame;
+  OcclusionStats _stats;
+};
+} // namespace RS
+
+#endif // !RS_OCCLUSION_H
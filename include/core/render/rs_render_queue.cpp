@@ -0,0 +1,90 @@
+#include "rs_render_queue.h"
+#include <cstddef>
+#include <cstring>
+#include <sys/types.h>
+#include <utility>
+
+namespace {
+const u_int DEPTH_BITS = 24;
+const u_int MATERIAL_BITS = 16;
+const u_int PROGRAM_BITS = 10;
+const u_int LOW_BITS = 9; // Free
+const u_int TRANSLUCENT_SHIFT = 59;
+const u_int LAYER_SHIFT = 60;
+const u_int64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+} // namespace
+
+u_int32_t RS::quantizeSortDepth(float viewDepth) {
+  if (!(viewDepth > 0.0f)) { // NaN goes to the front as well
+    return 0;
+  };
+  u_int32_t bits;
+  std::memcpy(&bits, &viewDepth, sizeof(bits));
+  // Sign is 0, the 31 bits left order like the value
+  return (bits >> (31 - DEPTH_BITS)) & (u_int32_t)DEPTH_MASK;
+};
+
+u_int64_t RS::makeSortKey(u_int layer, bool translucent, u_int program,
+                          u_int material, float viewDepth) {
+  const u_int64_t depth = quantizeSortDepth(viewDepth);
+  u_int64_t key = (u_int64_t)(layer & (RS_SORT_LAYERS - 1)) << LAYER_SHIFT;
+  const u_int64_t programBits = program & (RS_SORT_PROGRAMS - 1);
+  const u_int64_t materialBits = material & (RS_SORT_MATERIALS - 1);
+
+  if (translucent) {
+    key |= 1ull << TRANSLUCENT_SHIFT;
+    key |= ((~depth) & DEPTH_MASK) << (LOW_BITS + MATERIAL_BITS + PROGRAM_BITS);
+    key |= programBits << (LOW_BITS + MATERIAL_BITS);
+    key |= materialBits << LOW_BITS;
+  } else {
+    key |= programBits << (LOW_BITS + DEPTH_BITS + MATERIAL_BITS);
+    key |= materialBits << (LOW_BITS + DEPTH_BITS);
+    key |= depth << LOW_BITS;
+  };
+  return key;
+};
+
+void ::RS::RenderQueue::sort() {
+  const size_t count = _commands.size();
+  _sort_passes = 0;
+  if (count < 2) {
+    return;
+  };
+
+  size_t histograms[8][256];
+  std::memset(histograms, 0, sizeof(histograms));
+  for (const RenderCommand &command : _commands) {
+    for (u_int pass = 0; pass < 8; pass++) {
+      histograms[pass][(command.key >> (pass * 8)) & 0xFF]++;
+    };
+  };
+
+  _scratch.resize(count);
+  RenderCommand *source = _commands.data();
+  RenderCommand *destination = _scratch.data();
+  for (u_int pass = 0; pass < 8; pass++) {
+    size_t *histogram = histograms[pass];
+    // Every key shares this byte, the pass would not move anything
+    if (histogram[(source[0].key >> (pass * 8)) & 0xFF] == count) {
+      continue;
+    };
+
+    size_t offset = 0;
+    for (u_int digit = 0; digit < 256; digit++) {
+      size_t digitCount = histogram[digit];
+      histogram[digit] = offset;
+      offset += digitCount;
+    };
+    for (size_t i = 0; i < count; i++) {
+      destination[histogram[(source[i].key >> (pass * 8)) & 0xFF]++] =
+          source[i];
+    };
+    std::swap(source, destination);
+    _sort_passes++;
+  };
+
+  // An odd number of passes leaves the result in the scratch buffer
+  if (source != _commands.data()) {
+    _commands.swap(_scratch);
+  };
+};
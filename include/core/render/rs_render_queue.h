@@ -0,0 +1,69 @@
+#ifndef RS_RENDER_QUEUE_H
+#define RS_RENDER_QUEUE_H
+
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+// 64 bit sort keys, most significant first:
+//
+//   opaque       layer:4 | 0 | program:10 | material:16 | depth:24 | 0:9
+//   translucent  layer:4 | 1 | ~depth:24  | program:10 | material:16 | 0:9
+//
+// Sorting ascending draws layer by layer, every layer's opaque draws before
+// its translucent ones. Opaque draws are grouped by program then material
+// and go front to back within a group, translucent ones go strictly back to
+// front so blending comes out right.
+const u_int RS_SORT_LAYERS = 1 << 4;
+const u_int RS_SORT_PROGRAMS = 1 << 10;
+const u_int RS_SORT_MATERIALS = 1 << 16;
+
+u_int64_t makeSortKey(u_int layer, bool translucent, u_int program,
+                      u_int material, float viewDepth);
+
+// Depth as 24 bits that order like the float does. Positive floats compare
+// like their bit patterns, so this keeps the exponent and the top of the
+// mantissa and needs no near/far range. Negative depth clamps to 0.
+u_int32_t quantizeSortDepth(float viewDepth);
+
+struct RenderCommand {
+  u_int64_t key;
+  u_int32_t payload; // Index into whatever the recorder keeps per draw
+};
+
+// Draws recorded for one frame, sorted by key before submission
+class RenderQueue {
+public:
+  inline void clear() { _commands.clear(); };
+  inline void reserve(size_t count) {
+    _commands.reserve(count);
+    _scratch.reserve(count);
+  };
+  inline void push(u_int64_t key, u_int32_t payload) {
+    _commands.push_back({key, payload});
+  };
+
+  // LSD radix sort, 8 bits per pass. All eight histograms come from one
+  // read of the keys and passes where every key has the same byte are
+  // skipped, which with the key layout above is usually most of them.
+  // Stable, equal keys keep their recording order.
+  void sort();
+
+  inline size_t size() const { return _commands.size(); };
+  inline const RenderCommand &operator[](size_t i) const {
+    return _commands[i];
+  };
+  inline const RenderCommand *data() const { return _commands.data(); };
+
+  // Radix passes the last sort() actually ran, out of 8
+  inline u_int getSortPasses() const { return _sort_passes; };
+
+private:
+  std::vector<RenderCommand> _commands;
+  std::vector<RenderCommand> _scratch;
+  u_int _sort_passes = 0;
+};
+} // namespace RS
+
+#endif // !RS_RENDER_QUEUE_H
@@ -0,0 +1,190 @@
+#include "rs_stream_buffer.h"
+#include "rs_gl.h"
+#include "rs_profiler.h"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <sys/types.h>
+
+::RS::StreamBuffer::StreamBuffer() {
+  _buffer = 0;
+  _persistent = false;
+  _mapped = NULL;
+  _uniform_alignment = 256;
+  _frame_size = 0;
+  _frame_count = 0;
+  _frame_index = 0;
+  _region_start = 0;
+  _cursor = 0;
+  _flushed = 0;
+  for (u_int i = 0; i < RS_STREAM_MAX_FRAMES; i++) {
+    _fences[i] = NULL;
+  };
+  _stats = {};
+  _last_stats = {};
+};
+
+::RS::StreamBuffer::~StreamBuffer() {
+  for (u_int i = 0; i < RS_STREAM_MAX_FRAMES; i++) {
+    if (_fences[i] != NULL) {
+      glDeleteSync(_fences[i]);
+    }
+  };
+  if (_buffer != 0) {
+    if (_mapped != NULL) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    glDeleteBuffers(1, &_buffer);
+  };
+};
+
+bool ::RS::StreamBuffer::init(size_t bytesPerFrame, u_int frameCount) {
+  if (_buffer != 0) {
+    return false;
+  };
+
+  _frame_count = frameCount == 0 ? 1 : frameCount;
+  if (_frame_count > RS_STREAM_MAX_FRAMES) {
+    _frame_count = RS_STREAM_MAX_FRAMES;
+  };
+  _frame_size = bytesPerFrame;
+
+  // Keep every region start aligned for uniform ranges too
+  GLint uniformAlignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+  if (uniformAlignment > 0) {
+    _uniform_alignment = (size_t)uniformAlignment;
+  };
+  _frame_size = (_frame_size + _uniform_alignment - 1) &
+                ~(_uniform_alignment - 1);
+  const GLsizeiptr totalSize = (GLsizeiptr)(_frame_size * _frame_count);
+
+  // GL_COPY_WRITE_BUFFER binds it without disturbing vertex or index state
+  glGenBuffers(1, &_buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+
+  _persistent =
+      glVersionAtLeast(4, 4) || hasGLExtension("GL_ARB_buffer_storage");
+  if (_persistent) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, NULL, flags);
+    _mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0,
+                                                totalSize, flags);
+    _persistent = _mapped != NULL;
+    if (!_persistent) {
+      // Storage is immutable now, start over with a plain buffer
+      glDeleteBuffers(1, &_buffer);
+      glGenBuffers(1, &_buffer);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+    }
+  };
+
+  if (!_persistent) {
+    glBufferData(GL_COPY_WRITE_BUFFER, totalSize, NULL, GL_STREAM_DRAW);
+    _staging.resize(_frame_size);
+  };
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  _stats.persistent = _persistent;
+  _last_stats.persistent = _persistent;
+  return true;
+};
+
+void ::RS::StreamBuffer::beginFrame() {
+  const u_int region = _frame_index % _frame_count;
+  _region_start = region * _frame_size;
+  _cursor = 0;
+  _flushed = 0;
+  _stats.bytesUploaded = 0;
+  _stats.fenceWaitMs = 0.0;
+  _stats.failedAllocations = 0;
+
+  if (_persistent) {
+    // Wait for the GPU to be done with what we wrote here frameCount frames
+    // ago. Normally already signalled, a wait means the GPU is behind.
+    GLsync fence = _fences[region];
+    if (fence != NULL) {
+      RS_PROFILE_SCOPE("StreamBuffer fence wait");
+      auto start = std::chrono::high_resolution_clock::now();
+      GLbitfield flags = 0;
+      for (;;) {
+        GLenum result = glClientWaitSync(fence, flags, 1000000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED ||
+            result == GL_WAIT_FAILED) {
+          break;
+        }
+        flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      _stats.fenceWaitMs =
+          std::chrono::duration<double, std::milli>(end - start).count();
+      glDeleteSync(fence);
+      _fences[region] = NULL;
+    }
+  } else if (region == 0) {
+    // Orphan once per trip around the ring, the driver hands out fresh
+    // storage instead of stalling on draws still reading the old one
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER,
+                 (GLsizeiptr)(_frame_size * _frame_count), NULL,
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  };
+};
+
+::RS::StreamAllocation RS::StreamBuffer::allocate(size_t size,
+                                                  size_t alignment) {
+  StreamAllocation allocation;
+  // Align the absolute offset, GL cares about the offset in the buffer
+  size_t start = _region_start + _cursor;
+  start = (start + alignment - 1) & ~(alignment - 1);
+  if (start + size > _region_start + _frame_size) {
+    _stats.failedAllocations++;
+    allocation.data = NULL;
+    allocation.offset = -1;
+    return allocation;
+  };
+
+  _cursor = start + size - _region_start;
+  _stats.bytesUploaded += size;
+  allocation.offset = (GLintptr)start;
+  allocation.data = _persistent
+                        ? (void *)(_mapped + start)
+                        : (void *)(_staging.data() + (start - _region_start));
+  return allocation;
+};
+
+GLintptr RS::StreamBuffer::upload(const void *data, size_t size,
+                                  size_t alignment) {
+  StreamAllocation allocation = allocate(size, alignment);
+  if (allocation.data == NULL) {
+    return -1;
+  };
+  std::memcpy(allocation.data, data, size);
+  return allocation.offset;
+};
+
+void ::RS::StreamBuffer::flush() {
+  if (_persistent || _cursor == _flushed) {
+    return;
+  };
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  (GLintptr)(_region_start + _flushed),
+                  (GLsizeiptr)(_cursor - _flushed), _staging.data() + _flushed);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  _flushed = _cursor;
+};
+
+void ::RS::StreamBuffer::endFrame() {
+  flush();
+  if (_persistent) {
+    const u_int region = _frame_index % _frame_count;
+    _fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  };
+  _frame_index++;
+  _last_stats = _stats;
+};
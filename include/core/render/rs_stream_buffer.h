@@ -0,0 +1,99 @@
+#ifndef RS_STREAM_BUFFER_H
+#define RS_STREAM_BUFFER_H
+
+#include "rs_gl.h"
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+const u_int RS_STREAM_MAX_FRAMES = 4;
+// Largest storage and uniform buffer offset alignment GL lets a driver
+// require, callers can budget padding with it
+const size_t RS_STREAM_MAX_ALIGNMENT = 256;
+
+struct StreamAllocation {
+  void *data;      // Write the frame's data here, NULL if out of space
+  GLintptr offset; // Byte offset inside getBuffer()
+};
+
+struct StreamStats {
+  size_t bytesUploaded;
+  double fenceWaitMs; // Time blocked waiting for the GPU to free a region
+  u_int failedAllocations;
+  bool persistent;
+};
+
+// Per frame upload ring for dynamic vertex, instance, indirect and uniform
+// data. The buffer is split into one region per frame in flight. With
+// glBufferStorage the whole buffer stays persistently and coherently mapped
+// and a region is only reused after the fence placed at the end of its
+// frame has signalled. Sub-allocation inside a region is a bump pointer.
+//
+// Without buffer storage (GL < 4.4 and no ARB_buffer_storage) allocations
+// are staged in system memory and flush() uploads them with
+// glBufferSubData into the frame's region. The buffer is orphaned once per
+// trip around the ring, when the first region comes up again.
+//
+//   beginFrame() -> allocate()... -> flush() -> draw -> endFrame()
+class StreamBuffer {
+public:
+  // Constructor
+  StreamBuffer();
+
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  // Deconstructor
+  ~StreamBuffer();
+
+  // Needs a current GL context. frameCount is clamped to
+  // RS_STREAM_MAX_FRAMES.
+  bool init(size_t bytesPerFrame, u_int frameCount = 3);
+
+  void beginFrame();
+
+  // alignment must be a power of two
+  StreamAllocation allocate(size_t size, size_t alignment = 16);
+
+  // Aligned for glBindBufferRange(GL_UNIFORM_BUFFER, ...)
+  inline StreamAllocation allocateUniform(size_t size) {
+    return allocate(size, _uniform_alignment);
+  };
+
+  // Copies size bytes in, returns the offset or -1 if out of space
+  GLintptr upload(const void *data, size_t size, size_t alignment = 16);
+
+  // Makes this frame's allocations visible to GL, no-op when persistent
+  void flush();
+
+  void endFrame();
+
+  inline GLuint getBuffer() const { return _buffer; };
+  inline bool isPersistent() const { return _persistent; };
+  // Bytes left in this frame's region, before alignment
+  inline size_t getRemaining() const { return _frame_size - _cursor; };
+  // Stats of the last finished frame
+  inline const StreamStats &getStats() const { return _last_stats; };
+
+private:
+  GLuint _buffer;
+  bool _persistent;
+  unsigned char *_mapped;
+  std::vector<unsigned char> _staging; // Fallback only
+
+  size_t _uniform_alignment;
+  size_t _frame_size;
+  u_int _frame_count;
+  u_int _frame_index;
+  size_t _region_start;
+  size_t _cursor;  // Relative to _region_start
+  size_t _flushed; // Fallback, bytes of the region already uploaded
+  GLsync _fences[RS_STREAM_MAX_FRAMES];
+
+  StreamStats _stats;
+  StreamStats _last_stats;
+};
+} // namespace RS
+
+#endif // !RS_STREAM_BUFFER_H
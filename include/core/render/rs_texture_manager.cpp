@@ -0,0 +1,361 @@
+#include "rs_texture_manager.h"
+#include "rs_gl.h"
+#include "rs_profiler.h"
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <sys/types.h>
+
+::RS::TextureManager::TextureManager(u_int decodeThreads,
+                                     size_t uploadBudget)
+    : _texture_pool(64, MEM_RENDER) {
+  _placeholder = 0;
+  _upload_budget = uploadBudget;
+  _stats = {};
+  _running = true;
+
+  createPlaceholder();
+  // The ring has to hold a full budget for every frame in flight
+  if (!_staging.init(_upload_budget)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "TEXTURE STAGING BUFFER COULD NOT BE CREATED\n");
+  };
+
+  if (decodeThreads == 0) {
+    decodeThreads = 1;
+  };
+  for (u_int i = 0; i < decodeThreads; i++) {
+    _decoders.emplace_back(&TextureManager::decoderLoop, this);
+  };
+};
+
+::RS::TextureManager::~TextureManager() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _running = false;
+  }
+  _decode_wake.notify_all();
+  for (std::thread &decoder : _decoders) {
+    decoder.join();
+  };
+
+  for (Texture *texture : _textures) {
+    if (texture->texture != 0) {
+      glDeleteTextures(1, &texture->texture);
+    }
+    _texture_pool.destroy(texture);
+  };
+  glDeleteTextures(1, &_placeholder);
+};
+
+::RS::TextureHandle RS::TextureManager::load(const char *path,
+                                             bool generateMips) {
+  auto found = _handles.find(path);
+  if (found != _handles.end()) {
+    return found->second;
+  };
+
+  Texture *texture = _texture_pool.create();
+  texture->path = path;
+  texture->generateMips = generateMips;
+  texture->state.store(TEXTURE_QUEUED, std::memory_order_relaxed);
+  texture->texture = 0;
+  texture->uploadLevel = -1;
+  texture->uploadRow = 0;
+
+  TextureHandle handle = (TextureHandle)_textures.size();
+  _textures.push_back(texture);
+  _handles[texture->path] = handle;
+  _stats.requested++;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _decode_queue.push_back(texture);
+  }
+  _decode_wake.notify_one();
+  return handle;
+};
+
+void ::RS::TextureManager::update() {
+  RS_PROFILE_SCOPE("TextureManager::update");
+  auto start = std::chrono::high_resolution_clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (Texture *texture : _decoded) {
+      if (texture->state.load(std::memory_order_acquire) == TEXTURE_FAILED) {
+        _stats.failed++;
+      } else {
+        _upload_queue.push_back(texture);
+      }
+    };
+    _decoded.clear();
+  }
+
+  _stats.bytesUploaded = 0;
+  if (!_upload_queue.empty()) {
+    _staging.beginFrame();
+    size_t budget = _upload_budget;
+    while (!_upload_queue.empty() && budget > 0) {
+      Texture *texture = _upload_queue.front();
+      size_t uploaded = uploadSome(texture, budget);
+      if (uploaded == 0) {
+        break;
+      }
+      budget -= uploaded < budget ? uploaded : budget;
+      _stats.bytesUploaded += uploaded;
+
+      if (texture->state.load(std::memory_order_relaxed) ==
+          TEXTURE_RESIDENT) {
+        _upload_queue.pop_front();
+        _stats.resident++;
+      }
+    };
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    _staging.endFrame();
+  };
+
+  _stats.totalBytesUploaded += _stats.bytesUploaded;
+  _stats.pendingUploads = (u_int)_upload_queue.size();
+  auto end = std::chrono::high_resolution_clock::now();
+  _stats.uploadMs =
+      std::chrono::duration<double, std::milli>(end - start).count();
+};
+
+void ::RS::TextureManager::waitAll() {
+  for (;;) {
+    update();
+    if (_stats.resident + _stats.failed == _stats.requested) {
+      return;
+    }
+
+    // Only sleep while the decoders still owe us something
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_upload_queue.empty()) {
+      _decoded_wake.wait(lock, [this]() { return !_decoded.empty(); });
+    }
+  };
+};
+
+GLuint RS::TextureManager::getTexture(TextureHandle handle) const {
+  if (handle >= _textures.size()) {
+    return _placeholder;
+  };
+  const Texture *texture = _textures[handle];
+  int state = texture->state.load(std::memory_order_relaxed);
+  if (state == TEXTURE_RESIDENT ||
+      (state == TEXTURE_UPLOADING &&
+       texture->uploadLevel < (int)texture->levels.size() - 1)) {
+    return texture->texture;
+  };
+  return _placeholder;
+};
+
+void ::RS::TextureManager::bind(TextureHandle handle, GLuint unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D, getTexture(handle));
+};
+
+bool ::RS::TextureManager::isResident(TextureHandle handle) const {
+  return handle < _textures.size() &&
+         _textures[handle]->state.load(std::memory_order_relaxed) ==
+             TEXTURE_RESIDENT;
+};
+
+bool ::RS::TextureManager::hasFailed(TextureHandle handle) const {
+  return handle >= _textures.size() ||
+         _textures[handle]->state.load(std::memory_order_acquire) ==
+             TEXTURE_FAILED;
+};
+
+bool ::RS::TextureManager::decode(Texture *texture) {
+  RS_PROFILE_SCOPE("Texture decode");
+  SDL_Surface *loaded = IMG_Load(texture->path.c_str());
+  if (loaded == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "TEXTURE COULD NOT BE LOADED: %s\n",
+                 SDL_GetError());
+    return false;
+  };
+  SDL_Surface *rgba = SDL_ConvertSurface(loaded, SDL_PIXELFORMAT_RGBA32);
+  SDL_DestroySurface(loaded);
+  if (rgba == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "TEXTURE COULD NOT BE CONVERTED: %s\n", SDL_GetError());
+    return false;
+  };
+
+  // Size the whole chain up front so the levels never reallocate
+  u_int width = (u_int)rgba->w;
+  u_int height = (u_int)rgba->h;
+  size_t total = 0;
+  for (;;) {
+    texture->levels.push_back({width, height, total});
+    total += (size_t)width * height * 4;
+    if (!texture->generateMips || (width == 1 && height == 1)) {
+      break;
+    }
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  };
+  texture->pixels.resize(total);
+
+  // Level 0, dropping the surface's row padding
+  const size_t rowBytes = (size_t)rgba->w * 4;
+  for (int row = 0; row < rgba->h; row++) {
+    std::memcpy(texture->pixels.data() + row * rowBytes,
+                (const unsigned char *)rgba->pixels + (size_t)row * rgba->pitch,
+                rowBytes);
+  };
+  SDL_DestroySurface(rgba);
+
+  // 2x2 box filter, odd edges reuse the last row/column
+  for (size_t level = 1; level < texture->levels.size(); level++) {
+    const MipLevel &source = texture->levels[level - 1];
+    const MipLevel &target = texture->levels[level];
+    const unsigned char *in = texture->pixels.data() + source.offset;
+    unsigned char *out = texture->pixels.data() + target.offset;
+    for (u_int y = 0; y < target.height; y++) {
+      u_int y0 = y * 2 < source.height ? y * 2 : source.height - 1;
+      u_int y1 = y0 + 1 < source.height ? y0 + 1 : y0;
+      for (u_int x = 0; x < target.width; x++) {
+        u_int x0 = x * 2 < source.width ? x * 2 : source.width - 1;
+        u_int x1 = x0 + 1 < source.width ? x0 + 1 : x0;
+        const unsigned char *a = in + ((size_t)y0 * source.width + x0) * 4;
+        const unsigned char *b = in + ((size_t)y0 * source.width + x1) * 4;
+        const unsigned char *c = in + ((size_t)y1 * source.width + x0) * 4;
+        const unsigned char *d = in + ((size_t)y1 * source.width + x1) * 4;
+        unsigned char *texel = out + ((size_t)y * target.width + x) * 4;
+        for (int channel = 0; channel < 4; channel++) {
+          texel[channel] = (unsigned char)((a[channel] + b[channel] +
+                                            c[channel] + d[channel] + 2) /
+                                           4);
+        }
+      }
+    }
+  };
+  return true;
+};
+
+size_t RS::TextureManager::uploadSome(Texture *texture, size_t budget) {
+  if (texture->texture == 0) {
+    // Immutable storage for the whole chain, nothing is sampled until the
+    // smallest level is in
+    const MipLevel &base = texture->levels[0];
+    glGenTextures(1, &texture->texture);
+    glBindTexture(GL_TEXTURE_2D, texture->texture);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)texture->levels.size(), GL_RGBA8,
+                   (GLsizei)base.width, (GLsizei)base.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    texture->levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR
+                                               : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL,
+                    (GLint)texture->levels.size() - 1);
+    texture->uploadLevel = (int)texture->levels.size() - 1;
+    texture->uploadRow = 0;
+    texture->state.store(TEXTURE_UPLOADING, std::memory_order_relaxed);
+  } else {
+    glBindTexture(GL_TEXTURE_2D, texture->texture);
+  };
+
+  const MipLevel &level = texture->levels[texture->uploadLevel];
+  const size_t rowBytes = (size_t)level.width * 4;
+  u_int rows = level.height - texture->uploadRow;
+  if (rows * rowBytes > budget) {
+    rows = (u_int)(budget / rowBytes);
+    if (rows == 0) {
+      // A single row larger than what is left, try again next frame. With
+      // the whole budget left it goes on its own, past the ring if needed.
+      if (budget < _upload_budget) {
+        return 0;
+      }
+      rows = 1;
+    }
+  };
+
+  const size_t bytes = rows * rowBytes;
+  const unsigned char *source =
+      texture->pixels.data() + level.offset + texture->uploadRow * rowBytes;
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (bytes > _upload_budget) {
+    // One row wider than a whole staging region never fits the ring, it
+    // goes from client memory and the driver copies it
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, texture->uploadLevel, 0,
+                    (GLint)texture->uploadRow, (GLsizei)level.width,
+                    (GLsizei)rows, GL_RGBA, GL_UNSIGNED_BYTE, source);
+  } else {
+    StreamAllocation staging = _staging.allocate(bytes, 4);
+    if (staging.data == NULL) {
+      return 0;
+    };
+    std::memcpy(staging.data, source, bytes);
+    _staging.flush();
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging.getBuffer());
+    glTexSubImage2D(GL_TEXTURE_2D, texture->uploadLevel, 0,
+                    (GLint)texture->uploadRow, (GLsizei)level.width,
+                    (GLsizei)rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                    (void *)staging.offset);
+  };
+
+  texture->uploadRow += rows;
+  if (texture->uploadRow == level.height) {
+    // The level is complete, let the sampler use it
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL,
+                    texture->uploadLevel);
+    texture->uploadRow = 0;
+    texture->uploadLevel--;
+    if (texture->uploadLevel < 0) {
+      texture->state.store(TEXTURE_RESIDENT, std::memory_order_relaxed);
+      std::vector<unsigned char>().swap(texture->pixels);
+    }
+  };
+  return bytes;
+};
+
+void ::RS::TextureManager::createPlaceholder() {
+  // Magenta and black checkerboard, hard to miss on screen
+  const unsigned char pixels[16] = {255, 0, 255, 255, 0,   0, 0,   255,
+                                    0,   0, 0,   255, 255, 0, 255, 255};
+  glGenTextures(1, &_placeholder);
+  glBindTexture(GL_TEXTURE_2D, _placeholder);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 2, 2);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 2, 2, GL_RGBA, GL_UNSIGNED_BYTE,
+                  pixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+};
+
+void ::RS::TextureManager::decoderLoop() {
+  RS_PROFILE_THREAD("Texture decoder");
+  for (;;) {
+    Texture *texture = NULL;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _decode_wake.wait(lock,
+                        [this]() { return !_running || !_decode_queue.empty(); });
+      if (!_running) {
+        return;
+      }
+      texture = _decode_queue.front();
+      _decode_queue.pop_front();
+    }
+
+    bool decoded = decode(texture);
+    texture->state.store(decoded ? TEXTURE_DECODED : TEXTURE_FAILED,
+                         std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _decoded.push_back(texture);
+    }
+    _decoded_wake.notify_all();
+  };
+};
@@ -0,0 +1,133 @@
+#ifndef RS_TEXTURE_MANAGER_H
+#define RS_TEXTURE_MANAGER_H
+
+#include "rs_gl.h"
+#include "rs_object_pool.h"
+#include "rs_stream_buffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace RS {
+typedef u_int TextureHandle;
+const TextureHandle RS_INVALID_TEXTURE = 0xFFFFFFFFu;
+
+struct TextureStats {
+  u_int requested;
+  u_int resident; // Every mip level uploaded
+  u_int failed;
+  u_int pendingUploads;    // Decoded, waiting for or mid upload
+  size_t bytesUploaded;    // Last update()
+  double uploadMs;         // CPU time of the last update()
+  size_t totalBytesUploaded;
+};
+
+// Loads textures without stalling the frame loop.
+//
+// load() returns a handle right away. Decoder threads read the file with
+// SDL_image, convert it to RGBA8 and build the whole mip chain on the CPU.
+// update() then streams the levels to the GPU through pixel unpack buffers,
+// smallest level first and never more than uploadBudget bytes per frame, so
+// a 2048x2048 texture is spread over several frames instead of one hitch.
+// Until a texture's first level is up getTexture() returns a checkerboard
+// placeholder, after that the texture sharpens as finer levels arrive.
+//
+// Everything but the decoding runs on the thread that owns the GL context.
+class TextureManager {
+public:
+  // Constructor
+  // Needs a current GL context
+  TextureManager(u_int decodeThreads = 2, size_t uploadBudget = 4 << 20);
+
+  TextureManager(const TextureManager &) = delete;
+  TextureManager &operator=(const TextureManager &) = delete;
+
+  // Deconstructor
+  ~TextureManager();
+
+  // The same path always returns the same handle
+  TextureHandle load(const char *path, bool generateMips = true);
+
+  // Uploads what fits into this frame's budget, once per frame
+  void update();
+
+  // Blocks until every texture is resident or failed, for loading screens
+  // and tools
+  void waitAll();
+
+  // Placeholder until the texture has at least its smallest level
+  GLuint getTexture(TextureHandle handle) const;
+  void bind(TextureHandle handle, GLuint unit) const;
+
+  bool isResident(TextureHandle handle) const;
+  bool hasFailed(TextureHandle handle) const;
+
+  inline GLuint getPlaceholder() const { return _placeholder; };
+  inline const TextureStats &getStats() const { return _stats; };
+
+private:
+  enum TextureState {
+    TEXTURE_QUEUED,    // Waiting for or on a decoder thread
+    TEXTURE_DECODED,   // Decoder is done, waiting for upload
+    TEXTURE_UPLOADING, // Some levels are on the GPU
+    TEXTURE_RESIDENT,
+    TEXTURE_FAILED
+  };
+
+  struct MipLevel {
+    u_int width;
+    u_int height;
+    size_t offset; // Into Texture::pixels
+  };
+
+  struct Texture {
+    std::string path;
+    bool generateMips;
+    std::atomic<int> state;
+    GLuint texture;
+
+    // Written by the decoder, read by update() once TEXTURE_DECODED
+    std::vector<unsigned char> pixels; // Every level back to back, RGBA8
+    std::vector<MipLevel> levels;
+
+    // Upload progress, levels go out from the back (smallest) to 0
+    int uploadLevel;
+    u_int uploadRow;
+  };
+
+  static bool decode(Texture *texture);
+  // Returns the bytes uploaded, 0 once the budget or the staging buffer is
+  // used up
+  size_t uploadSome(Texture *texture, size_t budget);
+  void createPlaceholder();
+  void decoderLoop();
+
+  ObjectPool<Texture> _texture_pool;
+  std::vector<Texture *> _textures;
+  std::unordered_map<std::string, TextureHandle> _handles;
+
+  GLuint _placeholder;
+  StreamBuffer _staging; // Pixel unpack ring, one budget per frame
+  size_t _upload_budget;
+  std::deque<Texture *> _upload_queue;
+  TextureStats _stats;
+
+  // Decoders
+  std::vector<std::thread> _decoders;
+  std::mutex _mutex;
+  std::condition_variable _decode_wake;
+  std::condition_variable _decoded_wake; // For waitAll()
+  std::deque<Texture *> _decode_queue;
+  std::vector<Texture *> _decoded; // Finished since the last update()
+  bool _running;
+};
+} // namespace RS
+
+#endif // !RS_TEXTURE_MANAGER_H
@@ -0,0 +1,293 @@
+#include "rs_transform.h"
+#include "rs_job_system.h"
+#include "rs_profiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <sys/types.h>
+#include <vector>
+
+namespace {
+// _parents entry of a root
+const u_int32_t NO_PARENT = 0xFFFFFFFFu;
+// Levels smaller than this are not worth handing to other threads
+const size_t TRANSFORM_PARALLEL_GRAIN = 4096;
+
+// T * R * S without building three matrices
+inline glm::mat4 composeLocal(const glm::vec3 &position,
+                              const glm::quat &rotation,
+                              const glm::vec3 &scale) {
+  const glm::mat3 basis = glm::mat3_cast(rotation);
+  glm::mat4 local;
+  local[0] = glm::vec4(basis[0] * scale.x, 0.0f);
+  local[1] = glm::vec4(basis[1] * scale.y, 0.0f);
+  local[2] = glm::vec4(basis[2] * scale.z, 0.0f);
+  local[3] = glm::vec4(position, 1.0f);
+  return local;
+};
+} // namespace
+
+::RS::TransformHierarchy::TransformHierarchy() {
+  _first_dirty = 0;
+  _order_dirty = false;
+  _stats = {};
+};
+
+::RS::TransformHandle RS::TransformHierarchy::create(TransformHandle parent) {
+  TransformHandle handle;
+  if (!_free_handles.empty()) {
+    handle = _free_handles.back();
+    _free_handles.pop_back();
+  } else {
+    handle = (TransformHandle)_nodes.size();
+    _nodes.push_back(Node());
+  };
+
+  Node &node = _nodes[handle];
+  node.parent = RS_NULL_TRANSFORM;
+  node.firstChild = RS_NULL_TRANSFORM;
+  node.nextSibling = RS_NULL_TRANSFORM;
+  node.alive = true;
+
+  // Appended for now, rebuildOrder() puts it where it belongs
+  node.dense = (u_int32_t)_handles.size();
+  _handles.push_back(handle);
+  _parents.push_back(NO_PARENT);
+  _positions.push_back(glm::vec3(0.0f));
+  _rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+  _scales.push_back(glm::vec3(1.0f));
+  _world.push_back(glm::mat4(1.0f));
+  _dirty.push_back(1);
+
+  if (isValid(parent)) {
+    link(handle, parent);
+  };
+  _order_dirty = true;
+  return handle;
+};
+
+void ::RS::TransformHierarchy::destroy(TransformHandle node) {
+  if (!isValid(node)) {
+    return;
+  };
+  unlink(node);
+
+  // Depth first over the subtree, the dense slots are dropped by the next
+  // rebuildOrder()
+  std::vector<TransformHandle> stack(1, node);
+  while (!stack.empty()) {
+    TransformHandle current = stack.back();
+    stack.pop_back();
+    for (TransformHandle child = _nodes[current].firstChild;
+         child != RS_NULL_TRANSFORM; child = _nodes[child].nextSibling) {
+      stack.push_back(child);
+    };
+    _nodes[current].alive = false;
+    _nodes[current].firstChild = RS_NULL_TRANSFORM;
+    _free_handles.push_back(current);
+  };
+  _order_dirty = true;
+};
+
+bool ::RS::TransformHierarchy::setParent(TransformHandle node,
+                                         TransformHandle parent) {
+  if (!isValid(node) || (parent != RS_NULL_TRANSFORM && !isValid(parent))) {
+    return false;
+  };
+  // Walking up from the new parent must not run into node
+  for (TransformHandle up = parent; up != RS_NULL_TRANSFORM;
+       up = _nodes[up].parent) {
+    if (up == node) {
+      return false;
+    };
+  };
+  if (_nodes[node].parent == parent) {
+    return true;
+  };
+
+  unlink(node);
+  if (parent != RS_NULL_TRANSFORM) {
+    link(node, parent);
+  };
+  _order_dirty = true;
+  return true;
+};
+
+void ::RS::TransformHierarchy::unlink(TransformHandle node) {
+  TransformHandle parent = _nodes[node].parent;
+  if (parent == RS_NULL_TRANSFORM) {
+    return;
+  };
+  TransformHandle *link = &_nodes[parent].firstChild;
+  while (*link != node) {
+    link = &_nodes[*link].nextSibling;
+  };
+  *link = _nodes[node].nextSibling;
+  _nodes[node].parent = RS_NULL_TRANSFORM;
+  _nodes[node].nextSibling = RS_NULL_TRANSFORM;
+};
+
+void ::RS::TransformHierarchy::link(TransformHandle node,
+                                    TransformHandle parent) {
+  _nodes[node].parent = parent;
+  _nodes[node].nextSibling = _nodes[parent].firstChild;
+  _nodes[parent].firstChild = node;
+};
+
+void ::RS::TransformHierarchy::markDirty(u_int32_t dense) {
+  _dirty[dense] = 1;
+  if (dense < _first_dirty) {
+    _first_dirty = dense;
+  };
+};
+
+void ::RS::TransformHierarchy::setLocalPosition(TransformHandle node,
+                                                const glm::vec3 &position) {
+  const u_int32_t dense = _nodes[node].dense;
+  if (_positions[dense] != position) {
+    _positions[dense] = position;
+    markDirty(dense);
+  };
+};
+
+void ::RS::TransformHierarchy::setLocalRotation(TransformHandle node,
+                                                const glm::quat &rotation) {
+  const u_int32_t dense = _nodes[node].dense;
+  if (_rotations[dense] != rotation) {
+    _rotations[dense] = rotation;
+    markDirty(dense);
+  };
+};
+
+void ::RS::TransformHierarchy::setLocalScale(TransformHandle node,
+                                             const glm::vec3 &scale) {
+  const u_int32_t dense = _nodes[node].dense;
+  if (_scales[dense] != scale) {
+    _scales[dense] = scale;
+    markDirty(dense);
+  };
+};
+
+void ::RS::TransformHierarchy::rebuildOrder() {
+  RS_PROFILE_SCOPE("TransformHierarchy rebuild");
+  // Breadth first from every root, siblings end up next to each other
+  std::vector<TransformHandle> order;
+  order.reserve(_nodes.size());
+  for (size_t dense = 0; dense < _handles.size(); dense++) {
+    TransformHandle handle = _handles[dense];
+    if (_nodes[handle].alive && _nodes[handle].dense == dense &&
+        _nodes[handle].parent == RS_NULL_TRANSFORM) {
+      order.push_back(handle);
+    };
+  };
+
+  _level_starts.clear();
+  size_t levelBegin = 0;
+  while (levelBegin < order.size()) {
+    _level_starts.push_back((u_int32_t)levelBegin);
+    const size_t levelEnd = order.size();
+    for (size_t i = levelBegin; i < levelEnd; i++) {
+      for (TransformHandle child = _nodes[order[i]].firstChild;
+           child != RS_NULL_TRANSFORM; child = _nodes[child].nextSibling) {
+        order.push_back(child);
+      };
+    };
+    levelBegin = levelEnd;
+  };
+  _level_starts.push_back((u_int32_t)order.size());
+
+  const size_t count = order.size();
+  std::vector<glm::vec3> positions(count);
+  std::vector<glm::quat> rotations(count);
+  std::vector<glm::vec3> scales(count);
+  for (size_t i = 0; i < count; i++) {
+    const u_int32_t old = _nodes[order[i]].dense;
+    positions[i] = _positions[old];
+    rotations[i] = _rotations[old];
+    scales[i] = _scales[old];
+  };
+  for (size_t i = 0; i < count; i++) {
+    _nodes[order[i]].dense = (u_int32_t)i;
+  };
+
+  _parents.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    TransformHandle parent = _nodes[order[i]].parent;
+    _parents[i] = parent == RS_NULL_TRANSFORM ? NO_PARENT : _nodes[parent].dense;
+  };
+
+  _handles.swap(order);
+  _positions.swap(positions);
+  _rotations.swap(rotations);
+  _scales.swap(scales);
+  _world.resize(count);
+  // Cheaper than working out which subtrees moved
+  _dirty.assign(count, 1);
+  _first_dirty = 0;
+  _order_dirty = false;
+};
+
+u_int RS::TransformHierarchy::updateRange(size_t begin, size_t end) {
+  u_int updated = 0;
+  for (size_t i = begin; i < end; i++) {
+    const u_int32_t parent = _parents[i];
+    // Parents sit in earlier levels, their flag is final by now
+    if (_dirty[i] == 0 && (parent == NO_PARENT || _dirty[parent] == 0)) {
+      continue;
+    };
+    _dirty[i] = 1; // So our own children see it
+
+    const glm::mat4 local = composeLocal(_positions[i], _rotations[i], _scales[i]);
+    _world[i] = parent == NO_PARENT ? local : _world[parent] * local;
+    updated++;
+  };
+  return updated;
+};
+
+void ::RS::TransformHierarchy::update(JobSystem *jobs) {
+  RS_PROFILE_SCOPE("TransformHierarchy::update");
+  auto start = std::chrono::high_resolution_clock::now();
+
+  if (_order_dirty) {
+    rebuildOrder();
+  };
+
+  const size_t count = _handles.size();
+  std::atomic<u_int> updated(0);
+  if (_first_dirty < count) {
+    for (size_t level = 0; level + 1 < _level_starts.size(); level++) {
+      const size_t levelEnd = _level_starts[level + 1];
+      if (levelEnd <= _first_dirty) {
+        continue;
+      };
+      const size_t levelBegin = _level_starts[level] > _first_dirty
+                                    ? _level_starts[level]
+                                    : _first_dirty;
+      const size_t size = levelEnd - levelBegin;
+
+      if (jobs != NULL && size >= TRANSFORM_PARALLEL_GRAIN * 2) {
+        jobs->parallelFor(size, TRANSFORM_PARALLEL_GRAIN,
+                          [this, levelBegin, &updated](size_t begin,
+                                                       size_t end) {
+                            updated.fetch_add(updateRange(levelBegin + begin,
+                                                          levelBegin + end),
+                                              std::memory_order_relaxed);
+                          });
+      } else {
+        updated.fetch_add(updateRange(levelBegin, levelEnd),
+                          std::memory_order_relaxed);
+      };
+    };
+    std::memset(_dirty.data() + _first_dirty, 0, count - _first_dirty);
+  };
+  _first_dirty = count;
+
+  auto end = std::chrono::high_resolution_clock::now();
+  _stats.nodes = (u_int)count;
+  _stats.levels = _level_starts.empty() ? 0 : (u_int)_level_starts.size() - 1;
+  _stats.updated = updated.load(std::memory_order_relaxed);
+  _stats.updateMs =
+      std::chrono::duration<double, std::milli>(end - start).count();
+};
@@ -0,0 +1,119 @@
+#ifndef RS_TRANSFORM_H
+#define RS_TRANSFORM_H
+
+#include "rs_job_system.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+typedef u_int32_t TransformHandle;
+const TransformHandle RS_NULL_TRANSFORM = 0xFFFFFFFFu;
+
+struct TransformStats {
+  u_int nodes;
+  u_int levels;   // Depth of the deepest node plus one
+  u_int updated;  // World matrices the last update() recomputed
+  double updateMs;
+};
+
+// Parented translation/rotation/scale with world matrices computed in bulk.
+//
+// Hot data lives in flat arrays sorted breadth first, so every parent comes
+// before its children and one linear pass computes all world matrices.
+// Local changes only flag the node, update() starts at the first flagged
+// node and recomputes flagged nodes plus everything under them. A scene
+// where nothing moved costs one compare. Each depth level only reads the
+// level above it, so big levels are split across the JobSystem.
+//
+// Creating, destroying or reparenting rebuilds the order on the next
+// update() and recomputes everything once, so do those at load time
+// rather than every frame. Not thread safe.
+class TransformHierarchy {
+public:
+  // Constructor
+  TransformHierarchy();
+
+  TransformHierarchy(const TransformHierarchy &) = delete;
+  TransformHierarchy &operator=(const TransformHierarchy &) = delete;
+
+  // Identity local transform
+  TransformHandle create(TransformHandle parent = RS_NULL_TRANSFORM);
+  // The node's whole subtree goes with it
+  void destroy(TransformHandle node);
+  // RS_NULL_TRANSFORM makes it a root. Returns false when parent is the
+  // node itself or below it.
+  bool setParent(TransformHandle node, TransformHandle parent);
+
+  inline bool isValid(TransformHandle node) const {
+    return node < _nodes.size() && _nodes[node].alive;
+  };
+  inline TransformHandle getParent(TransformHandle node) const {
+    return _nodes[node].parent;
+  };
+
+  // Setting the value a node already has leaves it clean, so syncing
+  // unchanged components in every frame is free
+  void setLocalPosition(TransformHandle node, const glm::vec3 &position);
+  void setLocalRotation(TransformHandle node, const glm::quat &rotation);
+  void setLocalScale(TransformHandle node, const glm::vec3 &scale);
+
+  inline const glm::vec3 &getLocalPosition(TransformHandle node) const {
+    return _positions[_nodes[node].dense];
+  };
+  inline const glm::quat &getLocalRotation(TransformHandle node) const {
+    return _rotations[_nodes[node].dense];
+  };
+  inline const glm::vec3 &getLocalScale(TransformHandle node) const {
+    return _scales[_nodes[node].dense];
+  };
+
+  // Brings the world matrices up to date, jobs splits big levels
+  void update(JobSystem *jobs = NULL);
+
+  // As of the last update()
+  inline const glm::mat4 &getWorldMatrix(TransformHandle node) const {
+    return _world[_nodes[node].dense];
+  };
+
+  inline const TransformStats &getStats() const { return _stats; };
+
+private:
+  // Handle side, cold. Children form an intrusive sibling list.
+  struct Node {
+    TransformHandle parent;
+    TransformHandle firstChild;
+    TransformHandle nextSibling;
+    u_int32_t dense;
+    bool alive;
+  };
+
+  void unlink(TransformHandle node);
+  void link(TransformHandle node, TransformHandle parent);
+  void markDirty(u_int32_t dense);
+  void rebuildOrder();
+  u_int updateRange(size_t begin, size_t end);
+
+  std::vector<Node> _nodes;
+  std::vector<TransformHandle> _free_handles;
+
+  // Dense side, in breadth first order once the order is clean
+  std::vector<TransformHandle> _handles;
+  std::vector<u_int32_t> _parents; // Dense index or NO_PARENT
+  std::vector<glm::vec3> _positions;
+  std::vector<glm::quat> _rotations;
+  std::vector<glm::vec3> _scales;
+  std::vector<glm::mat4> _world;
+  std::vector<u_int8_t> _dirty;
+  std::vector<u_int32_t> _level_starts; // Plus one entry for the end
+
+  // Nothing below this dense index is flagged
+  size_t _first_dirty;
+  bool _order_dirty;
+  TransformStats _stats;
+};
+} // namespace RS
+
+#endif // !RS_TRANSFORM_H
@@ -0,0 +1,95 @@
+#version 430 core
+// Permutation source, see vert/forward.vert
+#pragma rs_feature TEXTURED
+#pragma rs_feature FOG
+#pragma rs_feature LIT
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+#ifdef RS_TEXTURED
+uniform sampler2D texture1;
+#else
+uniform vec4 baseColor = vec4(1.0);
+#endif
+
+#ifdef RS_LIT
+in vec3 ViewPosition;
+
+// Filled by RS::LightClusterBuffer, see rs_light_clusters.h
+layout (std140, binding = 1) uniform ClusterConstants {
+    uvec4 gridSize;     // x, y, z, cluster count. 0 without lights.
+    vec4 screenSize;    // width, height, 1 / width, 1 / height
+    vec4 depthSlicing;  // slice = log(depth) * x + y, near, far
+    vec4 ambient;
+};
+
+struct ClusterLight {
+    vec4 positionRadius; // View space
+    vec4 color;
+};
+layout (std430, binding = 6) readonly buffer ClusterLights {
+    ClusterLight lights[];
+};
+// Offset into lightIndices and light count per cluster
+layout (std430, binding = 7) readonly buffer ClusterGrid { uvec2 clusters[]; };
+layout (std430, binding = 8) readonly buffer ClusterIndices {
+    uint lightIndices[];
+};
+
+vec3 shade(vec3 albedo)
+{
+    // Meshes carry no normals, the faceted one from screen space
+    // derivatives is what the lighting uses
+    vec3 normal = normalize(cross(dFdx(ViewPosition), dFdy(ViewPosition)));
+    vec3 lit = ambient.rgb;
+    if (gridSize.w == 0u) {
+        return albedo * lit;
+    }
+
+    uvec2 tile = uvec2(gl_FragCoord.xy * screenSize.zw * vec2(gridSize.xy));
+    float slice = log(max(-ViewPosition.z, depthSlicing.z)) * depthSlicing.x +
+                  depthSlicing.y;
+    uvec3 cell = min(uvec3(tile, uint(max(slice, 0.0))), gridSize.xyz - 1u);
+    uvec2 cluster =
+        clusters[(cell.z * gridSize.y + cell.y) * gridSize.x + cell.x];
+
+    for (uint i = 0u; i < cluster.y; i++) {
+        ClusterLight light = lights[lightIndices[cluster.x + i]];
+        vec3 toLight = light.positionRadius.xyz - ViewPosition;
+        float distance2 = dot(toLight, toLight);
+        float radius = light.positionRadius.w;
+        // Inverse square, windowed to reach 0 at the radius
+        float window = clamp(1.0 - pow(distance2 / (radius * radius), 2.0),
+                             0.0, 1.0);
+        float attenuation = window * window / (distance2 + 1.0);
+        float diffuse = max(dot(normal, toLight * inversesqrt(distance2)), 0.0);
+        lit += light.color.rgb * diffuse * attenuation;
+    }
+    return albedo * lit;
+}
+#endif
+
+#ifdef RS_FOG
+in float ViewDepth;
+// Defaults to the clear color
+uniform vec3 fogColor = vec3(0.2, 0.3, 0.3);
+uniform float fogDensity = 0.05;
+#endif
+
+void main()
+{
+#ifdef RS_TEXTURED
+    vec4 color = texture(texture1, TexCoord);
+#else
+    vec4 color = baseColor;
+#endif
+#ifdef RS_LIT
+    color.rgb = shade(color.rgb);
+#endif
+#ifdef RS_FOG
+    float visibility = clamp(exp(-fogDensity * ViewDepth), 0.0, 1.0);
+    color.rgb = mix(fogColor, color.rgb, visibility);
+#endif
+    FragColor = color;
+}
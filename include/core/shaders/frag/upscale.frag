@@ -0,0 +1,41 @@
+#version 420 core
+// Stretches the dynamic resolution target over the output, see
+// RS::DynamicResolution. Bilinear, plus a light sharpen against the blur
+// bilinear adds when the scale is low.
+out vec4 FragColor;
+
+in vec2 TexCoord;
+
+layout (binding = 0) uniform sampler2D source;
+// Part of the source that was rendered to, in texture coordinates
+uniform vec2 uvScale;
+// Centers of the first and last rendered texel, so filtering never pulls
+// in the stale area around the rendered part
+uniform vec2 uvMin;
+uniform vec2 uvMax;
+// Source texel size
+uniform vec2 texelSize;
+// 0 is plain bilinear
+uniform float sharpness;
+
+vec3 fetch(vec2 uv)
+{
+    return texture(source, clamp(uv, uvMin, uvMax)).rgb;
+}
+
+void main()
+{
+    vec2 uv = TexCoord * uvScale;
+    vec3 center = fetch(uv);
+    if (sharpness <= 0.0) {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    vec3 neighbours = fetch(uv + vec2(texelSize.x, 0.0)) +
+                      fetch(uv - vec2(texelSize.x, 0.0)) +
+                      fetch(uv + vec2(0.0, texelSize.y)) +
+                      fetch(uv - vec2(0.0, texelSize.y));
+    vec3 sharpened = center + (center * 4.0 - neighbours) * sharpness * 0.25;
+    FragColor = vec4(clamp(sharpened, 0.0, 1.0), 1.0);
+}
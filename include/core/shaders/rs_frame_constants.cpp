@@ -0,0 +1,26 @@
+#include "rs_frame_constants.h"
+#include "shader.hpp"
+#include <GLES3/gl3.h>
+
+::RS::FrameConstantsBuffer::~FrameConstantsBuffer() {
+  if (_ubo != 0) {
+    glDeleteBuffers(1, &_ubo);
+  };
+};
+
+void ::RS::FrameConstantsBuffer::init() {
+  if (_ubo != 0) {
+    return;
+  };
+
+  glGenBuffers(1, &_ubo);
+  glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL,
+               GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, _ubo);
+};
+
+void ::RS::FrameConstantsBuffer::upload(const FrameConstants &constants) {
+  glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &constants);
+};
@@ -0,0 +1,40 @@
+#ifndef RS_FRAME_CONSTANTS_H
+#define RS_FRAME_CONSTANTS_H
+
+#include <GLES3/gl3.h>
+#include <glm/glm.hpp>
+
+namespace RS {
+// Mirrors the std140 FrameConstants block in main.vert. Only mat4/vec4
+// members keep the C++ and std140 layouts identical, pad anything else.
+struct FrameConstants {
+  glm::mat4 view;
+  glm::mat4 projection;
+};
+
+// Uniform buffer holding FrameConstants, bound once at
+// FRAME_CONSTANTS_BINDING so every program that declares the block sees the
+// same camera without per program uniform calls.
+class FrameConstantsBuffer {
+public:
+  // Constructor
+  FrameConstantsBuffer() { _ubo = 0; };
+
+  FrameConstantsBuffer(const FrameConstantsBuffer &) = delete;
+  FrameConstantsBuffer &operator=(const FrameConstantsBuffer &) = delete;
+
+  // Deconstructor
+  ~FrameConstantsBuffer();
+
+  // Needs a current GL context
+  void init();
+
+  // One upload per frame
+  void upload(const FrameConstants &constants);
+
+private:
+  GLuint _ubo;
+};
+} // namespace RS
+
+#endif // !RS_FRAME_CONSTANTS_H
@@ -0,0 +1,463 @@
+#include "rs_shader_cache.h"
+#include "rs_gl.h"
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+typedef void (*MaxShaderCompilerThreadsFn)(GLuint count);
+
+const u_int32_t BINARY_MAGIC = 0x42505352; // "RSPB"
+const u_int32_t BINARY_VERSION = 1;
+
+struct BinaryHeader {
+  u_int32_t magic;
+  u_int32_t version;
+  u_int32_t format;
+  u_int32_t length;
+  u_int64_t key;
+};
+
+u_int64_t fnv1a(u_int64_t hash, const std::string &text) {
+  for (unsigned char c : text) {
+    hash = (hash ^ c) * 1099511628211ull;
+  };
+  return hash;
+};
+
+std::string glString(GLenum name) {
+  const GLubyte *value = glGetString(name);
+  return value == NULL ? std::string() : std::string((const char *)value);
+};
+} // namespace
+
+::RS::ShaderCache::ShaderCache(const char *cacheDirectory,
+                               SDL_Window *window)
+    : _request_pool(64, MEM_RENDER) {
+  _cache_directory = cacheDirectory;
+  _worker_window = NULL;
+  _worker_context = NULL;
+  _worker_running = false;
+  _stats = {};
+
+  std::error_code error;
+  std::filesystem::create_directories(_cache_directory, error);
+  if (error) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "SHADER CACHE DIRECTORY %s COULD NOT BE CREATED: %s\n",
+                 cacheDirectory, error.message().c_str());
+  };
+
+  _driver_id = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" +
+               glString(GL_VERSION);
+
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  _binary_supported = formats > 0;
+
+  // Prefer letting the driver compile on its own threads
+  MaxShaderCompilerThreadsFn maxThreads = NULL;
+  if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+    maxThreads = (MaxShaderCompilerThreadsFn)SDL_GL_GetProcAddress(
+        "glMaxShaderCompilerThreadsKHR");
+  } else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile")) {
+    maxThreads = (MaxShaderCompilerThreadsFn)SDL_GL_GetProcAddress(
+        "glMaxShaderCompilerThreadsARB");
+  };
+  _parallel_compile = maxThreads != NULL;
+  if (_parallel_compile) {
+    maxThreads(0xFFFFFFFFu); // Let the driver pick
+  } else if (window != NULL) {
+    startWorker(window);
+  };
+  _stats.parallelCompile = _parallel_compile;
+};
+
+::RS::ShaderCache::~ShaderCache() {
+  if (_worker_running) {
+    {
+      std::lock_guard<std::mutex> lock(_worker_mutex);
+      _worker_running = false;
+    }
+    _worker_wake.notify_all();
+    _worker.join();
+  };
+
+  if (_worker_context != NULL) {
+    SDL_GL_DestroyContext(_worker_context);
+  };
+  if (_worker_window != NULL) {
+    SDL_DestroyWindow(_worker_window);
+  };
+
+  // Ready programs belong to whoever took them with getProgram()
+  for (Request *request : _requests) {
+    int state = request->state.load();
+    if (state != REQUEST_READY && request->program != 0) {
+      glDeleteProgram(request->program);
+    };
+    _request_pool.destroy(request);
+  };
+};
+
+bool ::RS::ShaderCache::readFile(const char *path, std::string &out) {
+  FILE *file = std::fopen(path, "rb");
+  if (file == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SHADER FILE %s COULD NOT BE READ\n",
+                 path);
+    return false;
+  };
+
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fseek(file, 0, SEEK_SET);
+
+  out.resize(size > 0 ? (size_t)size : 0);
+  size_t read = out.empty() ? 0 : std::fread(&out[0], 1, out.size(), file);
+  std::fclose(file);
+  return read == out.size();
+};
+
+::RS::ProgramRequest RS::ShaderCache::requestProgram(const char *vertexPath,
+                                                     const char *fragmentPath) {
+  std::string vertexSource;
+  std::string fragmentSource;
+  readFile(vertexPath, vertexSource);
+  readFile(fragmentPath, fragmentSource);
+  return requestProgramFromSource(vertexSource, fragmentSource);
+};
+
+::RS::ProgramRequest
+RS::ShaderCache::requestProgramFromSource(const std::string &vertexSource,
+                                          const std::string &fragmentSource) {
+  Request *request = _request_pool.create();
+  request->key = programKey(vertexSource, fragmentSource);
+  request->program = 0;
+  request->state.store(REQUEST_COMPILING);
+
+  ProgramRequest handle = (ProgramRequest)_requests.size();
+  _requests.push_back(request);
+
+  // Warm path
+  if (_binary_supported) {
+    GLuint program = glCreateProgram();
+    if (loadBinary(request->key, program)) {
+      request->program = program;
+      request->state.store(REQUEST_READY);
+      _stats.binaryHits++;
+      return handle;
+    }
+    glDeleteProgram(program);
+  };
+  _stats.binaryMisses++;
+
+  if (_parallel_compile) {
+    request->program = buildProgram(vertexSource, fragmentSource);
+    return handle;
+  };
+
+  if (_worker_running) {
+    request->vertexSource = vertexSource;
+    request->fragmentSource = fragmentSource;
+    request->state.store(REQUEST_QUEUED);
+    {
+      std::lock_guard<std::mutex> lock(_worker_mutex);
+      _worker_queue.push_back(request);
+    }
+    _worker_wake.notify_one();
+    return handle;
+  };
+
+  // No way to compile in the background
+  request->program = buildProgram(vertexSource, fragmentSource);
+  finishRequest(request);
+  return handle;
+};
+
+void ::RS::ShaderCache::poll() {
+  for (Request *request : _requests) {
+    int state = request->state.load(std::memory_order_acquire);
+    if (state == REQUEST_COMPILING) {
+      GLint done = 0;
+      glGetProgramiv(request->program, GL_COMPLETION_STATUS_KHR, &done);
+      if (done) {
+        finishRequest(request);
+      }
+    } else if (state == REQUEST_LINKED) {
+      finishRequest(request);
+    }
+  };
+};
+
+void ::RS::ShaderCache::waitAll() {
+  for (;;) {
+    poll();
+
+    bool pending = false;
+    for (Request *request : _requests) {
+      int state = request->state.load(std::memory_order_acquire);
+      if (state != REQUEST_READY && state != REQUEST_FAILED) {
+        pending = true;
+        break;
+      }
+    };
+    if (!pending) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  };
+};
+
+bool ::RS::ShaderCache::isReady(ProgramRequest request) const {
+  return request < _requests.size() &&
+         _requests[request]->state.load() == REQUEST_READY;
+};
+
+bool ::RS::ShaderCache::hasFailed(ProgramRequest request) const {
+  return request >= _requests.size() ||
+         _requests[request]->state.load() == REQUEST_FAILED;
+};
+
+GLuint RS::ShaderCache::getProgram(ProgramRequest request) const {
+  return isReady(request) ? _requests[request]->program : 0;
+};
+
+u_int64_t RS::ShaderCache::programKey(const std::string &vertexSource,
+                                      const std::string &fragmentSource) const {
+  u_int64_t hash = 14695981039346656037ull;
+  hash = fnv1a(hash, _driver_id);
+  hash = fnv1a(hash, vertexSource);
+  // Separator so moving text between stages changes the key
+  hash = fnv1a(hash, std::string(1, '\0'));
+  hash = fnv1a(hash, fragmentSource);
+  return hash;
+};
+
+std::string RS::ShaderCache::binaryPath(u_int64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+  return _cache_directory + "/" + name;
+};
+
+bool ::RS::ShaderCache::loadBinary(u_int64_t key, GLuint program) {
+  FILE *file = std::fopen(binaryPath(key).c_str(), "rb");
+  if (file == NULL) {
+    return false;
+  };
+
+  BinaryHeader header;
+  std::vector<char> binary;
+  bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+               header.magic == BINARY_MAGIC &&
+               header.version == BINARY_VERSION && header.key == key;
+  if (valid) {
+    binary.resize(header.length);
+    valid = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+  };
+  std::fclose(file);
+  if (!valid) {
+    return false;
+  };
+
+  glProgramBinary(program, header.format, binary.data(),
+                  (GLsizei)binary.size());
+
+  // A driver update invalidates old binaries, that is a miss not an error
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  return linked == GL_TRUE;
+};
+
+void ::RS::ShaderCache::storeBinary(u_int64_t key, GLuint program) {
+  if (!_binary_supported) {
+    return;
+  };
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  };
+
+  std::vector<char> binary(length);
+  BinaryHeader header;
+  GLenum format = 0;
+  glGetProgramBinary(program, length, NULL, &format, binary.data());
+  header.magic = BINARY_MAGIC;
+  header.version = BINARY_VERSION;
+  header.format = format;
+  header.length = (u_int32_t)length;
+  header.key = key;
+
+  // Write next to the final file and rename so a crash never leaves a
+  // truncated binary behind
+  std::string path = binaryPath(key);
+  std::string temporary = path + ".tmp";
+  FILE *file = std::fopen(temporary.c_str(), "wb");
+  if (file == NULL) {
+    return;
+  };
+  bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 std::fwrite(binary.data(), 1, binary.size(), file) ==
+                     binary.size();
+  written = std::fclose(file) == 0 && written;
+  if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+  };
+};
+
+GLuint RS::ShaderCache::buildProgram(const std::string &vertexSource,
+                                     const std::string &fragmentSource) {
+  const char *vertexCode = vertexSource.c_str();
+  const char *fragmentCode = fragmentSource.c_str();
+
+  GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vertex, 1, &vertexCode, NULL);
+  glCompileShader(vertex);
+
+  GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(fragment, 1, &fragmentCode, NULL);
+  glCompileShader(fragment);
+
+  // Status queries would block, they happen in finishRequest()
+  GLuint program = glCreateProgram();
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glAttachShader(program, vertex);
+  glAttachShader(program, fragment);
+  glLinkProgram(program);
+
+  // Only flagged, the program keeps them alive while attached
+  glDeleteShader(vertex);
+  glDeleteShader(fragment);
+  return program;
+};
+
+GLuint RS::ShaderCache::buildComputeProgram(const char *path) {
+  std::string source;
+  if (!readFile(path, source)) {
+    return 0;
+  };
+
+  const char *text = source.c_str();
+  GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+  glShaderSource(shader, 1, &text, NULL);
+  glCompileShader(shader);
+  if (!checkStatus(shader, false)) {
+    glDeleteShader(shader);
+    return 0;
+  };
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, shader);
+  glLinkProgram(program);
+  glDeleteShader(shader);
+  if (!checkStatus(program, true)) {
+    glDeleteProgram(program);
+    return 0;
+  };
+  return program;
+};
+
+bool ::RS::ShaderCache::checkStatus(GLuint program, bool isProgram) {
+  GLint success = GL_FALSE;
+  char infoLog[1024];
+  if (isProgram) {
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+      glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+    }
+  } else {
+    glGetShaderiv(program, GL_COMPILE_STATUS, &success);
+    if (!success) {
+      glGetShaderInfoLog(program, sizeof(infoLog), NULL, infoLog);
+    }
+  };
+
+  if (!success) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "SHADER %s FAILED:\n%s\n",
+                 isProgram ? "LINKING" : "COMPILATION", infoLog);
+  };
+  return success == GL_TRUE;
+};
+
+void ::RS::ShaderCache::finishRequest(Request *request) {
+  request->vertexSource.clear();
+  request->fragmentSource.clear();
+
+  if (!checkStatus(request->program, true)) {
+    glDeleteProgram(request->program);
+    request->program = 0;
+    request->state.store(REQUEST_FAILED);
+    _stats.failures++;
+    return;
+  };
+
+  storeBinary(request->key, request->program);
+  request->state.store(REQUEST_READY);
+};
+
+bool ::RS::ShaderCache::startWorker(SDL_Window *window) {
+  SDL_GLContext mainContext = SDL_GL_GetCurrentContext();
+
+  // The worker needs a surface of its own to make its context current
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+  _worker_window =
+      SDL_CreateWindow("", 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (_worker_window != NULL) {
+    _worker_context = SDL_GL_CreateContext(_worker_window);
+  };
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+
+  // Creating a context makes it current, give the main thread its own back
+  SDL_GL_MakeCurrent(window, mainContext);
+
+  if (_worker_context == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "SHADER WORKER CONTEXT COULD NOT BE CREATED: %s\n",
+                 SDL_GetError());
+    return false;
+  };
+
+  _worker_running = true;
+  _worker = std::thread(&ShaderCache::workerLoop, this);
+  return true;
+};
+
+void ::RS::ShaderCache::workerLoop() {
+  SDL_GL_MakeCurrent(_worker_window, _worker_context);
+
+  for (;;) {
+    Request *request = NULL;
+    {
+      std::unique_lock<std::mutex> lock(_worker_mutex);
+      _worker_wake.wait(lock, [this]() {
+        return !_worker_running || !_worker_queue.empty();
+      });
+      if (!_worker_running) {
+        break;
+      }
+      request = _worker_queue.front();
+      _worker_queue.pop_front();
+    }
+
+    request->program =
+        buildProgram(request->vertexSource, request->fragmentSource);
+    // Make the finished program visible to the main context
+    glFinish();
+    request->state.store(REQUEST_LINKED, std::memory_order_release);
+  };
+
+  SDL_GL_MakeCurrent(_worker_window, NULL);
+};
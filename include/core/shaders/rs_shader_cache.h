@@ -0,0 +1,128 @@
+#ifndef RS_SHADER_CACHE_H
+#define RS_SHADER_CACHE_H
+
+#include "rs_gl.h"
+#include "rs_object_pool.h"
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace RS {
+typedef u_int ProgramRequest;
+
+struct ShaderCacheStats {
+  u_int binaryHits;   // Programs restored with glProgramBinary
+  u_int binaryMisses; // Programs that had to be compiled
+  u_int failures;
+  bool parallelCompile; // GL_KHR_parallel_shader_compile in use
+};
+
+// Builds shader programs without blocking the frame.
+//
+// Every program is keyed by a hash of its sources and the driver
+// (GL_VENDOR, GL_RENDERER, GL_VERSION). A warm start restores the linked
+// binary from <cacheDirectory>/<key>.bin and skips compilation. Cold
+// programs are compiled through GL_KHR_parallel_shader_compile when the
+// driver has it, otherwise on a worker thread that owns a context shared
+// with the main one. New binaries are written back once they link.
+//
+// All calls except the worker's own work happen on the thread that owns
+// the main GL context.
+class ShaderCache {
+public:
+  // Constructor
+  // window is the main window, used to create the worker's shared context
+  ShaderCache(const char *cacheDirectory, SDL_Window *window);
+
+  ShaderCache(const ShaderCache &) = delete;
+  ShaderCache &operator=(const ShaderCache &) = delete;
+
+  // Deconstructor
+  ~ShaderCache();
+
+  ProgramRequest requestProgram(const char *vertexPath,
+                                const char *fragmentPath);
+  ProgramRequest requestProgramFromSource(const std::string &vertexSource,
+                                          const std::string &fragmentSource);
+
+  // Finishes whatever compiled since the last call, once per frame
+  void poll();
+
+  // Blocks until every request is ready or failed
+  void waitAll();
+
+  bool isReady(ProgramRequest request) const;
+  bool hasFailed(ProgramRequest request) const;
+
+  // 0 until the request is ready
+  GLuint getProgram(ProgramRequest request) const;
+
+  inline const ShaderCacheStats &getStats() const { return _stats; };
+
+  static bool readFile(const char *path, std::string &out);
+
+  // Compiles and links a compute shader right away, 0 on failure. These
+  // are few and small, they do not go through the cache.
+  static GLuint buildComputeProgram(const char *path);
+
+private:
+  enum RequestState {
+    REQUEST_COMPILING, // Parallel compile in flight on the driver
+    REQUEST_QUEUED,    // Waiting for or running on the worker
+    REQUEST_LINKED,    // Worker is done, main thread still has to finish it
+    REQUEST_READY,
+    REQUEST_FAILED
+  };
+
+  struct Request {
+    u_int64_t key;
+    std::string vertexSource;
+    std::string fragmentSource;
+    GLuint program;
+    std::atomic<int> state;
+  };
+
+  u_int64_t programKey(const std::string &vertexSource,
+                       const std::string &fragmentSource) const;
+  std::string binaryPath(u_int64_t key) const;
+  bool loadBinary(u_int64_t key, GLuint program);
+  void storeBinary(u_int64_t key, GLuint program);
+
+  // Compiles and links, blocking only if the driver does not compile in
+  // the background
+  static GLuint buildProgram(const std::string &vertexSource,
+                             const std::string &fragmentSource);
+  static bool checkStatus(GLuint object, bool program);
+  void finishRequest(Request *request);
+
+  bool startWorker(SDL_Window *window);
+  void workerLoop();
+
+  std::string _cache_directory;
+  std::string _driver_id;
+  bool _parallel_compile;
+  bool _binary_supported;
+  ShaderCacheStats _stats;
+
+  ObjectPool<Request> _request_pool;
+  std::vector<Request *> _requests;
+
+  // Shared context fallback
+  SDL_Window *_worker_window;
+  SDL_GLContext _worker_context;
+  std::thread _worker;
+  std::mutex _worker_mutex;
+  std::condition_variable _worker_wake;
+  std::deque<Request *> _worker_queue;
+  bool _worker_running;
+};
+} // namespace RS
+
+#endif // !RS_SHADER_CACHE_H
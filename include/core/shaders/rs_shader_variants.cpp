@@ -0,0 +1,252 @@
+#include "rs_shader_variants.h"
+#include "rs_shader_cache.h"
+#include <SDL3/SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace {
+const RS::ProgramRequest NO_REQUEST = 0xFFFFFFFFu;
+const char *const FEATURE_PRAGMA = "#pragma rs_feature";
+
+// Features named by the source's "#pragma rs_feature" lines
+RS::ShaderVariantKey declaredFeatures(const std::string &source,
+                                      const char *path) {
+  RS::ShaderVariantKey key = 0;
+  const size_t pragmaLength = std::strlen(FEATURE_PRAGMA);
+  size_t line = 0;
+  while (line < source.size()) {
+    size_t end = source.find('\n', line);
+    if (end == std::string::npos) {
+      end = source.size();
+    };
+
+    if (source.compare(line, pragmaLength, FEATURE_PRAGMA) == 0) {
+      std::string names =
+          source.substr(line + pragmaLength, end - line - pragmaLength);
+      RS::ShaderVariantKey declared = 0;
+      if (!RS::parseShaderFeatures(names.c_str(), declared)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "UNKNOWN SHADER FEATURE IN %s\n",
+                     path);
+      };
+      key |= declared;
+    };
+    line = end + 1;
+  };
+  return key;
+};
+} // namespace
+
+bool ::RS::parseShaderFeatures(const char *names, ShaderVariantKey &out) {
+  out = 0;
+  bool known = true;
+  char name[64];
+  int consumed = 0;
+  while (std::sscanf(names, " %63s%n", name, &consumed) == 1) {
+    names += consumed;
+    u_int feature = 0;
+    while (feature < RS_SHADER_FEATURE_COUNT &&
+           std::strcmp(name, RS_SHADER_FEATURE_NAMES[feature]) != 0) {
+      feature++;
+    };
+    if (feature == RS_SHADER_FEATURE_COUNT) {
+      known = false;
+      continue;
+    };
+    out |= 1u << feature;
+  };
+  return known;
+};
+
+::RS::ShaderPermutations::ShaderPermutations(ShaderCache *cache) {
+  _cache = cache;
+  _supported = 0;
+  for (u_int i = 0; i < RS_SHADER_VARIANTS; i++) {
+    _requested[i] = false;
+    _requests[i] = NO_REQUEST;
+    _programs[i] = 0;
+  };
+};
+
+::RS::ShaderPermutations::~ShaderPermutations() {
+  for (u_int i = 0; i < RS_SHADER_VARIANTS; i++) {
+    // Ready but never fetched still belongs to us
+    GLuint program = _programs[i];
+    if (program == 0 && _requested[i] && _cache->isReady(_requests[i])) {
+      program = _cache->getProgram(_requests[i]);
+    };
+    if (program != 0) {
+      glDeleteProgram(program);
+    };
+  };
+};
+
+bool ::RS::ShaderPermutations::load(const char *vertexPath,
+                                    const char *fragmentPath) {
+  if (!ShaderCache::readFile(vertexPath, _vertex_source) ||
+      !ShaderCache::readFile(fragmentPath, _fragment_source)) {
+    return false;
+  };
+  _vertex_path = vertexPath;
+  _fragment_path = fragmentPath;
+  _supported = declaredFeatures(_vertex_source, vertexPath) |
+               declaredFeatures(_fragment_source, fragmentPath);
+  return true;
+};
+
+::RS::ProgramRequest RS::ShaderPermutations::request(ShaderVariantKey key) {
+  key &= _supported;
+  if (_requested[key]) {
+    return _requests[key];
+  };
+
+  _requested[key] = true;
+  _requests[key] = _cache->requestProgramFromSource(
+      composeSource(_vertex_source, key), composeSource(_fragment_source, key));
+  return _requests[key];
+};
+
+GLuint RS::ShaderPermutations::finishProgram(ShaderVariantKey key) {
+  ProgramRequest handle = request(key);
+  _programs[key] = _cache->getProgram(handle);
+  return _programs[key];
+};
+
+void ::RS::ShaderPermutations::getRequested(
+    std::vector<ShaderVariantKey> &out) const {
+  for (u_int i = 0; i < RS_SHADER_VARIANTS; i++) {
+    if (_requested[i]) {
+      out.push_back(i);
+    };
+  };
+};
+
+std::string RS::ShaderPermutations::composeSource(const std::string &source,
+                                                  ShaderVariantKey key) {
+  // Nothing but comments may come before #version, so the defines go
+  // right after its line, wherever that is
+  size_t body = 0;
+  u_int line = 1;
+  for (size_t start = 0; start < source.size(); line++) {
+    size_t end = source.find('\n', start);
+    end = end == std::string::npos ? source.size() : end + 1;
+    const size_t first = source.find_first_not_of(" \t", start);
+    if (first < end && source.compare(first, 8, "#version") == 0) {
+      body = end;
+      break;
+    };
+    start = end;
+  };
+
+  std::string composed = source.substr(0, body);
+  if (body > 0 && composed.back() != '\n') {
+    composed += '\n';
+  };
+  for (u_int feature = 0; feature < RS_SHADER_FEATURE_COUNT; feature++) {
+    if ((key & (1u << feature)) != 0) {
+      composed += "#define RS_";
+      composed += RS_SHADER_FEATURE_NAMES[feature];
+      composed += " 1\n";
+    };
+  };
+  // Keep compiler errors on the line numbers of the file
+  composed += "#line ";
+  composed += std::to_string(body == 0 ? 1 : line + 1);
+  composed += '\n';
+  composed.append(source, body, std::string::npos);
+  return composed;
+};
+
+::RS::ShaderLibrary::ShaderLibrary(ShaderCache *cache) { _cache = cache; };
+
+::RS::ShaderLibrary::~ShaderLibrary() {
+  for (ShaderPermutations *shader : _shaders) {
+    delete shader;
+  };
+};
+
+::RS::ShaderPermutations *RS::ShaderLibrary::load(const char *vertexPath,
+                                                  const char *fragmentPath) {
+  for (ShaderPermutations *shader : _shaders) {
+    if (shader->getVertexPath() == vertexPath &&
+        shader->getFragmentPath() == fragmentPath) {
+      return shader;
+    };
+  };
+
+  ShaderPermutations *shader = new ShaderPermutations(_cache);
+  if (!shader->load(vertexPath, fragmentPath)) {
+    delete shader;
+    return NULL;
+  };
+  _shaders.push_back(shader);
+  return shader;
+};
+
+bool ::RS::ShaderLibrary::precompile(const char *manifestPath) {
+  std::string manifest;
+  if (!ShaderCache::readFile(manifestPath, manifest)) {
+    return false;
+  };
+
+  bool valid = true;
+  size_t line = 0;
+  while (line < manifest.size()) {
+    size_t end = manifest.find('\n', line);
+    if (end == std::string::npos) {
+      end = manifest.size();
+    };
+    std::string text = manifest.substr(line, end - line);
+    line = end + 1;
+
+    char vertexPath[512];
+    char fragmentPath[512];
+    int consumed = 0;
+    if (std::sscanf(text.c_str(), " %511s %511s%n", vertexPath, fragmentPath,
+                    &consumed) != 2) {
+      // Blank lines are fine
+      valid = valid && text.find_first_not_of(" \t\r") == std::string::npos;
+      continue;
+    };
+
+    ShaderVariantKey key = 0;
+    ShaderPermutations *shader = load(vertexPath, fragmentPath);
+    if (shader == NULL ||
+        !parseShaderFeatures(text.c_str() + consumed, key)) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "BAD SHADER MANIFEST LINE: %s\n",
+                   text.c_str());
+      valid = false;
+      continue;
+    };
+    shader->request(key);
+  };
+  return valid;
+};
+
+bool ::RS::ShaderLibrary::writeManifest(const char *manifestPath) const {
+  FILE *file = std::fopen(manifestPath, "w");
+  if (file == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "SHADER MANIFEST %s COULD NOT BE WRITTEN\n", manifestPath);
+    return false;
+  };
+
+  std::vector<ShaderVariantKey> keys;
+  for (const ShaderPermutations *shader : _shaders) {
+    keys.clear();
+    shader->getRequested(keys);
+    for (ShaderVariantKey key : keys) {
+      std::fprintf(file, "%s %s", shader->getVertexPath().c_str(),
+                   shader->getFragmentPath().c_str());
+      for (u_int feature = 0; feature < RS_SHADER_FEATURE_COUNT; feature++) {
+        if ((key & (1u << feature)) != 0) {
+          std::fprintf(file, " %s", RS_SHADER_FEATURE_NAMES[feature]);
+        };
+      };
+      std::fprintf(file, "\n");
+    };
+  };
+  return std::fclose(file) == 0;
+};
@@ -0,0 +1,130 @@
+#ifndef RS_SHADER_VARIANTS_H
+#define RS_SHADER_VARIANTS_H
+
+#include "rs_gl.h"
+#include "rs_shader_cache.h"
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+// Compile time features of a shader. A source declares the ones it reacts
+// to with "#pragma rs_feature <NAME>" and tests them with #ifdef RS_<NAME>.
+typedef enum RS_SHADER_FEATURE {
+  RS_SHADER_INSTANCED = 1 << 0, // Model matrix per instance at location 2
+  RS_SHADER_TEXTURED = 1 << 1,  // texture1 instead of a flat baseColor
+  RS_SHADER_FOG = 1 << 2,       // Exponential fog by view depth
+  RS_SHADER_LIT = 1 << 3,       // Clustered point lights, rs_light_clusters.h
+} RS_SHADER_FEATURE;
+
+const u_int RS_SHADER_FEATURE_COUNT = 4;
+const u_int RS_SHADER_VARIANTS = 1 << RS_SHADER_FEATURE_COUNT;
+// Keyword of each feature bit
+const char *const RS_SHADER_FEATURE_NAMES[RS_SHADER_FEATURE_COUNT] = {
+    "INSTANCED", "TEXTURED", "FOG", "LIT"};
+
+// One bit per RS_SHADER_FEATURE
+typedef u_int32_t ShaderVariantKey;
+
+// Variant key built at compile time, e.g.
+// ShaderFeatures<RS_SHADER_TEXTURED, RS_SHADER_FOG>::key
+template <u_int32_t... Features> struct ShaderFeatures {
+  static constexpr ShaderVariantKey key = (0u | ... | Features);
+  static_assert(key < RS_SHADER_VARIANTS, "UNKNOWN SHADER FEATURE");
+};
+
+// Parses space separated keywords, returns false on an unknown one
+bool parseShaderFeatures(const char *names, ShaderVariantKey &out);
+
+// Every variant of one vertex/fragment pair. Each variant is the source
+// with a #define preamble, compiled once through the ShaderCache, so it
+// gets a binary of its own and warm starts skip compiling it. Features the
+// sources do not declare are masked off, variants that only differ in
+// those share a program.
+class ShaderPermutations {
+public:
+  // Constructor
+  ShaderPermutations(ShaderCache *cache);
+
+  ShaderPermutations(const ShaderPermutations &) = delete;
+  ShaderPermutations &operator=(const ShaderPermutations &) = delete;
+
+  // Deconstructor
+  ~ShaderPermutations();
+
+  // Reads both stages and the features they declare
+  bool load(const char *vertexPath, const char *fragmentPath);
+
+  // Starts building the variant unless that already happened
+  ProgramRequest request(ShaderVariantKey key);
+  // 0 until the variant is ready, requests it on first use. Ready variants
+  // are a table lookup.
+  inline GLuint getProgram(ShaderVariantKey key) {
+    GLuint program = _programs[key & _supported];
+    return program != 0 ? program : finishProgram(key & _supported);
+  };
+  template <u_int32_t... Features> inline GLuint getProgram() {
+    return getProgram(ShaderFeatures<Features...>::key);
+  };
+
+  inline ShaderVariantKey getSupported() const { return _supported; };
+  inline const std::string &getVertexPath() const { return _vertex_path; };
+  inline const std::string &getFragmentPath() const {
+    return _fragment_path;
+  };
+  // Variants requested so far
+  void getRequested(std::vector<ShaderVariantKey> &out) const;
+
+  // The source with a #define RS_<NAME> for every feature in key, right
+  // after the #version line
+  static std::string composeSource(const std::string &source,
+                                   ShaderVariantKey key);
+
+private:
+  GLuint finishProgram(ShaderVariantKey key);
+
+  ShaderCache *_cache;
+  std::string _vertex_path;
+  std::string _fragment_path;
+  std::string _vertex_source;
+  std::string _fragment_source;
+  ShaderVariantKey _supported;
+
+  bool _requested[RS_SHADER_VARIANTS];
+  ProgramRequest _requests[RS_SHADER_VARIANTS];
+  GLuint _programs[RS_SHADER_VARIANTS]; // 0 until ready, owned
+};
+
+// ShaderPermutations by path pair, and the manifest of variants a run
+// used so the next one can build them up front:
+//
+//   <vertex path> <fragment path> [FEATURE ...]
+//
+// one variant per line, paths must not contain spaces.
+class ShaderLibrary {
+public:
+  // Constructor
+  ShaderLibrary(ShaderCache *cache);
+
+  ShaderLibrary(const ShaderLibrary &) = delete;
+  ShaderLibrary &operator=(const ShaderLibrary &) = delete;
+
+  // Deconstructor
+  ~ShaderLibrary();
+
+  // Loads the pair the first time, NULL if it could not be read
+  ShaderPermutations *load(const char *vertexPath, const char *fragmentPath);
+
+  // Requests every variant in the manifest, returns false if it could not
+  // be read or had bad lines. The rest is still requested.
+  bool precompile(const char *manifestPath);
+  bool writeManifest(const char *manifestPath) const;
+
+private:
+  ShaderCache *_cache;
+  std::vector<ShaderPermutations *> _shaders;
+};
+} // namespace RS
+
+#endif // !RS_SHADER_VARIANTS_H
@@ -2,17 +2,34 @@
 #define SHADER_H
 
 #include <GLES3/gl3.h>
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <glm/glm.hpp>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
+
+// Uniform location as returned by Shader::getUniform(). -1 means the uniform
+// does not exist, GL silently ignores sets to it.
+typedef GLint UniformHandle;
+
+// Uniform block binding shared by every program, see rs_frame_constants.h
+const GLuint FRAME_CONSTANTS_BINDING = 0;
+const char *const FRAME_CONSTANTS_BLOCK = "FrameConstants";
 
 /**
  * This class was pulled from learnopengl.com
  * as a means to learn how loading shaders from their source files
  * could be achieved. This was not created by me and only some
  * variable names were changed for personal learning reasons.
+ *
+ * Active uniforms are reflected once after linking into a table sorted by
+ * name hash, so setting a uniform by name never calls glGetUniformLocation.
+ * Hot code should fetch a UniformHandle once with getUniform() and use the
+ * handle overloads.
  */
 
 class Shader {
@@ -76,60 +93,163 @@ public:
     // Delete shaders after linking because they are no longer needed
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    reflectUniforms();
   }
+  // Adopts a program that is already linked, e.g. one handed out by
+  // RS::ShaderCache
+  explicit Shader(unsigned int program) : ID(program) { reflectUniforms(); }
   void use() const { glUseProgram(ID); }
+  // Looks a uniform up in the reflected table, -1 if the program has none
+  UniformHandle getUniform(std::string_view name) const {
+    const uint32_t hash = hashName(name);
+    auto it = std::lower_bound(
+        uniforms.begin(), uniforms.end(), hash,
+        [](const UniformEntry &entry, uint32_t h) { return entry.hash < h; });
+    for (; it != uniforms.end() && it->hash == hash; ++it) {
+      if (it->name == name) {
+        return it->location;
+      }
+    }
+    return -1;
+  }
   // utility uniform functions
   // ------------------------------------------------------------------------
-  void setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+  void setBool(UniformHandle location, bool value) const {
+    glUniform1i(location, (int)value);
+  }
+  void setBool(std::string_view name, bool value) const {
+    setBool(getUniform(name), value);
   }
   // ------------------------------------------------------------------------
-  void setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+  void setInt(UniformHandle location, int value) const {
+    glUniform1i(location, value);
+  }
+  void setInt(std::string_view name, int value) const {
+    setInt(getUniform(name), value);
   }
   // ------------------------------------------------------------------------
-  void setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+  void setFloat(UniformHandle location, float value) const {
+    glUniform1f(location, value);
+  }
+  void setFloat(std::string_view name, float value) const {
+    setFloat(getUniform(name), value);
   }
   // ------------------------------------------------------------------------
-  void setVec2(const std::string &name, const glm::vec2 &value) const {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  void setVec2(UniformHandle location, const glm::vec2 &value) const {
+    glUniform2fv(location, 1, &value[0]);
+  }
+  void setVec2(std::string_view name, const glm::vec2 &value) const {
+    setVec2(getUniform(name), value);
   }
-  void setVec2(const std::string &name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+  void setVec2(std::string_view name, float x, float y) const {
+    glUniform2f(getUniform(name), x, y);
   }
   // ------------------------------------------------------------------------
-  void setVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  void setVec3(UniformHandle location, const glm::vec3 &value) const {
+    glUniform3fv(location, 1, &value[0]);
   }
-  void setVec3(const std::string &name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+  void setVec3(std::string_view name, const glm::vec3 &value) const {
+    setVec3(getUniform(name), value);
+  }
+  void setVec3(std::string_view name, float x, float y, float z) const {
+    glUniform3f(getUniform(name), x, y, z);
   }
   // ------------------------------------------------------------------------
-  void setVec4(const std::string &name, const glm::vec4 &value) const {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+  void setVec4(UniformHandle location, const glm::vec4 &value) const {
+    glUniform4fv(location, 1, &value[0]);
+  }
+  void setVec4(std::string_view name, const glm::vec4 &value) const {
+    setVec4(getUniform(name), value);
   }
-  void setVec4(const std::string &name, float x, float y, float z,
+  void setVec4(std::string_view name, float x, float y, float z,
                float w) const {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    glUniform4f(getUniform(name), x, y, z, w);
   }
   // ------------------------------------------------------------------------
-  void setMat2(const std::string &name, const glm::mat2 &mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                       &mat[0][0]);
+  void setMat2(UniformHandle location, const glm::mat2 &mat) const {
+    glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+  }
+  void setMat2(std::string_view name, const glm::mat2 &mat) const {
+    setMat2(getUniform(name), mat);
   }
   // ------------------------------------------------------------------------
-  void setMat3(const std::string &name, const glm::mat3 &mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                       &mat[0][0]);
+  void setMat3(UniformHandle location, const glm::mat3 &mat) const {
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+  }
+  void setMat3(std::string_view name, const glm::mat3 &mat) const {
+    setMat3(getUniform(name), mat);
   }
   // ------------------------------------------------------------------------
-  void setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                       &mat[0][0]);
+  void setMat4(UniformHandle location, const glm::mat4 &mat) const {
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+  }
+  void setMat4(std::string_view name, const glm::mat4 &mat) const {
+    setMat4(getUniform(name), mat);
   }
 
 private:
+  struct UniformEntry {
+    uint32_t hash;
+    GLint location;
+    std::string name;
+  };
+
+  // Sorted by hash
+  std::vector<UniformEntry> uniforms;
+
+  // FNV-1a, only used to order and find reflected uniform names
+  static uint32_t hashName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+      hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    return hash;
+  }
+
+  // Caches every active uniform's location and binds the shared per-frame
+  // uniform block if the program declares it
+  void reflectUniforms() {
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+    uniforms.clear();
+    uniforms.reserve(count);
+    for (GLint i = 0; i < count; i++) {
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length,
+                         &size, &type, nameBuffer.data());
+
+      std::string name(nameBuffer.data(), length);
+      GLint location = glGetUniformLocation(ID, name.c_str());
+      if (location < 0) {
+        continue; // Lives in a uniform block
+      }
+
+      // Arrays are reported as "name[0]", make "name" find them as well
+      if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+        std::string base = name.substr(0, name.size() - 3);
+        uniforms.push_back({hashName(base), location, base});
+      }
+      uniforms.push_back({hashName(name), location, name});
+    }
+
+    std::sort(uniforms.begin(), uniforms.end(),
+              [](const UniformEntry &a, const UniformEntry &b) {
+                return a.hash < b.hash;
+              });
+
+    GLuint block = glGetUniformBlockIndex(ID, FRAME_CONSTANTS_BLOCK);
+    if (block != GL_INVALID_INDEX) {
+      glUniformBlockBinding(ID, block, FRAME_CONSTANTS_BINDING);
+    }
+  }
+
   // utility function for checking shader compilation/linking errors.
   // ------------------------------------------------------------------------
   void checkCompileErrors(unsigned int shader, std::string type) {
@@ -0,0 +1,45 @@
+#version 330 core
+// Permutation source, compiled through RS::ShaderPermutations which puts a
+// #define RS_<FEATURE> in front for every feature of the variant
+#pragma rs_feature INSTANCED
+#pragma rs_feature FOG
+#pragma rs_feature LIT
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+#ifdef RS_INSTANCED
+// Per-instance model matrix, filled by RS::BatchRenderer. A mat4 attribute
+// takes locations 2 to 5.
+layout (location = 2) in mat4 aModel;
+#else
+uniform mat4 model;
+#endif
+
+out vec2 TexCoord;
+#ifdef RS_FOG
+out float ViewDepth;
+#endif
+#ifdef RS_LIT
+out vec3 ViewPosition;
+#endif
+
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+};
+
+void main()
+{
+#ifdef RS_INSTANCED
+    vec4 viewPosition = view * aModel * vec4(aPos, 1.0);
+#else
+    vec4 viewPosition = view * model * vec4(aPos, 1.0);
+#endif
+    gl_Position = projection * viewPosition;
+    TexCoord = aTexCoord;
+#ifdef RS_FOG
+    ViewDepth = -viewPosition.z;
+#endif
+#ifdef RS_LIT
+    ViewPosition = viewPosition.xyz;
+#endif
+}
@@ -0,0 +1,11 @@
+#version 330 core
+// One triangle over the whole viewport, drawn with no vertex buffer:
+// glDrawArrays(GL_TRIANGLES, 0, 3) with an empty vertex array bound
+out vec2 TexCoord;
+
+void main()
+{
+    vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    TexCoord = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
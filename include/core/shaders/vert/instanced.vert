@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+// Per-instance model matrix, filled by RS::BatchRenderer. A mat4 attribute
+// takes locations 2 to 5.
+layout (location = 2) in mat4 aModel;
+
+out vec2 TexCoord;
+
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+};
+
+void main()
+{
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+    TexCoord = aTexCoord;
+}
@@ -4,14 +4,18 @@ layout (location = 1) in vec2 aTexCoord; // the texture coord variable has attri
   
 out vec2 TexCoord;
 
+// Per-frame camera data shared by every program, uploaded once per frame
+// by RS::FrameConstantsBuffer at binding 0
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+};
+
 uniform mat4 transform;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
     gl_Position = projection * view * model * (transform * vec4(aPos, 1.0));
     TexCoord = vec2(aTexCoord.x, aTexCoord.y);
 }   
-
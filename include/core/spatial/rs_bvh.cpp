@@ -0,0 +1,647 @@
+#include "rs_bvh.h"
+#include "rs_culling.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <functional>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace {
+const u_int32_t RS_BVH_INTERNAL = 0xFFFFFFFFu;
+const int SAH_BINS = 16;
+// Below this many leaves rebuild() splits at the median instead
+const size_t SAH_MIN_LEAVES = 16;
+
+inline float distanceSquared(const glm::vec3 &point, const glm::vec3 &min,
+                             const glm::vec3 &max) {
+  glm::vec3 closest = glm::clamp(point, min, max);
+  glm::vec3 delta = point - closest;
+  return glm::dot(delta, delta);
+};
+
+// Slab test, returns the entry distance or -1 when missed
+inline float rayEntry(const glm::vec3 &origin, const glm::vec3 &inverse,
+                      const glm::vec3 &min, const glm::vec3 &max,
+                      float maxDistance) {
+  glm::vec3 t0 = (min - origin) * inverse;
+  glm::vec3 t1 = (max - origin) * inverse;
+  glm::vec3 near = glm::min(t0, t1);
+  glm::vec3 far = glm::max(t0, t1);
+  float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+  float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+  return entry <= exit ? entry : -1.0f;
+};
+} // namespace
+
+::RS::DynamicBVH::DynamicBVH(float margin, float displacementScale) {
+  _root = RS_NULL_PROXY;
+  _free_list = RS_NULL_PROXY;
+  _proxy_count = 0;
+  _margin = margin;
+  _displacement_scale = displacementScale;
+  _flat_dirty = true;
+};
+
+::RS::BVHProxy RS::DynamicBVH::createProxy(const AABB &bounds,
+                                           u_int32_t userData) {
+  int32_t proxy = allocateNode();
+  const glm::vec3 margin(_margin);
+  _nodes[proxy].bounds = {bounds.min - margin, bounds.max + margin};
+  _nodes[proxy].userData = userData;
+  _nodes[proxy].height = 0;
+  insertLeaf(proxy);
+  _proxy_count++;
+  return proxy;
+};
+
+void ::RS::DynamicBVH::destroyProxy(BVHProxy proxy) {
+  removeLeaf(proxy);
+  freeNode(proxy);
+  _proxy_count--;
+};
+
+bool ::RS::DynamicBVH::moveProxy(BVHProxy proxy, const AABB &bounds,
+                                 const glm::vec3 &displacement) {
+  if (_nodes[proxy].bounds.contains(bounds)) {
+    return false;
+  };
+
+  removeLeaf(proxy);
+
+  // Fatten, then stretch towards where the object is heading so it stays
+  // inside for a few more frames
+  const glm::vec3 margin(_margin);
+  AABB fat = {bounds.min - margin, bounds.max + margin};
+  glm::vec3 stretch = displacement * _displacement_scale;
+  fat.min += glm::min(stretch, glm::vec3(0.0f));
+  fat.max += glm::max(stretch, glm::vec3(0.0f));
+  _nodes[proxy].bounds = fat;
+
+  insertLeaf(proxy);
+  return true;
+};
+
+void ::RS::DynamicBVH::refitProxy(BVHProxy proxy, const AABB &bounds) {
+  _nodes[proxy].bounds = bounds;
+  refitFrom(_nodes[proxy].parent, false);
+  _flat_dirty = true;
+};
+
+void ::RS::DynamicBVH::rebuild() {
+  _leaves.clear();
+  for (size_t i = 0; i < _nodes.size(); i++) {
+    Node &node = _nodes[i];
+    if (node.height < 0) {
+      continue;
+    }
+    if (node.isLeaf()) {
+      _leaves.push_back((int32_t)i);
+    } else {
+      freeNode((int32_t)i);
+    }
+  };
+
+  _centroids.resize(_nodes.size());
+  for (int32_t leaf : _leaves) {
+    _centroids[leaf] = (_nodes[leaf].bounds.min + _nodes[leaf].bounds.max) * 0.5f;
+  };
+
+  _root = _leaves.empty() ? RS_NULL_PROXY
+                          : buildSAH(_leaves.data(), _leaves.size());
+  if (_root != RS_NULL_PROXY) {
+    _nodes[_root].parent = RS_NULL_PROXY;
+  };
+  _flat_dirty = true;
+};
+
+void ::RS::DynamicBVH::clear() {
+  _nodes.clear();
+  _root = RS_NULL_PROXY;
+  _free_list = RS_NULL_PROXY;
+  _proxy_count = 0;
+  _flat.clear();
+  _flat_dirty = true;
+};
+
+void ::RS::DynamicBVH::queryAABB(const AABB &bounds,
+                                 std::vector<u_int32_t> &out) {
+  flatten();
+  const u_int32_t count = (u_int32_t)_flat.size();
+  u_int32_t i = 0;
+  while (i < count) {
+    const FlatNode &node = _flat[i];
+    bool hit = node.min.x <= bounds.max.x && node.max.x >= bounds.min.x &&
+               node.min.y <= bounds.max.y && node.max.y >= bounds.min.y &&
+               node.min.z <= bounds.max.z && node.max.z >= bounds.min.z;
+    if (!hit) {
+      i = node.skip;
+      continue;
+    }
+    if (node.userData != RS_BVH_INTERNAL) {
+      out.push_back(node.userData);
+    }
+    i++;
+  };
+};
+
+void ::RS::DynamicBVH::queryFrustum(const Frustum &frustum,
+                                    std::vector<u_int32_t> &out) {
+  flatten();
+  glm::vec3 absNormals[6];
+  for (int p = 0; p < 6; p++) {
+    absNormals[p] = glm::abs(glm::vec3(frustum.planes[p]));
+  };
+
+  const u_int32_t count = (u_int32_t)_flat.size();
+  u_int32_t i = 0;
+  while (i < count) {
+    const FlatNode &node = _flat[i];
+    glm::vec3 center = (node.min + node.max) * 0.5f;
+    glm::vec3 extents = (node.max - node.min) * 0.5f;
+
+    bool outside = false;
+    bool inside = true;
+    for (int p = 0; p < 6; p++) {
+      float distance =
+          glm::dot(glm::vec3(frustum.planes[p]), center) + frustum.planes[p].w;
+      float reach = glm::dot(absNormals[p], extents);
+      if (distance < -reach) {
+        outside = true;
+        break;
+      }
+      inside = inside && distance >= reach;
+    }
+
+    if (outside) {
+      i = node.skip;
+    } else if (inside) {
+      // Whole subtree visible, take its leaves without testing
+      for (u_int32_t j = i; j < node.skip; j++) {
+        if (_flat[j].userData != RS_BVH_INTERNAL) {
+          out.push_back(_flat[j].userData);
+        }
+      }
+      i = node.skip;
+    } else {
+      if (node.userData != RS_BVH_INTERNAL) {
+        out.push_back(node.userData);
+      }
+      i++;
+    }
+  };
+};
+
+bool ::RS::DynamicBVH::raycast(const glm::vec3 &origin,
+                               const glm::vec3 &direction, float maxDistance,
+                               RayHit &hit) {
+  flatten();
+  // Division by zero gives infinities, which the slab test handles
+  const glm::vec3 inverse = 1.0f / direction;
+  float closest = maxDistance;
+  bool found = false;
+
+  const u_int32_t count = (u_int32_t)_flat.size();
+  u_int32_t i = 0;
+  while (i < count) {
+    const FlatNode &node = _flat[i];
+    float entry = rayEntry(origin, inverse, node.min, node.max, closest);
+    if (entry < 0.0f) {
+      i = node.skip;
+      continue;
+    }
+    if (node.userData != RS_BVH_INTERNAL) {
+      // Later leaves only count if they are closer
+      closest = entry;
+      hit.userData = node.userData;
+      hit.distance = entry;
+      found = true;
+    }
+    i++;
+  };
+  return found;
+};
+
+void ::RS::DynamicBVH::queryNearest(const glm::vec3 &point, size_t k,
+                                    std::vector<u_int32_t> &out) {
+  flatten();
+  if (_flat.empty() || k == 0) {
+    return;
+  };
+
+  // Best first: nodes ordered by distance to their bounds in a min heap,
+  // results kept in a max heap of the k best so far
+  std::vector<NearestEntry> &open = _open_heap;
+  std::vector<NearestEntry> &best = _best_heap;
+  open.clear();
+  best.clear();
+  const auto farther = std::greater<NearestEntry>();
+  open.push_back({distanceSquared(point, _flat[0].min, _flat[0].max), 0});
+
+  while (!open.empty()) {
+    std::pop_heap(open.begin(), open.end(), farther);
+    NearestEntry entry = open.back();
+    open.pop_back();
+    if (best.size() == k && entry.first >= best.front().first) {
+      break; // Nothing left can beat the current k
+    }
+
+    const FlatNode &node = _flat[entry.second];
+    if (node.userData != RS_BVH_INTERNAL) {
+      best.push_back({entry.first, node.userData});
+      std::push_heap(best.begin(), best.end());
+      if (best.size() > k) {
+        std::pop_heap(best.begin(), best.end());
+        best.pop_back();
+      }
+      continue;
+    }
+
+    const u_int32_t left = entry.second + 1;
+    const u_int32_t right = _flat[left].skip;
+    open.push_back(
+        {distanceSquared(point, _flat[left].min, _flat[left].max), left});
+    std::push_heap(open.begin(), open.end(), farther);
+    open.push_back(
+        {distanceSquared(point, _flat[right].min, _flat[right].max), right});
+    std::push_heap(open.begin(), open.end(), farther);
+  };
+
+  std::sort_heap(best.begin(), best.end());
+  for (const NearestEntry &entry : best) {
+    out.push_back(entry.second);
+  };
+};
+
+::RS::BVHStats RS::DynamicBVH::getStats() const {
+  BVHStats stats;
+  stats.proxies = _proxy_count;
+  stats.nodes = 0;
+  stats.height = _root == RS_NULL_PROXY ? 0 : (u_int)_nodes[_root].height;
+  float internalArea = 0.0f;
+  for (const Node &node : _nodes) {
+    if (node.height < 0) {
+      continue;
+    }
+    stats.nodes++;
+    if (!node.isLeaf()) {
+      internalArea += node.bounds.surfaceArea();
+    }
+  };
+  float rootArea =
+      _root == RS_NULL_PROXY ? 0.0f : _nodes[_root].bounds.surfaceArea();
+  stats.sahCost = rootArea > 0.0f ? internalArea / rootArea : 0.0f;
+  return stats;
+};
+
+int32_t RS::DynamicBVH::allocateNode() {
+  int32_t node = _free_list;
+  if (node == RS_NULL_PROXY) {
+    node = (int32_t)_nodes.size();
+    _nodes.emplace_back();
+  } else {
+    _free_list = _nodes[node].parent;
+  };
+
+  Node &allocated = _nodes[node];
+  allocated.parent = RS_NULL_PROXY;
+  allocated.child1 = RS_NULL_PROXY;
+  allocated.child2 = RS_NULL_PROXY;
+  allocated.height = 0;
+  allocated.userData = RS_BVH_INTERNAL;
+  return node;
+};
+
+void ::RS::DynamicBVH::freeNode(int32_t node) {
+  _nodes[node].parent = _free_list;
+  _nodes[node].height = -1;
+  _free_list = node;
+  _flat_dirty = true;
+};
+
+void ::RS::DynamicBVH::insertLeaf(int32_t leaf) {
+  _flat_dirty = true;
+  if (_root == RS_NULL_PROXY) {
+    _root = leaf;
+    _nodes[leaf].parent = RS_NULL_PROXY;
+    return;
+  };
+
+  // Walk down to the sibling that grows the total area the least. Going
+  // further down costs the area every ancestor has to grow by.
+  const AABB leafBounds = _nodes[leaf].bounds;
+  int32_t index = _root;
+  while (!_nodes[index].isLeaf()) {
+    const Node &node = _nodes[index];
+    float area = node.bounds.surfaceArea();
+    float combinedArea = mergeAABB(node.bounds, leafBounds).surfaceArea();
+
+    float cost = 2.0f * combinedArea;
+    float inheritance = 2.0f * (combinedArea - area);
+
+    float childCosts[2];
+    const int32_t children[2] = {node.child1, node.child2};
+    for (int c = 0; c < 2; c++) {
+      const Node &child = _nodes[children[c]];
+      float merged = mergeAABB(leafBounds, child.bounds).surfaceArea();
+      childCosts[c] = (child.isLeaf() ? merged
+                                      : merged - child.bounds.surfaceArea()) +
+                      inheritance;
+    }
+
+    if (cost < childCosts[0] && cost < childCosts[1]) {
+      break;
+    }
+    index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+  };
+
+  const int32_t sibling = index;
+  const int32_t oldParent = _nodes[sibling].parent;
+  const int32_t newParent = allocateNode();
+  _nodes[newParent].parent = oldParent;
+  _nodes[newParent].bounds = mergeAABB(leafBounds, _nodes[sibling].bounds);
+  _nodes[newParent].height = _nodes[sibling].height + 1;
+  _nodes[newParent].child1 = sibling;
+  _nodes[newParent].child2 = leaf;
+  _nodes[sibling].parent = newParent;
+  _nodes[leaf].parent = newParent;
+
+  if (oldParent == RS_NULL_PROXY) {
+    _root = newParent;
+  } else if (_nodes[oldParent].child1 == sibling) {
+    _nodes[oldParent].child1 = newParent;
+  } else {
+    _nodes[oldParent].child2 = newParent;
+  };
+
+  refitFrom(newParent, true);
+};
+
+void ::RS::DynamicBVH::removeLeaf(int32_t leaf) {
+  _flat_dirty = true;
+  if (leaf == _root) {
+    _root = RS_NULL_PROXY;
+    return;
+  };
+
+  const int32_t parent = _nodes[leaf].parent;
+  const int32_t grandParent = _nodes[parent].parent;
+  const int32_t sibling = _nodes[parent].child1 == leaf
+                              ? _nodes[parent].child2
+                              : _nodes[parent].child1;
+
+  // The parent goes away, the sibling takes its place
+  if (grandParent == RS_NULL_PROXY) {
+    _root = sibling;
+    _nodes[sibling].parent = RS_NULL_PROXY;
+    freeNode(parent);
+    return;
+  };
+
+  if (_nodes[grandParent].child1 == parent) {
+    _nodes[grandParent].child1 = sibling;
+  } else {
+    _nodes[grandParent].child2 = sibling;
+  };
+  _nodes[sibling].parent = grandParent;
+  freeNode(parent);
+  refitFrom(grandParent, true);
+};
+
+// Rotates the taller grandchild up when the children's heights differ by
+// more than one, returns the node now at this position
+int32_t RS::DynamicBVH::balance(int32_t a) {
+  Node *nodes = _nodes.data();
+  if (nodes[a].isLeaf() || nodes[a].height < 2) {
+    return a;
+  };
+
+  const int32_t b = nodes[a].child1;
+  const int32_t c = nodes[a].child2;
+  const int32_t difference = nodes[c].height - nodes[b].height;
+
+  if (difference > 1) {
+    // Rotate c up
+    const int32_t f = nodes[c].child1;
+    const int32_t g = nodes[c].child2;
+    nodes[c].child1 = a;
+    nodes[c].parent = nodes[a].parent;
+    nodes[a].parent = c;
+
+    const int32_t parent = nodes[c].parent;
+    if (parent == RS_NULL_PROXY) {
+      _root = c;
+    } else if (nodes[parent].child1 == a) {
+      nodes[parent].child1 = c;
+    } else {
+      nodes[parent].child2 = c;
+    }
+
+    // The taller of f and g stays under c
+    const int32_t keep = nodes[f].height > nodes[g].height ? f : g;
+    const int32_t move = keep == f ? g : f;
+    nodes[c].child2 = keep;
+    nodes[a].child2 = move;
+    nodes[move].parent = a;
+    nodes[a].bounds = mergeAABB(nodes[b].bounds, nodes[move].bounds);
+    nodes[c].bounds = mergeAABB(nodes[a].bounds, nodes[keep].bounds);
+    nodes[a].height = 1 + std::max(nodes[b].height, nodes[move].height);
+    nodes[c].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+    return c;
+  };
+
+  if (difference < -1) {
+    // Rotate b up
+    const int32_t d = nodes[b].child1;
+    const int32_t e = nodes[b].child2;
+    nodes[b].child1 = a;
+    nodes[b].parent = nodes[a].parent;
+    nodes[a].parent = b;
+
+    const int32_t parent = nodes[b].parent;
+    if (parent == RS_NULL_PROXY) {
+      _root = b;
+    } else if (nodes[parent].child1 == a) {
+      nodes[parent].child1 = b;
+    } else {
+      nodes[parent].child2 = b;
+    }
+
+    const int32_t keep = nodes[d].height > nodes[e].height ? d : e;
+    const int32_t move = keep == d ? e : d;
+    nodes[b].child2 = keep;
+    nodes[a].child1 = move;
+    nodes[move].parent = a;
+    nodes[a].bounds = mergeAABB(nodes[c].bounds, nodes[move].bounds);
+    nodes[b].bounds = mergeAABB(nodes[a].bounds, nodes[keep].bounds);
+    nodes[a].height = 1 + std::max(nodes[c].height, nodes[move].height);
+    nodes[b].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+    return b;
+  };
+
+  return a;
+};
+
+void ::RS::DynamicBVH::refitFrom(int32_t node, bool rebalance) {
+  while (node != RS_NULL_PROXY) {
+    if (rebalance) {
+      node = balance(node);
+    }
+    Node &current = _nodes[node];
+    const Node &child1 = _nodes[current.child1];
+    const Node &child2 = _nodes[current.child2];
+    current.height = 1 + std::max(child1.height, child2.height);
+    current.bounds = mergeAABB(child1.bounds, child2.bounds);
+    node = current.parent;
+  };
+};
+
+int32_t RS::DynamicBVH::buildSAH(int32_t *leaves, size_t count) {
+  if (count == 1) {
+    return leaves[0];
+  };
+
+  AABB centroidBounds = {_centroids[leaves[0]], _centroids[leaves[0]]};
+  for (size_t i = 1; i < count; i++) {
+    centroidBounds.min = glm::min(centroidBounds.min, _centroids[leaves[i]]);
+    centroidBounds.max = glm::max(centroidBounds.max, _centroids[leaves[i]]);
+  };
+
+  size_t middle = count / 2;
+  if (count <= SAH_MIN_LEAVES) {
+    // Binning costs more than it saves this close to the leaves, split
+    // at the median of the widest axis
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                   : (extent.y > extent.z ? 1 : 2);
+    std::nth_element(leaves, leaves + middle, leaves + count,
+                     [&](int32_t a, int32_t b) {
+                       return _centroids[a][axis] < _centroids[b][axis];
+                     });
+    return createParent(buildSAH(leaves, middle),
+                        buildSAH(leaves + middle, count - middle));
+  };
+
+  // Try every bin boundary on every axis, keep the cheapest
+  float bestCost = FLT_MAX;
+  int bestAxis = -1;
+  int bestSplit = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+    if (extent <= 0.0f) {
+      continue;
+    }
+    const float scale = SAH_BINS / extent;
+
+    AABB binBounds[SAH_BINS];
+    u_int binCounts[SAH_BINS] = {};
+    for (size_t i = 0; i < count; i++) {
+      int bin = (int)((_centroids[leaves[i]][axis] - centroidBounds.min[axis]) *
+                      scale);
+      bin = bin < SAH_BINS ? bin : SAH_BINS - 1;
+      const AABB &bounds = _nodes[leaves[i]].bounds;
+      binBounds[bin] = binCounts[bin] == 0 ? bounds
+                                           : mergeAABB(binBounds[bin], bounds);
+      binCounts[bin]++;
+    }
+
+    // Sweep from the right, then from the left
+    float rightAreas[SAH_BINS];
+    u_int rightCounts[SAH_BINS];
+    AABB accumulated = {};
+    u_int accumulatedCount = 0;
+    for (int bin = SAH_BINS - 1; bin > 0; bin--) {
+      if (binCounts[bin] > 0) {
+        accumulated = accumulatedCount == 0
+                          ? binBounds[bin]
+                          : mergeAABB(accumulated, binBounds[bin]);
+        accumulatedCount += binCounts[bin];
+      }
+      rightAreas[bin] = accumulatedCount > 0 ? accumulated.surfaceArea() : 0.0f;
+      rightCounts[bin] = accumulatedCount;
+    }
+
+    accumulatedCount = 0;
+    for (int split = 1; split < SAH_BINS; split++) {
+      const int bin = split - 1;
+      if (binCounts[bin] > 0) {
+        accumulated = accumulatedCount == 0
+                          ? binBounds[bin]
+                          : mergeAABB(accumulated, binBounds[bin]);
+        accumulatedCount += binCounts[bin];
+      }
+      if (accumulatedCount == 0 || rightCounts[split] == 0) {
+        continue;
+      }
+      float cost = accumulated.surfaceArea() * accumulatedCount +
+                   rightAreas[split] * rightCounts[split];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = split;
+      }
+    }
+  };
+
+  if (bestAxis >= 0) {
+    const float scale = SAH_BINS / (centroidBounds.max[bestAxis] -
+                                    centroidBounds.min[bestAxis]);
+    const float minimum = centroidBounds.min[bestAxis];
+    int32_t *partition =
+        std::partition(leaves, leaves + count, [&](int32_t leaf) {
+          int bin = (int)((_centroids[leaf][bestAxis] - minimum) * scale);
+          return (bin < SAH_BINS ? bin : SAH_BINS - 1) < bestSplit;
+        });
+    middle = (size_t)(partition - leaves);
+  };
+  if (middle == 0 || middle == count) {
+    middle = count / 2; // All centroids in one spot, any split will do
+  };
+
+  return createParent(buildSAH(leaves, middle),
+                      buildSAH(leaves + middle, count - middle));
+};
+
+int32_t RS::DynamicBVH::createParent(int32_t left, int32_t right) {
+  const int32_t node = allocateNode();
+  _nodes[node].child1 = left;
+  _nodes[node].child2 = right;
+  _nodes[node].bounds = mergeAABB(_nodes[left].bounds, _nodes[right].bounds);
+  _nodes[node].height = 1 + std::max(_nodes[left].height, _nodes[right].height);
+  _nodes[left].parent = node;
+  _nodes[right].parent = node;
+  return node;
+};
+
+void ::RS::DynamicBVH::flatten() {
+  if (!_flat_dirty) {
+    return;
+  };
+  _flat.clear();
+  _flat.reserve(_proxy_count * 2);
+  if (_root != RS_NULL_PROXY) {
+    flattenNode(_root);
+  };
+  _flat_dirty = false;
+};
+
+u_int32_t RS::DynamicBVH::flattenNode(int32_t node) {
+  const u_int32_t index = (u_int32_t)_flat.size();
+  const Node &source = _nodes[node];
+  FlatNode flat;
+  flat.min = source.bounds.min;
+  flat.max = source.bounds.max;
+  flat.userData = source.isLeaf() ? source.userData : RS_BVH_INTERNAL;
+  flat.skip = index + 1;
+  _flat.push_back(flat);
+
+  if (!source.isLeaf()) {
+    // Left child lands right after us, the right child after its subtree
+    const int32_t child2 = source.child2;
+    flattenNode(source.child1);
+    _flat[index].skip = flattenNode(child2);
+  };
+  return (u_int32_t)_flat.size();
+};
@@ -0,0 +1,169 @@
+#ifndef RS_BVH_H
+#define RS_BVH_H
+
+#include "rs_culling.h"
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace RS {
+struct AABB {
+  glm::vec3 min;
+  glm::vec3 max;
+
+  inline static AABB fromCenterExtents(const glm::vec3 &center,
+                                       const glm::vec3 &extents) {
+    return {center - extents, center + extents};
+  };
+
+  inline bool overlaps(const AABB &other) const {
+    return min.x <= other.max.x && max.x >= other.min.x &&
+           min.y <= other.max.y && max.y >= other.min.y &&
+           min.z <= other.max.z && max.z >= other.min.z;
+  };
+
+  inline bool contains(const AABB &other) const {
+    return min.x <= other.min.x && min.y <= other.min.y &&
+           min.z <= other.min.z && max.x >= other.max.x &&
+           max.y >= other.max.y && max.z >= other.max.z;
+  };
+
+  inline float surfaceArea() const {
+    glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  };
+};
+
+inline AABB mergeAABB(const AABB &a, const AABB &b) {
+  return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+};
+
+typedef int32_t BVHProxy;
+const BVHProxy RS_NULL_PROXY = -1;
+
+struct RayHit {
+  u_int32_t userData;
+  float distance; // Along the ray to the leaf's (fat) bounds
+};
+
+struct BVHStats {
+  u_int proxies;
+  u_int nodes;
+  u_int height;
+  float sahCost; // Sum of internal node areas over the root area, lower is
+                 // better
+};
+
+// Dynamic bounding volume hierarchy over object bounds, for culling,
+// picking and proximity queries.
+//
+// Leaves are proxies that keep their id for their whole life. Each stores
+// its bounds grown by a margin so small movements do not touch the tree at
+// all. Inserts pick their sibling by the surface area heuristic and rotate
+// the tree AVL style on the way up to stay balanced. After heavy churn
+// rebuild() rebuilds every internal node with a binned SAH sweep, and the
+// proxies survive it.
+//
+// Queries run over a flattened copy of the tree in depth first order. A
+// node's left child is the next entry and "skip" points past its subtree,
+// so traversal walks one array front to back. The copy is rebuilt lazily
+// by the first query after the tree changed.
+class DynamicBVH {
+public:
+  // Constructor
+  // margin fattens every leaf, displacementScale stretches it further in
+  // the direction of motion passed to moveProxy()
+  DynamicBVH(float margin = 0.1f, float displacementScale = 2.0f);
+
+  BVHProxy createProxy(const AABB &bounds, u_int32_t userData);
+  void destroyProxy(BVHProxy proxy);
+
+  // Reinserts the proxy if bounds left its fat bounds. Returns true when
+  // the tree changed.
+  bool moveProxy(BVHProxy proxy, const AABB &bounds,
+                 const glm::vec3 &displacement = glm::vec3(0.0f));
+
+  // Sets the leaf bounds as given and refits its ancestors without
+  // restructuring. Cheapest update, the tree quality degrades if objects
+  // travel far, rebuild() restores it.
+  void refitProxy(BVHProxy proxy, const AABB &bounds);
+
+  // Rebuilds every internal node top down with a binned SAH
+  void rebuild();
+
+  void clear();
+
+  // Append the userData of matching proxies to out
+  void queryAABB(const AABB &bounds, std::vector<u_int32_t> &out);
+  void queryFrustum(const Frustum &frustum, std::vector<u_int32_t> &out);
+  // Closest proxy whose bounds the ray enters within maxDistance, direction
+  // does not need to be normalized, distances are in its units
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+               float maxDistance, RayHit &hit);
+  // Up to k proxies closest to point by distance to their bounds, nearest
+  // first
+  void queryNearest(const glm::vec3 &point, size_t k,
+                    std::vector<u_int32_t> &out);
+
+  inline u_int32_t getUserData(BVHProxy proxy) const {
+    return _nodes[proxy].userData;
+  };
+  inline const AABB &getFatBounds(BVHProxy proxy) const {
+    return _nodes[proxy].bounds;
+  };
+  BVHStats getStats() const;
+
+private:
+  struct Node {
+    AABB bounds;
+    int32_t parent; // Next free node while on the free list
+    int32_t child1;
+    int32_t child2;
+    int32_t height; // 0 for leaves, -1 while free
+    u_int32_t userData;
+
+    inline bool isLeaf() const { return child1 == RS_NULL_PROXY; };
+  };
+
+  // 32 bytes, two per cache line
+  struct FlatNode {
+    glm::vec3 min;
+    u_int32_t skip; // Index just past this subtree
+    glm::vec3 max;
+    u_int32_t userData; // RS_BVH_INTERNAL for internal nodes
+  };
+
+  int32_t allocateNode();
+  void freeNode(int32_t node);
+  void insertLeaf(int32_t leaf);
+  void removeLeaf(int32_t leaf);
+  int32_t balance(int32_t node);
+  void refitFrom(int32_t node, bool rebalance);
+
+  int32_t buildSAH(int32_t *leaves, size_t count);
+  int32_t createParent(int32_t left, int32_t right);
+  void flatten();
+  u_int32_t flattenNode(int32_t node);
+
+  std::vector<Node> _nodes;
+  int32_t _root;
+  int32_t _free_list;
+  u_int _proxy_count;
+  float _margin;
+  float _displacement_scale;
+
+  std::vector<FlatNode> _flat;
+  bool _flat_dirty;
+
+  // Scratch for rebuild() and queries
+  typedef std::pair<float, u_int32_t> NearestEntry;
+  std::vector<int32_t> _leaves;
+  std::vector<glm::vec3> _centroids;
+  std::vector<NearestEntry> _open_heap;
+  std::vector<NearestEntry> _best_heap;
+};
+} // namespace RS
+
+#endif // !RS_BVH_H
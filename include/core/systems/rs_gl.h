@@ -0,0 +1,39 @@
+#ifndef RS_GL_H
+#define RS_GL_H
+
+// Desktop OpenGL 4.x entry points. The context is always a 4.6 core context
+// and libGL exports the core functions directly, so the prototypes from
+// glext.h are all we need. GL_GLEXT_PROTOTYPES is also set by the build
+// because GL/gl.h pulls in glext.h the first time it is included.
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cstring>
+
+namespace RS {
+// True if the current context is at least GL major.minor
+inline bool glVersionAtLeast(GLint major, GLint minor) {
+  GLint currentMajor = 0;
+  GLint currentMinor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &currentMajor);
+  glGetIntegerv(GL_MINOR_VERSION, &currentMinor);
+  return currentMajor > major ||
+         (currentMajor == major && currentMinor >= minor);
+};
+
+inline bool hasGLExtension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++) {
+    const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+    if (extension != NULL && std::strcmp(extension, name) == 0) {
+      return true;
+    }
+  };
+  return false;
+};
+} // namespace RS
+
+#endif // !RS_GL_H
@@ -0,0 +1,192 @@
+#include "rs_input.h"
+#include "rs_event_manager.h"
+#include "rs_events.h"
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_mouse.h>
+#include <SDL3/SDL_scancode.h>
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <cstring>
+
+::RS::InputSystem::InputSystem(EventManager *eventManager, u_int sid,
+                               size_t latencyHistory) {
+  _event_manager = eventManager;
+  _sid = sid;
+  _last_event = RS_EVENT_NULL;
+  _state = {};
+  _key_actions.assign(SDL_SCANCODE_COUNT, RS_ACTION_NULL);
+  std::memset(_button_actions, RS_ACTION_NULL, sizeof(_button_actions));
+
+  _history.assign(latencyHistory == 0 ? 1 : latencyHistory, 0.0);
+  _sorted.reserve(_history.size());
+  _history_next = 0;
+  _history_count = 0;
+  _input_frames = 0;
+  _late_events = 0;
+};
+
+void ::RS::InputSystem::emitEvent(const RS_EVENT event) {
+  // Do nothing
+  if (_event_manager == NULL) {
+    return;
+  }
+
+  _event_manager->emitEvent(_sid, event);
+};
+
+void ::RS::InputSystem::update(const RS_EVENT event) { _last_event = event; };
+
+void ::RS::InputSystem::bindKey(SDL_Scancode scancode, u_int action) {
+  if ((size_t)scancode >= _key_actions.size() || action >= RS_MAX_ACTIONS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "CANNOT BIND KEY %d TO ACTION %u\n",
+                 (int)scancode, action);
+    return;
+  };
+  _key_actions[scancode] = (u_int8_t)action;
+};
+
+void ::RS::InputSystem::bindMouseButton(u_int8_t button, u_int action) {
+  if (button >= sizeof(_button_actions) || action >= RS_MAX_ACTIONS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "CANNOT BIND MOUSE BUTTON %u TO ACTION %u\n", button, action);
+    return;
+  };
+  _button_actions[button] = (u_int8_t)action;
+};
+
+void ::RS::InputSystem::bindDefaults() {
+  bindKey(SDL_SCANCODE_ESCAPE, RS_ACTION_QUIT);
+  bindKey(SDL_SCANCODE_W, RS_ACTION_MOVE_FORWARD);
+  bindKey(SDL_SCANCODE_S, RS_ACTION_MOVE_BACKWARD);
+  bindKey(SDL_SCANCODE_A, RS_ACTION_MOVE_LEFT);
+  bindKey(SDL_SCANCODE_D, RS_ACTION_MOVE_RIGHT);
+  bindKey(SDL_SCANCODE_UP, RS_ACTION_MOVE_FORWARD);
+  bindKey(SDL_SCANCODE_DOWN, RS_ACTION_MOVE_BACKWARD);
+  bindKey(SDL_SCANCODE_LEFT, RS_ACTION_MOVE_LEFT);
+  bindKey(SDL_SCANCODE_RIGHT, RS_ACTION_MOVE_RIGHT);
+};
+
+bool ::RS::InputSystem::pollEvents() {
+  // Held actions carry over, everything else is per frame
+  const u_int32_t down = _state.down;
+  _state = {};
+  _state.down = down;
+
+  drain();
+  return !_state.quit;
+};
+
+u_int RS::InputSystem::latch() {
+  // Events still sitting in the OS queue are not in SDL's yet
+  SDL_PumpEvents();
+  u_int events = drain();
+  _late_events += events;
+  return events;
+};
+
+void ::RS::InputSystem::markSubmitted(u_int64_t oldestEventNs) {
+  if (oldestEventNs == 0) {
+    return;
+  };
+
+  const u_int64_t now = SDL_GetTicksNS();
+  _history[_history_next] =
+      now > oldestEventNs ? (double)(now - oldestEventNs) / 1000000.0 : 0.0;
+  _history_next = (_history_next + 1) % _history.size();
+  if (_history_count < _history.size()) {
+    _history_count++;
+  };
+  _input_frames++;
+};
+
+::RS::InputLatencyStats RS::InputSystem::getLatencyStats() {
+  InputLatencyStats stats = {};
+  stats.frames = _input_frames;
+  stats.lateEvents = _late_events;
+  if (_history_count == 0) {
+    return stats;
+  };
+
+  _sorted.assign(_history.begin(), _history.begin() + _history_count);
+  std::sort(_sorted.begin(), _sorted.end());
+
+  stats.p50Ms = _sorted[(_sorted.size() - 1) / 2];
+  stats.p99Ms = _sorted[(_sorted.size() - 1) * 99 / 100];
+  stats.maxMs = _sorted.back();
+  return stats;
+};
+
+bool ::RS::InputSystem::setRelativeMouseMode(SDL_Window *window,
+                                             bool enabled) {
+  if (!SDL_SetWindowRelativeMouseMode(window, enabled)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "COULD NOT SET RELATIVE MOUSE MODE: %s\n", SDL_GetError());
+    return false;
+  };
+  return true;
+};
+
+u_int RS::InputSystem::drain() {
+  u_int events = 0;
+  SDL_Event event;
+  while (SDL_PollEvent(&event)) {
+    switch (event.type) {
+    case SDL_EVENT_QUIT:
+      _state.quit = true;
+      break;
+    case SDL_EVENT_KEY_DOWN:
+    case SDL_EVENT_KEY_UP:
+      // Repeats are the OS re-sending a held key
+      if (event.key.repeat) {
+        continue;
+      };
+      if ((size_t)event.key.scancode < _key_actions.size()) {
+        setAction(_key_actions[event.key.scancode], event.key.down);
+      };
+      break;
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+    case SDL_EVENT_MOUSE_BUTTON_UP:
+      if (event.button.button < sizeof(_button_actions)) {
+        setAction(_button_actions[event.button.button], event.button.down);
+      };
+      break;
+    case SDL_EVENT_MOUSE_MOTION:
+      _state.mouseDx += event.motion.xrel;
+      _state.mouseDy += event.motion.yrel;
+      break;
+    case SDL_EVENT_MOUSE_WHEEL:
+      _state.wheel += event.wheel.y;
+      break;
+    default:
+      // Not input, and not counted towards latency
+      continue;
+    };
+
+    if (_state.events == 0 || event.common.timestamp < _state.oldestEventNs) {
+      _state.oldestEventNs = event.common.timestamp;
+    };
+    _state.events++;
+    events++;
+  };
+
+  if (_state.wasPressed(RS_ACTION_QUIT)) {
+    _state.quit = true;
+  };
+  return events;
+};
+
+void ::RS::InputSystem::setAction(u_int action, bool down) {
+  if (action == RS_ACTION_NULL) {
+    return;
+  };
+
+  const u_int32_t bit = 1u << action;
+  const bool wasDown = (_state.down & bit) != 0;
+  if (down && !wasDown) {
+    _state.down |= bit;
+    _state.pressed |= bit;
+  } else if (!down && wasDown) {
+    _state.down &= ~bit;
+    _state.released |= bit;
+  };
+};
@@ -0,0 +1,126 @@
+#ifndef RS_INPUT_H
+#define RS_INPUT_H
+
+#include "rs_event_manager.h"
+#include "rs_events.h"
+#include "rs_system.h"
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+// Actions are bits in a 32 bit mask, games add their own starting at
+// RS_ACTION_USER
+typedef enum RS_ACTION {
+  RS_ACTION_NULL, // Unbound
+  RS_ACTION_QUIT,
+  RS_ACTION_MOVE_FORWARD,
+  RS_ACTION_MOVE_BACKWARD,
+  RS_ACTION_MOVE_LEFT,
+  RS_ACTION_MOVE_RIGHT,
+
+  RS_ACTION_USER,
+} RS_ACTION;
+
+const u_int RS_MAX_ACTIONS = 32;
+
+// Everything the input system saw during one frame
+struct InputState {
+  u_int32_t down;     // Actions held after the last sample
+  u_int32_t pressed;  // Went down this frame
+  u_int32_t released; // Went up this frame
+  // Relative mouse motion and wheel, every motion event of the frame summed
+  // up so high rate mice lose nothing
+  float mouseDx;
+  float mouseDy;
+  float wheel;
+  bool quit;
+  u_int events;
+  // SDL_GetTicksNS() time of the oldest event this frame, 0 without any
+  u_int64_t oldestEventNs;
+
+  inline bool isDown(u_int action) const {
+    return (down & (1u << action)) != 0;
+  };
+  inline bool wasPressed(u_int action) const {
+    return (pressed & (1u << action)) != 0;
+  };
+  inline bool wasReleased(u_int action) const {
+    return (released & (1u << action)) != 0;
+  };
+};
+
+// Time from an input event arriving to the frame it affected being
+// submitted, over the last frames that had input
+struct InputLatencyStats {
+  double p50Ms;
+  double p99Ms;
+  double maxMs;
+  u_int64_t frames;     // Frames with input since start
+  u_int64_t lateEvents; // Events that only made their frame through latch()
+};
+
+// Drains SDL's event queue into one InputState per frame and maps keys and
+// mouse buttons to actions. pollEvents() starts the frame, latch() samples
+// once more right before the camera is updated for submission.
+class InputSystem : public System {
+public:
+  // Constructor
+  InputSystem(EventManager *eventManager, u_int sid,
+              size_t latencyHistory = 512);
+
+  // Deconstructor
+  ~InputSystem() { _event_manager = NULL; };
+
+  void emitEvent(const RS_EVENT event) override;
+  void update(const RS_EVENT event) override;
+
+  // Bindings, binding RS_ACTION_NULL removes one
+  void bindKey(SDL_Scancode scancode, u_int action);
+  void bindMouseButton(u_int8_t button, u_int action);
+  // Escape quits, WASD and the arrow keys move
+  void bindDefaults();
+
+  // Starts a new frame and drains the event queue, returns false once the
+  // user asked to quit
+  bool pollEvents();
+  // Drains whatever arrived since pollEvents() into the same frame, returns
+  // how many events that were
+  u_int latch();
+  // Records the event to submit latency of a frame, call it once the
+  // frame's draws were issued. oldestEventNs is its InputState's, which
+  // travels with the frame when another thread submits it. From one thread
+  // at a time, getLatencyStats() included.
+  void markSubmitted(u_int64_t oldestEventNs);
+
+  inline const InputState &getState() const { return _state; };
+  InputLatencyStats getLatencyStats();
+
+  // Hides the cursor and reports unbounded relative motion
+  bool setRelativeMouseMode(SDL_Window *window, bool enabled);
+
+private:
+  // Returns the number of events drained
+  u_int drain();
+  void setAction(u_int action, bool down);
+
+  RS_EVENT _last_event;
+  EventManager *_event_manager;
+  u_int _sid;
+
+  InputState _state;
+  std::vector<u_int8_t> _key_actions; // Indexed by SDL_Scancode
+  u_int8_t _button_actions[8];        // Indexed by SDL mouse button
+
+  // Ring buffer of latencies in milliseconds
+  std::vector<double> _history;
+  size_t _history_next;
+  size_t _history_count;
+  std::vector<double> _sorted; // Scratch space for percentiles
+  u_int64_t _input_frames;
+  u_int64_t _late_events;
+};
+} // namespace RS
+
+#endif // !RS_INPUT_H
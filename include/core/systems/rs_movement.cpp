@@ -0,0 +1,33 @@
+#include "rs_movement.h"
+#include "rs_components.h"
+#include "rs_event_manager.h"
+#include "rs_events.h"
+#include "rs_registry.h"
+
+void ::RS::MovementSystem::emitEvent(const RS_EVENT event) {
+  // Do nothing
+  if (_event_manager == NULL) {
+    return;
+  }
+
+  _event_manager->emitEvent(_sid, event);
+};
+
+void ::RS::MovementSystem::update(const RS_EVENT event) {
+  _last_event = event;
+};
+
+void ::RS::MovementSystem::tick(Registry &registry, float deltaTime) {
+  registry.view<Position, Velocity>().each(
+      [deltaTime](EntityID, Position &position, Velocity &velocity) {
+        position.value += velocity.value * deltaTime;
+      });
+};
+
+::RS::ComponentAccess RS::MovementSystem::getComponentAccess() const {
+  ComponentAccess access;
+  access.reads = componentMask<Velocity>();
+  access.writes = componentMask<Position>();
+  access.mainThread = false;
+  return access;
+};
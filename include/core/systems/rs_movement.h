@@ -0,0 +1,37 @@
+#ifndef RS_MOVEMENT_H
+#define RS_MOVEMENT_H
+
+#include "rs_event_manager.h"
+#include "rs_events.h"
+#include "rs_registry.h"
+#include "rs_system.h"
+#include <cstddef>
+#include <sys/types.h>
+
+namespace RS {
+// Integrates Velocity into Position for every entity that owns both
+class MovementSystem : public System {
+public:
+  // Constructor
+  MovementSystem(EventManager *eventManager, u_int sid) {
+    _event_manager = eventManager;
+    _sid = sid;
+    _last_event = RS_EVENT_NULL;
+  };
+
+  // Deconstructor
+  ~MovementSystem() { _event_manager = NULL; };
+
+  void emitEvent(const RS_EVENT event) override;
+  void update(const RS_EVENT event) override;
+  void tick(Registry &registry, float deltaTime) override;
+  ComponentAccess getComponentAccess() const override;
+
+private:
+  RS_EVENT _last_event;
+  EventManager *_event_manager;
+  u_int _sid;
+};
+} // namespace RS
+
+#endif // !RS_MOVEMENT_H
@@ -1,10 +1,43 @@
 
 #include "rs_render.h"
+#include "rs_components.h"
 #include "rs_event_manager.h"
 #include "rs_events.h"
+#include "rs_profiler.h"
 #include <GL/gl.h>
 #include <GLES2/gl2.h>
 #include <GLES3/gl3.h>
+#include <SDL3/SDL.h>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
+
+// Where the shared mesh buffers start, they grow as meshes are added
+const u_int MAX_BATCH_VERTICES = 1 << 20;
+const u_int MAX_BATCH_INDICES = 1 << 22;
+// Instances one frame can draw, submits past it are dropped
+const u_int MAX_BATCH_INSTANCES = 1 << 17;
+
+namespace {
+// Fresh storage from the frame arena, the old one went away with its frame.
+// On the heap it is cleared and reused. Reserving the final size up front
+// keeps growth from leaving copies behind in the arena.
+template <typename T>
+void frameScratch(RS::FrameVector<T> &scratch, bool onArena, size_t count) {
+  if (onArena) {
+    // Same resource, so this takes the empty vector's storage
+    scratch = RS::FrameVector<T>(scratch.get_allocator());
+  } else {
+    scratch.clear();
+  };
+  scratch.reserve(count);
+};
+} // namespace
 
 inline void ::RS::RenderSystem::emitEvent(const RS_EVENT event) {
   // Do nothing
@@ -19,9 +52,297 @@ inline void ::RS::RenderSystem::update(const RS_EVENT event) {
 };
 
 void ::RS::RenderSystem::initOpenGL() {
-  glGenVertexArrays(1, &_vao);
-  glGenBuffers(1, &_vbo);
-  glGenBuffers(1, &_ebo);
+  _frame_constants_buffer.init();
+  _batch_renderer.init(MAX_BATCH_VERTICES, MAX_BATCH_INDICES,
+                       MAX_BATCH_INSTANCES);
+  _instanced_shader = new Shader(REDSTAR_SHADER_DIR "/vert/instanced.vert",
+                                 REDSTAR_SHADER_DIR "/frag/main.frag");
+  _batch_renderer.setStateCache(&_gl_state);
+  _light_buffer.init();
+  // Occlusion culling compares against the depth of earlier draws, and
+  // draws need it to begin with
+  glEnable(GL_DEPTH_TEST);
+  if (_occlusion.init(MAX_BATCH_INSTANCES, RS_MAX_BATCH_COMMANDS)) {
+    _occlusion.setStateCache(&_gl_state);
+    _batch_renderer.setOcclusionCuller(&_occlusion);
+  };
+  addMaterial(Material());
+};
+
+u_int RS::RenderSystem::addMaterial(const Material &material) {
+  if (_materials.size() >= RS_SORT_MATERIALS) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "TOO MANY MATERIALS\n");
+    return 0;
+  };
+
+  Material added = material;
+  if (added.program == 0) {
+    added.program = _instanced_shader->ID;
+  };
+  if (added.layer >= RS_SORT_LAYERS) {
+    added.layer = RS_SORT_LAYERS - 1;
+  };
+
+  // Programs get a small index of their own for the sort key
+  u_int program = 0;
+  while (program < _programs.size() && _programs[program] != added.program) {
+    program++;
+  };
+  if (program == _programs.size()) {
+    if (_programs.size() >= RS_SORT_PROGRAMS) {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "TOO MANY MATERIAL PROGRAMS\n");
+      return 0;
+    };
+    _programs.push_back(added.program);
+  };
+
+  _materials.push_back(added);
+  _material_programs.push_back(program);
+  return (u_int)(_materials.size() - 1);
+};
+
+void ::RS::RenderSystem::render(Registry &registry, float alpha) {
+  buildPacket(registry, alpha, _packet);
+  submit(_packet);
+};
+
+void ::RS::RenderSystem::buildPacket(Registry &registry, float alpha,
+                                     RenderPacket &packet) {
+  RS_PROFILE_SCOPE("Build render packet");
+  packet.frameConstants = _frame_constants;
+
+  // Blend between the last two ticks so motion stays smooth when the frame
+  // rate and the tick rate differ
+  ComponentPool<PreviousPosition> &previousPositions =
+      registry.getPool<PreviousPosition>();
+  ComponentPool<Transform> &transforms = registry.getPool<Transform>();
+  auto renderables = registry.view<Position, Renderable>();
+  const size_t drawable = renderables.sizeHint();
+  _cull_bounds.clear();
+  const bool onArena = _frame_resource != NULL;
+  frameScratch(_cull_positions, onArena, drawable);
+  frameScratch(_cull_models, onArena, drawable);
+  frameScratch(_cull_meshes, onArena, drawable);
+  frameScratch(_cull_materials, onArena, drawable);
+  frameScratch(_visible, onArena, drawable);
+  renderables.each(
+      [this, alpha, &previousPositions, &transforms](
+          EntityID entity, Position &position, Renderable &renderable) {
+        glm::vec3 center;
+        glm::vec3 extents;
+        if (!_batch_renderer.getMeshBounds(renderable.mesh, center,
+                                           extents)) {
+          return;
+        }
+
+        glm::vec3 drawn = position.value;
+        const PreviousPosition *previous =
+            previousPositions.tryGet(entity.index);
+        if (previous != NULL) {
+          drawn = previous->value + (position.value - previous->value) * alpha;
+        }
+
+        const Transform *transform = transforms.tryGet(entity.index);
+        if (transform != NULL && _transforms != NULL &&
+            _transforms->isValid(transform->node)) {
+          // The world matrix is as of the last tick, shift it by how far
+          // the interpolation moved the entity
+          glm::mat4 model = _transforms->getWorldMatrix(transform->node);
+          model[3] += glm::vec4(drawn - position.value, 0.0f);
+
+          // Box around the transformed box
+          glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+          glm::vec3 worldExtents;
+          for (int axis = 0; axis < 3; axis++) {
+            worldExtents[axis] = std::fabs(model[0][axis]) * extents.x +
+                                 std::fabs(model[1][axis]) * extents.y +
+                                 std::fabs(model[2][axis]) * extents.z;
+          };
+          _cull_bounds.push(worldCenter, worldExtents);
+          _cull_positions.push_back(glm::vec3(model[3]));
+          _cull_models.push_back(model);
+        } else {
+          _cull_bounds.push(drawn + center, extents);
+          _cull_positions.push_back(drawn);
+          _cull_models.push_back(glm::translate(glm::mat4(1.0f), drawn));
+        }
+        _cull_meshes.push_back(renderable.mesh);
+        _cull_materials.push_back(
+            renderable.material < _materials.size() ? renderable.material : 0);
+      });
+
+  {
+    RS_PROFILE_SCOPE("Frustum culling");
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t candidates = _cull_bounds.size();
+    _visible.resize(candidates);
+    size_t visible = candidates;
+    if (_culling_enabled) {
+      visible = cullBoxes(_frustum, _cull_bounds, _visible.data());
+    } else {
+      for (size_t i = 0; i < candidates; i++) {
+        _visible[i] = (u_int32_t)i;
+      };
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    _cull_stats.candidates = (u_int)candidates;
+    _cull_stats.visible = (u_int)visible;
+    _cull_stats.cullMs =
+        std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+  {
+    RS_PROFILE_SCOPE("Sort draws");
+    const glm::mat4 &view = _frame_constants.view;
+    const glm::mat4 &projection = _frame_constants.projection;
+    // Pixels per world unit at view depth 1, or at any depth without
+    // perspective
+    const bool perspective = projection[2][3] != 0.0f;
+    const float pixelScale =
+        (float)_viewport_height * 0.5f * std::fabs(projection[1][1]);
+    _lod_stats = {};
+    _render_queue.clear();
+    for (u_int i = 0; i < _cull_stats.visible; i++) {
+      const u_int32_t index = _visible[i];
+      const u_int materialIndex = _cull_materials[index];
+      const Material &material = _materials[materialIndex];
+      const glm::vec3 &position = _cull_positions[index];
+      // View space looks down -z
+      const float depth = -(view[0][2] * position.x + view[1][2] * position.y +
+                            view[2][2] * position.z + view[3][2]);
+
+      const MeshHandle mesh = _cull_meshes[index];
+      if (_lod_pixel_error > 0.0f && _batch_renderer.getLodCount(mesh) > 0 &&
+          (!perspective || depth > 0.0f)) {
+        // LOD errors are in object space, the largest axis scale bounds
+        // how much the model matrix stretches them
+        const glm::mat4 &model = _cull_models[index];
+        const float scale = std::sqrt(std::max(
+            glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+            std::max(glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                     glm::dot(glm::vec3(model[2]), glm::vec3(model[2])))));
+        const float maxError = _lod_pixel_error * (perspective ? depth : 1.0f) /
+                               (pixelScale * scale);
+        _cull_meshes[index] = _batch_renderer.selectLod(mesh, maxError);
+      }
+      const MeshHandle drawn = _cull_meshes[index];
+      _lod_stats.triangles += _batch_renderer.getTriangleCount(drawn);
+      _lod_stats.vertexInvocations +=
+          _batch_renderer.getVertexInvocations(drawn);
+      if (drawn != mesh) {
+        _lod_stats.coarser++;
+        _lod_stats.trianglesSaved += _batch_renderer.getTriangleCount(mesh) -
+                                     _batch_renderer.getTriangleCount(drawn);
+        const u_int full = _batch_renderer.getVertexInvocations(mesh);
+        const u_int coarse = _batch_renderer.getVertexInvocations(drawn);
+        _lod_stats.vertexInvocationsSaved += full > coarse ? full - coarse : 0;
+      }
+
+      _render_queue.push(makeSortKey(material.layer, material.translucent,
+                                     _material_programs[materialIndex],
+                                     materialIndex, depth),
+                         index);
+    };
+    _render_queue.sort();
+  }
+
+  {
+    // Lights use the same interpolated positions as what they light
+    auto lights = registry.view<Position, PointLight>();
+    frameScratch(_scene_lights, _frame_resource != NULL, lights.sizeHint());
+    lights.each(
+        [this, alpha, &previousPositions](EntityID entity, Position &position,
+                                          PointLight &light) {
+          glm::vec3 drawn = position.value;
+          const PreviousPosition *previous =
+              previousPositions.tryGet(entity.index);
+          if (previous != NULL) {
+            drawn =
+                previous->value + (position.value - previous->value) * alpha;
+          }
+
+          ClusterLight clustered;
+          clustered.positionRadius = glm::vec4(drawn, light.radius);
+          clustered.color = glm::vec4(light.color * light.intensity, 0.0f);
+          _scene_lights.push_back(clustered);
+        });
+    _light_builder.build(_frame_constants.view, _frame_constants.projection,
+                         _scene_lights.data(), _scene_lights.size(),
+                         packet.lights);
+    packet.lights.constants.ambient = glm::vec4(_ambient_light, 0.0f);
+  }
+
+  // Resolve materials into batches, one per run of the same material
+  packet.meshes.clear();
+  packet.models.clear();
+  packet.batches.clear();
+  size_t command = 0;
+  while (command < _render_queue.size()) {
+    const u_int materialIndex = _cull_materials[_render_queue[command].payload];
+    const Material &material = _materials[materialIndex];
+    RenderBatch batch;
+    batch.program = material.program;
+    batch.texture = material.texture;
+    batch.translucent = material.translucent;
+    batch.first = (u_int)packet.meshes.size();
+
+    for (; command < _render_queue.size(); command++) {
+      const u_int32_t index = _render_queue[command].payload;
+      if (_cull_materials[index] != materialIndex) {
+        break;
+      }
+      packet.meshes.push_back(_cull_meshes[index]);
+      packet.models.push_back(_cull_models[index]);
+    };
+    batch.count = (u_int)packet.meshes.size() - batch.first;
+    packet.batches.push_back(batch);
+  };
+};
+
+void ::RS::RenderSystem::submit(const RenderPacket &packet) {
+  // Texture uploads and the like bind things behind its back
+  _gl_state.beginFrame();
+  _frame_constants_buffer.upload(packet.frameConstants);
+  _light_buffer.upload(packet.lights, _target_width, _target_height);
+  if (_occlusion.isEnabled()) {
+    _occlusion.beginFrame();
+  };
+
+  {
+    RS_PROFILE_GPU_SCOPE("Clear");
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
+
+  {
+    RS_PROFILE_GPU_SCOPE("Batches");
+    _batch_renderer.beginFrame();
+    for (const RenderBatch &batch : packet.batches) {
+      _gl_state.useProgram(batch.program);
+      _gl_state.bindTexture(0, batch.texture);
+      _gl_state.setBlend(batch.translucent);
+      _gl_state.setDepthWrite(!batch.translucent);
+
+      for (u_int i = batch.first; i < batch.first + batch.count; i++) {
+        _batch_renderer.submit(packet.meshes[i], packet.models[i]);
+      };
+      _batch_renderer.flush(batch.translucent);
+    };
+    _batch_renderer.endFrame();
+  }
+
+  // Leave depth writes on, glClear honours the depth mask
+  _gl_state.setBlend(false);
+  _gl_state.setDepthWrite(true);
 
-  glBindVertexArray(_vao);
+  // Next frame tests against this frame's depth
+  if (_occlusion.isEnabled()) {
+    RS_PROFILE_GPU_SCOPE("Hi-Z");
+    _occlusion.buildPyramid(_target_width, _target_height, _target_max_width,
+                            _target_max_height,
+                            packet.frameConstants.projection *
+                                packet.frameConstants.view);
+    _occlusion.endFrame();
+  };
 };
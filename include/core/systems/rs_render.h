@@ -1,21 +1,111 @@
 #ifndef RS_RENDER_H
 #define RS_RENDER_H
 
+#include "rs_batch_renderer.h"
+#include "rs_culling.h"
 #include "rs_event_manager.h"
 #include "rs_events.h"
+#include "rs_frame_constants.h"
+#include "rs_gl_state.h"
+#include "rs_light_clusters.h"
+#include "rs_memory_resource.h"
+#include "rs_occlusion.h"
+#include "rs_registry.h"
+#include "rs_render_queue.h"
 #include "rs_system.h"
+#include "rs_transform.h"
+#include "shader.hpp"
 #include <GLES2/gl2.h>
 #include <GLES3/gl3.h>
+#include <algorithm>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <memory_resource>
 #include <sys/types.h>
+#include <vector>
 
 namespace RS {
+struct Material {
+  // 0 draws with the default instanced program. Others need the same
+  // vertex inputs, see vert/instanced.vert.
+  GLuint program = 0;
+  // GL_TEXTURE_2D on unit 0, 0 for none
+  GLuint texture = 0;
+  // Layers draw in ascending order, below RS_SORT_LAYERS
+  u_int layer = 0;
+  // Blended and drawn back to front after the opaque draws of its layer
+  bool translucent = false;
+};
+
+// One run of draws with the same material in a RenderPacket
+struct RenderBatch {
+  GLuint program;
+  GLuint texture;
+  bool translucent;
+  u_int first; // Into RenderPacket::meshes and models
+  u_int count;
+};
+
+// Per frame effect of LOD selection. Saved counts are against drawing
+// every visible mesh at full detail.
+struct LodStats {
+  u_int coarser;   // Draws that used a LOD instead of the full mesh
+  u_int triangles; // Triangles submitted
+  u_int trianglesSaved;
+  u_int vertexInvocations; // Estimated from the post transform cache
+  u_int vertexInvocationsSaved;
+};
+
+// Everything needed to draw one frame, with no references back into the
+// registry or the RenderSystem's scratch state, so it can be submitted on
+// another thread while the next one is built
+struct RenderPacket {
+  u_int64_t frameIndex;
+  // SDL_GetTicksNS() time of the oldest input the frame saw, 0 without any
+  u_int64_t oldestInputNs;
+  FrameConstants frameConstants;
+  // Visible draws in submission order
+  std::vector<MeshHandle> meshes;
+  std::vector<glm::mat4> models;
+  std::vector<RenderBatch> batches;
+  // Point lights binned for the LIT shaders
+  LightClusters lights;
+};
+
 class RenderSystem : public System {
 public:
   // Constructor
-  RenderSystem(EventManager *eventManager, u_int sid) {
+  // frameResource is where buildPacket() takes its scratch arrays from,
+  // e.g. the engine's frame arena. It has to keep them for the length of a
+  // buildPacket() call. NULL reuses heap arrays instead.
+  RenderSystem(EventManager *eventManager, u_int sid,
+               std::pmr::memory_resource *frameResource = NULL)
+      : _frame_resource(frameResource),
+        _cull_positions(scratchResource(frameResource)),
+        _cull_models(scratchResource(frameResource)),
+        _cull_meshes(scratchResource(frameResource)),
+        _cull_materials(scratchResource(frameResource)),
+        _visible(scratchResource(frameResource)),
+        _scene_lights(scratchResource(frameResource)) {
     _event_manager = eventManager;
     _sid = sid;
     _last_event = RS_EVENT_NULL;
+    _frame_constants.view = glm::mat4(1.0f);
+    _frame_constants.projection = glm::mat4(1.0f);
+    _instanced_shader = NULL;
+    _frustum = Frustum::fromMatrix(glm::mat4(1.0f));
+    _culling_enabled = true;
+    _transforms = NULL;
+    _cull_stats = {};
+    _viewport_width = 1;
+    _viewport_height = 1;
+    _target_width = 1;
+    _target_height = 1;
+    _target_max_width = 1;
+    _target_max_height = 1;
+    _lod_pixel_error = 1.0f;
+    _lod_stats = {};
+    _ambient_light = glm::vec3(0.1f);
     initOpenGL();
   };
 
@@ -23,10 +113,10 @@ public:
   ~RenderSystem() {
     _event_manager = NULL;
 
-    // TODO: Handle unintialiized vaos, vbos, or ebos
-    glDeleteVertexArrays(1, &_vao);
-    glDeleteBuffers(1, &_vbo);
-    glDeleteBuffers(1, &_ebo);
+    if (_instanced_shader != NULL) {
+      glDeleteProgram(_instanced_shader->ID);
+      delete _instanced_shader;
+    }
   };
 
   void emitEvent(const RS_EVENT event) override;
@@ -35,16 +125,173 @@ public:
   // Start all necessary OpenGL processes
   void initOpenGL();
 
+  // Draws the current frame. alpha is how far the frame lies between the
+  // previous and the latest simulation tick.
+  void render(Registry &registry, float alpha);
+
+  // render() in two halves. buildPacket() gathers, culls and sorts without
+  // touching GL, submit() issues the packet's draws on the thread that
+  // owns the context. Meshes and materials must not be added while a
+  // packet is in flight on another thread.
+  void buildPacket(Registry &registry, float alpha, RenderPacket &packet);
+  void submit(const RenderPacket &packet);
+
+  // Meshes drawn through Renderable::mesh have to be registered here first
+  inline MeshHandle addMesh(const Vertex *vertices, u_int vertexCount,
+                            const u_int32_t *indices, u_int indexCount) {
+    return _batch_renderer.addMesh(vertices, vertexCount, indices, indexCount);
+  };
+  // Registers every submesh of a .rsmesh file, handles are appended to out
+  inline bool loadMesh(const char *path, std::vector<MeshHandle> &out) {
+    MeshFile file;
+    return file.open(path) && _batch_renderer.addMeshFile(file, out);
+  };
+  inline const BatchStats &getBatchStats() const {
+    return _batch_renderer.getStats();
+  };
+  inline const StreamStats &getStreamStats() const {
+    return _batch_renderer.getStreamStats();
+  };
+
+  // Renderable::material indexes these, unknown indices fall back to
+  // material 0, the opaque untextured default
+  u_int addMaterial(const Material &material);
+  // Program, vertex array, texture and blend/depth changes this frame,
+  // issued and skipped because they were already set
+  inline const GLStateStats &getStateStats() const {
+    return _gl_state.getStats();
+  };
+
+  // Camera matrices for the next render(), uploaded once to the shared
+  // FrameConstants uniform block. Objects outside the frustum are culled.
+  inline void setViewProjection(const glm::mat4 &view,
+                                const glm::mat4 &projection) {
+    setViewProjection(view, projection,
+                      Frustum::fromMatrix(projection * view));
+  };
+  // For callers that already have the frustum, e.g. Camera::GetFrustum()
+  inline void setViewProjection(const glm::mat4 &view,
+                                const glm::mat4 &projection,
+                                const Frustum &frustum) {
+    _frame_constants.view = view;
+    _frame_constants.projection = projection;
+    _frustum = frustum;
+  };
+
+  inline void setCullingEnabled(bool enabled) { _culling_enabled = enabled; };
+
+  // Meshes with LODs draw the coarsest one whose error covers no more than
+  // pixelError pixels on screen, 0 always draws full detail. Needs the
+  // viewport size to turn errors into pixels.
+  inline void setViewportSize(int width, int height) {
+    _viewport_width = width > 0 ? width : 1;
+    _viewport_height = height > 0 ? height : 1;
+    setTargetSize(width, height);
+  };
+  // Size submit() actually draws at, when that differs from the viewport
+  // size, e.g. with dynamic resolution. maxWidth x maxHeight is the size
+  // of the target it draws into the lower left corner of, so buffers
+  // sized from it survive a change of scale. Called where submit() runs.
+  inline void setTargetSize(int width, int height, int maxWidth = 0,
+                            int maxHeight = 0) {
+    _target_width = width > 0 ? width : 1;
+    _target_height = height > 0 ? height : 1;
+    _target_max_width = std::max(maxWidth, _target_width);
+    _target_max_height = std::max(maxHeight, _target_height);
+  };
+  inline void setLodPixelError(float pixelError) {
+    _lod_pixel_error = pixelError;
+  };
+  inline const LodStats &getLodStats() const { return _lod_stats; };
+
+  // GPU occlusion culling of opaque draws against last frame's depth, see
+  // OcclusionCuller. Stays off where compute shaders are not available.
+  inline void setOcclusionCulling(bool enabled) {
+    _occlusion.setEnabled(enabled && _occlusion.isSupported());
+  };
+  inline bool isOcclusionCulling() const { return _occlusion.isEnabled(); };
+  inline const OcclusionStats &getOcclusionStats() const {
+    return _occlusion.getStats();
+  };
+
+  // PointLight entities light every material drawn with a LIT variant of
+  // the forward shaders, clustered each frame in buildPacket()
+  inline void setAmbientLight(const glm::vec3 &ambient) {
+    _ambient_light = ambient;
+  };
+  inline const LightClusterStats &getLightStats() const {
+    return _light_builder.getStats();
+  };
+
+  // Entities with a Transform component are drawn with their node's world
+  // matrix from here, the rest with a translation by their Position
+  inline void setTransformHierarchy(const TransformHierarchy *transforms) {
+    _transforms = transforms;
+  };
+  inline const CullStats &getCullStats() const { return _cull_stats; };
+
 private:
+  static inline std::pmr::memory_resource *
+  scratchResource(std::pmr::memory_resource *frameResource) {
+    return frameResource != NULL ? frameResource
+                                 : std::pmr::get_default_resource();
+  };
+
   RS_EVENT _last_event;
   EventManager *_event_manager;
   u_int _sid;
   bool isInitialized;
 
   // OpenGL
-  u_int _vbo;
-  u_int _vao;
-  u_int _ebo;
+  FrameConstants _frame_constants;
+  FrameConstantsBuffer _frame_constants_buffer;
+  BatchRenderer _batch_renderer;
+  Shader *_instanced_shader;
+  GLStateCache _gl_state;
+  OcclusionCuller _occlusion;
+
+  // Draws are recorded into the queue with a sort key and go out sorted,
+  // one batch per run of the same material
+  RenderQueue _render_queue;
+  std::vector<Material> _materials;
+  const TransformHierarchy *_transforms;
+  std::vector<u_int> _material_programs; // Index into _programs
+  std::vector<GLuint> _programs;
+
+  // Used by render()
+  RenderPacket _packet;
+
+  // Culling, _cull_bounds is reused every frame
+  Frustum _frustum;
+  bool _culling_enabled;
+  CullBounds _cull_bounds;
+  // The rest of the scratch lives in buildPacket() only and comes from the
+  // frame arena when there is one
+  std::pmr::memory_resource *_frame_resource;
+  FrameVector<glm::vec3> _cull_positions;
+  FrameVector<glm::mat4> _cull_models;
+  FrameVector<MeshHandle> _cull_meshes;
+  FrameVector<u_int> _cull_materials;
+  FrameVector<u_int32_t> _visible;
+  CullStats _cull_stats;
+
+  // LOD selection
+  int _viewport_width;
+  int _viewport_height;
+  float _lod_pixel_error;
+  LodStats _lod_stats;
+
+  // Clustered lighting, _scene_lights is buildPacket() scratch as well
+  LightClusterBuilder _light_builder;
+  LightClusterBuffer _light_buffer;
+  FrameVector<ClusterLight> _scene_lights;
+  glm::vec3 _ambient_light;
+
+  // What submit() draws into, render thread side
+  int _target_width;
+  int _target_height;
+  int _target_max_width;
+  int _target_max_height;
 };
 } // namespace RS
 
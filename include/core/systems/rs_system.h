@@ -3,11 +3,23 @@
 
 #include "rs_event_listener.h"
 #include "rs_events.h"
+#include "rs_registry.h"
 #include <sys/types.h>
 
 namespace RS {
+// Which component pools a system touches during tick(). The SystemGraph uses
+// this to decide which systems may run at the same time.
+struct ComponentAccess {
+  ComponentMask reads;
+  ComponentMask writes;
+  // Systems that talk to SDL or OpenGL must stay on the main thread
+  bool mainThread;
+};
+
 class System : public EventListener {
 public:
+  virtual ~System() {};
+
   // TODO: Change emitEvent return type to handle custom errors
   // Used to broadcast events to listeners of the current system
   virtual void emitEvent(const RS_EVENT event) = 0;
@@ -15,6 +27,18 @@ public:
   // TODO: Change update return type to handle custom errors
   virtual void update(const RS_EVENT event) override = 0;
 
+  // Called once per simulation step with the engine's entity registry.
+  // Systems that do not own any per entity work can ignore it.
+  virtual void tick(Registry &registry, float deltaTime) {};
+
+  // Systems that do not override this are kept on the main thread and are
+  // assumed not to touch any component pool.
+  virtual ComponentAccess getComponentAccess() const {
+    ComponentAccess access;
+    access.mainThread = true;
+    return access;
+  };
+
 private:
 };
 } // namespace RS
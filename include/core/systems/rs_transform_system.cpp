@@ -0,0 +1,49 @@
+#include "rs_transform_system.h"
+#include "rs_components.h"
+#include "rs_event_manager.h"
+#include "rs_events.h"
+#include "rs_registry.h"
+
+void ::RS::TransformSystem::emitEvent(const RS_EVENT event) {
+  // Do nothing
+  if (_event_manager == NULL) {
+    return;
+  }
+
+  _event_manager->emitEvent(_sid, event);
+};
+
+void ::RS::TransformSystem::update(const RS_EVENT event) {
+  _last_event = event;
+};
+
+void ::RS::TransformSystem::tick(Registry &registry, float deltaTime) {
+  // Unchanged values leave their nodes clean, a scene that did not move
+  // skips update() almost entirely
+  registry.view<Transform, Position>().each(
+      [this, &registry](EntityID entity, Transform &transform,
+                        Position &position) {
+        if (!_hierarchy.isValid(transform.node)) {
+          return;
+        }
+        _hierarchy.setLocalPosition(transform.node, position.value);
+
+        const Rotation *rotation = registry.getComponent<Rotation>(entity);
+        if (rotation != NULL) {
+          _hierarchy.setLocalRotation(transform.node, rotation->value);
+        }
+        const Scale *scale = registry.getComponent<Scale>(entity);
+        if (scale != NULL) {
+          _hierarchy.setLocalScale(transform.node, scale->value);
+        }
+      });
+
+  _hierarchy.update(_job_system);
+};
+
+::RS::ComponentAccess RS::TransformSystem::getComponentAccess() const {
+  ComponentAccess access;
+  access.reads = componentMask<Transform, Position, Rotation, Scale>();
+  access.mainThread = false;
+  return access;
+};
@@ -0,0 +1,46 @@
+#ifndef RS_TRANSFORM_SYSTEM_H
+#define RS_TRANSFORM_SYSTEM_H
+
+#include "rs_event_manager.h"
+#include "rs_events.h"
+#include "rs_job_system.h"
+#include "rs_registry.h"
+#include "rs_system.h"
+#include "rs_transform.h"
+#include <cstddef>
+#include <sys/types.h>
+
+namespace RS {
+// Copies Position, Rotation and Scale of every entity with a Transform into
+// its hierarchy node and brings the world matrices up to date
+class TransformSystem : public System {
+public:
+  // Constructor
+  TransformSystem(EventManager *eventManager, u_int sid, JobSystem *jobSystem) {
+    _event_manager = eventManager;
+    _sid = sid;
+    _last_event = RS_EVENT_NULL;
+    _job_system = jobSystem;
+  };
+
+  // Deconstructor
+  ~TransformSystem() { _event_manager = NULL; };
+
+  void emitEvent(const RS_EVENT event) override;
+  void update(const RS_EVENT event) override;
+  void tick(Registry &registry, float deltaTime) override;
+  ComponentAccess getComponentAccess() const override;
+
+  inline TransformHierarchy &getHierarchy() { return _hierarchy; };
+
+private:
+  RS_EVENT _last_event;
+  EventManager *_event_manager;
+  u_int _sid;
+
+  JobSystem *_job_system;
+  TransformHierarchy _hierarchy;
+};
+} // namespace RS
+
+#endif // !RS_TRANSFORM_SYSTEM_H
@@ -1,9 +1,12 @@
 #include "rs_window.h"
 #include "rs_event_manager.h"
 #include "rs_events.h"
+#include "rs_framebuffer.h"
+#include "rs_gl.h"
 #include <GL/gl.h>
 #include <GLES2/gl2.h>
 #include <SDL3/SDL_video.h>
+#include <vector>
 
 void ::RS::WindowSystem::emitEvent(const RS_EVENT event) {
   // Do nothing
@@ -18,16 +21,25 @@ inline void ::RS::WindowSystem::update(const RS_EVENT event) {
   _last_event = event;
 };
 
-bool ::RS::WindowSystem::initSDL(const char *engineVersion) {
+bool ::RS::WindowSystem::initSDL(const char *engineVersion,
+                                 const WindowConfig &config) {
 
-  // TODO: Get WIN_WIDTH, WIN_HEIGHT, and CreateWindow FLAGS
-  //       from a User Config file(?)
+  // TODO: Get the window config from a User Config file(?)
 
-  // Temp hard code
   const char *_PROGRAM_NAME = "RedStar";
-  const SDL_WindowFlags _FLAGS = SDL_WINDOW_OPENGL | SDL_WINDOW_BORDERLESS;
-  int _WIN_WIDTH = 1600;
-  int _WIN_HEIGHT = 900;
+  const SDL_WindowFlags _FLAGS =
+      SDL_WINDOW_OPENGL |
+      (config.headless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_BORDERLESS);
+  _window_w = config.width;
+  _window_h = config.height;
+  _headless = config.headless;
+
+  if (_headless) {
+    // Has to be set before the video subsystem starts. Build machines
+    // usually have no sound card either.
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    SDL_SetHint(SDL_HINT_AUDIO_DRIVER, "dummy");
+  };
 
   const int _NUM_OF_SUBSYSTEMS = 2;
   const std::pair<unsigned int, const char *> SUBSYSTEMS[_NUM_OF_SUBSYSTEMS]{
@@ -44,29 +56,98 @@ bool ::RS::WindowSystem::initSDL(const char *engineVersion) {
     }
   };
 
-  // Init OpenGL stuff
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-
-  _window = SDL_CreateWindow(_PROGRAM_NAME, _WIN_WIDTH, _WIN_HEIGHT, _FLAGS);
+  _window = SDL_CreateWindow(_PROGRAM_NAME, _window_w, _window_h, _FLAGS);
   if (_window == NULL) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR,
                  "THE PROGRAM WINDOW FAILED TO INIT: %s\n", SDL_GetError());
     return false;
   };
 
-  _gl_context = SDL_GL_CreateContext(_window);
+  // Init OpenGL stuff
+  // Nothing here needs more than 4.5, which is as far as llvmpipe goes
+  const int _NUM_OF_VERSIONS = 2;
+  const int GL_VERSIONS[_NUM_OF_VERSIONS][2]{{4, 6}, {4, 5}};
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+  for (int i = 0; i < _NUM_OF_VERSIONS && _gl_context == NULL; i++) {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, GL_VERSIONS[i][0]);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, GL_VERSIONS[i][1]);
+    _gl_context = SDL_GL_CreateContext(_window);
+  };
   if (_gl_context == NULL) {
     SDL_LogError(SDL_LOG_CATEGORY_ERROR,
-                 "OpenGL CONTEXT COULD NOT BE CREATED\n");
+                 "OpenGL CONTEXT COULD NOT BE CREATED: %s\n", SDL_GetError());
     return false;
   };
 
   _gl_program_id = glCreateProgram();
 
+  if (_headless) {
+    _offscreen = new Framebuffer();
+    if (!_offscreen->init(_window_w, _window_h)) {
+      return false;
+    };
+    // There is no display to sync with
+    return true;
+  };
+
   // Set SDL Settings
   // VSync: 0 for off, 1 for on, -1 for adaptive
   SDL_GL_SetSwapInterval(1);
   return true;
 };
+
+bool ::RS::WindowSystem::makeCurrent() {
+  if (!SDL_GL_MakeCurrent(_window, _gl_context)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                 "OpenGL CONTEXT COULD NOT BE MADE CURRENT: %s\n",
+                 SDL_GetError());
+    return false;
+  };
+  return true;
+};
+
+void ::RS::WindowSystem::releaseContext() {
+  SDL_GL_MakeCurrent(_window, NULL);
+};
+
+void ::RS::WindowSystem::beginFrame() {
+  if (_offscreen != NULL) {
+    _offscreen->bind();
+    return;
+  };
+  Framebuffer::unbind();
+  glViewport(0, 0, _window_w, _window_h);
+};
+
+void ::RS::WindowSystem::present() {
+  if (_headless) {
+    glFlush();
+    return;
+  };
+  SDL_GL_SwapWindow(_window);
+};
+
+bool ::RS::WindowSystem::captureFrame(const char *path, bool raw) {
+  std::vector<unsigned char> pixels;
+  if (_offscreen != NULL) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _offscreen->getFramebuffer());
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+  } else {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+  };
+  readPixels(_window_w, _window_h, pixels);
+
+  return raw ? writeRaw(path, pixels)
+             : writePNG(path, _window_w, _window_h, pixels);
+};
+
+bool ::RS::WindowSystem::setVSync(bool enabled) {
+  // VSync: 0 for off, 1 for on, -1 for adaptive
+  if (!SDL_GL_SetSwapInterval(enabled ? 1 : 0)) {
+    SDL_LogError(SDL_LOG_CATEGORY_ERROR, "COULD NOT SET SWAP INTERVAL: %s\n",
+                 SDL_GetError());
+    return false;
+  };
+  return true;
+};
@@ -3,12 +3,22 @@
 
 #include "rs_event_manager.h"
 #include "rs_events.h"
+#include "rs_framebuffer.h"
 #include "rs_system.h"
 #include <GL/gl.h>
 #include <SDL3/SDL.h>
 #include <sys/types.h>
 
 namespace RS {
+struct WindowConfig {
+  int width = 1600;
+  int height = 900;
+  // No display needed: SDL's offscreen video driver (EGL pbuffer or
+  // surfaceless) with every frame drawn into an offscreen framebuffer.
+  // Works with software GL such as llvmpipe.
+  bool headless = false;
+};
+
 class WindowSystem : public System {
 public:
   // Constructor
@@ -16,11 +26,17 @@ public:
     _event_manager = eventManager;
     _sid = sid;
     _last_event = RS_EVENT_NULL;
+    _window = NULL;
+    _gl_context = NULL;
+    _offscreen = NULL;
+    _headless = false;
   };
 
   // Deconstructor
   ~WindowSystem() {
     // TODO: Error handle on destroy fail
+    // Needs the context, so it goes first
+    delete _offscreen;
     SDL_GL_DestroyContext(_gl_context);
     SDL_DestroyWindow(_window);
     SDL_Quit();
@@ -31,12 +47,33 @@ public:
   // Getters
   inline SDL_Window *getWindow() { return _window; };
   inline GLuint getGLProgramID() { return _gl_program_id; };
+  inline int getWidth() const { return _window_w; };
+  inline int getHeight() const { return _window_h; };
+  inline bool isHeadless() const { return _headless; };
 
   // Setters
+  // Turns swap interval syncing on or off, returns false if the driver
+  // refused
+  bool setVSync(bool enabled);
 
   // SDL3
   // Starts up all necessary SDL3 processes
-  bool initSDL(const char *engineVer);
+  bool initSDL(const char *engineVer,
+               const WindowConfig &config = WindowConfig());
+
+  // Makes the GL context current on the calling thread. The thread that
+  // had it must call releaseContext() first.
+  bool makeCurrent();
+  void releaseContext();
+
+  // Binds what this frame renders into, the offscreen framebuffer when
+  // headless and the window otherwise
+  void beginFrame();
+  // Swaps the window, headless only flushes
+  void present();
+  // Reads back the frame rendered since beginFrame(), call it before
+  // present(). Writes a PNG, or headerless RGBA8 when raw is set.
+  bool captureFrame(const char *path, bool raw = false);
 
 private:
   RS_EVENT _last_event;
@@ -48,6 +85,8 @@ private:
   int _window_w;
   int _window_h;
   SDL_Window *_window;
+  bool _headless;
+  Framebuffer *_offscreen;
 
   // OpenGL
   SDL_GLContext _gl_context;
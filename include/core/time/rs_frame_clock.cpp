@@ -0,0 +1,78 @@
+#include "rs_frame_clock.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+::RS::FrameClock::FrameClock(size_t historySize) {
+  _history.assign(historySize == 0 ? 1 : historySize, 0.0);
+  _sorted.reserve(_history.size());
+  _history_next = 0;
+  _history_count = 0;
+  _started = false;
+  _frame_count = 0;
+  _tick_count = 0;
+  _missed_ticks = 0;
+};
+
+double ::RS::FrameClock::beginFrame() {
+  Clock::time_point now = Clock::now();
+  if (!_started) {
+    _started = true;
+    _frame_start = now;
+    return 0.0;
+  };
+
+  double seconds = std::chrono::duration<double>(now - _frame_start).count();
+  _frame_start = now;
+
+  _history[_history_next] = seconds * 1000.0;
+  _history_next = (_history_next + 1) % _history.size();
+  if (_history_count < _history.size()) {
+    _history_count++;
+  };
+  _frame_count++;
+  return seconds;
+};
+
+void ::RS::FrameClock::recordTicks(u_int ticks, u_int64_t missed) {
+  _tick_count += ticks;
+  _missed_ticks += missed;
+};
+
+void ::RS::FrameClock::waitUntil(Clock::time_point deadline,
+                                 std::chrono::microseconds spinThreshold) {
+  Clock::time_point now = Clock::now();
+  while (deadline - now > spinThreshold) {
+    std::this_thread::sleep_for(deadline - now - spinThreshold);
+    now = Clock::now();
+  };
+
+  while (Clock::now() < deadline) {
+    std::this_thread::yield();
+  };
+};
+
+::RS::FrameStats RS::FrameClock::getStats() {
+  FrameStats stats = {};
+  stats.frameCount = _frame_count;
+  stats.tickCount = _tick_count;
+  stats.missedTicks = _missed_ticks;
+  if (_history_count == 0) {
+    return stats;
+  };
+
+  _sorted.assign(_history.begin(), _history.begin() + _history_count);
+  std::sort(_sorted.begin(), _sorted.end());
+
+  double total = 0.0;
+  for (double ms : _sorted) {
+    total += ms;
+  };
+
+  stats.p50Ms = _sorted[(_sorted.size() - 1) / 2];
+  stats.p99Ms = _sorted[(_sorted.size() - 1) * 99 / 100];
+  stats.averageMs = total / (double)_sorted.size();
+  stats.maxMs = _sorted.back();
+  return stats;
+};
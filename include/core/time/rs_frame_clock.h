@@ -0,0 +1,62 @@
+#ifndef RS_FRAME_CLOCK_H
+#define RS_FRAME_CLOCK_H
+
+#include <chrono>
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+namespace RS {
+typedef std::chrono::steady_clock Clock;
+
+// Summary of the last frames recorded by a FrameClock
+struct FrameStats {
+  double p50Ms;
+  double p99Ms;
+  double averageMs;
+  double maxMs;
+  u_int64_t frameCount;  // Frames since start
+  u_int64_t tickCount;   // Fixed simulation ticks since start
+  u_int64_t missedTicks; // Ticks dropped because a frame took too long
+};
+
+// Measures frame times with a monotonic high resolution clock and keeps the
+// last historySize of them for percentile queries.
+class FrameClock {
+public:
+  // Constructor
+  FrameClock(size_t historySize = 512);
+
+  // Marks the start of a new frame and returns the previous frame's length
+  // in seconds
+  double beginFrame();
+
+  void recordTicks(u_int ticks, u_int64_t missed);
+
+  // Blocks until deadline. Sleeps while the deadline is further than
+  // spinThreshold away and busy waits the rest, OS sleeps alone overshoot
+  // by up to a scheduler quantum.
+  static void waitUntil(Clock::time_point deadline,
+                        std::chrono::microseconds spinThreshold);
+
+  inline Clock::time_point getFrameStart() const { return _frame_start; };
+
+  FrameStats getStats();
+
+private:
+  Clock::time_point _frame_start;
+  bool _started;
+
+  // Ring buffer of frame times in milliseconds
+  std::vector<double> _history;
+  size_t _history_next;
+  size_t _history_count;
+  std::vector<double> _sorted; // Scratch space for percentiles
+
+  u_int64_t _frame_count;
+  u_int64_t _tick_count;
+  u_int64_t _missed_ticks;
+};
+} // namespace RS
+
+#endif // !RS_FRAME_CLOCK_H
@@ -1,7 +1,7 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
-#include "classes/entity.hpp"
+#include "rs_culling.h"
 #include <GL/gl.h>
 #include <glm/ext/vector_float3.hpp>
 #include <glm/glm.hpp>
@@ -16,11 +16,14 @@ const float DEFAULT_CAMERA_FOV = 90.0f;
 const float DEFAULT_YAW = -90.0f;
 const float DEFAULT_PITCH = 0.0f;
 const float DEFAULT_CAMERA_SENSITIVITY = 0.1f;
+const float DEFAULT_ASPECT_RATIO = 16.0f / 9.0f;
+const float DEFAULT_NEAR_PLANE = 0.1f;
+const float DEFAULT_FAR_PLANE = 100.0f;
 
-class Camera : public Entity {
+class Camera {
 public:
   // Camera attributes
-  // Inherits Position from Entity
+  glm::vec3 Position;
   glm::vec3 Front;
   glm::vec3 Up;
   glm::vec3 Right;
@@ -33,14 +36,19 @@ public:
   // Camera options
   float MoveSpeed;
   float CameraSensitivity;
-  float FOV;
+  float FOV; // Vertical, in degrees
+  float AspectRatio;
+  float NearPlane;
+  float FarPlane;
 
   // Constructors
   Camera(glm::vec3 position = DEFAULT_POSITION,
          glm::vec3 worldUp = DEFAULT_WORLD_UP, float yaw = DEFAULT_YAW,
          float pitch = DEFAULT_PITCH)
       : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MoveSpeed(DEFAULT_MOVE_SPEED),
-        CameraSensitivity(DEFAULT_CAMERA_SENSITIVITY), FOV(DEFAULT_CAMERA_FOV) {
+        CameraSensitivity(DEFAULT_CAMERA_SENSITIVITY), FOV(DEFAULT_CAMERA_FOV),
+        AspectRatio(DEFAULT_ASPECT_RATIO), NearPlane(DEFAULT_NEAR_PLANE),
+        FarPlane(DEFAULT_FAR_PLANE), _cache_valid(false) {
     Position = position;
     WorldUp = worldUp;
     Yaw = yaw;
@@ -48,8 +56,9 @@ public:
     updateCameraVectors();
   }
 
-  Camera(glm::vec3 position, float moveSpeed, float cameraSensitivity) {
-    Position = position;
+  // Default orientation and lens, only the speeds differ
+  Camera(glm::vec3 position, float moveSpeed, float cameraSensitivity)
+      : Camera(position) {
     MoveSpeed = moveSpeed;
     CameraSensitivity = cameraSensitivity;
   }
@@ -96,11 +105,81 @@ public:
     updateCameraVectors();
   }
 
-  glm::mat4 GetViewMatrix() {
-    return glm::lookAt(Position, Position + Front, Up);
+  // The matrices and frustum are cached and only rebuilt when something
+  // they depend on changed since the last call
+  const glm::mat4 &GetViewMatrix() {
+    updateCache();
+    return _view;
+  }
+
+  const glm::mat4 &GetProjectionMatrix() {
+    updateCache();
+    return _projection;
+  }
+
+  const glm::mat4 &GetViewProjectionMatrix() {
+    updateCache();
+    return _view_projection;
+  }
+
+  const RS::Frustum &GetFrustum() {
+    updateCache();
+    return _frustum;
+  }
+
+  void SetAspectRatio(int width, int height) {
+    if (height > 0) {
+      AspectRatio = (float)width / (float)height;
+    }
   }
 
 private:
+  // Cached state, compared against the public members instead of a dirty
+  // flag so direct writes to Position or FOV are picked up as well
+  bool _cache_valid;
+  glm::vec3 _cached_position;
+  glm::vec3 _cached_front;
+  glm::vec3 _cached_up;
+  float _cached_fov;
+  float _cached_aspect_ratio;
+  float _cached_near_plane;
+  float _cached_far_plane;
+
+  glm::mat4 _view;
+  glm::mat4 _projection;
+  glm::mat4 _view_projection;
+  RS::Frustum _frustum;
+
+  void updateCache() {
+    bool viewChanged = !_cache_valid || Position != _cached_position ||
+                       Front != _cached_front || Up != _cached_up;
+    bool projectionChanged =
+        !_cache_valid || FOV != _cached_fov ||
+        AspectRatio != _cached_aspect_ratio || NearPlane != _cached_near_plane ||
+        FarPlane != _cached_far_plane;
+    if (!viewChanged && !projectionChanged) {
+      return;
+    }
+
+    if (viewChanged) {
+      _view = glm::lookAt(Position, Position + Front, Up);
+      _cached_position = Position;
+      _cached_front = Front;
+      _cached_up = Up;
+    }
+    if (projectionChanged) {
+      _projection = glm::perspective(glm::radians(FOV), AspectRatio, NearPlane,
+                                     FarPlane);
+      _cached_fov = FOV;
+      _cached_aspect_ratio = AspectRatio;
+      _cached_near_plane = NearPlane;
+      _cached_far_plane = FarPlane;
+    }
+    _view_projection = _projection * _view;
+    _frustum = RS::Frustum::fromMatrix(_view_projection);
+    _cache_valid = true;
+  }
+
   void updateCameraVectors() {
     // calculate the new Front vector
     glm::vec3 front;
@@ -3,6 +3,8 @@
 
 #include <glm/glm.hpp>
 
+// Object layout from before the ECS, see rs_registry.h. Nothing in the
+// game derives from it anymore, bench_ecs keeps it as its baseline.
 class Entity {
 public:
   // Coordinates of the entity in the world
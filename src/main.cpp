@@ -1,28 +1,150 @@
+#include "classes/camera.hpp"
 #include "core/engine.h"
-#include <GL/gl.h>
-#include <SDL3/SDL_events.h>
-#include <SDL3/SDL_scancode.h>
-#include <SDL3/SDL_video.h>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef REDSTAR_SHADER_DIR
+#define REDSTAR_SHADER_DIR "include/core/shaders"
+#endif
 
 void Update() {}
 
-int main(int argc, char *argv[]) {
-  RS::Engine *engine = new RS::Engine(0, 1, 0);
-
-  bool exit = false;
-  SDL_Event event;
-  while (!exit) {
-    while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_EVENT_KEY_DOWN &&
-          event.key.scancode == SDL_SCANCODE_ESCAPE) {
-        exit = true;
+// --headless              render offscreen, no display needed
+// --deterministic         one simulation tick per frame
+// --render-thread         submit and swap on a thread of its own
+// --occlusion-culling     skip opaque draws hidden in last frame's depth
+// --dynamic-resolution    scale the render size to hold a GPU budget
+// --gpu-budget MS         that budget, 15 ms by default
+// --frames N              exit after N frames
+// --size WxH              window or offscreen target size
+// --capture N             write frame N out, can be repeated
+// --capture-dir DIR       where captured frames go
+// --raw                   capture raw RGBA8 instead of PNG
+// --shader-manifest PATH  build the shader variants listed in PATH up front
+// --record-shaders        write the variants used into the manifest instead
+static bool parseArgs(int argc, char *argv[], RS::EngineConfig &config) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(arg, "--headless") == 0) {
+      config.window.headless = true;
+    } else if (std::strcmp(arg, "--deterministic") == 0) {
+      config.deterministic = true;
+    } else if (std::strcmp(arg, "--render-thread") == 0) {
+      config.renderThread = true;
+    } else if (std::strcmp(arg, "--occlusion-culling") == 0) {
+      config.occlusionCulling = true;
+    } else if (std::strcmp(arg, "--dynamic-resolution") == 0) {
+      config.dynamicResolution.enabled = true;
+    } else if (std::strcmp(arg, "--raw") == 0) {
+      config.captureRaw = true;
+    } else if (std::strcmp(arg, "--record-shaders") == 0) {
+      config.recordShaderManifest = true;
+    } else if (std::strcmp(arg, "--shader-manifest") == 0 && hasValue) {
+      config.shaderManifest = argv[++i];
+    } else if (std::strcmp(arg, "--gpu-budget") == 0 && hasValue) {
+      config.dynamicResolution.targetGpuMs = std::strtod(argv[++i], NULL);
+    } else if (std::strcmp(arg, "--frames") == 0 && hasValue) {
+      config.maxFrames = std::strtoull(argv[++i], NULL, 10);
+    } else if (std::strcmp(arg, "--capture") == 0 && hasValue) {
+      config.captureFrames.push_back(std::strtoull(argv[++i], NULL, 10));
+    } else if (std::strcmp(arg, "--capture-dir") == 0 && hasValue) {
+      config.captureDirectory = argv[++i];
+    } else if (std::strcmp(arg, "--size") == 0 && hasValue) {
+      if (std::sscanf(argv[++i], "%dx%d", &config.window.width,
+                      &config.window.height) != 2) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "BAD SIZE: %s\n", argv[i]);
+        return false;
       };
+    } else {
+      SDL_LogError(SDL_LOG_CATEGORY_ERROR, "UNKNOWN ARGUMENT: %s\n", arg);
+      return false;
     };
+  };
+  return true;
+};
+
+int main(int argc, char *argv[]) {
+  RS::EngineConfig config;
+  if (!parseArgs(argc, argv, config)) {
+    return 1;
+  };
+
+  RS::Engine *engine = new RS::Engine(0, 1, 0, config);
 
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+  Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+  engine->setCamera(&camera);
 
-    SDL_GL_SwapWindow(engine->getWindow());
+  // The forward variants the scene draws with, requested through the
+  // library so --record-shaders writes them into the manifest
+  RS::ShaderPermutations *forward = engine->getShaderLibrary()->load(
+      REDSTAR_SHADER_DIR "/vert/forward.vert",
+      REDSTAR_SHADER_DIR "/frag/forward.frag");
+  if (forward != NULL) {
+    forward->request(RS::ShaderFeatures<RS::RS_SHADER_INSTANCED,
+                                        RS::RS_SHADER_LIT>::key);
+    forward->request(
+        RS::ShaderFeatures<RS::RS_SHADER_INSTANCED, RS::RS_SHADER_TEXTURED,
+                           RS::RS_SHADER_LIT>::key);
+  };
+
+  engine->run();
+
+  RS::FrameStats stats = engine->getFrameStats();
+  SDL_Log("frames: %llu, p50: %.3f ms, p99: %.3f ms, missed ticks: %llu\n",
+          (unsigned long long)stats.frameCount, stats.p50Ms, stats.p99Ms,
+          (unsigned long long)stats.missedTicks);
+  if (config.renderThread) {
+    RS::RenderThreadStats render = engine->getRenderThreadStats();
+    SDL_Log("main build: %.3f ms, handoff wait: %.3f ms, render submit: %.3f "
+            "ms, render idle: %.3f ms\n",
+            render.buildMs, render.handoffMs, render.submitMs, render.idleMs);
+  };
+  RS::LodStats lods = engine->getLodStats();
+  SDL_Log("last frame: %u triangles, %u vertex shader runs, %u draws on a "
+          "LOD saved %u triangles and %u vertex shader runs\n",
+          lods.triangles, lods.vertexInvocations, lods.coarser,
+          lods.trianglesSaved, lods.vertexInvocationsSaved);
+  if (config.occlusionCulling) {
+    RS::OcclusionStats occlusion = engine->getOcclusionStats();
+    SDL_Log("occlusion culling: %u of %u instances drawn\n",
+            occlusion.visible, occlusion.tested);
+  };
+  RS::LightClusterStats lights = engine->getLightClusterStats();
+  if (lights.lights > 0) {
+    SDL_Log("lights: %u of %u visible, %u in the busiest cluster, binned in "
+            "%.3f ms\n",
+            lights.visibleLights, lights.lights, lights.maxPerCluster,
+            lights.buildMs);
+  };
+  if (config.dynamicResolution.enabled) {
+    RS::DynamicResolutionStats resolution =
+        engine->getDynamicResolutionStats();
+    SDL_Log("dynamic resolution: scale %.2f (%dx%d), scene GPU time %.3f ms, "
+            "%llu scale changes\n",
+            resolution.scale, resolution.renderWidth, resolution.renderHeight,
+            resolution.gpuMs, (unsigned long long)resolution.scaleChanges);
+  };
+  RS::InputLatencyStats latency = engine->getInputLatencyStats();
+  SDL_Log("input to submit p50: %.3f ms, p99: %.3f ms, max: %.3f ms over %llu "
+          "frames, %llu events latched late\n",
+          latency.p50Ms, latency.p99Ms, latency.maxMs,
+          (unsigned long long)latency.frames,
+          (unsigned long long)latency.lateEvents);
+  if (RS::heapTrackingEnabled()) {
+    SDL_Log("steady state heap allocations: %llu\n",
+            (unsigned long long)engine->getSteadyStateAllocations());
+  };
+  SDL_Log("frame arena peak: %zu of %zu bytes, %llu heap fallbacks\n",
+          engine->getFrameArena().current().getPeak(),
+          engine->getFrameArena().current().getCapacity(),
+          (unsigned long long)engine->getFrameResource().getFallbacks());
+  for (int tag = 0; tag < RS::MEM_TAG_COUNT; tag++) {
+    RS::MemoryStats memory = RS::getMemoryStats((RS::MemoryTag)tag);
+    SDL_Log("memory %-8s live: %llu bytes, allocations: %llu\n",
+            RS::getMemoryTagName((RS::MemoryTag)tag),
+            (unsigned long long)memory.bytesLive,
+            (unsigned long long)memory.allocations);
   };
 
   delete engine;
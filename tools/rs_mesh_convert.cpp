@@ -0,0 +1,809 @@
+#include "rs_mesh_file.h"
+#include "rs_mesh_format.h"
+#include "rs_mesh_optimize.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Offline converter from Wavefront OBJ and glTF 2.0 (.gltf or .glb) to the
+// engine's .rsmesh format.
+//
+//   rs_mesh_convert [--lods N] [--lod-error E] [--no-optimize]
+//                   <input.obj|input.gltf|input.glb> <output.rsmesh>
+//
+// OBJ: every usemtl/o/g starts a new submesh, faces are triangulated as
+// fans. glTF: every triangle primitive becomes a submesh with its material
+// index, node transforms are not applied. Both only keep positions and the
+// first texture coordinate set, which is all main.vert reads.
+//
+// Each submesh is reordered for the post transform cache and then for
+// overdraw, and gets up to N (default 4) simplified LODs, each about half
+// the triangles of the one before. A LOD is dropped once it saves less
+// than 10% or would deviate more than E from the full mesh, by default 5%
+// of the mesh's bounding box diagonal. Vertices are reordered for fetch
+// locality last.
+
+namespace {
+struct Mesh {
+  std::vector<RS::Vertex> vertices;
+  std::vector<u_int32_t> indices;
+  std::vector<RS::MeshFileSubmesh> submeshes;
+  std::vector<RS::MeshFileLod> lods;
+};
+
+bool readFile(const std::string &path, std::string &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  out = stream.str();
+  return true;
+};
+
+std::string directoryOf(const std::string &path) {
+  size_t slash = path.find_last_of('/');
+  return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+};
+
+bool endsWith(const std::string &text, const char *suffix) {
+  size_t length = std::strlen(suffix);
+  return text.size() >= length &&
+         text.compare(text.size() - length, length, suffix) == 0;
+};
+
+// Fills the bounds of every submesh from the vertices it references
+void computeBounds(Mesh &mesh) {
+  for (RS::MeshFileSubmesh &submesh : mesh.submeshes) {
+    for (int axis = 0; axis < 3; axis++) {
+      submesh.bounds.min[axis] = 0.0f;
+      submesh.bounds.max[axis] = 0.0f;
+    }
+    for (u_int i = 0; i < submesh.indexCount; i++) {
+      const RS::Vertex &vertex =
+          mesh.vertices[submesh.baseVertex +
+                        mesh.indices[submesh.firstIndex + i]];
+      for (int axis = 0; axis < 3; axis++) {
+        float value = vertex.position[axis];
+        if (i == 0 || value < submesh.bounds.min[axis]) {
+          submesh.bounds.min[axis] = value;
+        }
+        if (i == 0 || value > submesh.bounds.max[axis]) {
+          submesh.bounds.max[axis] = value;
+        }
+      }
+    }
+  };
+};
+
+// OBJ
+
+// Resolves a 1 based or negative relative OBJ index, -1 if absent/invalid
+long objIndex(const char *text, size_t count) {
+  if (*text == '\0') {
+    return -1;
+  }
+  long index = std::strtol(text, NULL, 10);
+  if (index < 0) {
+    index += (long)count;
+  } else {
+    index -= 1;
+  }
+  return index >= 0 && (size_t)index < count ? index : -1;
+};
+
+bool loadObj(const std::string &path, Mesh &mesh) {
+  std::ifstream file(path);
+  if (!file) {
+    std::fprintf(stderr, "could not open %s\n", path.c_str());
+    return false;
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texCoords;
+  // (position, texcoord) -> vertex, shares corners between faces
+  std::unordered_map<u_int64_t, u_int32_t> corners;
+  std::unordered_map<std::string, u_int32_t> materials;
+  u_int32_t material = 0;
+
+  auto startSubmesh = [&]() {
+    if (!mesh.submeshes.empty() && mesh.submeshes.back().indexCount == 0) {
+      mesh.submeshes.back().material = material;
+      return;
+    }
+    RS::MeshFileSubmesh submesh = {};
+    submesh.firstIndex = (u_int32_t)mesh.indices.size();
+    submesh.material = material;
+    mesh.submeshes.push_back(submesh);
+  };
+  startSubmesh();
+
+  std::string line;
+  std::vector<u_int32_t> face;
+  size_t lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    std::istringstream stream(line);
+    std::string keyword;
+    stream >> keyword;
+
+    if (keyword == "v") {
+      glm::vec3 position(0.0f);
+      stream >> position.x >> position.y >> position.z;
+      positions.push_back(position);
+    } else if (keyword == "vt") {
+      glm::vec2 texCoord(0.0f);
+      stream >> texCoord.x >> texCoord.y;
+      texCoords.push_back(texCoord);
+    } else if (keyword == "usemtl") {
+      std::string name;
+      stream >> name;
+      auto found = materials.emplace(name, (u_int32_t)materials.size());
+      material = found.first->second;
+      startSubmesh();
+    } else if (keyword == "o" || keyword == "g") {
+      startSubmesh();
+    } else if (keyword == "f") {
+      face.clear();
+      std::string corner;
+      while (stream >> corner) {
+        // v, v/vt, v//vn or v/vt/vn
+        size_t slash = corner.find('/');
+        long position = objIndex(corner.substr(0, slash).c_str(),
+                                 positions.size());
+        long texCoord = -1;
+        if (slash != std::string::npos) {
+          size_t next = corner.find('/', slash + 1);
+          texCoord = objIndex(
+              corner.substr(slash + 1, next == std::string::npos
+                                           ? std::string::npos
+                                           : next - slash - 1)
+                  .c_str(),
+              texCoords.size());
+        }
+        if (position < 0) {
+          std::fprintf(stderr, "%s:%zu: bad face index\n", path.c_str(),
+                       lineNumber);
+          return false;
+        }
+
+        u_int64_t key = ((u_int64_t)position << 32) | (u_int32_t)texCoord;
+        auto found = corners.find(key);
+        if (found == corners.end()) {
+          RS::Vertex vertex;
+          vertex.position = positions[position];
+          vertex.texCoord =
+              texCoord >= 0 ? texCoords[texCoord] : glm::vec2(0.0f);
+          found = corners.emplace(key, (u_int32_t)mesh.vertices.size()).first;
+          mesh.vertices.push_back(vertex);
+        }
+        face.push_back(found->second);
+      }
+
+      for (size_t i = 2; i < face.size(); i++) {
+        mesh.indices.push_back(face[0]);
+        mesh.indices.push_back(face[i - 1]);
+        mesh.indices.push_back(face[i]);
+        mesh.submeshes.back().indexCount += 3;
+      }
+    }
+  };
+
+  if (!mesh.submeshes.empty() && mesh.submeshes.back().indexCount == 0) {
+    mesh.submeshes.pop_back();
+  }
+  return true;
+};
+
+// glTF
+
+// Just enough JSON for glTF: no escapes beyond the simple ones and numbers
+// are always doubles
+struct Json {
+  enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY,
+              JSON_OBJECT };
+  Type type = JSON_NULL;
+  double number = 0.0;
+  std::string string;
+  std::vector<Json> items;
+  std::vector<std::pair<std::string, Json>> members;
+
+  const Json *find(const char *key) const {
+    for (const auto &member : members) {
+      if (member.first == key) {
+        return &member.second;
+      }
+    }
+    return NULL;
+  };
+  double numberOr(const char *key, double fallback) const {
+    const Json *value = find(key);
+    return value != NULL && value->type == JSON_NUMBER ? value->number
+                                                       : fallback;
+  };
+};
+
+class JsonParser {
+public:
+  JsonParser(const char *begin, const char *end) : _at(begin), _end(end) {};
+
+  bool parse(Json &out) {
+    bool parsed = value(out);
+    skipSpace();
+    return parsed && _at == _end;
+  };
+
+private:
+  void skipSpace() {
+    while (_at < _end && (*_at == ' ' || *_at == '\n' || *_at == '\r' ||
+                          *_at == '\t' || *_at == '\0')) {
+      _at++;
+    }
+  };
+
+  bool literal(const char *text) {
+    size_t length = std::strlen(text);
+    if ((size_t)(_end - _at) < length || std::strncmp(_at, text, length) != 0) {
+      return false;
+    }
+    _at += length;
+    return true;
+  };
+
+  bool string(std::string &out) {
+    if (_at >= _end || *_at != '"') {
+      return false;
+    }
+    _at++;
+    while (_at < _end && *_at != '"') {
+      char c = *_at++;
+      if (c == '\\' && _at < _end) {
+        c = *_at++;
+        switch (c) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': // Not needed for anything we read, keep a placeholder
+          _at += (_end - _at) >= 4 ? 4 : (_end - _at);
+          c = '?';
+          break;
+        default: break;
+        }
+      }
+      out.push_back(c);
+    }
+    if (_at >= _end) {
+      return false;
+    }
+    _at++;
+    return true;
+  };
+
+  bool value(Json &out) {
+    skipSpace();
+    if (_at >= _end) {
+      return false;
+    }
+
+    switch (*_at) {
+    case '{': {
+      out.type = Json::JSON_OBJECT;
+      _at++;
+      skipSpace();
+      if (_at < _end && *_at == '}') {
+        _at++;
+        return true;
+      }
+      for (;;) {
+        skipSpace();
+        std::pair<std::string, Json> member;
+        if (!string(member.first)) {
+          return false;
+        }
+        skipSpace();
+        if (_at >= _end || *_at++ != ':' || !value(member.second)) {
+          return false;
+        }
+        out.members.push_back(std::move(member));
+        skipSpace();
+        if (_at < _end && *_at == ',') {
+          _at++;
+          continue;
+        }
+        return _at < _end && *_at++ == '}';
+      }
+    }
+    case '[': {
+      out.type = Json::JSON_ARRAY;
+      _at++;
+      skipSpace();
+      if (_at < _end && *_at == ']') {
+        _at++;
+        return true;
+      }
+      for (;;) {
+        out.items.emplace_back();
+        if (!value(out.items.back())) {
+          return false;
+        }
+        skipSpace();
+        if (_at < _end && *_at == ',') {
+          _at++;
+          continue;
+        }
+        return _at < _end && *_at++ == ']';
+      }
+    }
+    case '"':
+      out.type = Json::JSON_STRING;
+      return string(out.string);
+    case 't':
+      out.type = Json::JSON_BOOL;
+      out.number = 1.0;
+      return literal("true");
+    case 'f':
+      out.type = Json::JSON_BOOL;
+      return literal("false");
+    case 'n':
+      return literal("null");
+    default: {
+      std::string number(_at, (size_t)(_end - _at) < 64 ? _end : _at + 64);
+      char *parsedEnd = NULL;
+      out.type = Json::JSON_NUMBER;
+      out.number = std::strtod(number.c_str(), &parsedEnd);
+      if (parsedEnd == number.c_str()) {
+        return false;
+      }
+      _at += parsedEnd - number.c_str();
+      return true;
+    }
+    }
+  };
+
+  const char *_at;
+  const char *_end;
+};
+
+bool decodeBase64(const std::string &text, size_t start, std::string &out) {
+  auto sextet = [](char c) -> int {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+  };
+
+  u_int32_t bits = 0;
+  int count = 0;
+  for (size_t i = start; i < text.size() && text[i] != '='; i++) {
+    int value = sextet(text[i]);
+    if (value < 0) {
+      return false;
+    }
+    bits = (bits << 6) | (u_int32_t)value;
+    count += 6;
+    if (count >= 8) {
+      count -= 8;
+      out.push_back((char)((bits >> count) & 0xFF));
+    }
+  }
+  return true;
+};
+
+// Typed view of a glTF accessor
+struct Accessor {
+  const unsigned char *data;
+  size_t count;
+  size_t stride;
+  int componentType;
+  int components;
+  bool normalized;
+
+  float component(size_t element, int index) const {
+    const unsigned char *at = data + element * stride;
+    switch (componentType) {
+    case 5126: { // FLOAT
+      float value;
+      std::memcpy(&value, at + index * 4, 4);
+      return value;
+    }
+    case 5121: { // UNSIGNED_BYTE
+      float value = at[index];
+      return normalized ? value / 255.0f : value;
+    }
+    case 5123: { // UNSIGNED_SHORT
+      u_int16_t value;
+      std::memcpy(&value, at + index * 2, 2);
+      return normalized ? value / 65535.0f : (float)value;
+    }
+    default:
+      return 0.0f;
+    }
+  };
+
+  u_int32_t index(size_t element) const {
+    const unsigned char *at = data + element * stride;
+    switch (componentType) {
+    case 5121:
+      return *at;
+    case 5123: {
+      u_int16_t value;
+      std::memcpy(&value, at, 2);
+      return value;
+    }
+    case 5125: {
+      u_int32_t value;
+      std::memcpy(&value, at, 4);
+      return value;
+    }
+    default:
+      return 0;
+    }
+  };
+};
+
+bool getAccessor(const Json &root, const std::vector<std::string> &buffers,
+                 size_t accessorIndex, Accessor &out) {
+  const Json *accessors = root.find("accessors");
+  const Json *views = root.find("bufferViews");
+  if (accessors == NULL || views == NULL ||
+      accessorIndex >= accessors->items.size()) {
+    return false;
+  }
+  const Json &accessor = accessors->items[accessorIndex];
+  size_t viewIndex = (size_t)accessor.numberOr("bufferView", -1.0);
+  if (viewIndex >= views->items.size()) {
+    return false; // Sparse or empty accessors are not supported
+  }
+  const Json &view = views->items[viewIndex];
+  size_t bufferIndex = (size_t)view.numberOr("buffer", -1.0);
+  if (bufferIndex >= buffers.size()) {
+    return false;
+  }
+
+  const Json *type = accessor.find("type");
+  std::string typeName = type != NULL ? type->string : "";
+  out.components = typeName == "SCALAR" ? 1
+                   : typeName == "VEC2" ? 2
+                   : typeName == "VEC3" ? 3
+                   : typeName == "VEC4" ? 4
+                                        : 0;
+  out.componentType = (int)accessor.numberOr("componentType", 0.0);
+  size_t componentSize = out.componentType == 5126 || out.componentType == 5125
+                             ? 4
+                         : out.componentType == 5123 ? 2
+                                                     : 1;
+  out.count = (size_t)accessor.numberOr("count", 0.0);
+  out.stride = (size_t)view.numberOr("byteStride", 0.0);
+  if (out.stride == 0) {
+    out.stride = componentSize * out.components;
+  }
+  const Json *normalized = accessor.find("normalized");
+  out.normalized = normalized != NULL && normalized->number != 0.0;
+
+  size_t offset = (size_t)view.numberOr("byteOffset", 0.0) +
+                  (size_t)accessor.numberOr("byteOffset", 0.0);
+  const std::string &buffer = buffers[bufferIndex];
+  if (out.components == 0 || out.count == 0 ||
+      offset + (out.count - 1) * out.stride + componentSize * out.components >
+          buffer.size()) {
+    return false;
+  }
+  out.data = (const unsigned char *)buffer.data() + offset;
+  return true;
+};
+
+bool loadGltf(const std::string &path, Mesh &mesh) {
+  std::string contents;
+  if (!readFile(path, contents)) {
+    std::fprintf(stderr, "could not open %s\n", path.c_str());
+    return false;
+  }
+
+  // .glb: 12 byte header, JSON chunk, optional BIN chunk
+  std::string jsonText;
+  std::string binaryChunk;
+  bool binary = contents.size() >= 12 && contents.compare(0, 4, "glTF") == 0;
+  if (binary) {
+    size_t offset = 12;
+    while (offset + 8 <= contents.size()) {
+      u_int32_t length;
+      u_int32_t type;
+      std::memcpy(&length, contents.data() + offset, 4);
+      std::memcpy(&type, contents.data() + offset + 4, 4);
+      if (offset + 8 + length > contents.size()) {
+        break;
+      }
+      if (type == 0x4E4F534Au) { // JSON
+        jsonText = contents.substr(offset + 8, length);
+      } else if (type == 0x004E4942u) { // BIN
+        binaryChunk = contents.substr(offset + 8, length);
+      }
+      offset += 8 + length;
+    }
+  } else {
+    jsonText = contents;
+  }
+
+  Json root;
+  JsonParser parser(jsonText.data(), jsonText.data() + jsonText.size());
+  if (!parser.parse(root) || root.type != Json::JSON_OBJECT) {
+    std::fprintf(stderr, "%s: invalid glTF JSON\n", path.c_str());
+    return false;
+  }
+
+  std::vector<std::string> buffers;
+  if (const Json *bufferList = root.find("buffers")) {
+    for (const Json &buffer : bufferList->items) {
+      const Json *uri = buffer.find("uri");
+      buffers.emplace_back();
+      if (uri == NULL) {
+        buffers.back() = binaryChunk;
+      } else if (uri->string.compare(0, 5, "data:") == 0) {
+        size_t comma = uri->string.find(',');
+        if (comma == std::string::npos ||
+            !decodeBase64(uri->string, comma + 1, buffers.back())) {
+          std::fprintf(stderr, "%s: bad data URI\n", path.c_str());
+          return false;
+        }
+      } else if (!readFile(directoryOf(path) + uri->string, buffers.back())) {
+        std::fprintf(stderr, "could not open buffer %s\n",
+                     uri->string.c_str());
+        return false;
+      }
+    }
+  }
+
+  const Json *meshes = root.find("meshes");
+  if (meshes == NULL) {
+    std::fprintf(stderr, "%s: no meshes\n", path.c_str());
+    return false;
+  }
+
+  for (const Json &gltfMesh : meshes->items) {
+    const Json *primitives = gltfMesh.find("primitives");
+    if (primitives == NULL) {
+      continue;
+    }
+    for (const Json &primitive : primitives->items) {
+      if (primitive.numberOr("mode", 4.0) != 4.0) {
+        continue; // Only triangle lists
+      }
+      const Json *attributes = primitive.find("attributes");
+      Accessor positions;
+      if (attributes == NULL ||
+          !getAccessor(root, buffers,
+                       (size_t)attributes->numberOr("POSITION", -1.0),
+                       positions) ||
+          positions.components != 3) {
+        std::fprintf(stderr, "%s: primitive without usable POSITION\n",
+                     path.c_str());
+        return false;
+      }
+      Accessor texCoords;
+      bool hasTexCoords =
+          getAccessor(root, buffers,
+                      (size_t)attributes->numberOr("TEXCOORD_0", -1.0),
+                      texCoords) &&
+          texCoords.components == 2 && texCoords.count == positions.count;
+
+      RS::MeshFileSubmesh submesh = {};
+      submesh.firstIndex = (u_int32_t)mesh.indices.size();
+      submesh.baseVertex = (int32_t)mesh.vertices.size();
+      submesh.material = (u_int32_t)primitive.numberOr("material", 0.0);
+
+      for (size_t i = 0; i < positions.count; i++) {
+        RS::Vertex vertex;
+        vertex.position = glm::vec3(positions.component(i, 0),
+                                    positions.component(i, 1),
+                                    positions.component(i, 2));
+        // glTF puts the texture origin top left, GL bottom left
+        vertex.texCoord = hasTexCoords
+                              ? glm::vec2(texCoords.component(i, 0),
+                                          1.0f - texCoords.component(i, 1))
+                              : glm::vec2(0.0f);
+        mesh.vertices.push_back(vertex);
+      }
+
+      Accessor indices;
+      if (getAccessor(root, buffers,
+                      (size_t)primitive.numberOr("indices", -1.0), indices)) {
+        for (size_t i = 0; i < indices.count; i++) {
+          mesh.indices.push_back(indices.index(i));
+        }
+      } else {
+        for (size_t i = 0; i < positions.count; i++) {
+          mesh.indices.push_back((u_int32_t)i);
+        }
+      }
+      submesh.indexCount = (u_int32_t)mesh.indices.size() - submesh.firstIndex;
+      mesh.submeshes.push_back(submesh);
+    }
+  }
+  return true;
+};
+
+// Optimization and LODs
+
+// Submesh indices relative to vertex 0, the optimizations work on the
+// whole vertex array
+void absoluteIndices(Mesh &mesh) {
+  for (RS::MeshFileSubmesh &submesh : mesh.submeshes) {
+    for (u_int i = 0; i < submesh.indexCount; i++) {
+      mesh.indices[submesh.firstIndex + i] += (u_int32_t)submesh.baseVertex;
+    }
+    submesh.baseVertex = 0;
+  };
+};
+
+void optimizeMesh(Mesh &mesh, u_int maxLods, float lodError) {
+  const size_t vertexCount = mesh.vertices.size();
+  RS::VertexCacheStats before = RS::analyzeVertexCache(
+      mesh.indices.data(), mesh.indices.size(), vertexCount);
+
+  // LOD ranges go after every full detail range
+  std::vector<u_int32_t> lodIndices;
+  std::vector<u_int32_t> simplified;
+  for (RS::MeshFileSubmesh &submesh : mesh.submeshes) {
+    u_int32_t *indices = mesh.indices.data() + submesh.firstIndex;
+    RS::optimizeVertexCache(indices, submesh.indexCount, vertexCount);
+    RS::optimizeOverdraw(indices, submesh.indexCount, mesh.vertices.data(),
+                         vertexCount);
+
+    submesh.firstLod = (u_int32_t)mesh.lods.size();
+    submesh.lodCount = 0;
+    size_t previous = submesh.indexCount;
+    simplified.resize(submesh.indexCount);
+    for (u_int level = 1; level <= maxLods; level++) {
+      // Always from the full mesh, errors do not pile up level by level
+      const size_t target = (submesh.indexCount >> level) / 3 * 3;
+      float error = 0.0f;
+      size_t count = RS::simplifyMesh(simplified.data(), indices,
+                                      submesh.indexCount,
+                                      mesh.vertices.data(), vertexCount,
+                                      target, lodError, &error);
+      if (count == 0 || (float)count > (float)previous * 0.9f) {
+        break;
+      }
+      RS::optimizeVertexCache(simplified.data(), count, vertexCount);
+
+      RS::MeshFileLod lod = {};
+      lod.firstIndex = (u_int32_t)lodIndices.size();
+      lod.indexCount = (u_int32_t)count;
+      lod.error = error;
+      mesh.lods.push_back(lod);
+      lodIndices.insert(lodIndices.end(), simplified.begin(),
+                        simplified.begin() + count);
+      submesh.lodCount++;
+      previous = count;
+    }
+  };
+
+  for (RS::MeshFileLod &lod : mesh.lods) {
+    lod.firstIndex += (u_int32_t)mesh.indices.size();
+  };
+  const size_t fullIndexCount = mesh.indices.size();
+  mesh.indices.insert(mesh.indices.end(), lodIndices.begin(),
+                      lodIndices.end());
+
+  // Full detail first, so its vertices come first and stay together
+  size_t used = RS::optimizeVertexFetch(mesh.vertices.data(),
+                                        mesh.indices.data(),
+                                        mesh.indices.size(), vertexCount);
+  mesh.vertices.resize(used);
+
+  RS::VertexCacheStats after = RS::analyzeVertexCache(
+      mesh.indices.data(), fullIndexCount, mesh.vertices.size());
+  std::printf("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr,
+              after.acmr, before.atvr, after.atvr);
+  for (size_t i = 0; i < mesh.submeshes.size(); i++) {
+    const RS::MeshFileSubmesh &submesh = mesh.submeshes[i];
+    std::printf("  submesh %zu triangles %u", i, submesh.indexCount / 3);
+    for (u_int level = 0; level < submesh.lodCount; level++) {
+      const RS::MeshFileLod &lod = mesh.lods[submesh.firstLod + level];
+      std::printf(" %u (%.4g)", lod.indexCount / 3, lod.error);
+    }
+    std::printf("\n");
+  };
+};
+// What the runtime reports per draw, stored so loading never scans indices
+void countInvocations(Mesh &mesh) {
+  const size_t vertexCount = mesh.vertices.size();
+  for (RS::MeshFileSubmesh &submesh : mesh.submeshes) {
+    submesh.vertexInvocations =
+        RS::analyzeVertexCache(mesh.indices.data() + submesh.firstIndex,
+                               submesh.indexCount, vertexCount)
+            .invocations;
+    for (u_int level = 0; level < submesh.lodCount; level++) {
+      RS::MeshFileLod &lod = mesh.lods[submesh.firstLod + level];
+      lod.vertexInvocations =
+          RS::analyzeVertexCache(mesh.indices.data() + lod.firstIndex,
+                                 lod.indexCount, vertexCount)
+              .invocations;
+    }
+  };
+};
+} // namespace
+
+int main(int argc, char *argv[]) {
+  u_int maxLods = 4;
+  float lodError = -1.0f;
+  bool optimize = true;
+  int arg = 1;
+  for (; arg < argc && std::strncmp(argv[arg], "--", 2) == 0; arg++) {
+    if (std::strcmp(argv[arg], "--lods") == 0 && arg + 1 < argc) {
+      maxLods = (u_int)std::strtoul(argv[++arg], NULL, 10);
+    } else if (std::strcmp(argv[arg], "--lod-error") == 0 && arg + 1 < argc) {
+      lodError = std::strtof(argv[++arg], NULL);
+    } else if (std::strcmp(argv[arg], "--no-optimize") == 0) {
+      optimize = false;
+    } else {
+      break;
+    }
+  };
+  if (argc - arg != 2) {
+    std::fprintf(stderr,
+                 "usage: %s [--lods N] [--lod-error E] [--no-optimize] "
+                 "<input.obj|input.gltf|input.glb> <output.rsmesh>\n",
+                 argv[0]);
+    return 2;
+  };
+
+  const std::string input = argv[arg];
+  const char *output = argv[arg + 1];
+  Mesh mesh;
+  bool loaded = false;
+  if (endsWith(input, ".obj")) {
+    loaded = loadObj(input, mesh);
+  } else if (endsWith(input, ".gltf") || endsWith(input, ".glb")) {
+    loaded = loadGltf(input, mesh);
+  } else {
+    std::fprintf(stderr, "unsupported input format: %s\n", input.c_str());
+  };
+  if (!loaded) {
+    return 1;
+  };
+
+  computeBounds(mesh);
+  if (optimize) {
+    if (lodError < 0.0f) {
+      glm::vec3 low = mesh.vertices.empty() ? glm::vec3(0.0f)
+                                            : mesh.vertices[0].position;
+      glm::vec3 high = low;
+      for (const RS::Vertex &vertex : mesh.vertices) {
+        low = glm::min(low, vertex.position);
+        high = glm::max(high, vertex.position);
+      }
+      lodError = glm::length(high - low) * 0.05f;
+    }
+    absoluteIndices(mesh);
+    optimizeMesh(mesh, maxLods, lodError);
+  };
+  countInvocations(mesh);
+
+  if (!RS::MeshFile::write(output, mesh.vertices.data(),
+                           (u_int)mesh.vertices.size(), mesh.indices.data(),
+                           (u_int)mesh.indices.size(), mesh.submeshes.data(),
+                           (u_int)mesh.submeshes.size(), mesh.lods.data(),
+                           (u_int)mesh.lods.size())) {
+    return 1;
+  };
+
+  std::printf("%s: %zu vertices, %zu indices, %zu submeshes, %zu lods\n",
+              output, mesh.vertices.size(), mesh.indices.size(),
+              mesh.submeshes.size(), mesh.lods.size());
+  return 0;
+};
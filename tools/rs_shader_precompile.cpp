@@ -0,0 +1,78 @@
+#include "rs_shader_cache.h"
+#include "rs_shader_variants.h"
+#include <SDL3/SDL.h>
+#include <cstdio>
+#include <cstring>
+
+// Builds every shader variant in a manifest into the binary shader cache,
+// so the engine's first run on this machine starts warm.
+//
+//   rs_shader_precompile <manifest> [cache directory] [--headless]
+//
+// Program binaries only load on the driver that wrote them, so this runs
+// on the target machine, e.g. as an install step. A manifest comes from a
+// run with --record-shaders, see ShaderLibrary for the format.
+
+int main(int argc, char *argv[]) {
+  const char *manifest = NULL;
+  const char *cacheDirectory = "shader_cache";
+  bool headless = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (manifest == NULL) {
+      manifest = argv[i];
+    } else {
+      cacheDirectory = argv[i];
+    }
+  }
+  if (manifest == NULL) {
+    std::fprintf(stderr, "usage: %s <manifest> [cache directory] "
+                         "[--headless]\n",
+                 argv[0]);
+    return 1;
+  }
+
+  if (headless) {
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+  }
+  if (!SDL_InitSubSystem(SDL_INIT_VIDEO)) {
+    std::fprintf(stderr, "SDL video init failed: %s\n", SDL_GetError());
+    return 1;
+  }
+
+  // Same context request as the engine, binaries are tied to it
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+  SDL_Window *window = SDL_CreateWindow("rs_shader_precompile", 1, 1,
+                                        SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  SDL_GLContext context = NULL;
+  const int versions[2][2] = {{4, 6}, {4, 5}};
+  for (int i = 0; i < 2 && window != NULL && context == NULL; i++) {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, versions[i][0]);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, versions[i][1]);
+    context = SDL_GL_CreateContext(window);
+  }
+  if (context == NULL) {
+    std::fprintf(stderr, "GL context creation failed: %s\n", SDL_GetError());
+    return 1;
+  }
+
+  bool valid = true;
+  RS::ShaderCacheStats stats;
+  {
+    RS::ShaderCache cache(cacheDirectory, window);
+    RS::ShaderLibrary library(&cache);
+    valid = library.precompile(manifest);
+    cache.waitAll();
+    stats = cache.getStats();
+  }
+
+  std::printf("%u variants compiled, %u already cached, %u failed\n",
+              stats.binaryMisses - stats.failures, stats.binaryHits,
+              stats.failures);
+
+  SDL_GL_DestroyContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return valid && stats.failures == 0 ? 0 : 1;
+}